@@ -0,0 +1,539 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+/*
+   Throughput of the lexer, the parser, the compiler and the generated code over synthetic sources.
+   Compilation and execution are measured at every PSL_OptLevel, to weigh latency against throughput.
+   Results are written as a JSON document, one record per benchmark and source, to stdout or to the
+   file given with --output=<path>, so they can be compared between runs.
+
+   Options:
+       --quick             small sources and short runs, to check the benchmarks still work
+       --min-time=<s>      minimum time spent measuring each throughput, 0.2 by default
+       --samples=<n>       compilations measured for the latency percentiles, 50 by default
+       --elements=<n>      elements per execution, 1 << 20 by default
+       --threads=<n>       largest number of threads executions are spread over, all processors by default
+       --output=<path>
+*/
+
+#include "generator.h"
+
+#include "psl/context.h"
+#include "psl/profile.h"
+#include "psl/queue.h"
+
+#include "libromano/logger.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(PSL_WIN)
+#include <Windows.h>
+#else
+#include <unistd.h>
+#endif /* defined(PSL_WIN) */
+
+/* Executions are split in this many submissions per thread, to balance the workers */
+#define CHUNKS_PER_THREAD 4
+
+typedef struct {
+    double min_time;
+    uint32_t num_samples;
+    size_t num_elements;
+    uint32_t max_threads;
+    bool quick;
+    const char* output;
+} BenchOptions;
+
+typedef struct {
+    FILE* file;
+    uint32_t num_records;
+} BenchOutput;
+
+/* Sources swept by every benchmark, each parameter varies around 8 functions of depth 4 */
+static const GeneratorParams _sources[] = {
+    { 1, 4, 0.5f, 1 },
+    { 8, 4, 0.5f, 1 },
+    { 31, 4, 0.5f, 1 },
+    { 8, 2, 0.5f, 1 },
+    { 8, 6, 0.5f, 1 },
+    { 8, 4, 0.0f, 1 },
+    { 8, 4, 1.0f, 1 },
+};
+
+static const GeneratorParams _quick_sources[] = {
+    { 2, 2, 0.5f, 1 },
+    { 4, 3, 0.5f, 1 },
+};
+
+uint32_t num_processors(void)
+{
+#if defined(PSL_WIN)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+
+    return (uint32_t)info.dwNumberOfProcessors;
+#else
+    const long num_processors = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return num_processors > 0 ? (uint32_t)num_processors : 1;
+#endif /* defined(PSL_WIN) */
+}
+
+void bench_options_init(BenchOptions* options)
+{
+    options->min_time = 0.2;
+    options->num_samples = 50;
+    options->num_elements = 1 << 20;
+    options->max_threads = num_processors();
+    options->quick = false;
+    options->output = NULL;
+}
+
+bool bench_options_parse(BenchOptions* options, int argc, char** argv)
+{
+    for(int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+
+        if(strcmp(arg, "--quick") == 0)
+        {
+            options->quick = true;
+            options->min_time = 0.01;
+            options->num_samples = 5;
+            options->num_elements = 1 << 14;
+            options->max_threads = options->max_threads < 2 ? options->max_threads : 2;
+        }
+        else if(strncmp(arg, "--min-time=", 11) == 0)
+        {
+            options->min_time = atof(arg + 11);
+        }
+        else if(strncmp(arg, "--samples=", 10) == 0)
+        {
+            options->num_samples = (uint32_t)strtoul(arg + 10, NULL, 10);
+        }
+        else if(strncmp(arg, "--elements=", 11) == 0)
+        {
+            options->num_elements = (size_t)strtoull(arg + 11, NULL, 10);
+        }
+        else if(strncmp(arg, "--threads=", 10) == 0)
+        {
+            options->max_threads = (uint32_t)strtoul(arg + 10, NULL, 10);
+        }
+        else if(strncmp(arg, "--output=", 9) == 0)
+        {
+            options->output = arg + 9;
+        }
+        else
+        {
+            logger_log_error("Unknown option %s", arg);
+            return false;
+        }
+    }
+
+    if(options->num_samples == 0 || options->num_elements == 0 || options->max_threads == 0)
+    {
+        logger_log_error("Samples, elements and threads must be greater than 0");
+        return false;
+    }
+
+    return true;
+}
+
+/* Opens a record with the parameters of the source it measures, the caller adds its fields and closes it */
+void output_begin_record(BenchOutput* output, const char* benchmark, const GeneratorParams* params)
+{
+    fprintf(output->file,
+            "%s\n    {\"benchmark\":\"%s\",\"functions\":%u,\"depth\":%u,\"literal_density\":%.2f",
+            output->num_records == 0 ? "" : ",",
+            benchmark,
+            params->num_functions,
+            params->depth,
+            params->literal_density);
+
+    output->num_records++;
+}
+
+void output_end_record(BenchOutput* output)
+{
+    fprintf(output->file, "}");
+}
+
+double per_second(uint64_t count, uint64_t time_ns)
+{
+    return time_ns > 0 ? (double)count * 1e9 / (double)time_ns : 0.0;
+}
+
+int compare_u64(const void* a, const void* b)
+{
+    const uint64_t x = *(const uint64_t*)a;
+    const uint64_t y = *(const uint64_t*)b;
+
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+/* Nearest-rank percentile of sorted samples */
+uint64_t percentile(const uint64_t* samples, uint32_t num_samples, uint32_t p)
+{
+    const uint32_t rank = (p * num_samples + 99) / 100;
+
+    return samples[rank > 0 ? rank - 1 : 0];
+}
+
+Vector* lex_source(const char* source)
+{
+    Vector* tokens = vector_new(128, sizeof(PSL_Token));
+
+    PSL_Lexer lexer;
+    psl_lexer_init(&lexer, source);
+
+    if(!psl_lexer_lex(&lexer, tokens))
+    {
+        vector_free(tokens);
+        return NULL;
+    }
+
+    return tokens;
+}
+
+bool bench_lex(BenchOutput* output, const BenchOptions* options, const GeneratorParams* params, const char* source)
+{
+    const uint64_t min_time_ns = (uint64_t)(options->min_time * 1e9);
+
+    uint64_t num_iterations = 0;
+    uint64_t num_tokens = 0;
+    uint64_t time_ns = 0;
+
+    while(time_ns < min_time_ns || num_iterations == 0)
+    {
+        const uint64_t start_ns = psl_profile_now_ns();
+        Vector* tokens = lex_source(source);
+        time_ns += psl_profile_now_ns() - start_ns;
+
+        if(tokens == NULL)
+        {
+            logger_log_error("Cannot lex the generated source");
+            return false;
+        }
+
+        num_tokens += vector_size(tokens);
+        num_iterations++;
+
+        vector_free(tokens);
+    }
+
+    output_begin_record(output, "lex", params);
+    fprintf(output->file,
+            ",\"source_bytes\":%zu,\"tokens\":%llu,\"iterations\":%llu,\"time_ns\":%llu,\"tokens_per_s\":%.0f",
+            strlen(source),
+            (unsigned long long)(num_tokens / num_iterations),
+            (unsigned long long)num_iterations,
+            (unsigned long long)time_ns,
+            per_second(num_tokens, time_ns));
+    output_end_record(output);
+
+    return true;
+}
+
+bool bench_parse(BenchOutput* output, const BenchOptions* options, const GeneratorParams* params, Vector* tokens)
+{
+    const uint64_t min_time_ns = (uint64_t)(options->min_time * 1e9);
+
+    uint64_t num_iterations = 0;
+    uint64_t time_ns = 0;
+
+    /* Nodes are counted by a profiled parse, the timed ones are not recorded */
+    PSL_CompileStats stats;
+    PSL_AST* ast = psl_ast_new();
+
+    psl_profile_begin(&stats);
+    const bool success = psl_ast_from_tokens(ast, tokens);
+    psl_profile_end();
+
+    psl_ast_destroy(ast);
+
+    if(!success)
+    {
+        logger_log_error("Cannot parse the generated source");
+        return false;
+    }
+
+    while(time_ns < min_time_ns || num_iterations == 0)
+    {
+        ast = psl_ast_new();
+
+        const uint64_t start_ns = psl_profile_now_ns();
+        psl_ast_from_tokens(ast, tokens);
+        time_ns += psl_profile_now_ns() - start_ns;
+
+        psl_ast_destroy(ast);
+        num_iterations++;
+    }
+
+    output_begin_record(output, "parse", params);
+    fprintf(output->file,
+            ",\"nodes\":%llu,\"iterations\":%llu,\"time_ns\":%llu,\"nodes_per_s\":%.0f",
+            (unsigned long long)stats.num_nodes,
+            (unsigned long long)num_iterations,
+            (unsigned long long)time_ns,
+            per_second(stats.num_nodes * num_iterations, time_ns));
+    output_end_record(output);
+
+    return true;
+}
+
+/*
+   Returns the last kernel compiled, to be destroyed by the caller. With a context, its buffers are
+   reused by every compilation and the record is named compile_context
+*/
+PSL_Kernel* bench_compile(BenchOutput* output,
+                          const BenchOptions* options,
+                          const GeneratorParams* params,
+                          PSL_AST* ast,
+                          PSL_OptLevel opt_level,
+                          PSL_CompileContext* context)
+{
+    uint64_t* samples = (uint64_t*)malloc(options->num_samples * sizeof(uint64_t));
+    PSL_Kernel* kernel = NULL;
+
+    PSL_CompileOptions compile_options;
+    psl_compile_options_init(&compile_options);
+    compile_options.opt_level = opt_level;
+
+    PSL_EntryPoint entry_point;
+    entry_point.ast = ast;
+    entry_point.name = NULL;
+
+    for(uint32_t i = 0; i < options->num_samples; i++)
+    {
+        psl_kernel_destroy(kernel);
+        kernel = psl_kernel_new();
+
+        const uint64_t start_ns = psl_profile_now_ns();
+        const bool success = context != NULL ?
+                             psl_compile_context_compile_fused(context, kernel, &entry_point, 1, &compile_options) :
+                             psl_kernel_compile(kernel, ast, NULL, &compile_options);
+        samples[i] = psl_profile_now_ns() - start_ns;
+
+        if(!success)
+        {
+            logger_log_error("Cannot compile the generated source: %s", kernel->error);
+            psl_kernel_destroy(kernel);
+            free(samples);
+            return NULL;
+        }
+    }
+
+    qsort(samples, options->num_samples, sizeof(uint64_t), compare_u64);
+
+    output_begin_record(output, context != NULL ? "compile_context" : "compile", params);
+    fprintf(output->file,
+            ",\"opt_level\":%d,\"samples\":%u,\"code_size\":%zu,\"min_ns\":%llu,\"p50_ns\":%llu,\"p90_ns\":%llu,\"p99_ns\":%llu,\"max_ns\":%llu",
+            (int)opt_level,
+            options->num_samples,
+            kernel->code_size,
+            (unsigned long long)samples[0],
+            (unsigned long long)percentile(samples, options->num_samples, 50),
+            (unsigned long long)percentile(samples, options->num_samples, 90),
+            (unsigned long long)percentile(samples, options->num_samples, 99),
+            (unsigned long long)samples[options->num_samples - 1]);
+    output_end_record(output);
+
+    free(samples);
+
+    return kernel;
+}
+
+/* Executes the kernel over count elements split in submissions of chunk_size elements, and waits for them */
+void execute_chunks(PSL_Queue* queue, PSL_Kernel* kernel, float* x, float* y, float* out, float* s, size_t count, size_t chunk_size)
+{
+    PSL_Fence fence = 0;
+
+    for(size_t first = 0; first < count; first += chunk_size)
+    {
+        void* columns[3] = { x + first, y + first, out + first };
+        void* uniforms[1] = { s };
+
+        PSL_Bindings bindings;
+        bindings.columns = columns;
+        bindings.uniforms = uniforms;
+
+        fence = psl_kernel_submit(queue, kernel, &bindings, count - first < chunk_size ? count - first : chunk_size, NULL, NULL);
+    }
+
+    psl_wait(queue, fence);
+}
+
+bool bench_execute(BenchOutput* output,
+                   const BenchOptions* options,
+                   const GeneratorParams* params,
+                   PSL_Kernel* kernel,
+                   PSL_OptLevel opt_level,
+                   uint32_t num_threads)
+{
+    const size_t num_elements = options->num_elements;
+    const uint64_t min_time_ns = (uint64_t)(options->min_time * 1e9);
+
+    float* x = (float*)malloc(num_elements * sizeof(float));
+    float* y = (float*)malloc(num_elements * sizeof(float));
+    float* out = (float*)malloc(num_elements * sizeof(float));
+    float s = 0.5f;
+
+    for(size_t i = 0; i < num_elements; i++)
+    {
+        x[i] = (float)(i % 1024) / 1024.0f;
+        y[i] = 1.0f - x[i];
+    }
+
+    const size_t num_chunks = (size_t)num_threads * CHUNKS_PER_THREAD;
+    const size_t chunk_size = (num_elements + num_chunks - 1) / num_chunks;
+
+    PSL_Queue* queue = psl_queue_new(num_threads);
+
+    /* Warms up the workers and the caches */
+    execute_chunks(queue, kernel, x, y, out, &s, num_elements, chunk_size);
+
+    uint64_t num_iterations = 0;
+    uint64_t time_ns = 0;
+
+    while(time_ns < min_time_ns || num_iterations == 0)
+    {
+        const uint64_t start_ns = psl_profile_now_ns();
+        execute_chunks(queue, kernel, x, y, out, &s, num_elements, chunk_size);
+        time_ns += psl_profile_now_ns() - start_ns;
+
+        num_iterations++;
+    }
+
+    psl_queue_destroy(queue);
+
+    /* Code is only generated for AVX2 */
+    output_begin_record(output, "execute", params);
+    fprintf(output->file,
+            ",\"opt_level\":%d,\"isa\":\"avx2\",\"lanes\":%u,\"threads\":%u,\"elements\":%zu,\"iterations\":%llu,\"time_ns\":%llu,"
+            "\"elements_per_s\":%.0f",
+            (int)opt_level,
+            PSL_LANES,
+            num_threads,
+            num_elements,
+            (unsigned long long)num_iterations,
+            (unsigned long long)time_ns,
+            per_second(num_elements * num_iterations, time_ns));
+    output_end_record(output);
+
+    free(x);
+    free(y);
+    free(out);
+
+    return true;
+}
+
+bool bench_source(BenchOutput* output, const BenchOptions* options, const GeneratorParams* params)
+{
+    char* source = generate_source(params);
+    Vector* tokens = lex_source(source);
+
+    PSL_AST* ast = psl_ast_new();
+    PSL_CompileContext* context = psl_compile_context_new();
+
+    bool success = tokens != NULL &&
+                   psl_ast_from_tokens(ast, tokens) &&
+                   bench_lex(output, options, params, source) &&
+                   bench_parse(output, options, params, tokens);
+
+    for(int opt_level = PSL_OptLevel_0; success && opt_level <= PSL_OptLevel_2; opt_level++)
+    {
+        PSL_Kernel* kernel = bench_compile(output, options, params, ast, (PSL_OptLevel)opt_level, context);
+        success = kernel != NULL;
+        psl_kernel_destroy(kernel);
+
+        kernel = success ? bench_compile(output, options, params, ast, (PSL_OptLevel)opt_level, NULL) : NULL;
+        success = kernel != NULL;
+
+        /* Thread counts double up to the largest one, which is always measured */
+        for(uint32_t num_threads = 1; success; num_threads *= 2)
+        {
+            num_threads = num_threads < options->max_threads ? num_threads : options->max_threads;
+            success = bench_execute(output, options, params, kernel, (PSL_OptLevel)opt_level, num_threads);
+
+            if(num_threads == options->max_threads)
+            {
+                break;
+            }
+        }
+
+        psl_kernel_destroy(kernel);
+    }
+
+    if(!success)
+    {
+        logger_log_error("Benchmark failed on the source:\n%s", source);
+    }
+
+    psl_compile_context_destroy(context);
+    psl_ast_destroy(ast);
+
+    if(tokens != NULL)
+    {
+        vector_free(tokens);
+    }
+
+    free(source);
+
+    return success;
+}
+
+int main(int argc, char** argv)
+{
+    logger_init();
+
+    BenchOptions options;
+    bench_options_init(&options);
+
+    if(!bench_options_parse(&options, argc, argv))
+    {
+        logger_release();
+        return 1;
+    }
+
+    BenchOutput output;
+    output.file = options.output != NULL ? fopen(options.output, "w") : stdout;
+    output.num_records = 0;
+
+    if(output.file == NULL)
+    {
+        logger_log_error("Cannot open %s", options.output);
+        logger_release();
+        return 1;
+    }
+
+    const GeneratorParams* sources = options.quick ? _quick_sources : _sources;
+    const size_t num_sources = options.quick ? sizeof(_quick_sources) / sizeof(_quick_sources[0]) :
+                                               sizeof(_sources) / sizeof(_sources[0]);
+
+    fprintf(output.file,
+            "{\n  \"platform\":\"%s\",\n  \"processors\":%u,\n  \"min_time\":%.3f,\n  \"results\":[",
+            PSL_PLATFORM_STR,
+            num_processors(),
+            options.min_time);
+
+    bool success = true;
+
+    for(size_t i = 0; i < num_sources && success; i++)
+    {
+        success = bench_source(&output, &options, &sources[i]);
+    }
+
+    fprintf(output.file, "\n  ]\n}\n");
+
+    if(output.file != stdout)
+    {
+        fclose(output.file);
+    }
+
+    logger_release();
+
+    return success ? 0 : 1;
+}
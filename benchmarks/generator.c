@@ -0,0 +1,143 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#include "generator.h"
+
+#include "psl/ast.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct {
+    char* data;
+    size_t size;
+    size_t capacity;
+    uint32_t state;
+} Generator;
+
+void generator_params_init(GeneratorParams* params)
+{
+    params->num_functions = 4;
+    params->depth = 4;
+    params->literal_density = 0.5f;
+    params->seed = 1;
+}
+
+void generator_append(Generator* generator, const char* format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    const int length = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+
+    while(generator->size + (size_t)length + 1 > generator->capacity)
+    {
+        generator->capacity *= 2;
+        generator->data = (char*)realloc(generator->data, generator->capacity);
+    }
+
+    va_start(args, format);
+    vsnprintf(generator->data + generator->size, (size_t)length + 1, format, args);
+    va_end(args);
+
+    generator->size += (size_t)length;
+}
+
+/* xorshift32, the state is never 0 */
+uint32_t generator_random(Generator* generator)
+{
+    uint32_t x = generator->state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    generator->state = x;
+
+    return x;
+}
+
+float generator_random_float(Generator* generator)
+{
+    return (float)(generator_random(generator) >> 8) / (float)(1 << 24);
+}
+
+void generator_expression(Generator* generator, const GeneratorParams* params, uint32_t depth)
+{
+    if(depth == 0)
+    {
+        if(generator_random_float(generator) < params->literal_density)
+        {
+            generator_append(generator, "%.4f", 0.25f + generator_random_float(generator));
+        }
+        else
+        {
+            generator_append(generator, generator_random(generator) & 1 ? "a" : "b");
+        }
+
+        return;
+    }
+
+    /* Literals stay within [0.25, 1.25) and operators keep values bounded, nothing overflows */
+    switch(generator_random(generator) % 5)
+    {
+        case 0:
+        case 1:
+            generator_append(generator, "(");
+            generator_expression(generator, params, depth - 1);
+            generator_append(generator, " * ");
+            generator_expression(generator, params, depth - 1);
+            generator_append(generator, ")");
+            break;
+        case 2:
+            generator_append(generator, "(");
+            generator_expression(generator, params, depth - 1);
+            generator_append(generator, " - ");
+            generator_expression(generator, params, depth - 1);
+            generator_append(generator, ")");
+            break;
+        case 3:
+            generator_append(generator, "min(");
+            generator_expression(generator, params, depth - 1);
+            generator_append(generator, ", ");
+            generator_expression(generator, params, depth - 1);
+            generator_append(generator, ")");
+            break;
+        default:
+            generator_append(generator, "max(");
+            generator_expression(generator, params, depth - 1);
+            generator_append(generator, ", ");
+            generator_expression(generator, params, depth - 1);
+            generator_append(generator, ")");
+            break;
+    }
+}
+
+char* generate_source(const GeneratorParams* params)
+{
+    Generator generator;
+    generator.capacity = 4096;
+    generator.size = 0;
+    generator.data = (char*)malloc(generator.capacity);
+    generator.data[0] = '\0';
+    generator.state = params->seed != 0 ? params->seed : 1;
+
+    for(uint32_t i = 0; i < params->num_functions; i++)
+    {
+        generator_append(&generator, "f32 fn%u(f32 a, f32 b)\n{\n    return ", i);
+        generator_expression(&generator, params, params->depth);
+        generator_append(&generator, ";\n}\n\n");
+    }
+
+    generator_append(&generator, "main bench(f32 x, f32 y, uniform f32 s, export f32 out)\n{\n    t = x;\n");
+
+    for(uint32_t i = 0; i < params->num_functions; i++)
+    {
+        generator_append(&generator, "    t = fn%u(t, y);\n", i);
+    }
+
+    generator_append(&generator, "    out = t * s;\n}\n");
+
+    return generator.data;
+}
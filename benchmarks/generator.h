@@ -0,0 +1,31 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#pragma once
+
+#if !defined(__PSL_BENCH_GENERATOR)
+#define __PSL_BENCH_GENERATOR
+
+#include "psl/psl.h"
+
+/*
+   Synthetic sources. Each helper function combines its two arguments in a random expression tree
+   of the given depth, whose leaves are literals with probability literal_density. The entry point
+   bench chains the helpers over the columns x and y and writes the result to the export out, scaled
+   by the uniform s. The same parameters always generate the same source
+*/
+
+typedef struct {
+    uint32_t num_functions; /* helpers called by main */
+    uint32_t depth; /* binary operators from the root of an expression to its leaves */
+    float literal_density; /* between 0 and 1 */
+    uint32_t seed;
+} GeneratorParams;
+
+void generator_params_init(GeneratorParams* params);
+
+/* Returns a source to be freed by the caller */
+char* generate_source(const GeneratorParams* params);
+
+#endif /* !defined(__PSL_BENCH_GENERATOR) */
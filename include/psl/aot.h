@@ -0,0 +1,60 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#pragma once
+
+#if !defined(__PSL_AOT)
+#define __PSL_AOT
+
+#include "psl/kernel.h"
+
+PSL_CPP_ENTER
+
+/*
+   Ahead-of-time compilation. The code of compiled kernels is written to a relocatable x86-64 ELF
+   object defining one function symbol per kernel, called like generated code through
+   PSL_KernelArgs. Vector helpers are referenced as undefined psl_builtin_vector_* symbols, resolved
+   by linking to PSL, and nothing is compiled nor made executable at runtime.
+
+   The header generated along the object declares the symbols and describes the parameters of each
+   kernel, so that psl_aot_execute can process any number of elements and combine reductions like
+   psl_kernel_execute does.
+
+   Objects are only written on Linux, the code follows the calling convention of the host
+*/
+
+/* Kernel compiled ahead of time, as described by the generated header */
+typedef struct {
+    const char* name;
+    PSL_KernelFunc func;
+    const PSL_IRParam* params;
+    uint32_t num_params;
+    uint32_t num_columns;
+    uint32_t num_uniforms;
+    uint32_t num_reductions;
+} PSL_AOTKernel;
+
+/* Writes the code of the kernels to an object at path, kernel i defines the symbol symbols[i] */
+PSL_API bool psl_aot_write_object(PSL_Kernel** kernels,
+                                  const char** symbols,
+                                  uint32_t num_kernels,
+                                  const char* path,
+                                  char** error);
+
+/*
+   Writes the header declaring the symbols of the kernels. For each symbol it defines
+   <symbol>_kernel(), returning its PSL_AOTKernel, and <symbol>_execute(bindings, count)
+*/
+PSL_API bool psl_aot_write_header(PSL_Kernel** kernels,
+                                  const char** symbols,
+                                  uint32_t num_kernels,
+                                  const char* path,
+                                  char** error);
+
+/* Executes a kernel compiled ahead of time over count elements */
+PSL_API void psl_aot_execute(const PSL_AOTKernel* kernel, const PSL_Bindings* bindings, size_t count);
+
+PSL_CPP_END
+
+#endif /* !defined(__PSL_AOT) */
@@ -11,20 +11,47 @@
 
 #define ARENA_GROWTH_RATE 1.6180339887f
 
+/*
+   Data is pushed into blocks that are never moved, so pointers to it stay valid until the arena is
+   rolled back or destroyed. When the current block is full a larger one is chained to it, each
+   block starts with a pointer to the previous one and its capacity.
+   Blocks emptied by a rollback are kept as spares and chained again, in the same order, when the
+   arena grows back, so an arena reused for similar data stops allocating
+*/
+
+#define ARENA_BLOCK_HEADER_SIZE 16
+
 typedef struct
 {
-    void* ptr;
-    size_t capacity;
-    size_t offset;
+    void* ptr; /* current block */
+    size_t capacity; /* of the current block */
+    size_t offset; /* in the current block */
+    size_t size; /* bytes pushed into all the blocks */
+    void* spare; /* blocks emptied by rollbacks, the next one to chain first */
 } Arena;
 
+/* Position of an arena, everything pushed after it is released by psl_arena_rollback */
+typedef struct
+{
+    void* block;
+    size_t offset;
+    size_t size;
+} ArenaMark;
+
 PSL_API void psl_arena_init(Arena* arena, const size_t size);
 
-PSL_API void psl_arena_resize(Arena* arena);
+/* Chains a new block with room for data_size bytes */
+PSL_API void psl_arena_resize(Arena* arena, const size_t data_size);
 
 PSL_API void* psl_arena_push(Arena* arena, void* data, const size_t data_size);
 
-PSL_API void* psl_arena_at(Arena* arena, const size_t offset);
+PSL_API ArenaMark psl_arena_mark(Arena* arena);
+
+/* Releases the data pushed since mark was taken, its blocks are kept as spares */
+PSL_API void psl_arena_rollback(Arena* arena, const ArenaMark* mark);
+
+/* Releases all the data, keeping the blocks */
+PSL_API void psl_arena_reset(Arena* arena);
 
 PSL_API void psl_arena_destroy(Arena* arena);
 
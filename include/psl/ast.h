@@ -27,10 +27,42 @@ typedef enum {
     PSL_ASTNodeType_PSL_ASTFunctionCall,
     PSL_ASTNodeType_PSL_ASTVariable,
     PSL_ASTNodeType_PSL_ASTLiteral,
+    PSL_ASTNodeType_PSL_ASTTernary,
+    PSL_ASTNodeType_PSL_ASTCast,
+    PSL_ASTNodeType_PSL_ASTConstructor,
+    PSL_ASTNodeType_PSL_ASTSwizzle,
 } PSL_ASTNodeType;
 
+/* Vectors have f32 components, they are stored and computed one component at a time */
+
+typedef enum {
+    PSL_ASTValueType_F32,
+    PSL_ASTValueType_F64,
+    PSL_ASTValueType_Vec2,
+    PSL_ASTValueType_Vec3,
+    PSL_ASTValueType_Vec4,
+} PSL_ASTValueType;
+
+#define PSL_AST_MAX_COMPONENTS 4
+
+/* Number of components of a value type, 1 for scalars */
+PSL_FORCE_INLINE uint32_t psl_ast_value_type_width(PSL_ASTValueType value_type)
+{
+    return value_type >= PSL_ASTValueType_Vec2 ? 2 + (uint32_t)(value_type - PSL_ASTValueType_Vec2) : 1;
+}
+
+/* Aggregate a reduce(op) export parameter is combined with */
+
+typedef enum {
+    PSL_ASTReduceOp_None,
+    PSL_ASTReduceOp_Sum,
+    PSL_ASTReduceOp_Min,
+    PSL_ASTReduceOp_Max,
+} PSL_ASTReduceOp;
+
 typedef struct {
     PSL_ASTNodeType type;
+    uint32_t line; /* source line of the statement or function the node belongs to */
 } PSL_ASTNode;
 
 typedef struct {
@@ -46,6 +78,7 @@ typedef struct {
     PSL_ASTNode** parameters;
     uint32_t num_parameters;
     PSL_ASTNode* body;
+    PSL_ASTValueType return_type;
     bool is_entry_point;
 } PSL_ASTFunction;
 
@@ -53,7 +86,10 @@ typedef struct {
     PSL_ASTNode base;
     char* name;
     uint32_t name_length;
+    PSL_ASTValueType value_type;
     bool exportable;
+    bool uniform;
+    PSL_ASTReduceOp reduce_op;
 } PSL_ASTParameter;
 
 typedef struct {
@@ -78,6 +114,12 @@ typedef enum {
     PSL_ASTBinOPType_Sub,
     PSL_ASTBinOPType_Mul,
     PSL_ASTBinOPType_Div,
+    PSL_ASTBinOPType_Lt,
+    PSL_ASTBinOPType_Le,
+    PSL_ASTBinOPType_Gt,
+    PSL_ASTBinOPType_Ge,
+    PSL_ASTBinOPType_Eq,
+    PSL_ASTBinOPType_Neq,
 } PSL_ASTBinOPType;
 
 typedef struct {
@@ -105,9 +147,10 @@ typedef struct {
     uint32_t num_arguments;
 } PSL_ASTFunctionCall;
 
+/* Literals are kept in double precision, and take the type of the expression they are used in */
 typedef struct {
     PSL_ASTNode base;
-    float value;
+    double value;
 } PSL_ASTLiteral;
 
 typedef struct {
@@ -116,19 +159,64 @@ typedef struct {
     uint32_t name_length;
 } PSL_ASTVariable;
 
+/* condition ? if_true : if_false, evaluated for both branches and blended per lane */
+typedef struct {
+    PSL_ASTNode base;
+    PSL_ASTNode* condition;
+    PSL_ASTNode* if_true;
+    PSL_ASTNode* if_false;
+} PSL_ASTTernary;
+
+/* f32(x) or f64(x), narrowing conversions must be explicit */
+typedef struct {
+    PSL_ASTNode base;
+    PSL_ASTValueType value_type;
+    PSL_ASTNode* operand;
+} PSL_ASTCast;
+
+/* vec2(...), vec3(...) or vec4(...), the components of the arguments are concatenated, a single scalar is broadcast */
+typedef struct {
+    PSL_ASTNode base;
+    PSL_ASTValueType value_type;
+    PSL_ASTNode** arguments;
+    uint32_t num_arguments;
+} PSL_ASTConstructor;
+
+/* v.xy, v.zyx or c.rgb, components are indexed 0 to 3 */
+typedef struct {
+    PSL_ASTNode base;
+    PSL_ASTNode* operand;
+    uint32_t components[PSL_AST_MAX_COMPONENTS];
+    uint32_t num_components;
+} PSL_ASTSwizzle;
+
 #define PSL_AST_CAST(__type__, __node__) ((__type__*)((__node__)->type == PSL_ASTNodeType_##__type__ ? __node__ : NULL))
 
-#define PSL_MAX_FUNCTIONS_PER_SOURCE 32
+/* Initial number of nodes the parser scratch stack holds, it doubles when full */
+#define PSL_AST_SCRATCH_CAPACITY 256
+
+/*
+   Nodes and their child arrays live in nodes_data. While the children of a block, call or function
+   are parsed they are pushed onto the scratch stack, which is shared by all the nesting levels and
+   reused across parses, and copied to the arena once their parent is built
+*/
 
 typedef struct 
 {
     Arena nodes_data;
     PSL_ASTNode* root;
     char* error;
+    uint32_t line; /* line of the statement being parsed, given to the new nodes */
+    PSL_ASTNode** scratch;
+    uint32_t scratch_size;
+    uint32_t scratch_capacity;
 } PSL_AST;
 
 PSL_API PSL_AST* psl_ast_new();
 
+/* Releases the nodes to parse another source, the arena and the scratch stack keep their capacity */
+PSL_API void psl_ast_reset(PSL_AST* ast);
+
 PSL_API PSL_ASTNode* psl_ast_new_source(PSL_AST* ast,
                                         PSL_ASTNode** functions,
                                         uint32_t num_functions);
@@ -139,12 +227,16 @@ PSL_API PSL_ASTNode* psl_ast_new_function(PSL_AST* ast,
                                           PSL_ASTNode** parameters,
                                           uint32_t num_parameters,
                                           PSL_ASTNode* body,
+                                          PSL_ASTValueType return_type,
                                           bool is_entry_point);
 
 PSL_API PSL_ASTNode* psl_ast_new_parameter(PSL_AST* ast,
                                            char* name,
                                            uint32_t name_length,
-                                           bool exportable);
+                                           PSL_ASTValueType value_type,
+                                           bool exportable,
+                                           bool uniform,
+                                           PSL_ASTReduceOp reduce_op);
 
 PSL_API PSL_ASTNode* psl_ast_new_block(PSL_AST* ast,
                                        PSL_ASTNode** statements,
@@ -173,12 +265,32 @@ PSL_API PSL_ASTNode* psl_ast_new_function_call(PSL_AST* ast,
                                                uint32_t num_arguments);
 
 PSL_API PSL_ASTNode* psl_ast_new_literal(PSL_AST* ast,
-                                         float value);
+                                         double value);
 
 PSL_API PSL_ASTNode* psl_ast_new_variable(PSL_AST* ast,
                                           char* name,
                                           uint32_t name_length);
 
+PSL_API PSL_ASTNode* psl_ast_new_ternary(PSL_AST* ast,
+                                         PSL_ASTNode* condition,
+                                         PSL_ASTNode* if_true,
+                                         PSL_ASTNode* if_false);
+
+PSL_API PSL_ASTNode* psl_ast_new_cast(PSL_AST* ast,
+                                      PSL_ASTValueType value_type,
+                                      PSL_ASTNode* operand);
+
+PSL_API PSL_ASTNode* psl_ast_new_constructor(PSL_AST* ast,
+                                             PSL_ASTValueType value_type,
+                                             PSL_ASTNode** arguments,
+                                             uint32_t num_arguments);
+
+PSL_API PSL_ASTNode* psl_ast_new_swizzle(PSL_AST* ast,
+                                         PSL_ASTNode* operand,
+                                         const uint32_t* components,
+                                         uint32_t num_components);
+
+/* Parses tokens into the AST, the nodes of a failed parse are released and root is left unchanged */
 PSL_API bool psl_ast_from_tokens(PSL_AST* ast, 
                                  Vector* tokens);
 
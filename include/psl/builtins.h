@@ -0,0 +1,74 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#pragma once
+
+#if !defined(__PSL_BUILTINS)
+#define __PSL_BUILTINS
+
+#include "psl/psl.h"
+
+PSL_CPP_ENTER
+
+/* Number of f32 lanes processed by one kernel iteration */
+#define PSL_LANES 8
+
+typedef enum {
+    /* Expanded to IR instructions during lowering */
+    PSL_BuiltinID_Min,
+    PSL_BuiltinID_Max,
+    PSL_BuiltinID_Clamp,
+    PSL_BuiltinID_Saturate,
+    PSL_BuiltinID_Select,
+    PSL_BuiltinID_Dot,
+    PSL_BuiltinID_Cross,
+    PSL_BuiltinID_Length,
+    PSL_BuiltinID_Normalize,
+    /* Lowered to native instructions */
+    PSL_BuiltinID_Sqrt,
+    PSL_BuiltinID_Abs,
+    PSL_BuiltinID_Floor,
+    PSL_BuiltinID_Ceil,
+    /* Lowered to calls to vector helpers */
+    PSL_BuiltinID_Sin,
+    PSL_BuiltinID_Cos,
+    PSL_BuiltinID_Tan,
+    PSL_BuiltinID_Asin,
+    PSL_BuiltinID_Acos,
+    PSL_BuiltinID_Atan,
+    PSL_BuiltinID_Atan2,
+    PSL_BuiltinID_Exp,
+    PSL_BuiltinID_Log,
+    PSL_BuiltinID_Pow,
+    PSL_BuiltinID_Count,
+} PSL_BuiltinID;
+
+/* Vector helpers process PSL_LANES lanes, b is NULL for unary builtins */
+typedef void (*PSL_BuiltinVectorFunc)(float* out, const float* a, const float* b);
+
+typedef void (*PSL_BuiltinVectorFuncF64)(double* out, const double* a, const double* b);
+
+/* Scalar evaluation, used for constant folding */
+typedef float (*PSL_BuiltinScalarFunc)(float a, float b);
+
+typedef double (*PSL_BuiltinScalarFuncF64)(double a, double b);
+
+typedef struct {
+    const char* name;
+    uint32_t name_length;
+    uint32_t num_arguments;
+    PSL_BuiltinVectorFunc vector_func;
+    PSL_BuiltinScalarFunc scalar_func;
+    PSL_BuiltinVectorFuncF64 vector_func_f64;
+    PSL_BuiltinScalarFuncF64 scalar_func_f64;
+} PSL_Builtin;
+
+/* Returns the builtin matching name, NULL if there is none */
+PSL_API const PSL_Builtin* psl_builtin_find(const char* name, uint32_t name_length, PSL_BuiltinID* id);
+
+PSL_API const PSL_Builtin* psl_builtin_get(PSL_BuiltinID id);
+
+PSL_CPP_END
+
+#endif /* !defined(__PSL_BUILTINS) */
@@ -0,0 +1,96 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#pragma once
+
+#if !defined(__PSL_CODEGEN)
+#define __PSL_CODEGEN
+
+#include "psl/builtins.h"
+#include "psl/ir.h"
+#include "psl/x64.h"
+
+PSL_CPP_ENTER
+
+/*
+   Arguments passed to generated kernels. count must be a multiple of PSL_LANES, the remaining
+   elements are processed by the caller through padded scratch columns.
+   partials holds PSL_LANES doubles per reduction, kernels write the lanes of their accumulators
+   there (as floats for f32 reductions), and the caller combines them
+*/
+
+typedef struct {
+    void** columns;
+    void** uniforms;
+    size_t count;
+    void* partials;
+} PSL_KernelArgs;
+
+typedef void (*PSL_KernelFunc)(const PSL_KernelArgs* args);
+
+/* Most groups of PSL_LANES elements a kernel processes per loop iteration */
+#define PSL_CODEGEN_MAX_UNROLL 4
+
+typedef struct {
+    uint32_t unroll; /* groups of PSL_LANES elements per loop iteration, 0 to pick it from the size of the loop */
+    bool streaming; /* f32 and f64 columns are written with non-temporal stores, they must be aligned on 32 bytes */
+    uint32_t prefetch_distance; /* elements ahead of the current ones inputs are prefetched, 0 disables it */
+    bool relocatable; /* vector helpers are called through a rel32 listed in the code map, for ahead-of-time compilation */
+} PSL_CodegenOptions;
+
+PSL_API void psl_codegen_options_init(PSL_CodegenOptions* options);
+
+/*
+   Instruction of the IR the code from offset to the next entry is emitted for, PSL_IR_INVALID_VALUE
+   for the code of the kernel itself (prologue, loop control, epilogue)
+*/
+typedef struct {
+    uint32_t offset;
+    uint32_t value;
+} PSL_CodeMapEntry;
+
+/*
+   Call to the vector helper of a builtin, offset is the one of the 8 bytes absolute address moved
+   into rax, or of the rel32 of the call for relocatable code
+*/
+typedef struct {
+    uint32_t offset;
+    PSL_BuiltinID builtin;
+    PSL_IRType type;
+} PSL_CodeReloc;
+
+/*
+   Code emitted for each instruction of the IR, and the layout codegen picked for the values. Slots
+   are offsets from rsp, values of the loop have one per group stride bytes apart, invariant ones a
+   single slot and a stride of 0. Reductions accumulate in ymm registers from accumulators[i], or in
+   their partials when it is 0
+*/
+typedef struct {
+    PSL_CodeMapEntry* entries;
+    uint32_t num_entries;
+    uint32_t capacity;
+    uint32_t* slots;
+    uint32_t* strides;
+    uint32_t* accumulators;
+    uint32_t num_groups; /* groups of PSL_LANES elements per iteration of the main loop */
+    uint32_t loop_start; /* code of the main loop, the unrolled one if any */
+    uint32_t loop_end;
+    PSL_CodeReloc* relocs;
+    uint32_t num_relocs;
+} PSL_CodeMap;
+
+PSL_API void psl_code_map_init(PSL_CodeMap* map);
+
+PSL_API void psl_code_map_destroy(PSL_CodeMap* map);
+
+/* Emits the AVX2 machine code of ir into buffer, and maps it to the IR if map is not NULL. Returns true on success */
+PSL_API bool psl_codegen_emit(PSL_IR* ir,
+                              const PSL_CodegenOptions* options,
+                              PSL_CodeBuffer* buffer,
+                              PSL_CodeMap* map,
+                              char** error);
+
+PSL_CPP_END
+
+#endif /* !defined(__PSL_CODEGEN) */
@@ -0,0 +1,75 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#pragma once
+
+#if !defined(__PSL_CODEHEAP)
+#define __PSL_CODEHEAP
+
+#include "psl/psl.h"
+
+PSL_CPP_ENTER
+
+/*
+   Executable memory of compiled kernels. Code is copied into chunks of pages shared by the process
+   and never writable and executable at the same time:
+   - in PSL_CodeHeapMode_DualMapping the memory of a chunk is mapped twice, from a memfd on Linux or
+     a file mapping on Windows. Code is written through a read-write view and executed from a
+     read-execute one, so kernels are packed next to each other with their entry on a cache line
+   - in PSL_CodeHeapMode_Protect pages are read-write while code is copied and read-execute
+     afterwards. A kernel running on another thread must stay executable, so kernels never share
+     pages in this mode
+   Dual mapping is used by default and falls back to protection changes when the shared memory
+   cannot be created. The mode can be chosen when the library is loaded by setting the PSL_CODE_HEAP
+   environment variable to "dual" or "protect".
+   Freed code is filled with int3 and its space reused, empty chunks are kept for the next kernels
+   until psl_code_heap_compact returns them to the system.
+*/
+
+#define PSL_CODE_HEAP_ENV "PSL_CODE_HEAP"
+
+/* Entry points are aligned on a cache line */
+#define PSL_CODE_HEAP_ALIGNMENT 64
+
+/* Bytes of a chunk, larger code gets a chunk of its own */
+#define PSL_CODE_HEAP_CHUNK_SIZE ((size_t)256 << 10)
+
+typedef enum {
+    PSL_CodeHeapMode_DualMapping,
+    PSL_CodeHeapMode_Protect,
+} PSL_CodeHeapMode;
+
+typedef struct {
+    size_t reserved; /* bytes of the chunks */
+    size_t used; /* bytes of the live code, rounded to the alignment, or to pages when protected */
+    size_t free; /* bytes freed between live code, reused first */
+    uint32_t num_chunks;
+    uint32_t num_allocations;
+} PSL_CodeHeapStats;
+
+/* Chunks created from then on use mode, the existing ones keep theirs */
+PSL_API void psl_code_heap_set_mode(PSL_CodeHeapMode mode);
+
+PSL_API PSL_CodeHeapMode psl_code_heap_get_mode(void);
+
+/* Sets the mode from PSL_CODE_HEAP */
+PSL_API void psl_code_heap_init_from_env(void);
+
+/* Copies size bytes of code to executable memory, returns NULL if it cannot be allocated */
+PSL_API void* psl_code_heap_alloc(const uint8_t* code, size_t size);
+
+/* Frees code returned by psl_code_heap_alloc for size bytes */
+PSL_API void psl_code_heap_free(void* code, size_t size);
+
+/*
+   Returns the chunks holding no code to the system, and on Linux the pages of the others that
+   only hold freed code. Returns the bytes of the chunks released
+*/
+PSL_API size_t psl_code_heap_compact(void);
+
+PSL_API void psl_code_heap_get_stats(PSL_CodeHeapStats* stats);
+
+PSL_CPP_END
+
+#endif /* !defined(__PSL_CODEHEAP) */
@@ -0,0 +1,62 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#pragma once
+
+#if !defined(__PSL_CONTEXT)
+#define __PSL_CONTEXT
+
+#include "psl/kernel.h"
+
+PSL_CPP_ENTER
+
+/*
+   Buffers reused by the compilations of a service compiling many sources: the tokens of the lexer,
+   the AST, the scratch arena the IR and the passes work in, and the code buffer. They grow to the
+   largest source compiled and keep their capacity, so once warm the compilation itself does not
+   allocate, only the kernel does for its structure, its copy of the optimized IR and its code.
+   Arenas are rolled back to a mark after a failed parse and after each compilation.
+   A context is used by one thread at a time
+*/
+
+/* Initial bytes of the scratch arena */
+#define PSL_COMPILE_CONTEXT_SCRATCH_SIZE ((size_t)64 << 10)
+
+typedef struct {
+    Vector* tokens;
+    PSL_AST* ast;
+    Arena scratch;
+    PSL_CodeBuffer code;
+    char* error; /* of the last parse */
+} PSL_CompileContext;
+
+PSL_API PSL_CompileContext* psl_compile_context_new(void);
+
+/*
+   Lexes and parses source into the AST of the context, replacing the previous one. Returns NULL on
+   error, see context->error. The AST points into source, which must outlive it
+*/
+PSL_API PSL_AST* psl_compile_context_parse(PSL_CompileContext* context, const char* source);
+
+/* Compiles the main function named entry_point (or the first one if NULL) of the last parsed source */
+PSL_API bool psl_compile_context_compile(PSL_CompileContext* context,
+                                         PSL_Kernel* kernel,
+                                         const char* entry_point,
+                                         const PSL_CompileOptions* options);
+
+/* Compiles like psl_kernel_compile_fused, the entry points may belong to any AST */
+PSL_API bool psl_compile_context_compile_fused(PSL_CompileContext* context,
+                                               PSL_Kernel* kernel,
+                                               const PSL_EntryPoint* entry_points,
+                                               uint32_t num_entry_points,
+                                               const PSL_CompileOptions* options);
+
+/* Releases the AST and the tokens, every buffer keeps its capacity */
+PSL_API void psl_compile_context_reset(PSL_CompileContext* context);
+
+PSL_API void psl_compile_context_destroy(PSL_CompileContext* context);
+
+PSL_CPP_END
+
+#endif /* !defined(__PSL_CONTEXT) */
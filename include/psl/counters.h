@@ -0,0 +1,71 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#pragma once
+
+#if !defined(__PSL_COUNTERS)
+#define __PSL_COUNTERS
+
+#include "psl/kernel.h"
+
+PSL_CPP_ENTER
+
+/*
+   Execution counters. Every compiled kernel counts its executions into one slot per thread, padded
+   so threads do not share cache lines, and the slots are summed when the counters are read.
+   Reading the time stamp counter costs about as much as a small call, so only one call in
+   PSL_COUNTERS_SAMPLE_PERIOD of each thread is timed, and the cycles of the others are extrapolated.
+   Compiled kernels are listed process-wide until they are destroyed.
+*/
+
+/* The first threads own a slot, the ones beyond share the last one with atomic updates */
+#define PSL_COUNTERS_MAX_SLOTS 16
+
+#define PSL_COUNTERS_SAMPLE_PERIOD 16
+
+typedef struct {
+    uint64_t calls;
+    uint64_t elements;
+    uint64_t tail_iterations; /* calls of the padded loop processing the last count % PSL_LANES elements */
+    uint64_t timed_calls;
+    uint64_t timed_cycles; /* time stamp counter cycles spent in the timed calls, see psl_tsc_frequency */
+    uint64_t cycles; /* timed_cycles extrapolated to all the calls */
+} PSL_KernelStats;
+
+typedef struct PSL_KernelCounters PSL_KernelCounters;
+
+/* Sums the counters of all the threads that executed the kernel */
+PSL_API void psl_kernel_get_stats(PSL_Kernel* kernel, PSL_KernelStats* stats);
+
+PSL_API void psl_kernel_reset_stats(PSL_Kernel* kernel);
+
+typedef void (*PSL_KernelStatsFunc)(PSL_Kernel* kernel, const PSL_KernelStats* stats, void* user_data);
+
+/*
+   Calls func with the stats of every compiled kernel that has not been destroyed yet, in order of
+   compilation. Kernels cannot be compiled or destroyed from func
+*/
+PSL_API void psl_kernel_for_each_live(PSL_KernelStatsFunc func, void* user_data);
+
+/* Ticks per second of the time stamp counter, calibrated on the first call which busy waits 2 ms */
+PSL_API double psl_tsc_frequency(void);
+
+/* Measures the frequency again, busy waiting 2 ms */
+PSL_API void psl_tsc_calibrate(void);
+
+PSL_API uint64_t psl_tsc_now(void);
+
+/* Allocates the counters of a compiled kernel and adds it to the live kernels */
+PSL_API void psl_kernel_counters_init(PSL_Kernel* kernel);
+
+PSL_API void psl_kernel_counters_release(PSL_Kernel* kernel);
+
+/* Returns the time stamp counter if the call is timed, 0 otherwise */
+PSL_API uint64_t psl_kernel_counters_begin(PSL_Kernel* kernel);
+
+PSL_API void psl_kernel_counters_end(PSL_Kernel* kernel, uint64_t start, size_t count, bool tail);
+
+PSL_CPP_END
+
+#endif /* !defined(__PSL_COUNTERS) */
@@ -0,0 +1,50 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#pragma once
+
+#if !defined(__PSL_DUMP)
+#define __PSL_DUMP
+
+#include "psl/kernel.h"
+
+PSL_CPP_ENTER
+
+/*
+   Static cost of an iteration of the main loop of a kernel, the unrolled one if any. Instructions
+   are spread over the execution ports of a Skylake-like core: vector arithmetic on p0 and p1,
+   shuffles on p5, integer instructions on p0, p1, p5 and p6, branches on p6, loads on p2 and p3,
+   store data on p4 and store addresses on p2, p3 and p7. Instructions that can go to several ports
+   are spread evenly, and divisions and square roots keep p0 busy for their reciprocal throughput.
+   The most used port bounds the throughput of the loop, latencies and the front end are ignored.
+*/
+
+#define PSL_NUM_PORTS 8
+
+typedef struct {
+    uint32_t num_insts;
+    uint32_t lanes; /* elements processed per iteration */
+    uint32_t num_loads;
+    uint32_t num_stores;
+    uint32_t num_calls; /* calls to vector helpers, their cost is not estimated */
+    double insts_per_lane;
+    double ports[PSL_NUM_PORTS]; /* cycles port i is busy per iteration */
+    uint32_t bottleneck; /* most used port */
+    double cycles_per_lane; /* cycles of the bottleneck per element */
+} PSL_KernelCost;
+
+/* Estimates the cost of a compiled kernel, returns false if it has no code */
+PSL_API bool psl_kernel_estimate_cost(PSL_Kernel* kernel, PSL_KernelCost* cost);
+
+/*
+   Prints what a compiled kernel has become: its optimized IR with the source line and the stack
+   slot of each value, the registers accumulating its reductions, the disassembly of its code
+   annotated with the instruction and source line it was emitted for, and its cost estimate.
+   Returns false if the kernel has no code
+*/
+PSL_API bool psl_kernel_dump(PSL_Kernel* kernel, FILE* file);
+
+PSL_CPP_END
+
+#endif /* !defined(__PSL_DUMP) */
@@ -0,0 +1,248 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#pragma once
+
+#if !defined(__PSL_IR)
+#define __PSL_IR
+
+#include "psl/ast.h"
+#include "psl/builtins.h"
+
+PSL_CPP_ENTER
+
+/*
+   The IR is a flat SSA list of instructions for a single entry point, user functions are inlined
+   during lowering. Instructions only reference values defined before them, so the list is always
+   in a valid evaluation order.
+
+   Every instruction has a type. f32 and f64 values are mixed by widening f32 operands to f64,
+   narrowing must be explicit. f32 constants lowered from literals keep the double value of the
+   literal so that widening them is exact, they are rounded to f32 when evaluated. Literals narrowed
+   explicitly with f32() are rounded, and widened from their f32 value.
+
+   The IR has no vectors: every component of a vector is lowered to its own scalar values, and
+   vector parameters take one parameter, and so one column or uniform, per component.
+*/
+
+typedef enum {
+    PSL_IRType_F32,
+    PSL_IRType_F64,
+} PSL_IRType;
+
+PSL_FORCE_INLINE size_t psl_ir_type_size(PSL_IRType type)
+{
+    return type == PSL_IRType_F64 ? sizeof(double) : sizeof(float);
+}
+
+typedef enum {
+    PSL_IROpcode_Const,     /* constant */
+    PSL_IROpcode_Load,      /* index = column */
+    PSL_IROpcode_Uniform,   /* index = uniform */
+    PSL_IROpcode_Store,     /* index = column, args[0] = value */
+    PSL_IROpcode_Reduce,    /* index = reduction, args[0] = value accumulated across iterations */
+    PSL_IROpcode_Add,
+    PSL_IROpcode_Sub,
+    PSL_IROpcode_Mul,
+    PSL_IROpcode_Div,
+    PSL_IROpcode_Neg,
+    PSL_IROpcode_Convert,   /* args[0] converted to the type of the instruction */
+    PSL_IROpcode_Min,       /* x86 semantics, args[1] if any of them is NaN */
+    PSL_IROpcode_Max,       /* x86 semantics, args[1] if any of them is NaN */
+    PSL_IROpcode_Cmp,       /* index = PSL_IRCmp, produces a lane mask as wide as the operands */
+    PSL_IROpcode_Select,    /* args[0] = mask, args[1] if set, args[2] otherwise */
+    PSL_IROpcode_Call,      /* index = PSL_BuiltinID */
+    PSL_IROpcode_Fma,       /* args[0] * args[1] + args[2] rounded once, fast math only */
+    PSL_IROpcode_Rcp,       /* approximation of 1 / args[0], f32 only, fast math only */
+    PSL_IROpcode_Rsqrt,     /* approximation of 1 / sqrt(args[0]), f32 only, fast math only */
+    PSL_IROpcode_Count,
+} PSL_IROpcode;
+
+/* Comparisons follow C semantics: false when any operand is NaN, except for != */
+
+typedef enum {
+    PSL_IRCmp_Lt,
+    PSL_IRCmp_Le,
+    PSL_IRCmp_Gt,
+    PSL_IRCmp_Ge,
+    PSL_IRCmp_Eq,
+    PSL_IRCmp_Neq,
+} PSL_IRCmp;
+
+#define PSL_IR_MAX_ARGS 3
+
+#define PSL_IR_INVALID_VALUE 0xFFFFFFFF
+
+typedef struct {
+    PSL_IROpcode opcode;
+    PSL_IRType type;
+    uint32_t args[PSL_IR_MAX_ARGS];
+    uint32_t num_args;
+    uint32_t index;
+    double constant;
+    uint32_t line; /* source line the instruction computes a part of, 0 if unknown */
+} PSL_IRInst;
+
+/* How the values of a column are stored in memory, they are converted on load and store */
+
+typedef enum {
+    PSL_ColumnFormat_Default,   /* type of the parameter */
+    PSL_ColumnFormat_F32,
+    PSL_ColumnFormat_F64,
+    PSL_ColumnFormat_F16,
+    PSL_ColumnFormat_Unorm8,    /* [0, 255] mapped to [0, 1], clamped to [0, 1] on store */
+    PSL_ColumnFormat_Unorm16,   /* [0, 65535] mapped to [0, 1], clamped to [0, 1] on store */
+} PSL_ColumnFormat;
+
+PSL_API size_t psl_column_format_size(PSL_ColumnFormat format);
+
+typedef enum {
+    PSL_IRParamKind_Input,
+    PSL_IRParamKind_Export,
+    PSL_IRParamKind_Uniform,
+    PSL_IRParamKind_Reduction, /* export bound to a single value receiving the aggregate */
+    PSL_IRParamKind_Dropped,   /* input or export whose column is never accessed */
+} PSL_IRParamKind;
+
+/* Min and max ignore NaN values */
+
+typedef enum {
+    PSL_IRReduceOp_Sum,
+    PSL_IRReduceOp_Min,
+    PSL_IRReduceOp_Max,
+} PSL_IRReduceOp;
+
+typedef struct {
+    char* name;
+    uint32_t name_length;
+    PSL_IRParamKind kind;
+    PSL_IRType type;
+    PSL_ColumnFormat format; /* storage of the column of inputs/exports, never Default */
+    PSL_IRReduceOp reduce_op;
+    uint32_t index; /* column index for inputs/exports/reductions, uniform index for uniforms */
+    uint32_t reduction; /* accumulator index for reductions */
+    uint32_t component; /* component of a vector parameter, the ones of a vector follow each other */
+} PSL_IRParam;
+
+typedef struct {
+    PSL_IRInst* insts;
+    uint32_t num_insts;
+    uint32_t capacity;
+    PSL_IRParam* params;
+    uint32_t num_params;
+    uint32_t num_columns;
+    uint32_t num_uniforms;
+    uint32_t num_reductions;
+    uint32_t line; /* line given to the pushed instructions that have none */
+    char* error;
+    Arena* scratch; /* holds the arrays of the IR and of its passes instead of the heap when set */
+} PSL_IR;
+
+PSL_API void psl_ir_init(PSL_IR* ir);
+
+/*
+   Arrays of the IR and temporary arrays of the passes. They are pushed into ir->scratch when it is
+   set, the arena of a PSL_CompileContext, where they are released all at once by a rollback, and
+   allocated on the heap otherwise
+*/
+PSL_API void* psl_ir_alloc(PSL_IR* ir, size_t size);
+
+PSL_API void* psl_ir_alloc_zeroed(PSL_IR* ir, size_t size);
+
+PSL_API void* psl_ir_realloc(PSL_IR* ir, void* ptr, size_t old_size, size_t new_size);
+
+PSL_API void psl_ir_free(PSL_IR* ir, void* ptr);
+
+/* Initializes dst with a deep copy of src on the heap */
+PSL_API void psl_ir_copy(PSL_IR* dst, const PSL_IR* src);
+
+/* Appends an instruction and returns its value */
+PSL_API uint32_t psl_ir_push(PSL_IR* ir, const PSL_IRInst* inst);
+
+/* Lowers the main function named entry_point (or the first one if NULL), returns true on success */
+PSL_API bool psl_ir_from_ast(PSL_IR* ir, PSL_AST* ast, const char* entry_point);
+
+/* Main function named name in ast, the first one if name is NULL */
+
+typedef struct {
+    PSL_AST* ast;
+    const char* name;
+} PSL_EntryPoint;
+
+/* Returns the main function named entry_point in source, the first one if NULL */
+PSL_API PSL_ASTFunction* psl_ir_find_entry_point(PSL_ASTSource* source, const char* entry_point);
+
+/*
+   Lowers several main functions into a single IR, in order. Parameters are shared by name: inputs
+   and uniforms of the same name are read once, and inputs named like an export of a previous entry
+   point read the exported value instead of their column. Parameters are numbered in the order they
+   first appear in
+*/
+PSL_API bool psl_ir_from_entry_points(PSL_IR* ir, const PSL_EntryPoint* entry_points, uint32_t num_entry_points);
+
+/* Returns the parameter named name, NULL if there is none */
+PSL_API PSL_IRParam* psl_ir_find_param(PSL_IR* ir, const char* name, uint32_t name_length);
+
+/* Returns the input or export parameter stored in column, NULL if there is none */
+PSL_API PSL_IRParam* psl_ir_find_column(PSL_IR* ir, uint32_t column);
+
+/* Returns the reduction parameter accumulated in reduction */
+PSL_API PSL_IRParam* psl_ir_find_reduction(PSL_IR* ir, uint32_t reduction);
+
+/* Sets the storage format of the column of the input or export parameter named name, of all its components for vectors */
+PSL_API bool psl_ir_set_column_format(PSL_IR* ir, const char* name, PSL_ColumnFormat format);
+
+/* Replaces every read of the uniform named name, of all its components for vectors, by the constant value */
+PSL_API bool psl_ir_specialize(PSL_IR* ir, const char* name, double value);
+
+/*
+   Evaluates instructions whose operands are all constants, simplifies exact identities, and
+   computes in f32 the f64 operations whose operands and result are f32
+*/
+PSL_API void psl_ir_fold_constants(PSL_IR* ir);
+
+/* Transformations trading IEEE exactness for speed, none of them is applied by default */
+
+typedef enum {
+    PSL_FastMath_Contract = 1 << 0,     /* a * b + c computed with a single rounding */
+    PSL_FastMath_Reassoc = 1 << 1,      /* chains of additions summed as balanced trees */
+    PSL_FastMath_ApproxRcp = 1 << 2,    /* divisions computed with a reciprocal approximation and a Newton step */
+    PSL_FastMath_ApproxRsqrt = 1 << 3,  /* 1 / sqrt(x) computed with an approximation and a Newton step */
+    PSL_FastMath_All = 0xF,
+} PSL_FastMath;
+
+/* Rewrites the IR with the PSL_FastMath transformations set in flags, after constant folding */
+PSL_API void psl_ir_fast_math(PSL_IR* ir, uint32_t flags);
+
+/*
+   Value numbering: identical instructions are replaced by the first one computing the same value.
+   Operands of add and mul are ordered as they commute exactly, nothing is reassociated
+*/
+PSL_API void psl_ir_eliminate_common_subexpressions(PSL_IR* ir);
+
+/*
+   Drops the stores and reductions of the exports whose column bit is not set in export_mask, so
+   that dead code elimination removes what only feeds them. Columns past 63 are always kept
+*/
+PSL_API void psl_ir_drop_exports(PSL_IR* ir, uint64_t export_mask);
+
+/* Removes instructions that do not contribute to any store or reduction, and drops unread inputs */
+PSL_API void psl_ir_eliminate_dead_code(PSL_IR* ir);
+
+/*
+   Flags instructions that only depend on constants and uniforms, and can be computed once
+   outside of the kernel loop. invariant must hold num_insts entries
+*/
+PSL_API void psl_ir_find_invariants(PSL_IR* ir, bool* invariant);
+
+PSL_API void psl_ir_print(PSL_IR* ir);
+
+/* Prints the instruction defining value to file, without a newline */
+PSL_API void psl_ir_print_inst(PSL_IR* ir, uint32_t value, FILE* file);
+
+PSL_API void psl_ir_destroy(PSL_IR* ir);
+
+PSL_CPP_END
+
+#endif /* !defined(__PSL_IR) */
@@ -0,0 +1,174 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#pragma once
+
+#if !defined(__PSL_KERNEL)
+#define __PSL_KERNEL
+
+#include "psl/codegen.h"
+
+PSL_CPP_ENTER
+
+/* Value a uniform parameter is fixed to at compile time, and constant folded with */
+
+typedef struct {
+    const char* name;
+    double value;
+} PSL_Specialization;
+
+/* Storage format of the column of an input or export parameter, f32 or f64 if not set */
+
+typedef struct {
+    const char* name;
+    PSL_ColumnFormat format;
+} PSL_ColumnStorage;
+
+/*
+   Compilation latency against throughput of the generated code. Functions are always inlined and
+   loop invariants hoisted, the levels differ in the passes run over the IR and in unrolling
+*/
+
+typedef enum {
+    PSL_OptLevel_0, /* IR emitted as lowered, one group of PSL_LANES elements per loop iteration */
+    PSL_OptLevel_1, /* constants folded and dead code eliminated */
+    PSL_OptLevel_2, /* common subexpressions eliminated, fast math allowed, unrolling picked from the loop */
+} PSL_OptLevel;
+
+typedef struct {
+    const PSL_Specialization* specializations;
+    uint32_t num_specializations;
+    const PSL_ColumnStorage* column_formats;
+    uint32_t num_column_formats;
+    uint32_t fast_math; /* PSL_FastMath flags, 0 keeps results exact. Only applied from PSL_OptLevel_2 */
+    uint32_t unroll; /* groups of PSL_LANES elements per loop iteration up to PSL_CODEGEN_MAX_UNROLL, 0 for auto */
+    PSL_OptLevel opt_level; /* PSL_OptLevel_2 by default */
+} PSL_CompileOptions;
+
+PSL_API void psl_compile_options_init(PSL_CompileOptions* options);
+
+/*
+   Data a kernel is executed on.
+   columns holds one array per input and export parameter, uniforms one pointer to a single value
+   per uniform parameter, both in the order the parameters are declared in. Specialized uniforms
+   keep their place in uniforms but are not read. Uniforms are float or double depending on the type
+   of their parameter, columns follow the format they have been compiled with.
+   Reduction parameters take the place of a column, and point to a single float or double that
+   receives the aggregate of the values assigned to them over all the elements
+*/
+
+typedef struct {
+    void** columns;
+    void** uniforms;
+} PSL_Bindings;
+
+/* Longest name of a kernel, null terminator included */
+#define PSL_KERNEL_NAME_SIZE 64
+
+typedef struct PSL_Kernel {
+    char name[PSL_KERNEL_NAME_SIZE]; /* names of the compiled entry points, joined by '+' */
+    PSL_IR ir;
+    PSL_KernelFunc func;
+    void* code;
+    size_t code_size;
+    char* error;
+    uint64_t export_mask; /* exports written by the kernel, bit i for column i */
+    PSL_CodegenOptions codegen;
+    struct PSL_Kernel* variants; /* cached variants writing a subset of the exports or with other codegen options, chained */
+    struct PSL_KernelCounters* counters; /* execution counters, see psl/counters.h */
+} PSL_Kernel;
+
+PSL_API PSL_Kernel* psl_kernel_new();
+
+/* Compiles the main function named entry_point (or the first one if NULL), returns true on success */
+PSL_API bool psl_kernel_compile(PSL_Kernel* kernel,
+                                PSL_AST* ast,
+                                const char* entry_point,
+                                const PSL_CompileOptions* options);
+
+/*
+   Compiles several main functions into a single loop, see psl_ir_from_entry_points for how their
+   parameters are shared and ordered. Shared inputs are loaded once per element, and exports read
+   by later entry points are passed to them directly while still being written to their column
+*/
+PSL_API bool psl_kernel_compile_fused(PSL_Kernel* kernel,
+                                      const PSL_EntryPoint* entry_points,
+                                      uint32_t num_entry_points,
+                                      const PSL_CompileOptions* options);
+
+/*
+   Compiles like psl_kernel_compile_fused, with the IR and the temporary arrays of the passes pushed
+   into scratch and the code emitted into buffer. The kernel gets its own copy of the optimized IR,
+   scratch is rolled back to where it was and both keep their capacity for the next compilation,
+   see psl/context.h
+*/
+PSL_API bool psl_kernel_compile_with_buffers(PSL_Kernel* kernel,
+                                             const PSL_EntryPoint* entry_points,
+                                             uint32_t num_entry_points,
+                                             const PSL_CompileOptions* options,
+                                             Arena* scratch,
+                                             PSL_CodeBuffer* buffer);
+
+/*
+   Generates the code of the optimized IR kernel->ir already holds, with kernel->codegen, the last
+   step of a compilation. Used to compile kernels saved to a module, see psl/module.h
+*/
+PSL_API bool psl_kernel_compile_ir(PSL_Kernel* kernel);
+
+/*
+   Returns a variant of the kernel that only writes the exports whose column bit is set in
+   export_mask, and skips all the computations feeding the other ones. Variants use the bindings of
+   the kernel, columns of the exports they do not write are not accessed. They are cached and owned
+   by the kernel, NULL is returned on error
+*/
+PSL_API PSL_Kernel* psl_kernel_variant(PSL_Kernel* kernel, uint64_t export_mask);
+
+/* Tuning of the memory accesses of an execution, for batches larger than the caches */
+
+typedef struct {
+    /*
+       Bytes written to f32 and f64 export columns above which they are written with non-temporal
+       stores, bypassing the caches. Only used when all those columns are aligned on 32 bytes,
+       0 disables it
+    */
+    size_t streaming_threshold;
+    uint32_t prefetch_distance; /* elements ahead of the current ones inputs are prefetched, 0 disables it */
+} PSL_ExecuteOptions;
+
+PSL_API void psl_execute_options_init(PSL_ExecuteOptions* options);
+
+/*
+   Compiles the variants of the kernel executions with options use, with prefetching and, unless
+   streaming_threshold is 0, with non-temporal stores. Otherwise they are compiled by the first
+   execution needing them, executions on other threads finding them once published.
+   Returns false if one of them cannot be compiled
+*/
+PSL_API bool psl_kernel_prepare(PSL_Kernel* kernel, const PSL_ExecuteOptions* options);
+
+/* Executes the kernel over count elements with the default execute options */
+PSL_API void psl_kernel_execute(PSL_Kernel* kernel, const PSL_Bindings* bindings, size_t count);
+
+/* Executes the kernel over count elements, the code needed by the options is compiled and cached on first use */
+PSL_API void psl_kernel_execute_with_options(PSL_Kernel* kernel,
+                                             const PSL_Bindings* bindings,
+                                             size_t count,
+                                             const PSL_ExecuteOptions* options);
+
+/* Sets the result of every reduction binding to the identity of its aggregate */
+PSL_API void psl_kernel_reset_reductions(PSL_Kernel* kernel, const PSL_Bindings* bindings);
+
+/*
+   Executes the kernel over count elements and combines the reductions with the results they
+   already hold, to process a dataset in several calls after psl_kernel_reset_reductions
+*/
+PSL_API void psl_kernel_accumulate(PSL_Kernel* kernel,
+                                   const PSL_Bindings* bindings,
+                                   size_t count,
+                                   const PSL_ExecuteOptions* options);
+
+PSL_API void psl_kernel_destroy(PSL_Kernel* kernel);
+
+PSL_CPP_END
+
+#endif /* !defined(__PSL_KERNEL) */
@@ -25,14 +25,22 @@ typedef enum {
     PSL_TokenType_RBrace,
     PSL_TokenType_Comma,
     PSL_TokenType_Semicolon,
+    PSL_TokenType_Question,
+    PSL_TokenType_Colon,
+    PSL_TokenType_Dot,
     PSL_TokenType_Count
 } PSL_TokenType;
 
 typedef enum {
     PSL_KeywordType_f32,
     PSL_KeywordType_f64,
+    PSL_KeywordType_Vec2,
+    PSL_KeywordType_Vec3,
+    PSL_KeywordType_Vec4,
     PSL_KeywordType_Main,
     PSL_KeywordType_Export,
+    PSL_KeywordType_Uniform,
+    PSL_KeywordType_Reduce,
     PSL_KeywordType_Return,
     PSL_KeywordType_Count,
 } PSL_KeywordType;
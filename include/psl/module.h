@@ -0,0 +1,106 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#pragma once
+
+#if !defined(__PSL_MODULE)
+#define __PSL_MODULE
+
+#include "psl/kernel.h"
+
+PSL_CPP_ENTER
+
+/*
+   Modules hold compiled kernels as their optimized IR, independently of the instruction set, so
+   that loading them only runs code generation: no lexing, parsing, lowering nor optimization.
+
+   The file is little-endian and references everything by offset from its start:
+   - a PSL_ModuleHeader
+   - a PSL_ModuleKernel per kernel
+   - the PSL_ModuleInst and PSL_ModuleParam records of each kernel, aligned on 8 bytes
+   - the string table: names of the kernels and of their parameters, null terminated, each stored once
+   Loading maps the file read-only and checks it once, so that a damaged or truncated file is
+   rejected instead of compiled. Parameter names of the kernels compiled from a module point into
+   its string table, the module must outlive them. Files of another PSL_MODULE_VERSION are rejected
+*/
+
+#define PSL_MODULE_MAGIC 0x4D4C5350 /* "PSLM" */
+
+#define PSL_MODULE_VERSION 1
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t num_kernels;
+    uint32_t strings_size;
+    uint64_t size; /* bytes of the file */
+    uint64_t strings_offset;
+} PSL_ModuleHeader;
+
+typedef struct {
+    uint32_t name; /* offset in the string table */
+    uint32_t num_insts;
+    uint32_t num_params;
+    uint32_t num_columns;
+    uint32_t num_uniforms;
+    uint32_t num_reductions;
+    uint32_t unroll; /* PSL_CodegenOptions.unroll the kernel has been compiled with */
+    uint32_t reserved;
+    uint64_t insts_offset;
+    uint64_t params_offset;
+} PSL_ModuleKernel;
+
+typedef struct {
+    uint8_t opcode;
+    uint8_t type;
+    uint8_t num_args;
+    uint8_t reserved;
+    uint32_t args[PSL_IR_MAX_ARGS];
+    uint32_t index;
+    uint32_t line;
+    double constant;
+} PSL_ModuleInst;
+
+typedef struct {
+    uint32_t name; /* offset in the string table */
+    uint32_t name_length;
+    uint8_t kind;
+    uint8_t type;
+    uint8_t format;
+    uint8_t reduce_op;
+    uint32_t index;
+    uint32_t reduction;
+    uint32_t component;
+} PSL_ModuleParam;
+
+typedef struct {
+    const uint8_t* data;
+    size_t size;
+    uint32_t num_kernels;
+    bool mapped; /* data is a mapping of the file, not memory of the caller */
+} PSL_Module;
+
+/* Writes the optimized IR of the compiled kernels to a module at path */
+PSL_API bool psl_module_save(PSL_Kernel** kernels, uint32_t num_kernels, const char* path, char** error);
+
+/* Maps and checks the module at path, returns NULL on error */
+PSL_API PSL_Module* psl_module_load(const char* path, char** error);
+
+/* Checks a module already in memory, an asset loaded by the application. data must outlive it */
+PSL_API PSL_Module* psl_module_from_memory(const void* data, size_t size, char** error);
+
+/* Returns the name of kernel index */
+PSL_API const char* psl_module_kernel_name(const PSL_Module* module, uint32_t index);
+
+/*
+   Generates the code of the kernel named name (or the first one if NULL) into kernel, which
+   executes like the kernel the module has been saved from. Returns true on success
+*/
+PSL_API bool psl_module_compile(const PSL_Module* module, PSL_Kernel* kernel, const char* name);
+
+PSL_API void psl_module_destroy(PSL_Module* module);
+
+PSL_CPP_END
+
+#endif /* !defined(__PSL_MODULE) */
@@ -0,0 +1,53 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#pragma once
+
+#if !defined(__PSL_PERF)
+#define __PSL_PERF
+
+#include "psl/codegen.h"
+
+PSL_CPP_ENTER
+
+/*
+   Linux perf integration. Kernels compiled while an output is enabled are described to perf so
+   their samples are attributed to them instead of anonymous memory:
+   - the perf map /tmp/perf-<pid>.map lists the address, size and name of their code
+   - the jitdump /tmp/jit-<pid>.dump also holds their code and the source line of each instruction,
+     to be merged into a recording with perf inject --jit (record with perf record -k mono)
+   Outputs are enabled with psl_perf_enable, or when the library is loaded by setting the
+   PSL_PERF environment variable to a comma separated list of "map" and "jitdump".
+   Code is named psl::<kernel name>. On other platforms enabling outputs fails.
+*/
+
+#define PSL_PERF_ENV "PSL_PERF"
+
+typedef enum {
+    PSL_PerfOutput_Map = 1,
+    PSL_PerfOutput_JitDump = 2,
+} PSL_PerfOutput;
+
+/* Enables the PSL_PerfOutput flags of outputs, returns false if a file cannot be created */
+PSL_API bool psl_perf_enable(uint32_t outputs);
+
+/* Disables and closes all the outputs, the files are kept for perf */
+PSL_API void psl_perf_disable(void);
+
+/* Returns the PSL_PerfOutput flags enabled */
+PSL_API uint32_t psl_perf_outputs(void);
+
+/* Enables the outputs listed in PSL_PERF */
+PSL_API void psl_perf_init_from_env(void);
+
+/* Describes the code of the kernel named name to the enabled outputs, lines are only known with ir and map */
+PSL_API void psl_perf_register(const char* name,
+                               const void* code,
+                               size_t code_size,
+                               const PSL_IR* ir,
+                               const PSL_CodeMap* map);
+
+PSL_CPP_END
+
+#endif /* !defined(__PSL_PERF) */
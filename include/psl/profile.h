@@ -0,0 +1,141 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#pragma once
+
+#if !defined(__PSL_PROFILE)
+#define __PSL_PROFILE
+
+#include "psl/psl.h"
+
+PSL_CPP_ENTER
+
+/*
+   Compilation profiling. Recording is opt-in and per thread: the phases run by a thread between
+   psl_profile_begin and psl_profile_end are accumulated into the given stats, which are then
+   added to the process-wide totals. When no recording is active each phase only checks a thread
+   local pointer. Executions are only instrumented when they look up a variant of the kernel.
+*/
+
+typedef enum
+{
+    PSL_CompilePhase_Lex,
+    PSL_CompilePhase_Parse,
+    PSL_CompilePhase_Lower,
+    PSL_CompilePhase_Specialize,
+    PSL_CompilePhase_FoldConstants,
+    PSL_CompilePhase_CSE,
+    PSL_CompilePhase_DCE,
+    PSL_CompilePhase_FastMath,
+    PSL_CompilePhase_SlotLayout,
+    PSL_CompilePhase_Encode,
+    PSL_CompilePhase_CacheLookup,
+    PSL_CompilePhase_Count,
+} PSL_CompilePhase;
+
+typedef struct
+{
+    /* Wall time spent in the phase */
+    uint64_t time_ns;
+    /* Bytes requested from the allocator during the phase, buffers growth included */
+    uint64_t bytes_allocated;
+    /* Number of times the phase ran */
+    uint64_t count;
+} PSL_PhaseStats;
+
+typedef struct
+{
+    PSL_PhaseStats phases[PSL_CompilePhase_Count];
+
+    /* Tokens lexed, and AST nodes allocated by the parser */
+    uint64_t num_tokens;
+    uint64_t num_nodes;
+
+    /* Most bytes pushed into an arena, and number of blocks arenas grew by */
+    uint64_t arena_peak;
+    uint64_t arena_resizes;
+
+    /* Instructions of the optimized IR, and bytes of machine code emitted */
+    uint64_t num_insts;
+    uint64_t code_size;
+
+    /* Number of recordings accumulated, 1 for a single psl_profile_begin/psl_profile_end pair */
+    uint64_t num_compilations;
+
+    /* Bytes requested from the allocator by all the phases */
+    uint64_t bytes_allocated;
+} PSL_CompileStats;
+
+/* Clears stats and records the compilation phases run by the calling thread into them */
+PSL_API void psl_profile_begin(PSL_CompileStats* stats);
+
+/* Stops the recording of the calling thread and adds its stats to the process-wide totals */
+PSL_API void psl_profile_end(void);
+
+/* Copies the totals of all the recordings ended so far */
+PSL_API void psl_profile_get_totals(PSL_CompileStats* totals);
+
+PSL_API void psl_profile_reset_totals(void);
+
+PSL_API const char* psl_compile_phase_to_string(PSL_CompilePhase phase);
+
+/*
+   Writes stats as a JSON object into buffer, truncated to size bytes null terminator included.
+   Returns the length of the whole object, like snprintf
+*/
+PSL_API size_t psl_compile_stats_to_json(const PSL_CompileStats* stats, char* buffer, size_t size);
+
+/* Monotonic clock, in nanoseconds */
+PSL_API uint64_t psl_profile_now_ns(void);
+
+/* Instrumentation points, no-ops without an active recording */
+
+typedef struct
+{
+    uint64_t start_ns;
+    uint64_t start_bytes;
+} PSL_ProfileScope;
+
+PSL_API void psl_profile_phase_begin(PSL_ProfileScope* scope);
+
+PSL_API void psl_profile_phase_end(PSL_ProfileScope* scope, PSL_CompilePhase phase);
+
+PSL_API void psl_profile_alloc(size_t size);
+
+/*
+   Stats of the recording of the calling thread, NULL without one. Only referenced by the inline
+   hooks below, which the library calls on each arena push and AST node
+*/
+extern PSL_THREAD_LOCAL PSL_CompileStats* _psl_current_stats;
+
+/* Called for each push into an arena, with the bytes pushed so far */
+static PSL_FORCE_INLINE void psl_profile_arena(size_t size, bool resized)
+{
+    if(_psl_current_stats == NULL)
+    {
+        return;
+    }
+
+    _psl_current_stats->arena_resizes += resized ? 1 : 0;
+
+    if(size > _psl_current_stats->arena_peak)
+    {
+        _psl_current_stats->arena_peak = size;
+    }
+}
+
+/* Called for each AST node created by the parser */
+static PSL_FORCE_INLINE void psl_profile_node(void)
+{
+    if(_psl_current_stats != NULL)
+    {
+        _psl_current_stats->num_nodes++;
+    }
+}
+
+PSL_API void psl_profile_counts(uint64_t num_tokens, uint64_t num_insts, uint64_t code_size);
+
+PSL_CPP_END
+
+#endif /* !defined(__PSL_PROFILE) */
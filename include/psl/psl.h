@@ -106,6 +106,12 @@
 #define PSL_API PSL_IMPORT
 #endif /* defined(PSL_BUILD_SHARED) */
 
+#if defined(PSL_MSVC)
+#define PSL_THREAD_LOCAL __declspec(thread)
+#else
+#define PSL_THREAD_LOCAL __thread
+#endif /* defined(PSL_MSVC) */
+
 #if defined(PSL_WIN)
 #define PSL_FUNCTION __FUNCTION__
 #elif defined(PSL_GCC) || defined(PSL_CLANG)
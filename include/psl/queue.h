@@ -0,0 +1,56 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#pragma once
+
+#if !defined(__PSL_QUEUE)
+#define __PSL_QUEUE
+
+#include "psl/kernel.h"
+
+PSL_CPP_ENTER
+
+/*
+   Asynchronous execution. Submissions are dequeued in order of submission by a pool of worker
+   threads, consecutive small submissions of the same kernel are coalesced into a single batch
+   whose columns are gathered and scattered around one kernel call, unless one of them accesses
+   the exports of an earlier one of the batch. With more than one worker, submissions and their
+   callbacks can complete out of order: a submission depending on the results of another one must
+   wait for its fence, or use a queue with a single worker.
+
+   Submissions can be made from any thread. The data of the columns and uniforms must stay valid
+   until the submission completes, the bindings arrays themselves are copied.
+*/
+
+/* Called from a worker thread once the submission has been executed */
+typedef void (*PSL_CompletionFunc)(void* user_data);
+
+/* Submissions are numbered from 1 in the order they are made, a fence is the number of one of them */
+typedef uint64_t PSL_Fence;
+
+typedef struct PSL_Queue PSL_Queue;
+
+/* Creates a queue executing submissions on num_threads workers, one per processor if 0 */
+PSL_API PSL_Queue* psl_queue_new(uint32_t num_threads);
+
+/* Queues the execution of the kernel over count elements, returns its fence. callback may be NULL */
+PSL_API PSL_Fence psl_kernel_submit(PSL_Queue* queue,
+                                    PSL_Kernel* kernel,
+                                    const PSL_Bindings* bindings,
+                                    size_t count,
+                                    PSL_CompletionFunc callback,
+                                    void* user_data);
+
+/* Returns the fence of the last submission */
+PSL_API PSL_Fence psl_queue_fence(PSL_Queue* queue);
+
+/* Waits until the submission of fence and all the ones before it have completed, callbacks included */
+PSL_API void psl_wait(PSL_Queue* queue, PSL_Fence fence);
+
+/* Waits for all the submissions and stops the workers */
+PSL_API void psl_queue_destroy(PSL_Queue* queue);
+
+PSL_CPP_END
+
+#endif /* !defined(__PSL_QUEUE) */
@@ -0,0 +1,74 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#pragma once
+
+#if !defined(__PSL_STREAM)
+#define __PSL_STREAM
+
+#include "psl/kernel.h"
+
+PSL_CPP_ENTER
+
+/*
+   Out-of-core execution over column files, for datasets larger than memory. Files are mapped and
+   processed window by window, so only a few windows of each column are resident at once.
+
+   Column files are either raw arrays of little-endian values in the format of their column, or
+   containers starting with a PSL_ColumnFileHeader followed by the values.
+*/
+
+#define PSL_COLUMN_FILE_MAGIC "PSLC"
+
+#define PSL_COLUMN_FILE_VERSION 1
+
+/* 64 bytes, so that the values are aligned for vector loads and stores */
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t format; /* PSL_ColumnFormat, never Default */
+    uint32_t reserved;
+    uint64_t count;
+    uint8_t padding[40];
+} PSL_ColumnFileHeader;
+
+typedef enum {
+    PSL_ColumnFileLayout_Raw,
+    PSL_ColumnFileLayout_Container,
+} PSL_ColumnFileLayout;
+
+/*
+   paths holds the file of each input and export column, in the order of PSL_Bindings::columns.
+   Inputs are read with the layout their file has, exports are created with export_layout.
+   Reductions and uniforms are bound as for psl_kernel_execute, in bindings, their entries of
+   paths are ignored
+*/
+
+typedef struct {
+    const char** paths;
+    PSL_Bindings bindings;
+    PSL_ColumnFileLayout export_layout;
+} PSL_FileBindings;
+
+typedef struct {
+    size_t count; /* elements to process, 0 to take the count of the input files which must agree */
+    size_t window_size; /* elements processed per window, rounded to a multiple of PSL_LANES */
+    PSL_ExecuteOptions execute;
+} PSL_StreamOptions;
+
+PSL_API void psl_stream_options_init(PSL_StreamOptions* options);
+
+/*
+   Executes the kernel over the columns stored in files. The next window of every input is read
+   ahead by the system while the current one is processed, and exports are written back as each
+   window completes. Returns false and sets the error of the kernel if a file cannot be accessed
+*/
+PSL_API bool psl_kernel_execute_files(PSL_Kernel* kernel,
+                                      const PSL_FileBindings* files,
+                                      const PSL_StreamOptions* options);
+
+PSL_CPP_END
+
+#endif /* !defined(__PSL_STREAM) */
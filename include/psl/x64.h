@@ -0,0 +1,247 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#pragma once
+
+#if !defined(__PSL_X64)
+#define __PSL_X64
+
+#include "psl/psl.h"
+
+PSL_CPP_ENTER
+
+/* Growable buffer machine code gets emitted into */
+
+typedef struct {
+    uint8_t* data;
+    size_t size;
+    size_t capacity;
+} PSL_CodeBuffer;
+
+PSL_API void psl_code_buffer_init(PSL_CodeBuffer* buffer, const size_t capacity);
+
+PSL_API void psl_code_buffer_emit8(PSL_CodeBuffer* buffer, uint8_t value);
+
+PSL_API void psl_code_buffer_emit32(PSL_CodeBuffer* buffer, uint32_t value);
+
+PSL_API void psl_code_buffer_emit64(PSL_CodeBuffer* buffer, uint64_t value);
+
+PSL_API void psl_code_buffer_destroy(PSL_CodeBuffer* buffer);
+
+typedef enum {
+    PSL_GPR_RAX,
+    PSL_GPR_RCX,
+    PSL_GPR_RDX,
+    PSL_GPR_RBX,
+    PSL_GPR_RSP,
+    PSL_GPR_RBP,
+    PSL_GPR_RSI,
+    PSL_GPR_RDI,
+    PSL_GPR_R8,
+    PSL_GPR_R9,
+    PSL_GPR_R10,
+    PSL_GPR_R11,
+    PSL_GPR_R12,
+    PSL_GPR_R13,
+    PSL_GPR_R14,
+    PSL_GPR_R15,
+    PSL_GPR_None = -1,
+} PSL_GPR;
+
+typedef enum {
+    PSL_Cond_B = 0x2,
+    PSL_Cond_AE = 0x3,
+    PSL_Cond_E = 0x4,
+    PSL_Cond_NE = 0x5,
+    PSL_Cond_BE = 0x6,
+    PSL_Cond_A = 0x7,
+    PSL_Cond_L = 0xC,
+    PSL_Cond_GE = 0xD,
+    PSL_Cond_LE = 0xE,
+    PSL_Cond_G = 0xF,
+} PSL_Cond;
+
+/* [base + index * scale + disp] memory operand */
+
+typedef struct {
+    PSL_GPR base;
+    PSL_GPR index;
+    uint8_t scale;
+    int32_t disp;
+} PSL_X64Mem;
+
+PSL_FORCE_INLINE PSL_X64Mem psl_x64_mem(PSL_GPR base, int32_t disp)
+{
+    PSL_X64Mem mem;
+    mem.base = base;
+    mem.index = PSL_GPR_None;
+    mem.scale = 1;
+    mem.disp = disp;
+    return mem;
+}
+
+PSL_FORCE_INLINE PSL_X64Mem psl_x64_mem_index(PSL_GPR base, PSL_GPR index, uint8_t scale, int32_t disp)
+{
+    PSL_X64Mem mem;
+    mem.base = base;
+    mem.index = index;
+    mem.scale = scale;
+    mem.disp = disp;
+    return mem;
+}
+
+/* General purpose instructions */
+
+PSL_API void psl_x64_push(PSL_CodeBuffer* buffer, PSL_GPR reg);
+
+PSL_API void psl_x64_pop(PSL_CodeBuffer* buffer, PSL_GPR reg);
+
+PSL_API void psl_x64_mov_rr(PSL_CodeBuffer* buffer, PSL_GPR dst, PSL_GPR src);
+
+PSL_API void psl_x64_mov_rm(PSL_CodeBuffer* buffer, PSL_GPR dst, const PSL_X64Mem* src);
+
+PSL_API void psl_x64_mov_mr(PSL_CodeBuffer* buffer, const PSL_X64Mem* dst, PSL_GPR src);
+
+/* mov r32, imm32 (zero extends to 64 bits) */
+PSL_API void psl_x64_mov_ri32(PSL_CodeBuffer* buffer, PSL_GPR dst, uint32_t imm);
+
+PSL_API void psl_x64_mov_ri64(PSL_CodeBuffer* buffer, PSL_GPR dst, uint64_t imm);
+
+PSL_API void psl_x64_lea(PSL_CodeBuffer* buffer, PSL_GPR dst, const PSL_X64Mem* src);
+
+PSL_API void psl_x64_add_ri(PSL_CodeBuffer* buffer, PSL_GPR dst, int32_t imm);
+
+PSL_API void psl_x64_sub_ri(PSL_CodeBuffer* buffer, PSL_GPR dst, int32_t imm);
+
+PSL_API void psl_x64_and_ri(PSL_CodeBuffer* buffer, PSL_GPR dst, int32_t imm);
+
+PSL_API void psl_x64_cmp_rr(PSL_CodeBuffer* buffer, PSL_GPR a, PSL_GPR b);
+
+PSL_API void psl_x64_xor_rr32(PSL_CodeBuffer* buffer, PSL_GPR dst, PSL_GPR src);
+
+/* test dword [mem], eax, used for stack probing */
+PSL_API void psl_x64_probe(PSL_CodeBuffer* buffer, const PSL_X64Mem* mem);
+
+/* prefetcht0 [mem], brings the cache line of mem into all the cache levels */
+PSL_API void psl_x64_prefetch(PSL_CodeBuffer* buffer, const PSL_X64Mem* mem);
+
+/* Orders the non-temporal stores before it with the stores after it */
+PSL_API void psl_x64_sfence(PSL_CodeBuffer* buffer);
+
+/* Emits a jcc with a zeroed rel32 and returns the offset to patch */
+PSL_API size_t psl_x64_jcc(PSL_CodeBuffer* buffer, PSL_Cond cond);
+
+/* Emits a jmp with a zeroed rel32 and returns the offset to patch */
+PSL_API size_t psl_x64_jmp(PSL_CodeBuffer* buffer);
+
+/* Patches the rel32 at patch_offset to jump to target_offset */
+PSL_API void psl_x64_patch_rel32(PSL_CodeBuffer* buffer, size_t patch_offset, size_t target_offset);
+
+PSL_API void psl_x64_call_r(PSL_CodeBuffer* buffer, PSL_GPR reg);
+
+/* Emits a call with a zeroed rel32 and returns the offset to patch or relocate */
+PSL_API size_t psl_x64_call_rel32(PSL_CodeBuffer* buffer);
+
+PSL_API void psl_x64_ret(PSL_CodeBuffer* buffer);
+
+/* VEX encoded instructions. All of them are described in a table in x64.c */
+
+typedef enum {
+    PSL_X64VexOp_vmovups,       /* ymm, ymm/m256 */
+    PSL_X64VexOp_vmovups_store, /* m256, ymm */
+    PSL_X64VexOp_vmovaps,       /* ymm, ymm/m256 */
+    PSL_X64VexOp_vmovaps_store, /* m256, ymm */
+    PSL_X64VexOp_vaddps,
+    PSL_X64VexOp_vsubps,
+    PSL_X64VexOp_vmulps,
+    PSL_X64VexOp_vdivps,
+    PSL_X64VexOp_vminps,
+    PSL_X64VexOp_vmaxps,
+    PSL_X64VexOp_vsqrtps,
+    PSL_X64VexOp_vandps,
+    PSL_X64VexOp_vandnps,
+    PSL_X64VexOp_vorps,
+    PSL_X64VexOp_vxorps,
+    PSL_X64VexOp_vroundps,      /* ymm, ymm/m256, imm8 */
+    PSL_X64VexOp_vcmpps,        /* ymm, ymm, ymm/m256, imm8 predicate */
+    PSL_X64VexOp_vblendvps,     /* ymm, ymm, ymm/m256, imm8 mask register in bits 7:4 */
+    PSL_X64VexOp_vbroadcastss,  /* ymm, xmm/m32 */
+    PSL_X64VexOp_vpbroadcastd,  /* ymm, xmm/m32 */
+    PSL_X64VexOp_vmovd,         /* xmm, r32/m32 */
+    PSL_X64VexOp_vaddpd,
+    PSL_X64VexOp_vsubpd,
+    PSL_X64VexOp_vmulpd,
+    PSL_X64VexOp_vdivpd,
+    PSL_X64VexOp_vminpd,
+    PSL_X64VexOp_vmaxpd,
+    PSL_X64VexOp_vsqrtpd,
+    PSL_X64VexOp_vandpd,
+    PSL_X64VexOp_vxorpd,
+    PSL_X64VexOp_vroundpd,      /* ymm, ymm/m256, imm8 */
+    PSL_X64VexOp_vcmppd,        /* ymm, ymm, ymm/m256, imm8 predicate */
+    PSL_X64VexOp_vblendvpd,     /* ymm, ymm, ymm/m256, imm8 mask register in bits 7:4 */
+    PSL_X64VexOp_vpbroadcastq,  /* ymm, xmm/m64 */
+    PSL_X64VexOp_vbroadcastsd,  /* ymm, m64 */
+    PSL_X64VexOp_vmovq,         /* xmm, r64/m64 */
+    PSL_X64VexOp_vcvtps2pd,     /* ymm, xmm/m128 */
+    PSL_X64VexOp_vcvtpd2ps,     /* xmm, ymm/m256 */
+    PSL_X64VexOp_vinsertf128,   /* ymm, ymm, xmm/m128, imm8 */
+    PSL_X64VexOp_vextractf128,  /* xmm/m128, ymm, imm8. reg is the source */
+    PSL_X64VexOp_vcvtph2ps,     /* ymm, xmm/m128 */
+    PSL_X64VexOp_vcvtps2ph,     /* xmm/m128, ymm, imm8 rounding. reg is the source */
+    PSL_X64VexOp_vcvtdq2ps,     /* ymm, ymm/m256 */
+    PSL_X64VexOp_vcvtps2dq,     /* ymm, ymm/m256 */
+    PSL_X64VexOp_vpmovzxbd,     /* ymm, xmm/m64 */
+    PSL_X64VexOp_vpmovzxwd,     /* ymm, xmm/m128 */
+    PSL_X64VexOp_vpackusdw,     /* xmm, xmm, xmm/m128 */
+    PSL_X64VexOp_vpackuswb,     /* xmm, xmm, xmm/m128 */
+    PSL_X64VexOp_vmovq_store,   /* m64, xmm */
+    PSL_X64VexOp_vmovups_store128, /* m128, xmm */
+    PSL_X64VexOp_vfmadd231ps,   /* ymm1 = ymm2 * ymm3/m256 + ymm1 */
+    PSL_X64VexOp_vfmadd231pd,
+    PSL_X64VexOp_vfnmadd231ps,  /* ymm1 = -(ymm2 * ymm3/m256) + ymm1 */
+    PSL_X64VexOp_vfnmadd231pd,
+    PSL_X64VexOp_vrcpps,        /* ymm, ymm/m256, 12 bits approximation */
+    PSL_X64VexOp_vrsqrtps,      /* ymm, ymm/m256, 12 bits approximation */
+    PSL_X64VexOp_vmovntps,      /* m256, ymm, non-temporal, m256 must be aligned on 32 bytes */
+    PSL_X64VexOp_Count,
+} PSL_X64VexOp;
+
+/* Emits op with a register operand in rm. For stores, reg is the source */
+PSL_API void psl_x64_vex_rr(PSL_CodeBuffer* buffer, PSL_X64VexOp op, uint32_t reg, uint32_t vvvv, uint32_t rm);
+
+/* Emits op with a memory operand in rm. For stores, reg is the source */
+PSL_API void psl_x64_vex_rm(PSL_CodeBuffer* buffer, PSL_X64VexOp op, uint32_t reg, uint32_t vvvv, const PSL_X64Mem* rm);
+
+PSL_API void psl_x64_vzeroupper(PSL_CodeBuffer* buffer);
+
+/* Decoding of the instructions emitted above, for disassembly and cost estimates */
+
+typedef enum {
+    PSL_X64InstClass_Vex,    /* see vex_op */
+    PSL_X64InstClass_Alu,    /* integer arithmetic, register moves and lea */
+    PSL_X64InstClass_Load,   /* mov from memory, pop, prefetch, stack probes */
+    PSL_X64InstClass_Store,  /* mov to memory, push */
+    PSL_X64InstClass_Branch, /* jcc, jmp and ret */
+    PSL_X64InstClass_Call,
+    PSL_X64InstClass_Other,  /* sfence and vzeroupper */
+} PSL_X64InstClass;
+
+#define PSL_X64_INST_TEXT_SIZE 96
+
+typedef struct {
+    uint32_t size;
+    PSL_X64InstClass inst_class;
+    PSL_X64VexOp vex_op; /* PSL_X64VexOp_Count if not a VEX instruction of the table */
+    bool memory; /* has a memory operand, lea excluded */
+    int64_t target; /* offset jcc and jmp go to, -1 for other instructions */
+    char text[PSL_X64_INST_TEXT_SIZE]; /* Intel syntax */
+} PSL_X64Inst;
+
+/* Decodes the instruction at offset of code, returns false if its bytes are not emitted by the functions above */
+PSL_API bool psl_x64_decode(const uint8_t* code, size_t size, size_t offset, PSL_X64Inst* inst);
+
+PSL_CPP_END
+
+#endif /* !defined(__PSL_X64) */
@@ -0,0 +1,333 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+/*
+   Ahead-of-time compiler. Compiles every entry point of a source, or the one given with --entry,
+   into an object defining <prefix><entry point> and writes the header describing them, or into a
+   module loaded with psl_module_load.
+
+   Usage: pslc [options] <source.psl>
+       -o <path>           object to write, the source with a .o extension by default (.so with -shared)
+       --header=<path>     header to write, the object with a .h extension by default
+       --prefix=<prefix>   prefix of the symbols, psl_ by default
+       --entry=<name>      entry point to compile, all of them by default
+       --unroll=<n>        groups of PSL_LANES elements per loop iteration, picked from the kernel by default
+       --fast-math         allows all the PSL_FastMath transformations
+       -O<level>           optimization level from 0 to 2, 2 by default
+       -shared             links the object into a shared library with $CC, cc by default. The helpers
+                           it calls are resolved from PSL when the library is loaded
+       --module            writes a module holding the optimized IR of the kernels instead of an object,
+                           the source with a .pslm extension by default
+*/
+
+#include "psl/aot.h"
+#include "psl/module.h"
+
+#include "libromano/filesystem.h"
+#include "libromano/logger.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define PSLC_PATH_SIZE 1024
+
+#define PSLC_SYMBOL_SIZE 128
+
+typedef struct {
+    const char* source;
+    const char* output;
+    const char* header;
+    const char* prefix;
+    const char* entry;
+    bool shared;
+    bool module;
+    PSL_CompileOptions compile;
+} PslcOptions;
+
+void pslc_usage(void)
+{
+    logger_log_info("Usage: pslc [-o <object>] [--header=<path>] [--prefix=<prefix>] [--entry=<name>] "
+                    "[--unroll=<n>] [--fast-math] [-O<level>] [-shared] [--module] <source.psl>");
+}
+
+bool pslc_parse_options(PslcOptions* options, int argc, char** argv)
+{
+    options->source = NULL;
+    options->output = NULL;
+    options->header = NULL;
+    options->prefix = "psl_";
+    options->entry = NULL;
+    options->shared = false;
+    options->module = false;
+    psl_compile_options_init(&options->compile);
+
+    for(int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+
+        if(strcmp(arg, "-o") == 0 && i + 1 < argc)
+        {
+            options->output = argv[++i];
+        }
+        else if(strncmp(arg, "--header=", 9) == 0)
+        {
+            options->header = arg + 9;
+        }
+        else if(strncmp(arg, "--prefix=", 9) == 0)
+        {
+            options->prefix = arg + 9;
+        }
+        else if(strncmp(arg, "--entry=", 8) == 0)
+        {
+            options->entry = arg + 8;
+        }
+        else if(strncmp(arg, "--unroll=", 9) == 0)
+        {
+            options->compile.unroll = (uint32_t)strtoul(arg + 9, NULL, 10);
+        }
+        else if(strcmp(arg, "--fast-math") == 0)
+        {
+            options->compile.fast_math = PSL_FastMath_All;
+        }
+        else if(strncmp(arg, "-O", 2) == 0 && arg[2] >= '0' && arg[2] <= '2' && arg[3] == '\0')
+        {
+            options->compile.opt_level = (PSL_OptLevel)(arg[2] - '0');
+        }
+        else if(strcmp(arg, "-shared") == 0)
+        {
+            options->shared = true;
+        }
+        else if(strcmp(arg, "--module") == 0)
+        {
+            options->module = true;
+        }
+        else if(arg[0] != '-' && options->source == NULL)
+        {
+            options->source = arg;
+        }
+        else
+        {
+            logger_log_error("Unknown option %s", arg);
+            return false;
+        }
+    }
+
+    if(options->source == NULL)
+    {
+        logger_log_error("No source given");
+        return false;
+    }
+
+    if(options->module && options->shared)
+    {
+        logger_log_error("A module cannot be linked into a shared library");
+        return false;
+    }
+
+    return true;
+}
+
+/* Copies path with its extension, if any, replaced by extension */
+void pslc_replace_extension(char* out, size_t size, const char* path, const char* extension)
+{
+    const char* dot = strrchr(path, '.');
+    const char* separator = strrchr(path, '/');
+
+    const size_t length = dot != NULL && (separator == NULL || dot > separator) ? (size_t)(dot - path) : strlen(path);
+
+    snprintf(out, size, "%.*s%s", (int)length, path, extension);
+}
+
+/* Links the object into a shared library with the C compiler of the system */
+bool pslc_link_shared(const char* object, const char* output)
+{
+    const char* compiler = getenv("CC");
+
+    char command[3 * PSLC_PATH_SIZE];
+    snprintf(command,
+             sizeof(command),
+             "\"%s\" -shared -o \"%s\" \"%s\"",
+             compiler != NULL && compiler[0] != '\0' ? compiler : "cc",
+             output,
+             object);
+
+    if(system(command) != 0)
+    {
+        logger_log_error("Cannot link %s: %s", output, command);
+        return false;
+    }
+
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    logger_init();
+
+    PslcOptions options;
+
+    if(!pslc_parse_options(&options, argc, argv))
+    {
+        pslc_usage();
+        logger_release();
+        return 1;
+    }
+
+    char output[PSLC_PATH_SIZE];
+    char object[PSLC_PATH_SIZE];
+    char header[PSLC_PATH_SIZE];
+
+    if(options.output != NULL)
+    {
+        snprintf(output, sizeof(output), "%s", options.output);
+    }
+    else
+    {
+        pslc_replace_extension(output,
+                               sizeof(output),
+                               options.source,
+                               options.module ? ".pslm" : options.shared ? ".so" : ".o");
+    }
+
+    /* The object linked into a shared library is written next to it */
+    if(options.shared)
+    {
+        pslc_replace_extension(object, sizeof(object), output, ".o");
+    }
+    else
+    {
+        snprintf(object, sizeof(object), "%s", output);
+    }
+
+    if(options.header != NULL)
+    {
+        snprintf(header, sizeof(header), "%s", options.header);
+    }
+    else
+    {
+        pslc_replace_extension(header, sizeof(header), output, ".h");
+    }
+
+    FileContent content;
+
+    if(!fs_file_content_new(options.source, &content))
+    {
+        logger_log_error("Cannot open %s", options.source);
+        logger_release();
+        return 1;
+    }
+
+    Vector* tokens = vector_new(128, sizeof(PSL_Token));
+
+    PSL_Lexer lexer;
+    psl_lexer_init(&lexer, content.content);
+
+    PSL_AST* ast = psl_ast_new();
+
+    PSL_Kernel** kernels = NULL;
+    char* symbol_names = NULL;
+    const char** symbols = NULL;
+    uint32_t num_kernels = 0;
+
+    bool success = true;
+
+    if(!psl_lexer_lex(&lexer, tokens))
+    {
+        logger_log_error("%s: %s", options.source, psl_lexer_get_error(&lexer));
+        success = false;
+    }
+    else if(!psl_ast_from_tokens(ast, tokens))
+    {
+        logger_log_error("%s:%u: %s", options.source, ast->line, ast->error);
+        success = false;
+    }
+
+    PSL_ASTSource* source = success ? PSL_AST_CAST(PSL_ASTSource, ast->root) : NULL;
+
+    /* At most one kernel per function */
+    if(success)
+    {
+        kernels = (PSL_Kernel**)malloc(source->num_functions * sizeof(PSL_Kernel*));
+        symbol_names = (char*)malloc(source->num_functions * PSLC_SYMBOL_SIZE);
+        symbols = (const char**)malloc(source->num_functions * sizeof(const char*));
+    }
+
+    for(uint32_t i = 0; success && i < source->num_functions; i++)
+    {
+        PSL_ASTFunction* func = PSL_AST_CAST(PSL_ASTFunction, source->functions[i]);
+
+        if(func == NULL || !func->is_entry_point)
+        {
+            continue;
+        }
+
+        char name[PSLC_SYMBOL_SIZE];
+        snprintf(name, sizeof(name), "%.*s", (int)func->name_length, func->name);
+
+        if(options.entry != NULL && strcmp(name, options.entry) != 0)
+        {
+            continue;
+        }
+
+        PSL_Kernel* kernel = psl_kernel_new();
+        kernels[num_kernels] = kernel;
+
+        char* symbol = symbol_names + num_kernels * PSLC_SYMBOL_SIZE;
+        snprintf(symbol, PSLC_SYMBOL_SIZE, "%s%s", options.prefix, name);
+        symbols[num_kernels] = symbol;
+        num_kernels++;
+
+        if(!psl_kernel_compile(kernel, ast, name, &options.compile))
+        {
+            logger_log_error("%s: cannot compile %s: %s", options.source, name, kernel->error);
+            success = false;
+        }
+    }
+
+    if(success && num_kernels == 0)
+    {
+        logger_log_error("%s: no entry point to compile", options.source);
+        success = false;
+    }
+
+    char* error = NULL;
+
+    if(success && options.module)
+    {
+        if(!psl_module_save(kernels, num_kernels, output, &error))
+        {
+            logger_log_error("%s", error);
+            success = false;
+        }
+    }
+    else if(success && !(psl_aot_write_object(kernels, symbols, num_kernels, object, &error) &&
+                         psl_aot_write_header(kernels, symbols, num_kernels, header, &error)))
+    {
+        logger_log_error("%s", error);
+        success = false;
+    }
+
+    if(success && options.shared)
+    {
+        success = pslc_link_shared(object, output);
+        remove(object);
+    }
+
+    for(uint32_t i = 0; i < num_kernels; i++)
+    {
+        psl_kernel_destroy(kernels[i]);
+    }
+
+    free(kernels);
+    free(symbol_names);
+    free(symbols);
+
+    psl_ast_destroy(ast);
+    vector_free(tokens);
+    fs_file_content_free(&content);
+
+    logger_release();
+
+    return success ? 0 : 1;
+}
@@ -0,0 +1,599 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#include "psl/aot.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* See the System V ABI and its AMD64 supplement */
+
+#define PSL_ELF_CLASS_64 2
+#define PSL_ELF_DATA_LSB 1
+#define PSL_ELF_VERSION 1
+#define PSL_ELF_TYPE_REL 1
+#define PSL_ELF_MACHINE_X86_64 62
+
+#define PSL_ELF_SECTION_PROGBITS 1
+#define PSL_ELF_SECTION_SYMTAB 2
+#define PSL_ELF_SECTION_STRTAB 3
+#define PSL_ELF_SECTION_RELA 4
+
+#define PSL_ELF_FLAG_ALLOC 0x2
+#define PSL_ELF_FLAG_EXECINSTR 0x4
+#define PSL_ELF_FLAG_INFO_LINK 0x40
+
+#define PSL_ELF_SYMBOL_INFO(__binding__, __type__) (uint8_t)(((__binding__) << 4) | (__type__))
+#define PSL_ELF_BINDING_LOCAL 0
+#define PSL_ELF_BINDING_GLOBAL 1
+#define PSL_ELF_SYMBOL_NOTYPE 0
+#define PSL_ELF_SYMBOL_FUNC 2
+#define PSL_ELF_SYMBOL_SECTION 3
+
+#define PSL_ELF_RELOC_X86_64_PLT32 4
+
+/* Sections of the object, in order */
+typedef enum {
+    PSL_ElfSection_Null,
+    PSL_ElfSection_Text,
+    PSL_ElfSection_RelaText,
+    PSL_ElfSection_Symtab,
+    PSL_ElfSection_Strtab,
+    PSL_ElfSection_NoteStack,
+    PSL_ElfSection_Shstrtab,
+    PSL_ElfSection_Count,
+} PSL_ElfSectionIndex;
+
+/* Kernels start on a cache line, padded with int3 */
+#define PSL_AOT_CODE_ALIGNMENT 32
+
+#define PSL_AOT_SYMBOL_SIZE 128
+
+typedef struct {
+    uint8_t ident[16];
+    uint16_t type;
+    uint16_t machine;
+    uint32_t version;
+    uint64_t entry;
+    uint64_t phoff;
+    uint64_t shoff;
+    uint32_t flags;
+    uint16_t ehsize;
+    uint16_t phentsize;
+    uint16_t phnum;
+    uint16_t shentsize;
+    uint16_t shnum;
+    uint16_t shstrndx;
+} PSL_ElfHeader;
+
+typedef struct {
+    uint32_t name;
+    uint32_t type;
+    uint64_t flags;
+    uint64_t addr;
+    uint64_t offset;
+    uint64_t size;
+    uint32_t link;
+    uint32_t info;
+    uint64_t addralign;
+    uint64_t entsize;
+} PSL_ElfSection;
+
+typedef struct {
+    uint32_t name;
+    uint8_t info;
+    uint8_t other;
+    uint16_t shndx;
+    uint64_t value;
+    uint64_t size;
+} PSL_ElfSymbol;
+
+typedef struct {
+    uint64_t offset;
+    uint64_t info;
+    int64_t addend;
+} PSL_ElfRela;
+
+typedef struct {
+    PSL_CodeBuffer text;
+    PSL_CodeBuffer strtab;
+    PSL_ElfSymbol* symbols;
+    uint32_t num_symbols;
+    PSL_ElfRela* relas;
+    uint32_t num_relas;
+    uint32_t helpers[PSL_BuiltinID_Count][2]; /* symbol of the f32 and f64 helper of each builtin, 0 if unused */
+} PSL_ElfWriter;
+
+static const char* _section_names[PSL_ElfSection_Count] = {
+    NULL,
+    ".text",
+    ".rela.text",
+    ".symtab",
+    ".strtab",
+    ".note.GNU-stack",
+    ".shstrtab",
+};
+
+uint32_t psl_aot_add_string(PSL_CodeBuffer* strtab, const char* string)
+{
+    const uint32_t offset = (uint32_t)strtab->size;
+
+    for(const char* c = string; *c != '\0'; c++)
+    {
+        psl_code_buffer_emit8(strtab, (uint8_t)*c);
+    }
+
+    psl_code_buffer_emit8(strtab, 0);
+
+    return offset;
+}
+
+uint32_t psl_aot_add_symbol(PSL_ElfWriter* writer, const char* name, uint8_t info, uint16_t shndx, uint64_t value, uint64_t size)
+{
+    writer->symbols = (PSL_ElfSymbol*)realloc(writer->symbols, (writer->num_symbols + 1) * sizeof(PSL_ElfSymbol));
+
+    PSL_ASSERT(writer->symbols != NULL, "Error during symbols reallocation");
+
+    PSL_ElfSymbol* symbol = &writer->symbols[writer->num_symbols];
+    symbol->name = name != NULL ? psl_aot_add_string(&writer->strtab, name) : 0;
+    symbol->info = info;
+    symbol->other = 0;
+    symbol->shndx = shndx;
+    symbol->value = value;
+    symbol->size = size;
+
+    return writer->num_symbols++;
+}
+
+/* Returns the undefined symbol of the vector helper called by reloc, added on first use */
+uint32_t psl_aot_helper_symbol(PSL_ElfWriter* writer, const PSL_CodeReloc* reloc)
+{
+    const uint32_t f64 = reloc->type == PSL_IRType_F64 ? 1 : 0;
+
+    if(writer->helpers[reloc->builtin][f64] == 0)
+    {
+        char name[PSL_AOT_SYMBOL_SIZE];
+        snprintf(name, sizeof(name), "psl_builtin_vector_%s%s", psl_builtin_get(reloc->builtin)->name, f64 ? "_f64" : "");
+
+        writer->helpers[reloc->builtin][f64] = psl_aot_add_symbol(writer,
+                                                                  name,
+                                                                  PSL_ELF_SYMBOL_INFO(PSL_ELF_BINDING_GLOBAL, PSL_ELF_SYMBOL_NOTYPE),
+                                                                  0,
+                                                                  0,
+                                                                  0);
+    }
+
+    return writer->helpers[reloc->builtin][f64];
+}
+
+void psl_aot_add_rela(PSL_ElfWriter* writer, uint64_t offset, uint32_t symbol)
+{
+    writer->relas = (PSL_ElfRela*)realloc(writer->relas, (writer->num_relas + 1) * sizeof(PSL_ElfRela));
+
+    PSL_ASSERT(writer->relas != NULL, "Error during relocations reallocation");
+
+    /* The rel32 is relative to the end of the call */
+    writer->relas[writer->num_relas].offset = offset;
+    writer->relas[writer->num_relas].info = ((uint64_t)symbol << 32) | PSL_ELF_RELOC_X86_64_PLT32;
+    writer->relas[writer->num_relas].addend = -4;
+    writer->num_relas++;
+}
+
+/* Emits the kernel again as relocatable code at the end of the text section */
+bool psl_aot_emit_kernel(PSL_ElfWriter* writer, PSL_Kernel* kernel, const char* symbol, char** error)
+{
+    PSL_CodegenOptions options = kernel->codegen;
+    options.relocatable = true;
+    options.streaming = false;
+
+    PSL_CodeBuffer buffer;
+    psl_code_buffer_init(&buffer, 4096);
+
+    PSL_CodeMap map;
+    psl_code_map_init(&map);
+
+    if(!psl_codegen_emit(&kernel->ir, &options, &buffer, &map, error))
+    {
+        psl_code_map_destroy(&map);
+        psl_code_buffer_destroy(&buffer);
+        return false;
+    }
+
+    while(writer->text.size % PSL_AOT_CODE_ALIGNMENT != 0)
+    {
+        psl_code_buffer_emit8(&writer->text, 0xCC);
+    }
+
+    const size_t start = writer->text.size;
+
+    for(size_t i = 0; i < buffer.size; i++)
+    {
+        psl_code_buffer_emit8(&writer->text, buffer.data[i]);
+    }
+
+    /* Helper symbols are added before the kernel one, all of them are global */
+    for(uint32_t i = 0; i < map.num_relocs; i++)
+    {
+        psl_aot_add_rela(writer, start + map.relocs[i].offset, psl_aot_helper_symbol(writer, &map.relocs[i]));
+    }
+
+    psl_aot_add_symbol(writer,
+                       symbol,
+                       PSL_ELF_SYMBOL_INFO(PSL_ELF_BINDING_GLOBAL, PSL_ELF_SYMBOL_FUNC),
+                       PSL_ElfSection_Text,
+                       start,
+                       buffer.size);
+
+    psl_code_map_destroy(&map);
+    psl_code_buffer_destroy(&buffer);
+
+    return true;
+}
+
+bool psl_aot_write_padding(FILE* file, size_t size)
+{
+    static const uint8_t zeros[8] = { 0 };
+
+    return size == 0 || fwrite(zeros, 1, size, file) == size;
+}
+
+size_t psl_aot_align(size_t offset, size_t alignment)
+{
+    return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+bool psl_aot_write_elf(PSL_ElfWriter* writer, FILE* file)
+{
+    /* String tables start with an empty string, the name of the null section */
+    PSL_CodeBuffer shstrtab;
+    psl_code_buffer_init(&shstrtab, 128);
+    psl_code_buffer_emit8(&shstrtab, 0);
+
+    PSL_ElfSection sections[PSL_ElfSection_Count];
+    memset(sections, 0, sizeof(sections));
+
+    for(uint32_t i = 1; i < PSL_ElfSection_Count; i++)
+    {
+        sections[i].name = psl_aot_add_string(&shstrtab, _section_names[i]);
+    }
+
+    const size_t text_offset = psl_aot_align(sizeof(PSL_ElfHeader), PSL_AOT_CODE_ALIGNMENT);
+    const size_t rela_offset = psl_aot_align(text_offset + writer->text.size, 8);
+    const size_t symtab_offset = rela_offset + writer->num_relas * sizeof(PSL_ElfRela);
+    const size_t strtab_offset = symtab_offset + writer->num_symbols * sizeof(PSL_ElfSymbol);
+    const size_t shstrtab_offset = strtab_offset + writer->strtab.size;
+    const size_t sections_offset = psl_aot_align(shstrtab_offset + shstrtab.size, 8);
+
+    sections[PSL_ElfSection_Text].type = PSL_ELF_SECTION_PROGBITS;
+    sections[PSL_ElfSection_Text].flags = PSL_ELF_FLAG_ALLOC | PSL_ELF_FLAG_EXECINSTR;
+    sections[PSL_ElfSection_Text].offset = text_offset;
+    sections[PSL_ElfSection_Text].size = writer->text.size;
+    sections[PSL_ElfSection_Text].addralign = PSL_AOT_CODE_ALIGNMENT;
+
+    sections[PSL_ElfSection_RelaText].type = PSL_ELF_SECTION_RELA;
+    sections[PSL_ElfSection_RelaText].flags = PSL_ELF_FLAG_INFO_LINK;
+    sections[PSL_ElfSection_RelaText].offset = rela_offset;
+    sections[PSL_ElfSection_RelaText].size = writer->num_relas * sizeof(PSL_ElfRela);
+    sections[PSL_ElfSection_RelaText].link = PSL_ElfSection_Symtab;
+    sections[PSL_ElfSection_RelaText].info = PSL_ElfSection_Text;
+    sections[PSL_ElfSection_RelaText].addralign = 8;
+    sections[PSL_ElfSection_RelaText].entsize = sizeof(PSL_ElfRela);
+
+    /* info is the first global symbol, after the null and the section ones */
+    sections[PSL_ElfSection_Symtab].type = PSL_ELF_SECTION_SYMTAB;
+    sections[PSL_ElfSection_Symtab].offset = symtab_offset;
+    sections[PSL_ElfSection_Symtab].size = writer->num_symbols * sizeof(PSL_ElfSymbol);
+    sections[PSL_ElfSection_Symtab].link = PSL_ElfSection_Strtab;
+    sections[PSL_ElfSection_Symtab].info = 2;
+    sections[PSL_ElfSection_Symtab].addralign = 8;
+    sections[PSL_ElfSection_Symtab].entsize = sizeof(PSL_ElfSymbol);
+
+    sections[PSL_ElfSection_Strtab].type = PSL_ELF_SECTION_STRTAB;
+    sections[PSL_ElfSection_Strtab].offset = strtab_offset;
+    sections[PSL_ElfSection_Strtab].size = writer->strtab.size;
+    sections[PSL_ElfSection_Strtab].addralign = 1;
+
+    /* Empty, marks the stack as non executable */
+    sections[PSL_ElfSection_NoteStack].type = PSL_ELF_SECTION_PROGBITS;
+    sections[PSL_ElfSection_NoteStack].offset = shstrtab_offset;
+    sections[PSL_ElfSection_NoteStack].addralign = 1;
+
+    sections[PSL_ElfSection_Shstrtab].type = PSL_ELF_SECTION_STRTAB;
+    sections[PSL_ElfSection_Shstrtab].offset = shstrtab_offset;
+    sections[PSL_ElfSection_Shstrtab].size = shstrtab.size;
+    sections[PSL_ElfSection_Shstrtab].addralign = 1;
+
+    PSL_ElfHeader header;
+    memset(&header, 0, sizeof(header));
+    header.ident[0] = 0x7F;
+    header.ident[1] = 'E';
+    header.ident[2] = 'L';
+    header.ident[3] = 'F';
+    header.ident[4] = PSL_ELF_CLASS_64;
+    header.ident[5] = PSL_ELF_DATA_LSB;
+    header.ident[6] = PSL_ELF_VERSION;
+    header.type = PSL_ELF_TYPE_REL;
+    header.machine = PSL_ELF_MACHINE_X86_64;
+    header.version = PSL_ELF_VERSION;
+    header.shoff = sections_offset;
+    header.ehsize = sizeof(PSL_ElfHeader);
+    header.shentsize = sizeof(PSL_ElfSection);
+    header.shnum = PSL_ElfSection_Count;
+    header.shstrndx = PSL_ElfSection_Shstrtab;
+
+    bool success = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   psl_aot_write_padding(file, text_offset - sizeof(header)) &&
+                   fwrite(writer->text.data, 1, writer->text.size, file) == writer->text.size &&
+                   psl_aot_write_padding(file, rela_offset - text_offset - writer->text.size) &&
+                   fwrite(writer->relas, sizeof(PSL_ElfRela), writer->num_relas, file) == writer->num_relas &&
+                   fwrite(writer->symbols, sizeof(PSL_ElfSymbol), writer->num_symbols, file) == writer->num_symbols &&
+                   fwrite(writer->strtab.data, 1, writer->strtab.size, file) == writer->strtab.size &&
+                   fwrite(shstrtab.data, 1, shstrtab.size, file) == shstrtab.size &&
+                   psl_aot_write_padding(file, sections_offset - shstrtab_offset - shstrtab.size) &&
+                   fwrite(sections, sizeof(PSL_ElfSection), PSL_ElfSection_Count, file) == PSL_ElfSection_Count;
+
+    psl_code_buffer_destroy(&shstrtab);
+
+    return success;
+}
+
+bool psl_aot_write_object(PSL_Kernel** kernels,
+                          const char** symbols,
+                          uint32_t num_kernels,
+                          const char* path,
+                          char** error)
+{
+#if !defined(PSL_LINUX) || !defined(PSL_X64)
+    (void)kernels;
+    (void)symbols;
+    (void)num_kernels;
+    (void)path;
+    *error = "ELF objects can only be written on x86-64 Linux";
+    return false;
+#else
+    PSL_ElfWriter writer;
+    psl_code_buffer_init(&writer.text, 4096);
+    psl_code_buffer_init(&writer.strtab, 256);
+    writer.symbols = NULL;
+    writer.num_symbols = 0;
+    writer.relas = NULL;
+    writer.num_relas = 0;
+    memset(writer.helpers, 0, sizeof(writer.helpers));
+
+    psl_code_buffer_emit8(&writer.strtab, 0);
+
+    psl_aot_add_symbol(&writer, NULL, 0, 0, 0, 0);
+    psl_aot_add_symbol(&writer, NULL, PSL_ELF_SYMBOL_INFO(PSL_ELF_BINDING_LOCAL, PSL_ELF_SYMBOL_SECTION), PSL_ElfSection_Text, 0, 0);
+
+    bool success = true;
+
+    for(uint32_t i = 0; success && i < num_kernels; i++)
+    {
+        if(kernels[i]->code == NULL)
+        {
+            *error = "Cannot write a kernel that has not been compiled";
+            success = false;
+        }
+        else
+        {
+            success = psl_aot_emit_kernel(&writer, kernels[i], symbols[i], error);
+        }
+    }
+
+    if(success)
+    {
+        FILE* file = fopen(path, "wb");
+
+        if(file == NULL)
+        {
+            *error = "Cannot open the object file";
+            success = false;
+        }
+        else
+        {
+            success = psl_aot_write_elf(&writer, file);
+            success &= fclose(file) == 0;
+
+            if(!success)
+            {
+                *error = "Cannot write the object file";
+            }
+        }
+    }
+
+    psl_code_buffer_destroy(&writer.text);
+    psl_code_buffer_destroy(&writer.strtab);
+    free(writer.symbols);
+    free(writer.relas);
+
+    return success;
+#endif /* !defined(PSL_LINUX) || !defined(PSL_X64) */
+}
+
+static const char* _kind_names[] = {
+    "PSL_IRParamKind_Input",
+    "PSL_IRParamKind_Export",
+    "PSL_IRParamKind_Uniform",
+    "PSL_IRParamKind_Reduction",
+    "PSL_IRParamKind_Dropped",
+};
+
+static const char* _kind_comments[] = { "input", "export", "uniform", "reduction", "unused" };
+
+static const char* _type_names[] = { "PSL_IRType_F32", "PSL_IRType_F64" };
+
+static const char* _format_names[] = {
+    "PSL_ColumnFormat_Default",
+    "PSL_ColumnFormat_F32",
+    "PSL_ColumnFormat_F64",
+    "PSL_ColumnFormat_F16",
+    "PSL_ColumnFormat_Unorm8",
+    "PSL_ColumnFormat_Unorm16",
+};
+
+static const char* _format_comments[] = { "default", "f32", "f64", "f16", "unorm8", "unorm16" };
+
+static const char* _reduce_op_names[] = { "PSL_IRReduceOp_Sum", "PSL_IRReduceOp_Min", "PSL_IRReduceOp_Max" };
+
+static const char* _reduce_op_comments[] = { "sum", "min", "max" };
+
+static const char* _components = "xyzw";
+
+/* Writes the name of the parameter, with its component if it belongs to a vector */
+void psl_aot_write_param_name(FILE* file, PSL_IR* ir, uint32_t index)
+{
+    const PSL_IRParam* param = &ir->params[index];
+
+    const bool vector = param->component > 0 ||
+                        (index + 1 < ir->num_params && ir->params[index + 1].component > 0 &&
+                         ir->params[index + 1].name == param->name);
+
+    fprintf(file, "%.*s", (int)param->name_length, param->name);
+
+    if(vector && param->component < 4)
+    {
+        fprintf(file, ".%c", _components[param->component]);
+    }
+}
+
+void psl_aot_write_kernel_header(FILE* file, PSL_Kernel* kernel, const char* symbol)
+{
+    PSL_IR* ir = &kernel->ir;
+
+    fprintf(file, "/*\n   %s\n", kernel->name);
+
+    for(uint32_t i = 0; i < ir->num_params; i++)
+    {
+        const PSL_IRParam* param = &ir->params[i];
+
+        fprintf(file, "   %s %u: ", param->kind == PSL_IRParamKind_Uniform ? "uniform" : "column", param->index);
+        psl_aot_write_param_name(file, ir, i);
+
+        if(param->kind == PSL_IRParamKind_Uniform)
+        {
+            fprintf(file, ", %s\n", param->type == PSL_IRType_F64 ? "f64" : "f32");
+        }
+        else if(param->kind == PSL_IRParamKind_Reduction)
+        {
+            fprintf(file, ", %s %s reduction\n", param->type == PSL_IRType_F64 ? "f64" : "f32", _reduce_op_comments[param->reduce_op]);
+        }
+        else
+        {
+            fprintf(file, ", %s %s\n", _format_comments[param->format], _kind_comments[param->kind]);
+        }
+    }
+
+    fprintf(file, "*/\n");
+    fprintf(file, "void %s(const PSL_KernelArgs* args);\n\n", symbol);
+
+    fprintf(file, "static inline const PSL_AOTKernel* %s_kernel(void)\n{\n", symbol);
+    fprintf(file, "    static const PSL_IRParam params[] = {\n");
+
+    for(uint32_t i = 0; i < ir->num_params; i++)
+    {
+        const PSL_IRParam* param = &ir->params[i];
+
+        fprintf(file,
+                "        { (char*)\"%.*s\", %u, %s, %s, %s, %s, %u, %u, %u },\n",
+                (int)param->name_length,
+                param->name,
+                param->name_length,
+                _kind_names[param->kind],
+                _type_names[param->type],
+                _format_names[param->format],
+                _reduce_op_names[param->reduce_op],
+                param->index,
+                param->reduction,
+                param->component);
+    }
+
+    /* C does not allow empty initializers, kernels without parameters get a placeholder */
+    if(ir->num_params == 0)
+    {
+        fprintf(file, "        { (char*)\"\", 0, PSL_IRParamKind_Dropped, PSL_IRType_F32, PSL_ColumnFormat_F32, PSL_IRReduceOp_Sum, 0, 0, 0 },\n");
+    }
+
+    fprintf(file, "    };\n\n");
+    fprintf(file,
+            "    static const PSL_AOTKernel kernel = { \"%s\", %s, params, %u, %u, %u, %u };\n\n",
+            kernel->name,
+            symbol,
+            ir->num_params,
+            ir->num_columns,
+            ir->num_uniforms,
+            ir->num_reductions);
+    fprintf(file, "    return &kernel;\n}\n\n");
+
+    fprintf(file, "static inline void %s_execute(const PSL_Bindings* bindings, size_t count)\n{\n", symbol);
+    fprintf(file, "    psl_aot_execute(%s_kernel(), bindings, count);\n}\n\n", symbol);
+}
+
+bool psl_aot_write_header(PSL_Kernel** kernels,
+                          const char** symbols,
+                          uint32_t num_kernels,
+                          const char* path,
+                          char** error)
+{
+    FILE* file = fopen(path, "w");
+
+    if(file == NULL)
+    {
+        *error = "Cannot open the header file";
+        return false;
+    }
+
+    fprintf(file, "/* Generated by pslc, do not edit */\n\n");
+    fprintf(file, "#pragma once\n\n");
+    fprintf(file, "#include \"psl/aot.h\"\n\n");
+    fprintf(file, "PSL_CPP_ENTER\n\n");
+
+    for(uint32_t i = 0; i < num_kernels; i++)
+    {
+        psl_aot_write_kernel_header(file, kernels[i], symbols[i]);
+    }
+
+    fprintf(file, "PSL_CPP_END\n");
+
+    if(ferror(file) != 0 || fclose(file) != 0)
+    {
+        *error = "Cannot write the header file";
+        return false;
+    }
+
+    return true;
+}
+
+void psl_aot_execute(const PSL_AOTKernel* kernel, const PSL_Bindings* bindings, size_t count)
+{
+    /* Drives the code like a compiled kernel that is never recompiled, nor has variants */
+    PSL_Kernel shell;
+    memset(&shell, 0, sizeof(shell));
+    strncpy(shell.name, kernel->name, PSL_KERNEL_NAME_SIZE - 1);
+    psl_ir_init(&shell.ir);
+    shell.ir.params = (PSL_IRParam*)kernel->params;
+    shell.ir.num_params = kernel->num_params;
+    shell.ir.num_columns = kernel->num_columns;
+    shell.ir.num_uniforms = kernel->num_uniforms;
+    shell.ir.num_reductions = kernel->num_reductions;
+    shell.func = kernel->func;
+    psl_codegen_options_init(&shell.codegen);
+
+    for(uint32_t i = 0; i < kernel->num_params; i++)
+    {
+        const PSL_IRParam* param = &kernel->params[i];
+
+        if((param->kind == PSL_IRParamKind_Export || param->kind == PSL_IRParamKind_Reduction) && param->index < 64)
+        {
+            shell.export_mask |= (uint64_t)1 << param->index;
+        }
+    }
+
+    /* Streaming and prefetching would need code that was not compiled */
+    PSL_ExecuteOptions options;
+    psl_execute_options_init(&options);
+    options.streaming_threshold = 0;
+    options.prefetch_distance = 0;
+
+    psl_kernel_execute_with_options(&shell, bindings, count, &options);
+}
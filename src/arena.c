@@ -3,15 +3,28 @@
 /* All rights reserved. */
 
 #include "psl/arena.h"
+#include "psl/profile.h"
 
 #include <stdlib.h>
 #include <string.h>
 
+/* The capacity of a block follows the pointer to the previous one in its header */
+PSL_FORCE_INLINE size_t* psl_arena_block_capacity(void* block)
+{
+    return (size_t*)((char*)block + sizeof(void*));
+}
+
 void psl_arena_init(Arena* arena, const size_t size)
 {
-    arena->ptr = malloc(size);
-    arena->offset = 0;
-    arena->capacity = size;
+    arena->capacity = size > ARENA_BLOCK_HEADER_SIZE ? size : 2 * ARENA_BLOCK_HEADER_SIZE;
+    arena->ptr = malloc(arena->capacity);
+    psl_profile_alloc(arena->capacity);
+
+    *(void**)arena->ptr = NULL;
+    *psl_arena_block_capacity(arena->ptr) = arena->capacity;
+    arena->offset = ARENA_BLOCK_HEADER_SIZE;
+    arena->size = 0;
+    arena->spare = NULL;
 }
 
 PSL_FORCE_INLINE bool psl_arena_check_resize(Arena* arena, 
@@ -20,23 +33,59 @@ PSL_FORCE_INLINE bool psl_arena_check_resize(Arena* arena,
     return (arena->offset + new_size) >= arena->capacity;
 }
 
-void psl_arena_resize(Arena* arena)
+void psl_arena_resize(Arena* arena, const size_t data_size)
 {
-    const size_t new_capacity = (size_t)((float)arena->capacity * ARENA_GROWTH_RATE);
+    size_t new_capacity = (size_t)((float)arena->capacity * ARENA_GROWTH_RATE);
+
+    if(new_capacity < ARENA_BLOCK_HEADER_SIZE + data_size)
+    {
+        new_capacity = ARENA_BLOCK_HEADER_SIZE + data_size;
+    }
+
+    void* new_ptr = NULL;
+
+    /* Spares are chained back in the order they have been released, larger ones come later */
+    if(arena->spare != NULL)
+    {
+        void* spare = arena->spare;
+        arena->spare = *(void**)spare;
+
+        if(*psl_arena_block_capacity(spare) >= ARENA_BLOCK_HEADER_SIZE + data_size)
+        {
+            new_ptr = spare;
+            new_capacity = *psl_arena_block_capacity(spare);
+        }
+        else
+        {
+            free(spare);
+        }
+    }
+
+    if(new_ptr == NULL)
+    {
+        new_ptr = malloc(new_capacity);
 
-    void* new_ptr = realloc(arena->ptr, new_capacity);
+        PSL_ASSERT(new_ptr != NULL, "Error during arena reallocation");
+
+        psl_profile_alloc(new_capacity);
+    }
 
-    PSL_ASSERT(new_ptr != NULL, "Error during arena reallocation");
+    /* The previous block keeps the data already pushed, its pointers must stay valid */
+    *(void**)new_ptr = arena->ptr;
+    *psl_arena_block_capacity(new_ptr) = new_capacity;
 
     arena->ptr = new_ptr;
     arena->capacity = new_capacity;
+    arena->offset = ARENA_BLOCK_HEADER_SIZE;
 }
 
 void* psl_arena_push(Arena* arena, void* data, const size_t data_size)
 {
-    if(psl_arena_check_resize(arena, data_size))
+    const bool resized = psl_arena_check_resize(arena, data_size);
+
+    if(resized)
     {
-        psl_arena_resize(arena);
+        psl_arena_resize(arena, data_size);
     }
 
     void* data_address = (void*)((char*)arena->ptr + arena->offset);
@@ -47,23 +96,76 @@ void* psl_arena_push(Arena* arena, void* data, const size_t data_size)
     }
 
     arena->offset += data_size;
+    arena->size += data_size;
+
+    psl_profile_arena(arena->size, resized);
 
     return data_address;
 }
 
-void* psl_arena_at(Arena* arena, const size_t offset)
+ArenaMark psl_arena_mark(Arena* arena)
 {
-    PSL_ASSERT(offset < arena->capacity, "offset too large");
+    ArenaMark mark;
+    mark.block = arena->ptr;
+    mark.offset = arena->offset;
+    mark.size = arena->size;
 
-    void* data_address = (char*)arena->ptr + offset;
+    return mark;
+}
 
-    return data_address;
+void psl_arena_rollback(Arena* arena, const ArenaMark* mark)
+{
+    while(arena->ptr != mark->block)
+    {
+        void* block = arena->ptr;
+
+        PSL_ASSERT(*(void**)block != NULL, "Mark does not belong to the arena");
+
+        arena->ptr = *(void**)block;
+
+        *(void**)block = arena->spare;
+        arena->spare = block;
+    }
+
+    arena->capacity = *psl_arena_block_capacity(arena->ptr);
+    arena->offset = mark->offset;
+    arena->size = mark->size;
+}
+
+void psl_arena_reset(Arena* arena)
+{
+    ArenaMark mark;
+    mark.block = arena->ptr;
+    mark.offset = ARENA_BLOCK_HEADER_SIZE;
+    mark.size = 0;
+
+    while(*(void**)mark.block != NULL)
+    {
+        mark.block = *(void**)mark.block;
+    }
+
+    psl_arena_rollback(arena, &mark);
+}
+
+void psl_arena_free_blocks(void* block)
+{
+    while(block != NULL)
+    {
+        void* previous = *(void**)block;
+        free(block);
+        block = previous;
+    }
 }
 
 void psl_arena_destroy(Arena* arena)
 {
-    free(arena->ptr);
+    psl_arena_free_blocks(arena->ptr);
+    psl_arena_free_blocks(arena->spare);
+
+    arena->spare = NULL;
+
     arena->ptr = NULL;
     arena->offset = 0;
     arena->capacity = 0;
+    arena->size = 0;
 }
\ No newline at end of file
@@ -4,10 +4,10 @@
 
 #include "psl/ast.h"
 #include "psl/lexer.h"
-
-#include "libromano/stack_no_alloc.h"
+#include "psl/profile.h"
 
 #include <string.h>
+#include <stdlib.h>
 
 PSL_AST* psl_ast_new()
 {
@@ -15,18 +15,58 @@ PSL_AST* psl_ast_new()
     psl_arena_init(&new_ast->nodes_data, 4096);
     new_ast->root = NULL;
     new_ast->error = NULL;
+    new_ast->line = 0;
+    new_ast->scratch = (PSL_ASTNode**)malloc(PSL_AST_SCRATCH_CAPACITY * sizeof(PSL_ASTNode*));
+    psl_profile_alloc(PSL_AST_SCRATCH_CAPACITY * sizeof(PSL_ASTNode*));
+    new_ast->scratch_size = 0;
+    new_ast->scratch_capacity = PSL_AST_SCRATCH_CAPACITY;
 
     return new_ast;
 }
 
+void psl_ast_reset(PSL_AST* ast)
+{
+    psl_arena_reset(&ast->nodes_data);
+    ast->root = NULL;
+    ast->error = NULL;
+    ast->line = 0;
+    ast->scratch_size = 0;
+}
+
+void* psl_ast_push_node(PSL_AST* ast, size_t size)
+{
+    psl_profile_node();
+
+    return psl_arena_push(&ast->nodes_data, NULL, size);
+}
+
+/* Copies the child array of a node to the arena */
+PSL_ASTNode** psl_ast_push_nodes(PSL_AST* ast, PSL_ASTNode** nodes, uint32_t num_nodes)
+{
+    return (PSL_ASTNode**)psl_arena_push(&ast->nodes_data, nodes, num_nodes * sizeof(PSL_ASTNode*));
+}
+
+void psl_ast_scratch_push(PSL_AST* ast, PSL_ASTNode* node)
+{
+    if(ast->scratch_size == ast->scratch_capacity)
+    {
+        ast->scratch_capacity *= 2;
+        ast->scratch = (PSL_ASTNode**)realloc(ast->scratch, ast->scratch_capacity * sizeof(PSL_ASTNode*));
+        PSL_ASSERT(ast->scratch != NULL, "Error during scratch reallocation");
+        psl_profile_alloc(ast->scratch_capacity * sizeof(PSL_ASTNode*));
+    }
+
+    ast->scratch[ast->scratch_size++] = node;
+}
+
 PSL_ASTNode* psl_ast_new_source(PSL_AST* ast,
                                 PSL_ASTNode** functions,
                                 uint32_t num_functions)
 {
-    PSL_ASTSource* src = (PSL_ASTSource*)psl_arena_push(&ast->nodes_data, NULL, sizeof(PSL_ASTFunction));
+    PSL_ASTSource* src = (PSL_ASTSource*)psl_ast_push_node(ast, sizeof(PSL_ASTFunction));
     src->base.type = PSL_ASTNodeType_PSL_ASTSource;
-    src->functions = (PSL_ASTNode**)malloc(num_functions * sizeof(PSL_ASTNode*));
-    memcpy(src->functions, functions, num_functions * sizeof(PSL_ASTNode*));
+    src->base.line = ast->line;
+    src->functions = psl_ast_push_nodes(ast, functions, num_functions);
     src->num_functions = num_functions;
 
     return (PSL_ASTNode*)src;
@@ -38,16 +78,18 @@ PSL_ASTNode* psl_ast_new_function(PSL_AST* ast,
                                   PSL_ASTNode** parameters,
                                   uint32_t num_parameters,
                                   PSL_ASTNode* body,
+                                  PSL_ASTValueType return_type,
                                   bool is_entry_point)
 {
-    PSL_ASTFunction* func = (PSL_ASTFunction*)psl_arena_push(&ast->nodes_data, NULL, sizeof(PSL_ASTFunction));
+    PSL_ASTFunction* func = (PSL_ASTFunction*)psl_ast_push_node(ast, sizeof(PSL_ASTFunction));
     func->base.type = PSL_ASTNodeType_PSL_ASTFunction;
+    func->base.line = ast->line;
     func->name = name;
     func->name_length = name_length;
-    func->parameters = (PSL_ASTNode**)malloc(num_parameters * sizeof(PSL_ASTNode*));
-    memcpy(func->parameters, parameters, num_parameters * sizeof(PSL_ASTNode*));
+    func->parameters = psl_ast_push_nodes(ast, parameters, num_parameters);
     func->num_parameters = num_parameters;
     func->body = body;
+    func->return_type = return_type;
     func->is_entry_point = is_entry_point;
 
     return (PSL_ASTNode*)func;
@@ -56,13 +98,20 @@ PSL_ASTNode* psl_ast_new_function(PSL_AST* ast,
 PSL_ASTNode* psl_ast_new_parameter(PSL_AST* ast,
                                    char* name,
                                    uint32_t name_length,
-                                   bool exportable)
+                                   PSL_ASTValueType value_type,
+                                   bool exportable,
+                                   bool uniform,
+                                   PSL_ASTReduceOp reduce_op)
 {
-    PSL_ASTParameter* param = (PSL_ASTParameter*)psl_arena_push(&ast->nodes_data, NULL, sizeof(PSL_ASTParameter));
+    PSL_ASTParameter* param = (PSL_ASTParameter*)psl_ast_push_node(ast, sizeof(PSL_ASTParameter));
     param->base.type = PSL_ASTNodeType_PSL_ASTParameter;
+    param->base.line = ast->line;
     param->name = name;
     param->name_length = name_length;
+    param->value_type = value_type;
     param->exportable = exportable;
+    param->uniform = uniform;
+    param->reduce_op = reduce_op;
 
     return (PSL_ASTNode*)param;
 }
@@ -71,10 +120,10 @@ PSL_ASTNode* psl_ast_new_block(PSL_AST* ast,
                                PSL_ASTNode** statements,
                                uint32_t num_statements)
 {
-    PSL_ASTBlock* block = (PSL_ASTBlock*)psl_arena_push(&ast->nodes_data, NULL, sizeof(PSL_ASTBlock));
+    PSL_ASTBlock* block = (PSL_ASTBlock*)psl_ast_push_node(ast, sizeof(PSL_ASTBlock));
     block->base.type = PSL_ASTNodeType_PSL_ASTBlock;
-    block->statements = (PSL_ASTNode**)malloc(num_statements * sizeof(PSL_ASTNode*));
-    memcpy(block->statements, statements, num_statements * sizeof(PSL_ASTNode*));
+    block->base.line = ast->line;
+    block->statements = psl_ast_push_nodes(ast, statements, num_statements);
     block->num_statements = num_statements;
 
     return (PSL_ASTNode*)block;
@@ -83,8 +132,9 @@ PSL_ASTNode* psl_ast_new_block(PSL_AST* ast,
 PSL_ASTNode* psl_ast_new_return(PSL_AST* ast, 
                                 PSL_ASTNode* statement)
 {
-    PSL_ASTReturn* ret = (PSL_ASTReturn*)psl_arena_push(&ast->nodes_data, NULL, sizeof(PSL_ASTReturn));
+    PSL_ASTReturn* ret = (PSL_ASTReturn*)psl_ast_push_node(ast, sizeof(PSL_ASTReturn));
     ret->base.type = PSL_ASTNodeType_PSL_ASTReturn;
+    ret->base.line = ast->line;
     ret->statement = statement;
 
     return (PSL_ASTNode*)ret;
@@ -94,8 +144,9 @@ PSL_ASTNode* psl_ast_new_assignment(PSL_AST* ast,
                                     PSL_ASTNode* lvalue,
                                     PSL_ASTNode* rvalue)
 {
-    PSL_ASTAssignment* assignment = (PSL_ASTAssignment*)psl_arena_push(&ast->nodes_data, NULL, sizeof(PSL_ASTAssignment));
+    PSL_ASTAssignment* assignment = (PSL_ASTAssignment*)psl_ast_push_node(ast, sizeof(PSL_ASTAssignment));
     assignment->base.type = PSL_ASTNodeType_PSL_ASTAssignment;
+    assignment->base.line = ast->line;
     assignment->lvalue = lvalue;
     assignment->rvalue = rvalue;
 
@@ -107,8 +158,9 @@ PSL_ASTNode* psl_ast_new_binop(PSL_AST* ast,
                                PSL_ASTNode* left,
                                PSL_ASTNode* right)
 {
-    PSL_ASTBinOP* binop = (PSL_ASTBinOP*)psl_arena_push(&ast->nodes_data, NULL, sizeof(PSL_ASTBinOP));
+    PSL_ASTBinOP* binop = (PSL_ASTBinOP*)psl_ast_push_node(ast, sizeof(PSL_ASTBinOP));
     binop->base.type = PSL_ASTNodeType_PSL_ASTBinOP;
+    binop->base.line = ast->line;
     binop->op = op;
     binop->left = left;
     binop->right = right;
@@ -120,8 +172,9 @@ PSL_ASTNode* psl_ast_new_unop(PSL_AST* ast,
                               PSL_ASTUnOPType op,
                               PSL_ASTNode* operand)
 {
-    PSL_ASTUnOP* unop = (PSL_ASTUnOP*)psl_arena_push(&ast->nodes_data, NULL, sizeof(PSL_ASTUnOP));
+    PSL_ASTUnOP* unop = (PSL_ASTUnOP*)psl_ast_push_node(ast, sizeof(PSL_ASTUnOP));
     unop->base.type = PSL_ASTNodeType_PSL_ASTUnOP;
+    unop->base.line = ast->line;
     unop->op = op;
     unop->operand = operand;
 
@@ -134,22 +187,23 @@ PSL_ASTNode* psl_ast_new_function_call(PSL_AST* ast,
                                        PSL_ASTNode** arguments,
                                        uint32_t num_arguments)
 {
-    PSL_ASTFunctionCall* funccall = (PSL_ASTFunctionCall*)psl_arena_push(&ast->nodes_data, NULL, sizeof(PSL_ASTFunctionCall));
+    PSL_ASTFunctionCall* funccall = (PSL_ASTFunctionCall*)psl_ast_push_node(ast, sizeof(PSL_ASTFunctionCall));
     funccall->base.type = PSL_ASTNodeType_PSL_ASTFunctionCall;
+    funccall->base.line = ast->line;
     funccall->name = name;
     funccall->name_length = name_length;
-    funccall->arguments = (PSL_ASTNode**)malloc(num_arguments * sizeof(PSL_ASTNode*));
-    memcpy(funccall->arguments, arguments, num_arguments * sizeof(PSL_ASTNode*));
+    funccall->arguments = psl_ast_push_nodes(ast, arguments, num_arguments);
     funccall->num_arguments = num_arguments;
 
     return (PSL_ASTNode*)funccall;
 }
 
 PSL_ASTNode* psl_ast_new_literal(PSL_AST* ast,
-                                 float value)
+                                 double value)
 {
-    PSL_ASTLiteral* lit = (PSL_ASTLiteral*)psl_arena_push(&ast->nodes_data, NULL, sizeof(PSL_ASTLiteral));
+    PSL_ASTLiteral* lit = (PSL_ASTLiteral*)psl_ast_push_node(ast, sizeof(PSL_ASTLiteral));
     lit->base.type = PSL_ASTNodeType_PSL_ASTLiteral;
+    lit->base.line = ast->line;
     lit->value = value;
 
     return (PSL_ASTNode*)lit;
@@ -159,17 +213,161 @@ PSL_ASTNode* psl_ast_new_variable(PSL_AST* ast,
                                   char* name,
                                   uint32_t name_length)
 {
-    PSL_ASTVariable* var = (PSL_ASTVariable*)psl_arena_push(&ast->nodes_data, NULL, sizeof(PSL_ASTVariable));
+    PSL_ASTVariable* var = (PSL_ASTVariable*)psl_ast_push_node(ast, sizeof(PSL_ASTVariable));
     var->base.type = PSL_ASTNodeType_PSL_ASTVariable;
+    var->base.line = ast->line;
     var->name = name;
     var->name_length = name_length;
 
     return (PSL_ASTNode*)var;
 }
 
+PSL_ASTNode* psl_ast_new_ternary(PSL_AST* ast,
+                                 PSL_ASTNode* condition,
+                                 PSL_ASTNode* if_true,
+                                 PSL_ASTNode* if_false)
+{
+    PSL_ASTTernary* ternary = (PSL_ASTTernary*)psl_ast_push_node(ast, sizeof(PSL_ASTTernary));
+    ternary->base.type = PSL_ASTNodeType_PSL_ASTTernary;
+    ternary->base.line = ast->line;
+    ternary->condition = condition;
+    ternary->if_true = if_true;
+    ternary->if_false = if_false;
+
+    return (PSL_ASTNode*)ternary;
+}
+
+PSL_ASTNode* psl_ast_new_cast(PSL_AST* ast,
+                              PSL_ASTValueType value_type,
+                              PSL_ASTNode* operand)
+{
+    PSL_ASTCast* cast = (PSL_ASTCast*)psl_ast_push_node(ast, sizeof(PSL_ASTCast));
+    cast->base.type = PSL_ASTNodeType_PSL_ASTCast;
+    cast->base.line = ast->line;
+    cast->value_type = value_type;
+    cast->operand = operand;
+
+    return (PSL_ASTNode*)cast;
+}
+
+PSL_ASTNode* psl_ast_new_constructor(PSL_AST* ast,
+                                     PSL_ASTValueType value_type,
+                                     PSL_ASTNode** arguments,
+                                     uint32_t num_arguments)
+{
+    PSL_ASTConstructor* constructor = (PSL_ASTConstructor*)psl_ast_push_node(ast, sizeof(PSL_ASTConstructor));
+    constructor->base.type = PSL_ASTNodeType_PSL_ASTConstructor;
+    constructor->base.line = ast->line;
+    constructor->value_type = value_type;
+    constructor->arguments = psl_ast_push_nodes(ast, arguments, num_arguments);
+    constructor->num_arguments = num_arguments;
+
+    return (PSL_ASTNode*)constructor;
+}
+
+PSL_ASTNode* psl_ast_new_swizzle(PSL_AST* ast,
+                                 PSL_ASTNode* operand,
+                                 const uint32_t* components,
+                                 uint32_t num_components)
+{
+    PSL_ASTSwizzle* swizzle = (PSL_ASTSwizzle*)psl_ast_push_node(ast, sizeof(PSL_ASTSwizzle));
+    swizzle->base.type = PSL_ASTNodeType_PSL_ASTSwizzle;
+    swizzle->base.line = ast->line;
+    swizzle->operand = operand;
+    memcpy(swizzle->components, components, num_components * sizeof(uint32_t));
+    swizzle->num_components = num_components;
+
+    return (PSL_ASTNode*)swizzle;
+}
+
+PSL_FORCE_INLINE bool psl_ast_is_type_token(const PSL_Token* token)
+{
+    return token->type == PSL_TokenType_Keyword &&
+           (token->subtype == PSL_KeywordType_f32 ||
+            token->subtype == PSL_KeywordType_f64 ||
+            token->subtype == PSL_KeywordType_Vec2 ||
+            token->subtype == PSL_KeywordType_Vec3 ||
+            token->subtype == PSL_KeywordType_Vec4);
+}
+
+PSL_FORCE_INLINE PSL_ASTValueType psl_ast_token_to_value_type(const PSL_Token* token)
+{
+    switch(token->subtype)
+    {
+        case PSL_KeywordType_f64:
+            return PSL_ASTValueType_F64;
+        case PSL_KeywordType_Vec2:
+            return PSL_ASTValueType_Vec2;
+        case PSL_KeywordType_Vec3:
+            return PSL_ASTValueType_Vec3;
+        case PSL_KeywordType_Vec4:
+            return PSL_ASTValueType_Vec4;
+        default:
+            return PSL_ASTValueType_F32;
+    }
+}
+
+/* Parses the components following a dot, from either xyzw or rgba */
+bool psl_ast_parse_swizzle(PSL_AST* ast, PSL_Parser* parser, uint32_t* components, uint32_t* num_components)
+{
+    static const char* component_sets[2] = { "xyzw", "rgba" };
+
+    psl_parser_advance(parser); /* Consume . */
+
+    PSL_Token* token = psl_parser_current_token(parser);
+
+    if(token->type != PSL_TokenType_Identifier || token->length > PSL_AST_MAX_COMPONENTS)
+    {
+        ast->error = "Expected up to four components after '.'";
+        return false;
+    }
+
+    const char* set = memchr(component_sets[0], token->start[0], 4) != NULL ? component_sets[0] : component_sets[1];
+
+    for(uint32_t i = 0; i < token->length; i++)
+    {
+        const char* component = (const char*)memchr(set, token->start[i], 4);
+
+        if(component == NULL)
+        {
+            ast->error = "Unknown swizzle component, expected xyzw or rgba";
+            return false;
+        }
+
+        components[i] = (uint32_t)(component - set);
+    }
+
+    *num_components = token->length;
+
+    psl_parser_advance(parser); /* Consume components */
+
+    return true;
+}
+
+PSL_ASTReduceOp psl_ast_token_to_reduce_op(const PSL_Token* token)
+{
+    if(token->length == 3 && strncmp(token->start, "sum", 3) == 0)
+    {
+        return PSL_ASTReduceOp_Sum;
+    }
+
+    if(token->length == 3 && strncmp(token->start, "min", 3) == 0)
+    {
+        return PSL_ASTReduceOp_Min;
+    }
+
+    if(token->length == 3 && strncmp(token->start, "max", 3) == 0)
+    {
+        return PSL_ASTReduceOp_Max;
+    }
+
+    return PSL_ASTReduceOp_None;
+}
+
 PSL_ASTBinOPType psl_ast_token_op_to_binop(const PSL_Token* token)
 {
     char op_char = *(token->start);
+    bool or_equal = token->length == 2 && token->start[1] == '=';
 
     switch (op_char) 
     {
@@ -181,6 +379,14 @@ PSL_ASTBinOPType psl_ast_token_op_to_binop(const PSL_Token* token)
             return PSL_ASTBinOPType_Mul;
         case '/':  
             return PSL_ASTBinOPType_Div;
+        case '<':
+            return or_equal ? PSL_ASTBinOPType_Le : PSL_ASTBinOPType_Lt;
+        case '>':
+            return or_equal ? PSL_ASTBinOPType_Ge : PSL_ASTBinOPType_Gt;
+        case '=':
+            return PSL_ASTBinOPType_Eq;
+        case '!':
+            return PSL_ASTBinOPType_Neq;
         default:   
             return PSL_ASTBinOPType_Add;
     }
@@ -196,6 +402,13 @@ uint32_t psl_ast_get_binop_precedence(PSL_ASTBinOPType op)
         case PSL_ASTBinOPType_Add:
         case PSL_ASTBinOPType_Sub:         
             return 2;
+        case PSL_ASTBinOPType_Lt:
+        case PSL_ASTBinOPType_Le:
+        case PSL_ASTBinOPType_Gt:
+        case PSL_ASTBinOPType_Ge:
+        case PSL_ASTBinOPType_Eq:
+        case PSL_ASTBinOPType_Neq:
+            return 1;
         default:
             return 0;
     }
@@ -203,6 +416,7 @@ uint32_t psl_ast_get_binop_precedence(PSL_ASTBinOPType op)
 
 PSL_ASTNode* psl_parse_expression(PSL_AST* ast, PSL_Parser* parser);
 PSL_ASTNode* psl_parse_binary_expression(PSL_AST* ast, PSL_Parser* parser, uint32_t min_prec);
+PSL_ASTNode* psl_parse_postfix(PSL_AST* ast, PSL_Parser* parser);
 PSL_ASTNode* psl_parse_primary(PSL_AST* ast, PSL_Parser* parser);
 PSL_ASTNode* psl_parse_function_call(PSL_AST* ast, PSL_Parser* parser);
 
@@ -216,11 +430,13 @@ PSL_ASTNode* psl_parse_function_body(PSL_AST* ast, PSL_Parser* parser)
 
     psl_parser_advance(parser);
 
-    Vector* statements = vector_new(128, sizeof(PSL_ASTNode*));
-    
+    const uint32_t mark = ast->scratch_size;
+
+
     while(psl_parser_current_token(parser)->type != PSL_TokenType_RBrace) 
     {
         PSL_Token* current = psl_parser_current_token(parser);
+        ast->line = current->line;
         
         /* Return statements */
         if(current->type == PSL_TokenType_Keyword && 
@@ -232,12 +448,12 @@ PSL_ASTNode* psl_parse_function_body(PSL_AST* ast, PSL_Parser* parser)
 
             if(expr == NULL)
             {
-                return false;
+                return NULL;
             }
 
             PSL_ASTNode* ret = psl_ast_new_return(ast, expr);
 
-            vector_push_back(statements, &ret);
+            psl_ast_scratch_push(ast, ret);
         }
         /* Assignments and expressions */
         else if(current->type == PSL_TokenType_Identifier) 
@@ -245,24 +461,45 @@ PSL_ASTNode* psl_parse_function_body(PSL_AST* ast, PSL_Parser* parser)
             PSL_ASTNode* lvalue = psl_ast_new_variable(ast, current->start, current->length);
 
             psl_parser_advance(parser); /* Consume identifier */
+
+            /* Assignments to some components of a vector */
+            if(psl_parser_current_token(parser)->type == PSL_TokenType_Dot)
+            {
+                uint32_t components[PSL_AST_MAX_COMPONENTS];
+                uint32_t num_components;
+
+                if(!psl_ast_parse_swizzle(ast, parser, components, &num_components))
+                {
+                    return NULL;
+                }
+
+                lvalue = psl_ast_new_swizzle(ast, lvalue, components, num_components);
+            }
+
+            if(psl_parser_current_token(parser)->type != PSL_TokenType_Assign)
+            {
+                ast->error = "Expected '=' after assigned variable";
+                return NULL;
+            }
+
             psl_parser_advance(parser); /* Consume = */
 
             PSL_ASTNode* rvalue = psl_parse_expression(ast, parser);
 
             if(rvalue == NULL)
             {
-                return false;
+                return NULL;
             }
 
             PSL_ASTNode* assignment = psl_ast_new_assignment(ast, lvalue, rvalue);
             
-            vector_push_back(statements, &assignment);
+            psl_ast_scratch_push(ast, assignment);
         }
         
         if(psl_parser_current_token(parser)->type != PSL_TokenType_Semicolon) 
         {
             ast->error = "Expected ';' after statement";
-            return false;
+            return NULL;
         }
 
         psl_parser_advance(parser);
@@ -270,23 +507,53 @@ PSL_ASTNode* psl_parse_function_body(PSL_AST* ast, PSL_Parser* parser)
     
     psl_parser_advance(parser);
 
-    PSL_ASTNode* block = psl_ast_new_block(ast, 
-                                           (PSL_ASTNode**)vector_at(statements, 0),
-                                           (uint32_t)vector_size(statements));
+    PSL_ASTNode* block = psl_ast_new_block(ast, ast->scratch + mark, ast->scratch_size - mark);
 
-    vector_free(statements);
+    ast->scratch_size = mark;
 
     return block;
 }
 
 PSL_ASTNode* psl_parse_expression(PSL_AST* ast, PSL_Parser* parser) 
 {
-    return psl_parse_binary_expression(ast, parser, 0);
+    PSL_ASTNode* condition = psl_parse_binary_expression(ast, parser, 0);
+
+    if(condition == NULL || psl_parser_current_token(parser)->type != PSL_TokenType_Question)
+    {
+        return condition;
+    }
+
+    /* Ternary expressions, right associative */
+    psl_parser_advance(parser); /* Consume ? */
+
+    PSL_ASTNode* if_true = psl_parse_expression(ast, parser);
+
+    if(if_true == NULL)
+    {
+        return NULL;
+    }
+
+    if(psl_parser_current_token(parser)->type != PSL_TokenType_Colon)
+    {
+        ast->error = "Expected ':' in ternary expression";
+        return NULL;
+    }
+
+    psl_parser_advance(parser); /* Consume : */
+
+    PSL_ASTNode* if_false = psl_parse_expression(ast, parser);
+
+    if(if_false == NULL)
+    {
+        return NULL;
+    }
+
+    return psl_ast_new_ternary(ast, condition, if_true, if_false);
 }
 
 PSL_ASTNode* psl_parse_binary_expression(PSL_AST* ast, PSL_Parser* parser, uint32_t min_prec) 
 {
-    PSL_ASTNode* left = psl_parse_primary(ast, parser);
+    PSL_ASTNode* left = psl_parse_postfix(ast, parser);
 
     if(left == NULL) 
     {
@@ -325,6 +592,75 @@ PSL_ASTNode* psl_parse_binary_expression(PSL_AST* ast, PSL_Parser* parser, uint3
     return left;
 }
 
+/* Primary expressions followed by swizzles */
+PSL_ASTNode* psl_parse_postfix(PSL_AST* ast, PSL_Parser* parser)
+{
+    PSL_ASTNode* node = psl_parse_primary(ast, parser);
+
+    while(node != NULL && psl_parser_current_token(parser)->type == PSL_TokenType_Dot)
+    {
+        uint32_t components[PSL_AST_MAX_COMPONENTS];
+        uint32_t num_components;
+
+        if(!psl_ast_parse_swizzle(ast, parser, components, &num_components))
+        {
+            return NULL;
+        }
+
+        node = psl_ast_new_swizzle(ast, node, components, num_components);
+    }
+
+    return node;
+}
+
+PSL_ASTNode* psl_parse_constructor(PSL_AST* ast, PSL_Parser* parser)
+{
+    const PSL_ASTValueType value_type = psl_ast_token_to_value_type(psl_parser_current_token(parser));
+
+    psl_parser_advance(parser); /* Consume type */
+    psl_parser_advance(parser); /* Consume ( */
+
+    const uint32_t mark = ast->scratch_size;
+    uint32_t num_arguments = 0;
+
+    while(psl_parser_current_token(parser)->type != PSL_TokenType_RParen)
+    {
+        if(num_arguments == PSL_AST_MAX_COMPONENTS)
+        {
+            ast->error = "Too many arguments in vector constructor";
+            return NULL;
+        }
+
+        PSL_ASTNode* arg = psl_parse_expression(ast, parser);
+
+        if(arg == NULL)
+        {
+            return NULL;
+        }
+
+        psl_ast_scratch_push(ast, arg);
+        num_arguments++;
+
+        if(psl_parser_current_token(parser)->type == PSL_TokenType_Comma)
+        {
+            psl_parser_advance(parser);
+        }
+        else if(psl_parser_current_token(parser)->type != PSL_TokenType_RParen)
+        {
+            ast->error = "Expected closing parenthesis after vector constructor";
+            return NULL;
+        }
+    }
+
+    psl_parser_advance(parser); /* Consume ) */
+
+    PSL_ASTNode* constructor = psl_ast_new_constructor(ast, value_type, ast->scratch + mark, num_arguments);
+
+    ast->scratch_size = mark;
+
+    return constructor;
+}
+
 PSL_ASTNode* psl_parse_function_call(PSL_AST* ast, PSL_Parser* parser)
 {
     PSL_Token* name_token = psl_parser_current_token(parser);
@@ -332,8 +668,7 @@ PSL_ASTNode* psl_parse_function_call(PSL_AST* ast, PSL_Parser* parser)
     psl_parser_advance(parser); /* Consume identifier */
     psl_parser_advance(parser); /* Consume ( */
 
-    stack_init(PSL_ASTNode*, arguments, 32);
-    uint32_t num_arguments = 0;
+    const uint32_t mark = ast->scratch_size;
     
     while(psl_parser_current_token(parser)->type != PSL_TokenType_RParen) 
     {
@@ -344,8 +679,7 @@ PSL_ASTNode* psl_parse_function_call(PSL_AST* ast, PSL_Parser* parser)
             return NULL;
         }
 
-        stack_push(arguments, arg);
-        num_arguments++;
+        psl_ast_scratch_push(ast, arg);
         
         if(psl_parser_current_token(parser)->type == PSL_TokenType_Comma) 
         {
@@ -355,11 +689,15 @@ PSL_ASTNode* psl_parse_function_call(PSL_AST* ast, PSL_Parser* parser)
 
     psl_parser_advance(parser); /* Consume ) */
 
-    return psl_ast_new_function_call(ast,
-                                     name_token->start,
-                                     name_token->length,
-                                     arguments,
-                                     num_arguments);
+    PSL_ASTNode* funccall = psl_ast_new_function_call(ast,
+                                                      name_token->start,
+                                                      name_token->length,
+                                                      ast->scratch + mark,
+                                                      ast->scratch_size - mark);
+
+    ast->scratch_size = mark;
+
+    return funccall;
 }
 
 PSL_ASTNode* psl_parse_primary(PSL_AST* ast, PSL_Parser* parser) 
@@ -389,6 +727,41 @@ PSL_ASTNode* psl_parse_primary(PSL_AST* ast, PSL_Parser* parser)
         return expr;
     }
     
+    /* Vector constructors */
+    if(psl_ast_is_type_token(current) &&
+       current->subtype != PSL_KeywordType_f32 &&
+       current->subtype != PSL_KeywordType_f64 &&
+       psl_parser_peek_check(parser, 1, PSL_TokenType_LParen))
+    {
+        return psl_parse_constructor(ast, parser);
+    }
+
+    /* Conversions */
+    if(psl_ast_is_type_token(current) && psl_parser_peek_check(parser, 1, PSL_TokenType_LParen))
+    {
+        const PSL_ASTValueType value_type = psl_ast_token_to_value_type(current);
+
+        psl_parser_advance(parser); /* Consume type */
+        psl_parser_advance(parser); /* Consume ( */
+
+        PSL_ASTNode* operand = psl_parse_expression(ast, parser);
+
+        if(operand == NULL)
+        {
+            return NULL;
+        }
+
+        if(psl_parser_current_token(parser)->type != PSL_TokenType_RParen)
+        {
+            ast->error = "Expected closing parenthesis after conversion";
+            return NULL;
+        }
+
+        psl_parser_advance(parser); /* Consume ) */
+
+        return psl_ast_new_cast(ast, value_type, operand);
+    }
+
     /* Handle function calls */
     if(current->type == PSL_TokenType_Identifier && 
        psl_parser_peek_check(parser, 1, PSL_TokenType_LParen)) 
@@ -405,7 +778,7 @@ PSL_ASTNode* psl_parse_primary(PSL_AST* ast, PSL_Parser* parser)
     }
     else if(current->type == PSL_TokenType_Literal) 
     {
-        node = psl_ast_new_literal(ast, strtof(current->start, NULL));
+        node = psl_ast_new_literal(ast, strtod(current->start, NULL));
     }
     else 
     {
@@ -418,7 +791,7 @@ PSL_ASTNode* psl_parse_primary(PSL_AST* ast, PSL_Parser* parser)
     return node;
 }
 
-bool psl_ast_from_tokens(PSL_AST* ast, Vector* tokens)
+bool psl_ast_parse_tokens(PSL_AST* ast, Vector* tokens)
 {
     PSL_Parser parser;
     psl_parser_init(&parser, tokens);
@@ -432,22 +805,23 @@ bool psl_ast_from_tokens(PSL_AST* ast, Vector* tokens)
         return false;
     }
 
-    stack_init(PSL_ASTNode*, functions, 32);
-    uint32_t num_functions = 0;
+    /* Rolls back what a previous failed parse left on the scratch stack */
+    ast->scratch_size = 0;
     
     while(!psl_parser_is_at_end(&parser))
     {
         PSL_Token* current = psl_parser_current_token(&parser);
         
         /* Function declarations */
-        if(current->type == PSL_TokenType_Keyword && 
-           (current->subtype == PSL_KeywordType_Main ||
-            current->subtype == PSL_KeywordType_f32 || 
-            current->subtype == PSL_KeywordType_f64))
+        if(psl_ast_is_type_token(current) ||
+           (current->type == PSL_TokenType_Keyword && current->subtype == PSL_KeywordType_Main))
         {
+            const uint32_t line = current->line;
+            ast->line = line;
             psl_parser_advance(&parser);
 
             bool is_entry_point = current->subtype == PSL_KeywordType_Main;
+            PSL_ASTValueType return_type = psl_ast_token_to_value_type(current);
 
             /* Function name */
             PSL_Token* name_token = psl_parser_current_token(&parser);
@@ -463,24 +837,78 @@ bool psl_ast_from_tokens(PSL_AST* ast, Vector* tokens)
             /* Parameters */
             psl_parser_advance(&parser); /* Consume ( */
 
-            stack_init(PSL_ASTNode*, parameters, 32);
-            uint32_t num_parameters = 0;
+            const uint32_t parameters_mark = ast->scratch_size;
             
             while(psl_parser_current_token(&parser)->type != PSL_TokenType_RParen) 
             {
-                bool export = psl_parser_current_token(&parser)->subtype == PSL_KeywordType_Export;
-                
-                if(export)
+                bool export = false;
+                bool uniform = false;
+                PSL_ASTReduceOp reduce_op = PSL_ASTReduceOp_None;
+
+                /* Parameter qualifiers */
+                while(psl_parser_current_token(&parser)->type == PSL_TokenType_Keyword &&
+                      (psl_parser_current_token(&parser)->subtype == PSL_KeywordType_Export ||
+                       psl_parser_current_token(&parser)->subtype == PSL_KeywordType_Uniform ||
+                       psl_parser_current_token(&parser)->subtype == PSL_KeywordType_Reduce))
                 {
+                    export |= psl_parser_current_token(&parser)->subtype == PSL_KeywordType_Export;
+                    uniform |= psl_parser_current_token(&parser)->subtype == PSL_KeywordType_Uniform;
+
+                    if(psl_parser_current_token(&parser)->subtype == PSL_KeywordType_Reduce)
+                    {
+                        /* reduce(sum|min|max), implies export */
+                        psl_parser_advance(&parser);
+
+                        if(!psl_parser_peek_check(&parser, 0, PSL_TokenType_LParen) ||
+                           !psl_parser_peek_check(&parser, 1, PSL_TokenType_Identifier) ||
+                           !psl_parser_peek_check(&parser, 2, PSL_TokenType_RParen))
+                        {
+                            ast->error = "Expected reduce(sum), reduce(min) or reduce(max)";
+                            return false;
+                        }
+
+                        reduce_op = psl_ast_token_to_reduce_op(psl_parser_peek(&parser, 1));
+
+                        if(reduce_op == PSL_ASTReduceOp_None)
+                        {
+                            ast->error = "Unknown reduction, expected sum, min or max";
+                            return false;
+                        }
+
+                        psl_parser_advance(&parser);
+                        psl_parser_advance(&parser);
+                        export = true;
+                    }
+
                     psl_parser_advance(&parser);
                 }
 
-                if(psl_parser_current_token(&parser)->type != PSL_TokenType_Keyword) 
+                if(export && uniform)
+                {
+                    ast->error = "A parameter cannot be both export and uniform";
+                    return false;
+                }
+
+                if(reduce_op != PSL_ASTReduceOp_None && !is_entry_point)
+                {
+                    ast->error = "Reduction parameters are only allowed on main functions";
+                    return false;
+                }
+
+                if(uniform && !is_entry_point)
+                {
+                    ast->error = "Uniform parameters are only allowed on main functions";
+                    return false;
+                }
+
+                if(!psl_ast_is_type_token(psl_parser_current_token(&parser))) 
                 {
                     ast->error = "Expected parameter type";
                     return false;
                 }
 
+                const PSL_ASTValueType value_type = psl_ast_token_to_value_type(psl_parser_current_token(&parser));
+
                 psl_parser_advance(&parser);
 
                 /* Parameter name */
@@ -492,10 +920,15 @@ bool psl_ast_from_tokens(PSL_AST* ast, Vector* tokens)
                     return false;
                 }
 
-                PSL_ASTNode* param = psl_ast_new_parameter(ast, param_name->start, param_name->length, export);
+                PSL_ASTNode* param = psl_ast_new_parameter(ast,
+                                                           param_name->start,
+                                                           param_name->length,
+                                                           value_type,
+                                                           export,
+                                                           uniform,
+                                                           reduce_op);
 
-                stack_push(parameters, param);
-                num_parameters++;
+                psl_ast_scratch_push(ast, param);
                 
                 psl_parser_advance(&parser);
 
@@ -507,6 +940,8 @@ bool psl_ast_from_tokens(PSL_AST* ast, Vector* tokens)
             
             psl_parser_advance(&parser); /* Consume ) */
 
+            const uint32_t num_parameters = ast->scratch_size - parameters_mark;
+
             /* Function body */
             PSL_ASTNode* body = psl_parse_function_body(ast, &parser);
 
@@ -515,16 +950,21 @@ bool psl_ast_from_tokens(PSL_AST* ast, Vector* tokens)
                 return false;
             }
 
+            /* The statements of the body moved the line forward */
+            ast->line = line;
+
             PSL_ASTNode* func = psl_ast_new_function(ast,
                                                      name_token->start,
                                                      name_token->length,
-                                                     &parameters,
+                                                     ast->scratch + parameters_mark,
                                                      num_parameters,
                                                      body,
+                                                     return_type,
                                                      is_entry_point);
 
-            stack_push(functions, func);
-            num_functions++;
+            /* The parameters are replaced by the function on the stack */
+            ast->scratch_size = parameters_mark;
+            psl_ast_scratch_push(ast, func);
         }
         else 
         {
@@ -533,11 +973,33 @@ bool psl_ast_from_tokens(PSL_AST* ast, Vector* tokens)
         }
     }
 
-    ast->root = psl_ast_new_source(ast, &functions, num_functions);
+    ast->root = psl_ast_new_source(ast, ast->scratch, ast->scratch_size);
+
+    ast->scratch_size = 0;
 
     return true;
 }
 
+bool psl_ast_from_tokens(PSL_AST* ast, Vector* tokens)
+{
+    PSL_ProfileScope scope;
+    psl_profile_phase_begin(&scope);
+
+    const ArenaMark mark = psl_arena_mark(&ast->nodes_data);
+
+    const bool success = psl_ast_parse_tokens(ast, tokens);
+
+    /* Nodes of a failed parse are unreachable, the arena is left as it was before */
+    if(!success)
+    {
+        psl_arena_rollback(&ast->nodes_data, &mark);
+    }
+
+    psl_profile_phase_end(&scope, PSL_CompilePhase_Parse);
+
+    return success;
+}
+
 const char* psl_binop_type_to_string(PSL_ASTBinOPType op) 
 {
     switch(op) 
@@ -550,6 +1012,52 @@ const char* psl_binop_type_to_string(PSL_ASTBinOPType op)
             return "*";
         case PSL_ASTBinOPType_Div: 
             return "/";
+        case PSL_ASTBinOPType_Lt:
+            return "<";
+        case PSL_ASTBinOPType_Le:
+            return "<=";
+        case PSL_ASTBinOPType_Gt:
+            return ">";
+        case PSL_ASTBinOPType_Ge:
+            return ">=";
+        case PSL_ASTBinOPType_Eq:
+            return "==";
+        case PSL_ASTBinOPType_Neq:
+            return "!=";
+        default:
+            return "?";
+    }
+}
+
+const char* psl_reduce_op_to_string(PSL_ASTReduceOp reduce_op)
+{
+    switch(reduce_op)
+    {
+        case PSL_ASTReduceOp_Sum:
+            return " (reduce sum)";
+        case PSL_ASTReduceOp_Min:
+            return " (reduce min)";
+        case PSL_ASTReduceOp_Max:
+            return " (reduce max)";
+        default:
+            return "";
+    }
+}
+
+const char* psl_value_type_to_string(PSL_ASTValueType value_type)
+{
+    switch(value_type)
+    {
+        case PSL_ASTValueType_F32:
+            return "f32";
+        case PSL_ASTValueType_F64:
+            return "f64";
+        case PSL_ASTValueType_Vec2:
+            return "vec2";
+        case PSL_ASTValueType_Vec3:
+            return "vec3";
+        case PSL_ASTValueType_Vec4:
+            return "vec4";
         default:
             return "?";
     }
@@ -598,11 +1106,12 @@ void psl_ast_print_node(PSL_ASTNode* node, int indent)
         case PSL_ASTNodeType_PSL_ASTFunction: {
             PSL_ASTFunction* func = PSL_AST_CAST(PSL_ASTFunction, node);
             print_indent(indent);
-            printf("Function %.*s (%s)%s:\n",
+            printf("Function %.*s (%s)%s%s:\n",
                    func->name_length,
                    func->name,
                    func->num_parameters > 0 ? "parameters" : "no parameters",
-                   func->is_entry_point ? " [main]" : "");
+                   func->is_entry_point ? " [main]" : " -> ",
+                   func->is_entry_point ? "" : psl_value_type_to_string(func->return_type));
             
             // Print parameters
             for(uint32_t i = 0; i < func->num_parameters; i++) {
@@ -617,10 +1126,13 @@ void psl_ast_print_node(PSL_ASTNode* node, int indent)
         case PSL_ASTNodeType_PSL_ASTParameter: {
             PSL_ASTParameter* param = PSL_AST_CAST(PSL_ASTParameter, node);
             print_indent(indent);
-            printf("Parameter %.*s%s\n",
+            printf("Parameter %s %.*s%s%s%s\n",
+                   psl_value_type_to_string(param->value_type),
                    param->name_length,
                    param->name,
-                   param->exportable ? " (export)" : "");
+                   param->exportable ? " (export)" : "",
+                   param->uniform ? " (uniform)" : "",
+                   psl_reduce_op_to_string(param->reduce_op));
             break;
         }
 
@@ -696,145 +1208,66 @@ void psl_ast_print_node(PSL_ASTNode* node, int indent)
             break;
         }
 
-        default: {
+        case PSL_ASTNodeType_PSL_ASTTernary: {
+            PSL_ASTTernary* ternary = PSL_AST_CAST(PSL_ASTTernary, node);
             print_indent(indent);
-            printf("Unknown node type: %d\n", node->type);
+            printf("Ternary:\n");
+            psl_ast_print_node(ternary->condition, indent + 1);
+            psl_ast_print_node(ternary->if_true, indent + 1);
+            psl_ast_print_node(ternary->if_false, indent + 1);
             break;
         }
-    }
-}
-
-void psl_ast_print(PSL_AST* ast) 
-{
-    psl_ast_print_node(ast->root, 0);
-}
-
-void psl_free_malloced_nodes(PSL_ASTNode* root)
-{
-    stack_init(PSL_ASTNode*, nodes_to_visit, 128);
-
-    stack_push(nodes_to_visit, root);
-
-    while(!stack_is_empty(nodes_to_visit))
-    {
-        PSL_ASTNode* current = stack_pop(nodes_to_visit);
-
-        switch(current->type)
-        {
-            case PSL_ASTNodeType_PSL_ASTSource:
-            {
-                PSL_ASTSource* src = PSL_AST_CAST(PSL_ASTSource, current);
-                PSL_ASSERT(src != NULL, "Wrong type casting, should be PSL_ASTSource*");
-
-                for(uint32_t i = 0; i < src->num_functions; i++)
-                {
-                    stack_push(nodes_to_visit, src->functions[i]);
-                }
-
-                free(src->functions);
-
-                break;
-            }
-            case PSL_ASTNodeType_PSL_ASTFunction:
-            {
-                PSL_ASTFunction* func = PSL_AST_CAST(PSL_ASTFunction, current);
-                PSL_ASSERT(func != NULL, "Wrong type casting, should be PSL_ASTFunction*");
-
-                stack_push(nodes_to_visit, func->body);
-
-                for(uint32_t i = 0; i < func->num_parameters; i++)
-                {
-                    stack_push(nodes_to_visit, func->parameters[i]);
-                }
-
-                free(func->parameters);
-
-                break;
-            }
-            case PSL_ASTNodeType_PSL_ASTBlock:
-            {
-                PSL_ASTBlock* block = PSL_AST_CAST(PSL_ASTBlock, current);
-                PSL_ASSERT(block != NULL, "Wrong type casting, should be PSL_ASTBlock*");
-
-                for(uint32_t i = 0; i < block->num_statements; i++)
-                {
-                    stack_push(nodes_to_visit, block->statements[i]);
-                }
-
-                free(block->statements);
-
-                break;
-            }
-            case PSL_ASTNodeType_PSL_ASTReturn:
-            {
-                PSL_ASTReturn* ret = PSL_AST_CAST(PSL_ASTReturn, current);
-                PSL_ASSERT(ret != NULL, "Wrong type casting, should be PSL_ASTReturn*");
-
-                stack_push(nodes_to_visit, (PSL_ASTNode*)ret->statement);
-
-                break;
-            }
-            case PSL_ASTNodeType_PSL_ASTAssignment:
-            {
-                PSL_ASTAssignment* assignment = PSL_AST_CAST(PSL_ASTAssignment, current);
-                PSL_ASSERT(assignment != NULL, "Wrong type casting, should be PSL_ASTAssignment*");
-
-                stack_push(nodes_to_visit, (PSL_ASTNode*)assignment->lvalue);
-                stack_push(nodes_to_visit, (PSL_ASTNode*)assignment->rvalue);
-
-                break;
-            }
-            case PSL_ASTNodeType_PSL_ASTBinOP:
-            {
-                PSL_ASTBinOP* binop = PSL_AST_CAST(PSL_ASTBinOP, current);
-                PSL_ASSERT(binop != NULL, "Wrong type casting, should be PSL_ASTBinOP*");
 
-                stack_push(nodes_to_visit, (PSL_ASTNode*)binop->left);
-                stack_push(nodes_to_visit, (PSL_ASTNode*)binop->right);
+        case PSL_ASTNodeType_PSL_ASTCast: {
+            PSL_ASTCast* cast = PSL_AST_CAST(PSL_ASTCast, node);
+            print_indent(indent);
+            printf("Conversion to %s:\n", psl_value_type_to_string(cast->value_type));
+            psl_ast_print_node(cast->operand, indent + 1);
+            break;
+        }
 
-                break;
+        case PSL_ASTNodeType_PSL_ASTConstructor: {
+            PSL_ASTConstructor* constructor = PSL_AST_CAST(PSL_ASTConstructor, node);
+            print_indent(indent);
+            printf("Constructor %s (%u arguments):\n", psl_value_type_to_string(constructor->value_type), constructor->num_arguments);
+            for(uint32_t i = 0; i < constructor->num_arguments; i++) {
+                psl_ast_print_node(constructor->arguments[i], indent + 1);
             }
-            case PSL_ASTNodeType_PSL_ASTUnOP:
-            {
-                PSL_ASTUnOP* unop = PSL_AST_CAST(PSL_ASTUnOP, current);
-                PSL_ASSERT(unop != NULL, "Wrong type casting, should be PSL_ASTUnOP*");
-
-                stack_push(nodes_to_visit, (PSL_ASTNode*)unop->operand);
+            break;
+        }
 
-                break;
+        case PSL_ASTNodeType_PSL_ASTSwizzle: {
+            PSL_ASTSwizzle* swizzle = PSL_AST_CAST(PSL_ASTSwizzle, node);
+            print_indent(indent);
+            printf("Swizzle .");
+            for(uint32_t i = 0; i < swizzle->num_components; i++) {
+                printf("%c", "xyzw"[swizzle->components[i]]);
             }
-            case PSL_ASTNodeType_PSL_ASTFunctionCall:
-            {
-                PSL_ASTFunctionCall* funccall = PSL_AST_CAST(PSL_ASTFunctionCall, current);
-                PSL_ASSERT(funccall != NULL, "Wrong type casting, should be PSL_ASTFunctionCall*");
-
-                for(uint32_t i = 0; i < funccall->num_arguments; i++)
-                {
-                    stack_push(nodes_to_visit, funccall->arguments[i]);
-                }
-
-                free(funccall->arguments);
+            printf(":\n");
+            psl_ast_print_node(swizzle->operand, indent + 1);
+            break;
+        }
 
-                break;
-            }
-            case PSL_ASTNodeType_PSL_ASTVariable:
-            case PSL_ASTNodeType_PSL_ASTLiteral:
-            case PSL_ASTNodeType_PSL_ASTParameter:
-                break;
-            default: 
-                break;
+        default: {
+            print_indent(indent);
+            printf("Unknown node type: %d\n", node->type);
+            break;
         }
     }
 }
 
+void psl_ast_print(PSL_AST* ast) 
+{
+    psl_ast_print_node(ast->root, 0);
+}
+
 void psl_ast_destroy(PSL_AST* ast)
 {
     if(ast != NULL)
     {
-        psl_free_malloced_nodes(ast->root);
-
         psl_arena_destroy(&ast->nodes_data);
 
+        free(ast->scratch);
         free(ast);
     }
 }
\ No newline at end of file
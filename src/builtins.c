@@ -0,0 +1,151 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#include "psl/builtins.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+   Builtins that have no single instruction equivalent are called from the generated code through
+   vector helpers processing PSL_LANES lanes at once, reading and writing from the kernel stack frame
+*/
+
+#define PSL_BUILTIN_UNARY(__name__, __func__, __func_f64__)                                \
+    float psl_builtin_scalar_##__name__(float a, float b)                                   \
+    {                                                                                       \
+        (void)b;                                                                            \
+        return __func__(a);                                                                 \
+    }                                                                                       \
+                                                                                            \
+    void psl_builtin_vector_##__name__(float* out, const float* a, const float* b)          \
+    {                                                                                       \
+        (void)b;                                                                            \
+        for(uint32_t i = 0; i < PSL_LANES; i++)                                             \
+        {                                                                                   \
+            out[i] = __func__(a[i]);                                                        \
+        }                                                                                   \
+    }                                                                                       \
+                                                                                            \
+    double psl_builtin_scalar_##__name__##_f64(double a, double b)                          \
+    {                                                                                       \
+        (void)b;                                                                            \
+        return __func_f64__(a);                                                             \
+    }                                                                                       \
+                                                                                            \
+    void psl_builtin_vector_##__name__##_f64(double* out, const double* a, const double* b) \
+    {                                                                                       \
+        (void)b;                                                                            \
+        for(uint32_t i = 0; i < PSL_LANES; i++)                                             \
+        {                                                                                   \
+            out[i] = __func_f64__(a[i]);                                                    \
+        }                                                                                   \
+    }
+
+#define PSL_BUILTIN_BINARY(__name__, __func__, __func_f64__)                               \
+    float psl_builtin_scalar_##__name__(float a, float b)                                   \
+    {                                                                                       \
+        return __func__(a, b);                                                              \
+    }                                                                                       \
+                                                                                            \
+    void psl_builtin_vector_##__name__(float* out, const float* a, const float* b)          \
+    {                                                                                       \
+        for(uint32_t i = 0; i < PSL_LANES; i++)                                             \
+        {                                                                                   \
+            out[i] = __func__(a[i], b[i]);                                                  \
+        }                                                                                   \
+    }                                                                                       \
+                                                                                            \
+    double psl_builtin_scalar_##__name__##_f64(double a, double b)                          \
+    {                                                                                       \
+        return __func_f64__(a, b);                                                          \
+    }                                                                                       \
+                                                                                            \
+    void psl_builtin_vector_##__name__##_f64(double* out, const double* a, const double* b) \
+    {                                                                                       \
+        for(uint32_t i = 0; i < PSL_LANES; i++)                                             \
+        {                                                                                   \
+            out[i] = __func_f64__(a[i], b[i]);                                              \
+        }                                                                                   \
+    }
+
+PSL_BUILTIN_UNARY(sqrt, sqrtf, sqrt)
+PSL_BUILTIN_UNARY(abs, fabsf, fabs)
+PSL_BUILTIN_UNARY(floor, floorf, floor)
+PSL_BUILTIN_UNARY(ceil, ceilf, ceil)
+PSL_BUILTIN_UNARY(sin, sinf, sin)
+PSL_BUILTIN_UNARY(cos, cosf, cos)
+PSL_BUILTIN_UNARY(tan, tanf, tan)
+PSL_BUILTIN_UNARY(asin, asinf, asin)
+PSL_BUILTIN_UNARY(acos, acosf, acos)
+PSL_BUILTIN_UNARY(atan, atanf, atan)
+PSL_BUILTIN_BINARY(atan2, atan2f, atan2)
+PSL_BUILTIN_UNARY(exp, expf, exp)
+PSL_BUILTIN_UNARY(log, logf, log)
+PSL_BUILTIN_BINARY(pow, powf, pow)
+
+#define PSL_BUILTIN_IR(__name__, __num_args__) \
+    { #__name__, sizeof(#__name__) - 1, __num_args__, NULL, NULL, NULL, NULL }
+
+#define PSL_BUILTIN_NATIVE(__name__, __num_args__)                                 \
+    { #__name__, sizeof(#__name__) - 1, __num_args__,                              \
+      NULL, psl_builtin_scalar_##__name__, NULL, psl_builtin_scalar_##__name__##_f64 }
+
+#define PSL_BUILTIN_HELPER(__name__, __num_args__)                                 \
+    { #__name__, sizeof(#__name__) - 1, __num_args__,                              \
+      psl_builtin_vector_##__name__, psl_builtin_scalar_##__name__,                \
+      psl_builtin_vector_##__name__##_f64, psl_builtin_scalar_##__name__##_f64 }
+
+static const PSL_Builtin _builtins[PSL_BuiltinID_Count] = {
+    PSL_BUILTIN_IR(min, 2),
+    PSL_BUILTIN_IR(max, 2),
+    PSL_BUILTIN_IR(clamp, 3),
+    PSL_BUILTIN_IR(saturate, 1),
+    PSL_BUILTIN_IR(select, 3),
+    PSL_BUILTIN_IR(dot, 2),
+    PSL_BUILTIN_IR(cross, 2),
+    PSL_BUILTIN_IR(length, 1),
+    PSL_BUILTIN_IR(normalize, 1),
+    PSL_BUILTIN_NATIVE(sqrt, 1),
+    PSL_BUILTIN_NATIVE(abs, 1),
+    PSL_BUILTIN_NATIVE(floor, 1),
+    PSL_BUILTIN_NATIVE(ceil, 1),
+    PSL_BUILTIN_HELPER(sin, 1),
+    PSL_BUILTIN_HELPER(cos, 1),
+    PSL_BUILTIN_HELPER(tan, 1),
+    PSL_BUILTIN_HELPER(asin, 1),
+    PSL_BUILTIN_HELPER(acos, 1),
+    PSL_BUILTIN_HELPER(atan, 1),
+    PSL_BUILTIN_HELPER(atan2, 2),
+    PSL_BUILTIN_HELPER(exp, 1),
+    PSL_BUILTIN_HELPER(log, 1),
+    PSL_BUILTIN_HELPER(pow, 2),
+};
+
+const PSL_Builtin* psl_builtin_find(const char* name, uint32_t name_length, PSL_BuiltinID* id)
+{
+    for(uint32_t i = 0; i < PSL_BuiltinID_Count; i++)
+    {
+        if(_builtins[i].name_length == name_length &&
+           memcmp(_builtins[i].name, name, name_length) == 0)
+        {
+            if(id != NULL)
+            {
+                *id = (PSL_BuiltinID)i;
+            }
+
+            return &_builtins[i];
+        }
+    }
+
+    return NULL;
+}
+
+const PSL_Builtin* psl_builtin_get(PSL_BuiltinID id)
+{
+    PSL_ASSERT(id < PSL_BuiltinID_Count, "Invalid builtin id");
+
+    return &_builtins[id];
+}
@@ -0,0 +1,1234 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#include "psl/codegen.h"
+#include "psl/profile.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+   Kernel layout:
+
+   prologue      saves callee-saved registers and aligns the stack frame on 32 bytes
+   preheader     loop invariant instructions (constants, uniforms and what only depends on them)
+                 are computed once and broadcast to all lanes
+   loop          processes num_groups groups of PSL_LANES elements per iteration, each instruction
+                 being emitted for all the groups before the next one so that their dependency
+                 chains interleave
+   remainder     processes the last groups one at a time
+   epilogue
+
+   Every IR value lives in a stack slot, instructions load their operands into ymm0-ymm2
+   and store their result back into their slot. f32 values fit in one ymm register, f64 values
+   are split in two halves of 4 lanes, stored next to each other. Values computed in the loop have
+   one slot per group, invariant ones a single slot shared by all of them.
+
+   f32 and f64 columns are written with non-temporal stores when streaming, and inputs can be
+   prefetched a distance ahead of the current elements.
+
+   Reductions accumulate PSL_LANES partial aggregates in ymm3-ymm15 across the loop, ymm3-ymm5 on
+   Windows where xmm6-xmm15 are callee-saved, or in their partials when there are more of them than
+   registers. Register accumulators are written to their
+   partials when the loop ends and around helper calls, which clobber all ymm registers.
+
+   Registers:
+   rbx  element index
+   r12  columns array
+   r13  element count
+   r14  uniforms array
+   r15  reduction partials
+*/
+
+#define PSL_CODEGEN_SLOT_SIZE 32
+
+/* Home space needed by the Win64 calling convention, kept on all platforms to share the frame layout */
+#define PSL_CODEGEN_SHADOW_SPACE 32
+
+/* Size of the callee-saved registers pushed after rbp */
+#define PSL_CODEGEN_SAVED_SIZE 40
+
+#define PSL_CODEGEN_PAGE_SIZE 4096
+
+/* Size of the slots of the loop above which fewer groups are processed per iteration */
+#define PSL_CODEGEN_UNROLL_SLOTS_SIZE 16384
+
+#define PSL_CODEGEN_CACHE_LINE_SIZE 64
+
+/* Largest prefetch distance in elements, keeping displacements within 32 bits */
+#define PSL_CODEGEN_MAX_PREFETCH_DISTANCE (1 << 24)
+
+#define PSL_CODEGEN_REG_INDEX PSL_GPR_RBX
+#define PSL_CODEGEN_REG_COLUMNS PSL_GPR_R12
+#define PSL_CODEGEN_REG_COUNT PSL_GPR_R13
+#define PSL_CODEGEN_REG_UNIFORMS PSL_GPR_R14
+#define PSL_CODEGEN_REG_PARTIALS PSL_GPR_R15
+
+/* ymm0-ymm2 are scratch registers, the others hold reduction accumulators up to the last volatile one */
+#define PSL_CODEGEN_FIRST_ACCUMULATOR 3
+
+#if defined(PSL_WIN)
+#define PSL_CODEGEN_END_ACCUMULATOR 6
+#else
+#define PSL_CODEGEN_END_ACCUMULATOR 16
+#endif /* defined(PSL_WIN) */
+
+#if defined(PSL_WIN)
+static const PSL_GPR _abi_args[3] = { PSL_GPR_RCX, PSL_GPR_RDX, PSL_GPR_R8 };
+#else
+static const PSL_GPR _abi_args[3] = { PSL_GPR_RDI, PSL_GPR_RSI, PSL_GPR_RDX };
+#endif /* defined(PSL_WIN) */
+
+typedef struct {
+    PSL_CodeBuffer* buffer;
+    PSL_IR* ir;
+    uint32_t* slots; /* offset of the slot of each value from rsp */
+    uint32_t* strides; /* distance between the slots of each value for consecutive groups */
+    uint32_t group; /* group of PSL_LANES elements instructions are emitted for */
+    const PSL_CodegenOptions* options;
+    uint32_t* accumulators; /* first ymm register of each reduction, 0 if accumulated in memory */
+    PSL_CodeMap* map; /* NULL if the code is not mapped to the IR */
+} PSL_Codegen;
+
+/* Number of ymm registers a value of type spans */
+PSL_FORCE_INLINE uint32_t psl_codegen_num_halves(PSL_IRType type)
+{
+    return type == PSL_IRType_F64 ? 2 : 1;
+}
+
+/* Packed single or packed double variant of an instruction */
+PSL_FORCE_INLINE PSL_X64VexOp psl_codegen_op(PSL_IRType type, PSL_X64VexOp ps, PSL_X64VexOp pd)
+{
+    return type == PSL_IRType_F64 ? pd : ps;
+}
+
+PSL_FORCE_INLINE PSL_X64Mem psl_codegen_slot(PSL_Codegen* codegen, uint32_t value, uint32_t half)
+{
+    return psl_x64_mem(PSL_GPR_RSP,
+                       (int32_t)(codegen->slots[value] +
+                                 codegen->group * codegen->strides[value] +
+                                 half * PSL_CODEGEN_SLOT_SIZE));
+}
+
+/* Loads the address of column into rax */
+void psl_codegen_column_address(PSL_CodeBuffer* buffer, uint32_t column)
+{
+    PSL_X64Mem column_ptr = psl_x64_mem(PSL_CODEGEN_REG_COLUMNS, (int32_t)(column * sizeof(void*)));
+    psl_x64_mov_rm(buffer, PSL_GPR_RAX, &column_ptr);
+}
+
+/* Address of the first element of the current group plus disp in the column of format whose address is in rax */
+PSL_FORCE_INLINE PSL_X64Mem psl_codegen_element(PSL_Codegen* codegen, PSL_ColumnFormat format, uint32_t disp)
+{
+    const uint32_t element_size = (uint32_t)psl_column_format_size(format);
+
+    return psl_x64_mem_index(PSL_GPR_RAX,
+                             PSL_CODEGEN_REG_INDEX,
+                             (uint8_t)element_size,
+                             (int32_t)(codegen->group * PSL_LANES * element_size + disp));
+}
+
+/* Prefetches the inputs of the column whose address is in rax, once per cache line of the loop */
+void psl_codegen_prefetch(PSL_Codegen* codegen, PSL_ColumnFormat format)
+{
+    const uint32_t distance = codegen->options->prefetch_distance < PSL_CODEGEN_MAX_PREFETCH_DISTANCE ?
+                              codegen->options->prefetch_distance : PSL_CODEGEN_MAX_PREFETCH_DISTANCE;
+    const uint32_t element_size = (uint32_t)psl_column_format_size(format);
+    const uint32_t group_size = PSL_LANES * element_size;
+
+    if(distance == 0 || (group_size < PSL_CODEGEN_CACHE_LINE_SIZE &&
+                         (codegen->group * group_size) % PSL_CODEGEN_CACHE_LINE_SIZE != 0))
+    {
+        return;
+    }
+
+    for(uint32_t offset = 0; offset < group_size; offset += PSL_CODEGEN_CACHE_LINE_SIZE)
+    {
+        PSL_X64Mem ahead = psl_codegen_element(codegen, format, distance * element_size + offset);
+        psl_x64_prefetch(codegen->buffer, &ahead);
+    }
+}
+
+/* Store of a full vector to an f32 or f64 column */
+PSL_FORCE_INLINE PSL_X64VexOp psl_codegen_store_op(PSL_Codegen* codegen)
+{
+    return codegen->options->streaming ? PSL_X64VexOp_vmovntps : PSL_X64VexOp_vmovups_store;
+}
+
+/* Broadcasts a 32 bits pattern to all the lanes of ymm */
+void psl_codegen_broadcast_bits(PSL_CodeBuffer* buffer, uint32_t ymm, uint32_t bits)
+{
+    psl_x64_mov_ri32(buffer, PSL_GPR_RAX, bits);
+    psl_x64_vex_rr(buffer, PSL_X64VexOp_vmovd, ymm, 0, PSL_GPR_RAX);
+    psl_x64_vex_rr(buffer, PSL_X64VexOp_vpbroadcastd, ymm, 0, ymm);
+}
+
+/* Broadcasts a 64 bits pattern to all the lanes of ymm */
+void psl_codegen_broadcast_bits64(PSL_CodeBuffer* buffer, uint32_t ymm, uint64_t bits)
+{
+    psl_x64_mov_ri64(buffer, PSL_GPR_RAX, bits);
+    psl_x64_vex_rr(buffer, PSL_X64VexOp_vmovq, ymm, 0, PSL_GPR_RAX);
+    psl_x64_vex_rr(buffer, PSL_X64VexOp_vpbroadcastq, ymm, 0, ymm);
+}
+
+/* Broadcasts the bits of a lane of type to all the lanes of ymm, bits64 being truncated for f32 */
+void psl_codegen_broadcast_lane(PSL_CodeBuffer* buffer, PSL_IRType type, uint32_t ymm, uint64_t bits64)
+{
+    if(type == PSL_IRType_F64)
+    {
+        psl_codegen_broadcast_bits64(buffer, ymm, bits64);
+    }
+    else
+    {
+        psl_codegen_broadcast_bits(buffer, ymm, (uint32_t)(bits64 >> 32));
+    }
+}
+
+void psl_codegen_store_slot(PSL_Codegen* codegen, uint32_t value, uint32_t half, uint32_t ymm)
+{
+    PSL_X64Mem slot = psl_codegen_slot(codegen, value, half);
+    psl_x64_vex_rm(codegen->buffer, PSL_X64VexOp_vmovaps_store, ymm, 0, &slot);
+}
+
+void psl_codegen_load_slot(PSL_Codegen* codegen, uint32_t ymm, uint32_t value, uint32_t half)
+{
+    PSL_X64Mem slot = psl_codegen_slot(codegen, value, half);
+    psl_x64_vex_rm(codegen->buffer, PSL_X64VexOp_vmovaps, ymm, 0, &slot);
+}
+
+/* Partial aggregates of reduction, PSL_LANES lanes of its type */
+PSL_FORCE_INLINE PSL_X64Mem psl_codegen_partial(uint32_t reduction, uint32_t half)
+{
+    return psl_x64_mem(PSL_CODEGEN_REG_PARTIALS,
+                       (int32_t)(reduction * PSL_LANES * sizeof(double) + half * PSL_CODEGEN_SLOT_SIZE));
+}
+
+/* Bits of the identity of op, f32 ones in the upper 32 bits as psl_codegen_broadcast_lane expects */
+PSL_FORCE_INLINE uint64_t psl_codegen_reduce_identity(PSL_IRType type, PSL_IRReduceOp op)
+{
+    switch(op)
+    {
+        case PSL_IRReduceOp_Min:
+            return type == PSL_IRType_F64 ? 0x7FF0000000000000 : 0x7F80000000000000;
+        case PSL_IRReduceOp_Max:
+            return type == PSL_IRType_F64 ? 0xFFF0000000000000 : 0xFF80000000000000;
+        default:
+            return 0;
+    }
+}
+
+/* Sets the accumulators to the identity of their reduction, in registers while there are some left */
+void psl_codegen_init_accumulators(PSL_Codegen* codegen)
+{
+    uint32_t next = PSL_CODEGEN_FIRST_ACCUMULATOR;
+
+    for(uint32_t i = 0; i < codegen->ir->num_reductions; i++)
+    {
+        const PSL_IRParam* param = psl_ir_find_reduction(codegen->ir, i);
+
+        /* Dropped from the kernel */
+        if(param == NULL)
+        {
+            codegen->accumulators[i] = 0;
+            continue;
+        }
+
+        const uint32_t num_halves = psl_codegen_num_halves(param->type);
+
+        codegen->accumulators[i] = next + num_halves <= PSL_CODEGEN_END_ACCUMULATOR ? next : 0;
+        next += codegen->accumulators[i] != 0 ? num_halves : 0;
+
+        psl_codegen_broadcast_lane(codegen->buffer,
+                                   param->type,
+                                   0,
+                                   psl_codegen_reduce_identity(param->type, param->reduce_op));
+
+        for(uint32_t half = 0; half < num_halves; half++)
+        {
+            PSL_X64Mem partial = psl_codegen_partial(i, half);
+
+            if(codegen->accumulators[i] != 0)
+            {
+                psl_x64_vex_rr(codegen->buffer, PSL_X64VexOp_vmovaps, codegen->accumulators[i] + half, 0, 0);
+            }
+            else
+            {
+                psl_x64_vex_rm(codegen->buffer, PSL_X64VexOp_vmovups_store, 0, 0, &partial);
+            }
+        }
+    }
+}
+
+/* Writes the register accumulators to their partials, or reads them back */
+void psl_codegen_sync_accumulators(PSL_Codegen* codegen, bool write)
+{
+    for(uint32_t i = 0; i < codegen->ir->num_reductions; i++)
+    {
+        if(codegen->accumulators[i] == 0)
+        {
+            continue;
+        }
+
+        const PSL_IRParam* param = psl_ir_find_reduction(codegen->ir, i);
+
+        for(uint32_t half = 0; half < psl_codegen_num_halves(param->type); half++)
+        {
+            PSL_X64Mem partial = psl_codegen_partial(i, half);
+
+            psl_x64_vex_rm(codegen->buffer,
+                           write ? PSL_X64VexOp_vmovups_store : PSL_X64VexOp_vmovups,
+                           codegen->accumulators[i] + half,
+                           0,
+                           &partial);
+        }
+    }
+}
+
+/*
+   Accumulates the lanes of the value into the accumulator of the reduction. The value is the first
+   operand of min and max, so that NaN lanes leave the accumulator unchanged
+*/
+void psl_codegen_reduce(PSL_Codegen* codegen, PSL_IRInst* inst)
+{
+    PSL_CodeBuffer* buffer = codegen->buffer;
+    const PSL_IRParam* param = psl_ir_find_reduction(codegen->ir, inst->index);
+    const uint32_t accumulator = codegen->accumulators[inst->index];
+
+    PSL_X64VexOp op;
+
+    switch(param->reduce_op)
+    {
+        case PSL_IRReduceOp_Min:
+            op = psl_codegen_op(inst->type, PSL_X64VexOp_vminps, PSL_X64VexOp_vminpd);
+            break;
+        case PSL_IRReduceOp_Max:
+            op = psl_codegen_op(inst->type, PSL_X64VexOp_vmaxps, PSL_X64VexOp_vmaxpd);
+            break;
+        default:
+            op = psl_codegen_op(inst->type, PSL_X64VexOp_vaddps, PSL_X64VexOp_vaddpd);
+            break;
+    }
+
+    for(uint32_t half = 0; half < psl_codegen_num_halves(inst->type); half++)
+    {
+        psl_codegen_load_slot(codegen, 0, inst->args[0], half);
+
+        if(accumulator != 0)
+        {
+            psl_x64_vex_rr(buffer, op, accumulator + half, 0, accumulator + half);
+        }
+        else
+        {
+            PSL_X64Mem partial = psl_codegen_partial(inst->index, half);
+
+            psl_x64_vex_rm(buffer, PSL_X64VexOp_vmovups, 1, 0, &partial);
+            psl_x64_vex_rr(buffer, op, 1, 0, 1);
+            psl_x64_vex_rm(buffer, PSL_X64VexOp_vmovups_store, 1, 0, &partial);
+        }
+    }
+}
+
+/* ymm0 = ymm0 op slot(b) */
+void psl_codegen_binary(PSL_Codegen* codegen, PSL_X64VexOp op, PSL_IRInst* inst, uint32_t half)
+{
+    PSL_X64Mem rhs = psl_codegen_slot(codegen, inst->args[1], half);
+
+    psl_codegen_load_slot(codegen, 0, inst->args[0], half);
+    psl_x64_vex_rm(codegen->buffer, op, 0, 0, &rhs);
+}
+
+/* vcmpps predicates, ordered and non signaling except for != which is unordered like in C */
+static const uint8_t _cmp_predicates[] = {
+    0x11, /* PSL_IRCmp_Lt, LT_OQ */
+    0x12, /* PSL_IRCmp_Le, LE_OQ */
+    0x1E, /* PSL_IRCmp_Gt, GT_OQ */
+    0x1D, /* PSL_IRCmp_Ge, GE_OQ */
+    0x00, /* PSL_IRCmp_Eq, EQ_OQ */
+    0x04, /* PSL_IRCmp_Neq, NEQ_UQ */
+};
+
+/* Records the address or the rel32 at offset as a reference to the vector helper of inst */
+void psl_codegen_reloc(PSL_Codegen* codegen, PSL_IRInst* inst, size_t offset)
+{
+    PSL_CodeMap* map = codegen->map;
+
+    if(map == NULL)
+    {
+        return;
+    }
+
+    map->relocs = (PSL_CodeReloc*)realloc(map->relocs, (map->num_relocs + 1) * sizeof(PSL_CodeReloc));
+
+    PSL_ASSERT(map->relocs != NULL, "Error during code map reallocation");
+
+    psl_profile_alloc((map->num_relocs + 1) * sizeof(PSL_CodeReloc));
+
+    map->relocs[map->num_relocs].offset = (uint32_t)offset;
+    map->relocs[map->num_relocs].builtin = (PSL_BuiltinID)inst->index;
+    map->relocs[map->num_relocs].type = inst->type;
+    map->num_relocs++;
+}
+
+void psl_codegen_call_helper(PSL_Codegen* codegen, uint32_t value, PSL_IRInst* inst, uintptr_t func)
+{
+    PSL_CodeBuffer* buffer = codegen->buffer;
+
+    PSL_X64Mem out = psl_codegen_slot(codegen, value, 0);
+    PSL_X64Mem a = psl_codegen_slot(codegen, inst->args[0], 0);
+    PSL_X64Mem b = psl_codegen_slot(codegen, inst->num_args > 1 ? inst->args[1] : inst->args[0], 0);
+
+    psl_codegen_sync_accumulators(codegen, true);
+    psl_x64_vzeroupper(buffer);
+    psl_x64_lea(buffer, _abi_args[0], &out);
+    psl_x64_lea(buffer, _abi_args[1], &a);
+    psl_x64_lea(buffer, _abi_args[2], &b);
+
+    if(codegen->options->relocatable)
+    {
+        psl_codegen_reloc(codegen, inst, psl_x64_call_rel32(buffer));
+    }
+    else
+    {
+        psl_x64_mov_ri64(buffer, PSL_GPR_RAX, (uint64_t)func);
+        psl_codegen_reloc(codegen, inst, buffer->size - 8);
+        psl_x64_call_r(buffer, PSL_GPR_RAX);
+    }
+
+    psl_codegen_sync_accumulators(codegen, false);
+}
+
+bool psl_codegen_call(PSL_Codegen* codegen, uint32_t value, PSL_IRInst* inst, char** error)
+{
+    PSL_CodeBuffer* buffer = codegen->buffer;
+
+    const PSL_BuiltinID id = (PSL_BuiltinID)inst->index;
+    const PSL_Builtin* builtin = psl_builtin_get(id);
+
+    if(inst->type == PSL_IRType_F64 && builtin->vector_func_f64 != NULL)
+    {
+        psl_codegen_call_helper(codegen, value, inst, (uintptr_t)builtin->vector_func_f64);
+        return true;
+    }
+
+    if(inst->type == PSL_IRType_F32 && builtin->vector_func != NULL)
+    {
+        psl_codegen_call_helper(codegen, value, inst, (uintptr_t)builtin->vector_func);
+        return true;
+    }
+
+    /* Constants needed by the lowering are broadcast once for both halves */
+    if(id == PSL_BuiltinID_Abs)
+    {
+        psl_codegen_broadcast_lane(buffer, inst->type, 1, 0x7FFFFFFFFFFFFFFF);
+    }
+
+    for(uint32_t half = 0; half < psl_codegen_num_halves(inst->type); half++)
+    {
+        PSL_X64Mem a = psl_codegen_slot(codegen, inst->args[0], half);
+
+        switch(id)
+        {
+            case PSL_BuiltinID_Sqrt:
+                psl_x64_vex_rm(buffer, psl_codegen_op(inst->type, PSL_X64VexOp_vsqrtps, PSL_X64VexOp_vsqrtpd), 0, 0, &a);
+                break;
+            case PSL_BuiltinID_Abs:
+                psl_x64_vex_rm(buffer, psl_codegen_op(inst->type, PSL_X64VexOp_vandps, PSL_X64VexOp_vandpd), 0, 1, &a);
+                break;
+            case PSL_BuiltinID_Floor:
+                /* imm8 bit 3 suppresses the precision exception */
+                psl_x64_vex_rm(buffer, psl_codegen_op(inst->type, PSL_X64VexOp_vroundps, PSL_X64VexOp_vroundpd), 0, 0, &a);
+                psl_code_buffer_emit8(buffer, 0x09);
+                break;
+            case PSL_BuiltinID_Ceil:
+                psl_x64_vex_rm(buffer, psl_codegen_op(inst->type, PSL_X64VexOp_vroundps, PSL_X64VexOp_vroundpd), 0, 0, &a);
+                psl_code_buffer_emit8(buffer, 0x0A);
+                break;
+            default:
+                *error = "Builtin has no native lowering nor vector helper";
+                return false;
+        }
+
+        psl_codegen_store_slot(codegen, value, half, 0);
+    }
+
+    return true;
+}
+
+/* Narrows the two halves of the f64 value into ymm0 */
+void psl_codegen_narrow(PSL_Codegen* codegen, const PSL_X64Mem* low, const PSL_X64Mem* high)
+{
+    psl_x64_vex_rm(codegen->buffer, PSL_X64VexOp_vcvtpd2ps, 0, 0, low);
+    psl_x64_vex_rm(codegen->buffer, PSL_X64VexOp_vcvtpd2ps, 1, 0, high);
+    psl_x64_vex_rr(codegen->buffer, PSL_X64VexOp_vinsertf128, 0, 0, 1);
+    psl_code_buffer_emit8(codegen->buffer, 1);
+}
+
+/* f32 lanes 0-3 and 4-7 are widened into the two halves, f64 halves are narrowed and joined */
+void psl_codegen_convert(PSL_Codegen* codegen, uint32_t value, PSL_IRInst* inst)
+{
+    PSL_CodeBuffer* buffer = codegen->buffer;
+
+    if(inst->type == PSL_IRType_F64)
+    {
+        for(uint32_t half = 0; half < 2; half++)
+        {
+            PSL_X64Mem src = psl_codegen_slot(codegen, inst->args[0], 0);
+            src.disp += (int32_t)(half * 4 * sizeof(float));
+
+            psl_x64_vex_rm(buffer, PSL_X64VexOp_vcvtps2pd, 0, 0, &src);
+            psl_codegen_store_slot(codegen, value, half, 0);
+        }
+    }
+    else
+    {
+        PSL_X64Mem low = psl_codegen_slot(codegen, inst->args[0], 0);
+        PSL_X64Mem high = psl_codegen_slot(codegen, inst->args[0], 1);
+
+        psl_codegen_narrow(codegen, &low, &high);
+        psl_codegen_store_slot(codegen, value, 0, 0);
+    }
+}
+
+/* Storage format of column, matching the type of its parameter if it has not been set */
+PSL_ColumnFormat psl_codegen_column_format(PSL_Codegen* codegen, PSL_IRInst* inst)
+{
+    PSL_IRParam* param = psl_ir_find_column(codegen->ir, inst->index);
+
+    if(param != NULL && param->format != PSL_ColumnFormat_Default)
+    {
+        return param->format;
+    }
+
+    return inst->type == PSL_IRType_F64 ? PSL_ColumnFormat_F64 : PSL_ColumnFormat_F32;
+}
+
+/* Broadcasts the f32 value to all the lanes of ymm */
+void psl_codegen_broadcast_f32(PSL_CodeBuffer* buffer, uint32_t ymm, float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(float));
+    psl_codegen_broadcast_bits(buffer, ymm, bits);
+}
+
+/* Largest value of a unorm format */
+PSL_FORCE_INLINE float psl_codegen_unorm_max(PSL_ColumnFormat format)
+{
+    return format == PSL_ColumnFormat_Unorm8 ? 255.0f : 65535.0f;
+}
+
+/* Loads the current elements of a f16 or unorm column as f32 into ymm0 */
+void psl_codegen_decode(PSL_Codegen* codegen, PSL_ColumnFormat format, uint32_t column)
+{
+    PSL_CodeBuffer* buffer = codegen->buffer;
+    PSL_X64Mem element = psl_codegen_element(codegen, format, 0);
+
+    psl_codegen_column_address(buffer, column);
+    psl_codegen_prefetch(codegen, format);
+
+    switch(format)
+    {
+        case PSL_ColumnFormat_F16:
+            psl_x64_vex_rm(buffer, PSL_X64VexOp_vcvtph2ps, 0, 0, &element);
+            return;
+        case PSL_ColumnFormat_Unorm8:
+            psl_x64_vex_rm(buffer, PSL_X64VexOp_vpmovzxbd, 0, 0, &element);
+            break;
+        default:
+            psl_x64_vex_rm(buffer, PSL_X64VexOp_vpmovzxwd, 0, 0, &element);
+            break;
+    }
+
+    psl_x64_vex_rr(buffer, PSL_X64VexOp_vcvtdq2ps, 0, 0, 0);
+    psl_codegen_broadcast_f32(buffer, 1, 1.0f / psl_codegen_unorm_max(format));
+    psl_x64_vex_rr(buffer, PSL_X64VexOp_vmulps, 0, 0, 1);
+}
+
+/* Stores the f32 lanes of ymm0 into the current elements of a f16 or unorm column */
+void psl_codegen_encode(PSL_Codegen* codegen, PSL_ColumnFormat format, uint32_t column)
+{
+    PSL_CodeBuffer* buffer = codegen->buffer;
+    PSL_X64Mem element = psl_codegen_element(codegen, format, 0);
+
+    if(format == PSL_ColumnFormat_F16)
+    {
+        psl_codegen_column_address(buffer, column);
+        psl_x64_vex_rm(buffer, PSL_X64VexOp_vcvtps2ph, 0, 0, &element);
+        psl_code_buffer_emit8(buffer, 0); /* round to nearest even */
+        return;
+    }
+
+    /* vmaxps returns its second operand when one of them is NaN, so NaN is stored as 0 */
+    psl_x64_vex_rr(buffer, PSL_X64VexOp_vxorps, 1, 1, 1);
+    psl_x64_vex_rr(buffer, PSL_X64VexOp_vmaxps, 0, 0, 1);
+    psl_codegen_broadcast_f32(buffer, 1, 1.0f);
+    psl_x64_vex_rr(buffer, PSL_X64VexOp_vminps, 0, 0, 1);
+    psl_codegen_broadcast_f32(buffer, 1, psl_codegen_unorm_max(format));
+    psl_x64_vex_rr(buffer, PSL_X64VexOp_vmulps, 0, 0, 1);
+    psl_x64_vex_rr(buffer, PSL_X64VexOp_vcvtps2dq, 0, 0, 0);
+
+    /* Lanes are in range, the saturating packs only narrow them */
+    psl_x64_vex_rr(buffer, PSL_X64VexOp_vextractf128, 0, 0, 1);
+    psl_code_buffer_emit8(buffer, 1);
+    psl_x64_vex_rr(buffer, PSL_X64VexOp_vpackusdw, 0, 0, 1);
+
+    psl_codegen_column_address(buffer, column);
+
+    if(format == PSL_ColumnFormat_Unorm8)
+    {
+        psl_x64_vex_rr(buffer, PSL_X64VexOp_vpackuswb, 0, 0, 0);
+        psl_x64_vex_rm(buffer, PSL_X64VexOp_vmovq_store, 0, 0, &element);
+    }
+    else
+    {
+        psl_x64_vex_rm(buffer, PSL_X64VexOp_vmovups_store128, 0, 0, &element);
+    }
+}
+
+void psl_codegen_load(PSL_Codegen* codegen, uint32_t value, PSL_IRInst* inst)
+{
+    PSL_CodeBuffer* buffer = codegen->buffer;
+    const PSL_ColumnFormat format = psl_codegen_column_format(codegen, inst);
+
+    if(format == PSL_ColumnFormat_F32 || format == PSL_ColumnFormat_F64)
+    {
+        const bool widen = format == PSL_ColumnFormat_F32 && inst->type == PSL_IRType_F64;
+
+        psl_codegen_column_address(buffer, inst->index);
+        psl_codegen_prefetch(codegen, format);
+
+        if(format == PSL_ColumnFormat_F64 && inst->type == PSL_IRType_F32)
+        {
+            PSL_X64Mem low = psl_codegen_element(codegen, format, 0);
+            PSL_X64Mem high = psl_codegen_element(codegen, format, PSL_CODEGEN_SLOT_SIZE);
+
+            psl_codegen_narrow(codegen, &low, &high);
+            psl_codegen_store_slot(codegen, value, 0, 0);
+            return;
+        }
+
+        const uint32_t half_size = widen ? (uint32_t)(4 * sizeof(float)) : PSL_CODEGEN_SLOT_SIZE;
+
+        for(uint32_t half = 0; half < psl_codegen_num_halves(inst->type); half++)
+        {
+            PSL_X64Mem element = psl_codegen_element(codegen, format, half * half_size);
+
+            psl_x64_vex_rm(buffer, widen ? PSL_X64VexOp_vcvtps2pd : PSL_X64VexOp_vmovups, 0, 0, &element);
+            psl_codegen_store_slot(codegen, value, half, 0);
+        }
+
+        return;
+    }
+
+    psl_codegen_decode(codegen, format, inst->index);
+
+    if(inst->type == PSL_IRType_F64)
+    {
+        psl_x64_vex_rr(buffer, PSL_X64VexOp_vcvtps2pd, 1, 0, 0);
+        psl_codegen_store_slot(codegen, value, 0, 1);
+        psl_x64_vex_rr(buffer, PSL_X64VexOp_vextractf128, 0, 0, 0);
+        psl_code_buffer_emit8(buffer, 1);
+        psl_x64_vex_rr(buffer, PSL_X64VexOp_vcvtps2pd, 0, 0, 0);
+        psl_codegen_store_slot(codegen, value, 1, 0);
+    }
+    else
+    {
+        psl_codegen_store_slot(codegen, value, 0, 0);
+    }
+}
+
+void psl_codegen_store(PSL_Codegen* codegen, PSL_IRInst* inst)
+{
+    PSL_CodeBuffer* buffer = codegen->buffer;
+    const PSL_ColumnFormat format = psl_codegen_column_format(codegen, inst);
+    const uint32_t source = inst->args[0];
+
+    if(format == PSL_ColumnFormat_F64 && inst->type == PSL_IRType_F32)
+    {
+        psl_codegen_column_address(buffer, inst->index);
+
+        for(uint32_t half = 0; half < 2; half++)
+        {
+            PSL_X64Mem src = psl_codegen_slot(codegen, source, 0);
+            PSL_X64Mem element = psl_codegen_element(codegen, format, half * PSL_CODEGEN_SLOT_SIZE);
+            src.disp += (int32_t)(half * 4 * sizeof(float));
+
+            psl_x64_vex_rm(buffer, PSL_X64VexOp_vcvtps2pd, 0, 0, &src);
+            psl_x64_vex_rm(buffer, psl_codegen_store_op(codegen), 0, 0, &element);
+        }
+
+        return;
+    }
+
+    if(format == PSL_ColumnFormat_F64 || (format == PSL_ColumnFormat_F32 && inst->type == PSL_IRType_F32))
+    {
+        psl_codegen_column_address(buffer, inst->index);
+
+        for(uint32_t half = 0; half < psl_codegen_num_halves(inst->type); half++)
+        {
+            PSL_X64Mem element = psl_codegen_element(codegen, format, half * PSL_CODEGEN_SLOT_SIZE);
+
+            psl_codegen_load_slot(codegen, 0, source, half);
+            psl_x64_vex_rm(buffer, psl_codegen_store_op(codegen), 0, 0, &element);
+        }
+
+        return;
+    }
+
+    /* Other formats are encoded from f32 lanes */
+    if(inst->type == PSL_IRType_F64)
+    {
+        PSL_X64Mem low = psl_codegen_slot(codegen, source, 0);
+        PSL_X64Mem high = psl_codegen_slot(codegen, source, 1);
+
+        psl_codegen_narrow(codegen, &low, &high);
+    }
+    else
+    {
+        psl_codegen_load_slot(codegen, 0, source, 0);
+    }
+
+    if(format == PSL_ColumnFormat_F32)
+    {
+        PSL_X64Mem element = psl_codegen_element(codegen, format, 0);
+
+        psl_codegen_column_address(buffer, inst->index);
+        psl_x64_vex_rm(buffer, psl_codegen_store_op(codegen), 0, 0, &element);
+        return;
+    }
+
+    psl_codegen_encode(codegen, format, inst->index);
+}
+
+/* slot = ymm0 = args[2] + args[0] * args[1] with a single rounding, assumes FMA3 next to AVX2 */
+void psl_codegen_fma(PSL_Codegen* codegen, uint32_t value, PSL_IRInst* inst)
+{
+    const uint32_t num_halves = psl_codegen_num_halves(inst->type);
+
+    for(uint32_t half = 0; half < num_halves; half++)
+    {
+        PSL_X64Mem b = psl_codegen_slot(codegen, inst->args[1], half);
+
+        psl_codegen_load_slot(codegen, 0, inst->args[2], half);
+        psl_codegen_load_slot(codegen, 1, inst->args[0], half);
+        psl_x64_vex_rm(codegen->buffer,
+                       psl_codegen_op(inst->type, PSL_X64VexOp_vfmadd231ps, PSL_X64VexOp_vfmadd231pd),
+                       0,
+                       1,
+                       &b);
+        psl_codegen_store_slot(codegen, value, half, 0);
+    }
+}
+
+/*
+   vrcpps and vrsqrtps only have 12 bits of precision, a Newton-Raphson step brings them close to
+   full f32 precision:
+   rcp:   r' = r + r * (1 - x * r)
+   rsqrt: r' = r + r * 0.5 * (1 - x * r * r)
+*/
+void psl_codegen_approx(PSL_Codegen* codegen, uint32_t value, PSL_IRInst* inst)
+{
+    PSL_CodeBuffer* buffer = codegen->buffer;
+
+    psl_codegen_load_slot(codegen, 1, inst->args[0], 0);
+
+    if(inst->opcode == PSL_IROpcode_Rcp)
+    {
+        psl_x64_vex_rr(buffer, PSL_X64VexOp_vrcpps, 0, 0, 1);
+        psl_codegen_broadcast_f32(buffer, 2, 1.0f);
+        psl_x64_vex_rr(buffer, PSL_X64VexOp_vfnmadd231ps, 2, 1, 0);
+        psl_x64_vex_rr(buffer, PSL_X64VexOp_vfmadd231ps, 0, 0, 2);
+    }
+    else
+    {
+        psl_x64_vex_rr(buffer, PSL_X64VexOp_vrsqrtps, 0, 0, 1);
+        psl_x64_vex_rr(buffer, PSL_X64VexOp_vmulps, 2, 1, 0);
+        psl_codegen_broadcast_f32(buffer, 1, 1.0f);
+        psl_x64_vex_rr(buffer, PSL_X64VexOp_vfnmadd231ps, 1, 2, 0);
+        psl_codegen_broadcast_f32(buffer, 2, 0.5f);
+        psl_x64_vex_rr(buffer, PSL_X64VexOp_vmulps, 1, 1, 2);
+        psl_x64_vex_rr(buffer, PSL_X64VexOp_vfmadd231ps, 0, 0, 1);
+    }
+
+    psl_codegen_store_slot(codegen, value, 0, 0);
+}
+
+bool psl_codegen_inst(PSL_Codegen* codegen, uint32_t value, char** error)
+{
+    PSL_CodeBuffer* buffer = codegen->buffer;
+    PSL_IRInst* inst = &codegen->ir->insts[value];
+
+    const PSL_IRType type = inst->type;
+    const uint32_t num_halves = psl_codegen_num_halves(type);
+
+    /* Instructions computing their result in ymm0 for each half */
+    PSL_X64VexOp op;
+
+    switch(inst->opcode)
+    {
+        case PSL_IROpcode_Const:
+        {
+            uint64_t bits;
+
+            if(type == PSL_IRType_F64)
+            {
+                memcpy(&bits, &inst->constant, sizeof(uint64_t));
+            }
+            else
+            {
+                const float constant = (float)inst->constant;
+                uint32_t bits32;
+                memcpy(&bits32, &constant, sizeof(uint32_t));
+                bits = (uint64_t)bits32 << 32;
+            }
+
+            psl_codegen_broadcast_lane(buffer, type, 0, bits);
+
+            for(uint32_t half = 0; half < num_halves; half++)
+            {
+                psl_codegen_store_slot(codegen, value, half, 0);
+            }
+
+            return true;
+        }
+        case PSL_IROpcode_Uniform:
+        {
+            PSL_X64Mem uniform_ptr = psl_x64_mem(PSL_CODEGEN_REG_UNIFORMS, (int32_t)(inst->index * sizeof(void*)));
+            PSL_X64Mem uniform = psl_x64_mem(PSL_GPR_RAX, 0);
+
+            psl_x64_mov_rm(buffer, PSL_GPR_RAX, &uniform_ptr);
+            psl_x64_vex_rm(buffer,
+                           psl_codegen_op(type, PSL_X64VexOp_vbroadcastss, PSL_X64VexOp_vbroadcastsd),
+                           0,
+                           0,
+                           &uniform);
+
+            for(uint32_t half = 0; half < num_halves; half++)
+            {
+                psl_codegen_store_slot(codegen, value, half, 0);
+            }
+
+            return true;
+        }
+        case PSL_IROpcode_Load:
+            psl_codegen_load(codegen, value, inst);
+            return true;
+        case PSL_IROpcode_Store:
+            psl_codegen_store(codegen, inst);
+            return true;
+        case PSL_IROpcode_Reduce:
+            psl_codegen_reduce(codegen, inst);
+            return true;
+        case PSL_IROpcode_Add:
+            op = psl_codegen_op(type, PSL_X64VexOp_vaddps, PSL_X64VexOp_vaddpd);
+            break;
+        case PSL_IROpcode_Sub:
+            op = psl_codegen_op(type, PSL_X64VexOp_vsubps, PSL_X64VexOp_vsubpd);
+            break;
+        case PSL_IROpcode_Mul:
+            op = psl_codegen_op(type, PSL_X64VexOp_vmulps, PSL_X64VexOp_vmulpd);
+            break;
+        case PSL_IROpcode_Div:
+            op = psl_codegen_op(type, PSL_X64VexOp_vdivps, PSL_X64VexOp_vdivpd);
+            break;
+        case PSL_IROpcode_Min:
+            op = psl_codegen_op(type, PSL_X64VexOp_vminps, PSL_X64VexOp_vminpd);
+            break;
+        case PSL_IROpcode_Max:
+            op = psl_codegen_op(type, PSL_X64VexOp_vmaxps, PSL_X64VexOp_vmaxpd);
+            break;
+        case PSL_IROpcode_Cmp:
+            for(uint32_t half = 0; half < num_halves; half++)
+            {
+                psl_codegen_binary(codegen, psl_codegen_op(type, PSL_X64VexOp_vcmpps, PSL_X64VexOp_vcmppd), inst, half);
+                psl_code_buffer_emit8(buffer, _cmp_predicates[inst->index]);
+                psl_codegen_store_slot(codegen, value, half, 0);
+            }
+
+            return true;
+        case PSL_IROpcode_Select:
+            /* Lanes never diverge, both sides are computed and blended on the mask */
+            for(uint32_t half = 0; half < num_halves; half++)
+            {
+                PSL_X64Mem if_true = psl_codegen_slot(codegen, inst->args[1], half);
+
+                psl_codegen_load_slot(codegen, 2, inst->args[0], half);
+                psl_codegen_load_slot(codegen, 1, inst->args[2], half);
+                psl_x64_vex_rm(buffer, psl_codegen_op(type, PSL_X64VexOp_vblendvps, PSL_X64VexOp_vblendvpd), 0, 1, &if_true);
+                psl_code_buffer_emit8(buffer, 2 << 4);
+                psl_codegen_store_slot(codegen, value, half, 0);
+            }
+
+            return true;
+        case PSL_IROpcode_Neg:
+            psl_codegen_broadcast_lane(buffer, type, 1, 0x8000000000000000);
+
+            for(uint32_t half = 0; half < num_halves; half++)
+            {
+                PSL_X64Mem a = psl_codegen_slot(codegen, inst->args[0], half);
+
+                psl_x64_vex_rm(buffer, psl_codegen_op(type, PSL_X64VexOp_vxorps, PSL_X64VexOp_vxorpd), 0, 1, &a);
+                psl_codegen_store_slot(codegen, value, half, 0);
+            }
+
+            return true;
+        case PSL_IROpcode_Convert:
+            psl_codegen_convert(codegen, value, inst);
+            return true;
+        case PSL_IROpcode_Call:
+            return psl_codegen_call(codegen, value, inst, error);
+        case PSL_IROpcode_Fma:
+            psl_codegen_fma(codegen, value, inst);
+            return true;
+        case PSL_IROpcode_Rcp:
+        case PSL_IROpcode_Rsqrt:
+            psl_codegen_approx(codegen, value, inst);
+            return true;
+        default:
+            *error = "Unsupported IR instruction";
+            return false;
+    }
+
+    for(uint32_t half = 0; half < num_halves; half++)
+    {
+        psl_codegen_binary(codegen, op, inst, half);
+        psl_codegen_store_slot(codegen, value, half, 0);
+    }
+
+    return true;
+}
+
+void psl_codegen_prologue(PSL_CodeBuffer* buffer, uint32_t frame_size)
+{
+    psl_x64_push(buffer, PSL_GPR_RBP);
+    psl_x64_mov_rr(buffer, PSL_GPR_RBP, PSL_GPR_RSP);
+    psl_x64_push(buffer, PSL_GPR_RBX);
+    psl_x64_push(buffer, PSL_GPR_R12);
+    psl_x64_push(buffer, PSL_GPR_R13);
+    psl_x64_push(buffer, PSL_GPR_R14);
+    psl_x64_push(buffer, PSL_GPR_R15);
+
+#if defined(PSL_WIN)
+    /* Windows commits stack pages one at a time through the guard page */
+    PSL_X64Mem probe = psl_x64_mem(PSL_GPR_RSP, 0);
+
+    while(frame_size > PSL_CODEGEN_PAGE_SIZE)
+    {
+        psl_x64_sub_ri(buffer, PSL_GPR_RSP, PSL_CODEGEN_PAGE_SIZE);
+        psl_x64_probe(buffer, &probe);
+        frame_size -= PSL_CODEGEN_PAGE_SIZE;
+    }
+#endif /* defined(PSL_WIN) */
+
+    psl_x64_sub_ri(buffer, PSL_GPR_RSP, (int32_t)frame_size);
+    psl_x64_and_ri(buffer, PSL_GPR_RSP, -PSL_CODEGEN_SLOT_SIZE);
+
+    PSL_X64Mem columns = psl_x64_mem(_abi_args[0], (int32_t)offsetof(PSL_KernelArgs, columns));
+    PSL_X64Mem uniforms = psl_x64_mem(_abi_args[0], (int32_t)offsetof(PSL_KernelArgs, uniforms));
+    PSL_X64Mem count = psl_x64_mem(_abi_args[0], (int32_t)offsetof(PSL_KernelArgs, count));
+    PSL_X64Mem partials = psl_x64_mem(_abi_args[0], (int32_t)offsetof(PSL_KernelArgs, partials));
+
+    psl_x64_mov_rm(buffer, PSL_CODEGEN_REG_COLUMNS, &columns);
+    psl_x64_mov_rm(buffer, PSL_CODEGEN_REG_UNIFORMS, &uniforms);
+    psl_x64_mov_rm(buffer, PSL_CODEGEN_REG_COUNT, &count);
+    psl_x64_mov_rm(buffer, PSL_CODEGEN_REG_PARTIALS, &partials);
+}
+
+void psl_codegen_epilogue(PSL_CodeBuffer* buffer)
+{
+    PSL_X64Mem saved = psl_x64_mem(PSL_GPR_RBP, -PSL_CODEGEN_SAVED_SIZE);
+
+    psl_x64_vzeroupper(buffer);
+    psl_x64_lea(buffer, PSL_GPR_RSP, &saved);
+    psl_x64_pop(buffer, PSL_GPR_R15);
+    psl_x64_pop(buffer, PSL_GPR_R14);
+    psl_x64_pop(buffer, PSL_GPR_R13);
+    psl_x64_pop(buffer, PSL_GPR_R12);
+    psl_x64_pop(buffer, PSL_GPR_RBX);
+    psl_x64_pop(buffer, PSL_GPR_RBP);
+    psl_x64_ret(buffer);
+}
+
+/*
+   Picks the number of groups processed per iteration when it is not forced. Values live in stack
+   slots rather than registers, so the pressure to keep in check is the size of the slots of the
+   loop: they must stay well within L1 for the loads and stores of each group to hit it
+*/
+uint32_t psl_codegen_num_groups(PSL_IR* ir, const bool* invariant, uint32_t unroll)
+{
+    if(unroll != 0)
+    {
+        return unroll < PSL_CODEGEN_MAX_UNROLL ? unroll : PSL_CODEGEN_MAX_UNROLL;
+    }
+
+    uint32_t loop_slots_size = 0;
+
+    for(uint32_t i = 0; i < ir->num_insts; i++)
+    {
+        loop_slots_size += invariant[i] ? 0 : psl_codegen_num_halves(ir->insts[i].type) * PSL_CODEGEN_SLOT_SIZE;
+    }
+
+    uint32_t num_groups = PSL_CODEGEN_MAX_UNROLL;
+
+    while(num_groups > 1 && num_groups * loop_slots_size > PSL_CODEGEN_UNROLL_SLOTS_SIZE)
+    {
+        num_groups /= 2;
+    }
+
+    return num_groups;
+}
+
+void psl_code_map_init(PSL_CodeMap* map)
+{
+    map->entries = NULL;
+    map->num_entries = 0;
+    map->capacity = 0;
+    map->slots = NULL;
+    map->strides = NULL;
+    map->accumulators = NULL;
+    map->num_groups = 0;
+    map->loop_start = 0;
+    map->loop_end = 0;
+    map->relocs = NULL;
+    map->num_relocs = 0;
+}
+
+void psl_code_map_destroy(PSL_CodeMap* map)
+{
+    free(map->entries);
+    free(map->slots);
+    free(map->strides);
+    free(map->accumulators);
+    free(map->relocs);
+    psl_code_map_init(map);
+}
+
+/* Maps the code emitted from now on to value, an entry at the same offset is replaced as it maps no code */
+void psl_codegen_map(PSL_Codegen* codegen, uint32_t value)
+{
+    PSL_CodeMap* map = codegen->map;
+
+    if(map == NULL)
+    {
+        return;
+    }
+
+    const uint32_t offset = (uint32_t)codegen->buffer->size;
+
+    if(map->num_entries > 0 && map->entries[map->num_entries - 1].offset == offset)
+    {
+        map->entries[map->num_entries - 1].value = value;
+        return;
+    }
+
+    if(map->num_entries > 0 && map->entries[map->num_entries - 1].value == value)
+    {
+        return;
+    }
+
+    if(map->num_entries == map->capacity)
+    {
+        map->capacity = map->capacity == 0 ? 64 : map->capacity * 2;
+        map->entries = (PSL_CodeMapEntry*)realloc(map->entries, map->capacity * sizeof(PSL_CodeMapEntry));
+
+        PSL_ASSERT(map->entries != NULL, "Error during code map reallocation");
+
+        psl_profile_alloc(map->capacity * sizeof(PSL_CodeMapEntry));
+    }
+
+    map->entries[map->num_entries].offset = offset;
+    map->entries[map->num_entries].value = value;
+    map->num_entries++;
+}
+
+bool psl_codegen_mapped_inst(PSL_Codegen* codegen, uint32_t value, char** error)
+{
+    psl_codegen_map(codegen, value);
+
+    const bool success = psl_codegen_inst(codegen, value, error);
+
+    psl_codegen_map(codegen, PSL_IR_INVALID_VALUE);
+
+    return success;
+}
+
+/* Emits the loop instructions for groups 0 to num_groups - 1, instruction by instruction */
+bool psl_codegen_loop_body(PSL_Codegen* codegen, const bool* invariant, uint32_t num_groups, char** error)
+{
+    bool success = true;
+
+    for(uint32_t i = 0; success && i < codegen->ir->num_insts; i++)
+    {
+        for(uint32_t group = 0; success && !invariant[i] && group < num_groups; group++)
+        {
+            codegen->group = group;
+            success = psl_codegen_mapped_inst(codegen, i, error);
+        }
+    }
+
+    codegen->group = 0;
+
+    return success;
+}
+
+/* Returns array on the heap, copied there when it lives in the scratch of the IR */
+uint32_t* psl_codegen_detach(PSL_IR* ir, uint32_t* array, uint32_t count)
+{
+    if(ir->scratch == NULL)
+    {
+        return array;
+    }
+
+    uint32_t* copy = (uint32_t*)malloc(count * sizeof(uint32_t) + 1);
+    psl_profile_alloc(count * sizeof(uint32_t));
+    memcpy(copy, array, count * sizeof(uint32_t));
+
+    return copy;
+}
+
+void psl_codegen_options_init(PSL_CodegenOptions* options)
+{
+    options->unroll = 0;
+    options->streaming = false;
+    options->prefetch_distance = 0;
+    options->relocatable = false;
+}
+
+bool psl_codegen_emit(PSL_IR* ir,
+                      const PSL_CodegenOptions* options,
+                      PSL_CodeBuffer* buffer,
+                      PSL_CodeMap* map,
+                      char** error)
+{
+    PSL_ProfileScope scope;
+    psl_profile_phase_begin(&scope);
+
+    PSL_Codegen codegen;
+    codegen.buffer = buffer;
+    codegen.ir = ir;
+    codegen.slots = (uint32_t*)psl_ir_alloc(ir, ir->num_insts * sizeof(uint32_t));
+    codegen.strides = (uint32_t*)psl_ir_alloc(ir, ir->num_insts * sizeof(uint32_t));
+    codegen.accumulators = (uint32_t*)psl_ir_alloc(ir, ir->num_reductions * sizeof(uint32_t));
+    codegen.group = 0;
+    codegen.options = options;
+    codegen.map = map;
+
+    /* The prologue belongs to the kernel itself */
+    psl_codegen_map(&codegen, PSL_IR_INVALID_VALUE);
+
+    bool* invariant = (bool*)psl_ir_alloc(ir, ir->num_insts * sizeof(bool));
+
+    psl_ir_find_invariants(ir, invariant);
+
+    const uint32_t num_groups = psl_codegen_num_groups(ir, invariant, options->unroll);
+
+    uint32_t slots_size = 0;
+
+    for(uint32_t i = 0; i < ir->num_insts; i++)
+    {
+        const uint32_t size = psl_codegen_num_halves(ir->insts[i].type) * PSL_CODEGEN_SLOT_SIZE;
+
+        codegen.slots[i] = PSL_CODEGEN_SHADOW_SPACE + slots_size;
+        codegen.strides[i] = invariant[i] ? 0 : size;
+        slots_size += invariant[i] ? size : size * num_groups;
+    }
+
+    /* Extra slot to leave room for the alignment of rsp */
+    const uint32_t frame_size = PSL_CODEGEN_SHADOW_SPACE + slots_size + PSL_CODEGEN_SLOT_SIZE;
+
+    psl_profile_phase_end(&scope, PSL_CompilePhase_SlotLayout);
+    psl_profile_phase_begin(&scope);
+
+    psl_codegen_prologue(buffer, frame_size);
+
+    bool success = true;
+
+    psl_codegen_init_accumulators(&codegen);
+
+    /* Preheader */
+    for(uint32_t i = 0; success && i < ir->num_insts; i++)
+    {
+        if(invariant[i])
+        {
+            success = psl_codegen_mapped_inst(&codegen, i, error);
+        }
+    }
+
+    psl_x64_xor_rr32(buffer, PSL_CODEGEN_REG_INDEX, PSL_CODEGEN_REG_INDEX);
+
+    size_t main_loop_start = 0;
+    size_t main_loop_end = 0;
+
+    /* Unrolled loop, while all the groups are before count */
+    if(num_groups > 1)
+    {
+        PSL_X64Mem groups_end = psl_x64_mem(PSL_CODEGEN_REG_INDEX, (int32_t)(num_groups * PSL_LANES));
+
+        const size_t unrolled_start = buffer->size;
+        main_loop_start = unrolled_start;
+
+        psl_x64_lea(buffer, PSL_GPR_RAX, &groups_end);
+        psl_x64_cmp_rr(buffer, PSL_GPR_RAX, PSL_CODEGEN_REG_COUNT);
+        const size_t unrolled_exit = psl_x64_jcc(buffer, PSL_Cond_A);
+
+        success = success && psl_codegen_loop_body(&codegen, invariant, num_groups, error);
+
+        psl_x64_add_ri(buffer, PSL_CODEGEN_REG_INDEX, (int32_t)(num_groups * PSL_LANES));
+        psl_x64_patch_rel32(buffer, psl_x64_jmp(buffer), unrolled_start);
+        main_loop_end = buffer->size;
+
+        psl_x64_patch_rel32(buffer, unrolled_exit, buffer->size);
+    }
+
+    /* Remainder loop, or the only one without unrolling */
+    const size_t loop_start = buffer->size;
+
+    psl_x64_cmp_rr(buffer, PSL_CODEGEN_REG_INDEX, PSL_CODEGEN_REG_COUNT);
+    const size_t loop_exit = psl_x64_jcc(buffer, PSL_Cond_AE);
+
+    success = success && psl_codegen_loop_body(&codegen, invariant, 1, error);
+
+    psl_x64_add_ri(buffer, PSL_CODEGEN_REG_INDEX, PSL_LANES);
+    psl_x64_patch_rel32(buffer, psl_x64_jmp(buffer), loop_start);
+
+    if(num_groups == 1)
+    {
+        main_loop_start = loop_start;
+        main_loop_end = buffer->size;
+    }
+
+    psl_x64_patch_rel32(buffer, loop_exit, buffer->size);
+
+    /* Non-temporal stores are weakly ordered, they must be visible once the kernel returns */
+    if(options->streaming)
+    {
+        psl_x64_sfence(buffer);
+    }
+
+    psl_codegen_sync_accumulators(&codegen, true);
+    psl_codegen_epilogue(buffer);
+
+    /* The layout is handed over to the map */
+    if(map != NULL)
+    {
+        map->slots = psl_codegen_detach(ir, codegen.slots, ir->num_insts);
+        map->strides = psl_codegen_detach(ir, codegen.strides, ir->num_insts);
+        map->accumulators = psl_codegen_detach(ir, codegen.accumulators, ir->num_reductions);
+        map->num_groups = num_groups;
+        map->loop_start = (uint32_t)main_loop_start;
+        map->loop_end = (uint32_t)main_loop_end;
+
+        codegen.slots = NULL;
+        codegen.strides = NULL;
+        codegen.accumulators = NULL;
+    }
+
+    psl_ir_free(ir, invariant);
+    psl_ir_free(ir, codegen.strides);
+    psl_ir_free(ir, codegen.slots);
+    psl_ir_free(ir, codegen.accumulators);
+
+    psl_profile_phase_end(&scope, PSL_CompilePhase_Encode);
+
+    return success;
+}
@@ -0,0 +1,630 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#include "psl/codeheap.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(PSL_WIN)
+#include <Windows.h>
+#else
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#if defined(PSL_LINUX)
+#include <sys/syscall.h>
+#endif /* defined(PSL_LINUX) */
+#endif /* defined(PSL_WIN) */
+
+#if !defined(MFD_CLOEXEC)
+#define MFD_CLOEXEC 1
+#endif /* !defined(MFD_CLOEXEC) */
+
+/* int3, traps if freed code is ever called */
+#define PSL_CODE_HEAP_FILL 0xCC
+
+/* Range of bytes of a chunk that holds no live code */
+typedef struct {
+    size_t offset;
+    size_t size;
+} PSL_CodeBlock;
+
+typedef struct PSL_CodeChunk {
+    struct PSL_CodeChunk* next;
+    PSL_CodeHeapMode mode;
+    uint8_t* code; /* executable view */
+    uint8_t* write; /* writable view in dual mapping, the executable view when protected */
+    size_t size;
+    size_t top; /* bytes above have never been allocated */
+    size_t used;
+    uint32_t num_allocations;
+    PSL_CodeBlock* free_blocks; /* sorted by offset, never adjacent nor touching top */
+    uint32_t num_free_blocks;
+    uint32_t free_capacity;
+} PSL_CodeChunk;
+
+static PSL_CodeChunk* _chunks = NULL;
+static PSL_CodeHeapMode _mode = PSL_CodeHeapMode_DualMapping;
+
+#if defined(PSL_WIN)
+static SRWLOCK _heap_lock = SRWLOCK_INIT;
+#else
+static pthread_mutex_t _heap_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif /* defined(PSL_WIN) */
+
+void psl_code_heap_lock(void)
+{
+#if defined(PSL_WIN)
+    AcquireSRWLockExclusive(&_heap_lock);
+#else
+    pthread_mutex_lock(&_heap_lock);
+#endif /* defined(PSL_WIN) */
+}
+
+void psl_code_heap_unlock(void)
+{
+#if defined(PSL_WIN)
+    ReleaseSRWLockExclusive(&_heap_lock);
+#else
+    pthread_mutex_unlock(&_heap_lock);
+#endif /* defined(PSL_WIN) */
+}
+
+size_t psl_code_heap_page_size(void)
+{
+#if defined(PSL_WIN)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (size_t)info.dwPageSize;
+#else
+    return (size_t)sysconf(_SC_PAGESIZE);
+#endif /* defined(PSL_WIN) */
+}
+
+PSL_FORCE_INLINE size_t psl_code_heap_align(size_t size, size_t alignment)
+{
+    return (size + alignment - 1) & ~(alignment - 1);
+}
+
+/* Kernels are packed on cache lines in dual mapping, and own their pages when protected */
+size_t psl_code_heap_granularity(PSL_CodeHeapMode mode)
+{
+    return mode == PSL_CodeHeapMode_DualMapping ? PSL_CODE_HEAP_ALIGNMENT : psl_code_heap_page_size();
+}
+
+void psl_code_heap_set_mode(PSL_CodeHeapMode mode)
+{
+    psl_code_heap_lock();
+    _mode = mode;
+    psl_code_heap_unlock();
+}
+
+PSL_CodeHeapMode psl_code_heap_get_mode(void)
+{
+    psl_code_heap_lock();
+    const PSL_CodeHeapMode mode = _mode;
+    psl_code_heap_unlock();
+
+    return mode;
+}
+
+void psl_code_heap_init_from_env(void)
+{
+    const char* value = getenv(PSL_CODE_HEAP_ENV);
+
+    if(value == NULL)
+    {
+        return;
+    }
+
+    if(strcmp(value, "dual") == 0)
+    {
+        psl_code_heap_set_mode(PSL_CodeHeapMode_DualMapping);
+    }
+    else if(strcmp(value, "protect") == 0)
+    {
+        psl_code_heap_set_mode(PSL_CodeHeapMode_Protect);
+    }
+}
+
+/* Maps the two views of the chunk, returns false if shared memory is not available */
+bool psl_code_chunk_map_dual(PSL_CodeChunk* chunk)
+{
+#if defined(PSL_WIN)
+    HANDLE mapping = CreateFileMappingW(INVALID_HANDLE_VALUE,
+                                        NULL,
+                                        PAGE_EXECUTE_READWRITE | SEC_COMMIT,
+                                        (DWORD)((uint64_t)chunk->size >> 32),
+                                        (DWORD)(chunk->size & 0xFFFFFFFF),
+                                        NULL);
+
+    if(mapping == NULL)
+    {
+        return false;
+    }
+
+    chunk->write = (uint8_t*)MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, chunk->size);
+    chunk->code = (uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ | FILE_MAP_EXECUTE, 0, 0, chunk->size);
+
+    /* The views keep the memory alive */
+    CloseHandle(mapping);
+
+    if(chunk->write == NULL || chunk->code == NULL)
+    {
+        if(chunk->write != NULL)
+        {
+            UnmapViewOfFile(chunk->write);
+        }
+
+        if(chunk->code != NULL)
+        {
+            UnmapViewOfFile(chunk->code);
+        }
+
+        return false;
+    }
+
+    return true;
+#elif defined(PSL_LINUX) && defined(SYS_memfd_create)
+    const int fd = (int)syscall(SYS_memfd_create, "psl-code", MFD_CLOEXEC);
+
+    if(fd < 0)
+    {
+        return false;
+    }
+
+    if(ftruncate(fd, (off_t)chunk->size) != 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    void* write = mmap(NULL, chunk->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    void* code = mmap(NULL, chunk->size, PROT_READ | PROT_EXEC, MAP_SHARED, fd, 0);
+
+    /* The mappings keep the memory alive */
+    close(fd);
+
+    if(write == MAP_FAILED || code == MAP_FAILED)
+    {
+        if(write != MAP_FAILED)
+        {
+            munmap(write, chunk->size);
+        }
+
+        if(code != MAP_FAILED)
+        {
+            munmap(code, chunk->size);
+        }
+
+        return false;
+    }
+
+    chunk->write = (uint8_t*)write;
+    chunk->code = (uint8_t*)code;
+
+    return true;
+#else
+    (void)chunk;
+    return false;
+#endif /* defined(PSL_WIN) */
+}
+
+/* Reserves the pages of the chunk, they are only accessible once allocated */
+bool psl_code_chunk_map_protected(PSL_CodeChunk* chunk)
+{
+#if defined(PSL_WIN)
+    chunk->code = (uint8_t*)VirtualAlloc(NULL, chunk->size, MEM_RESERVE, PAGE_NOACCESS);
+
+    if(chunk->code == NULL)
+    {
+        return false;
+    }
+#else
+    void* code = mmap(NULL, chunk->size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if(code == MAP_FAILED)
+    {
+        return false;
+    }
+
+    chunk->code = (uint8_t*)code;
+#endif /* defined(PSL_WIN) */
+
+    chunk->write = chunk->code;
+
+    return true;
+}
+
+void psl_code_chunk_unmap(PSL_CodeChunk* chunk)
+{
+#if defined(PSL_WIN)
+    if(chunk->mode == PSL_CodeHeapMode_DualMapping)
+    {
+        UnmapViewOfFile(chunk->write);
+        UnmapViewOfFile(chunk->code);
+    }
+    else
+    {
+        VirtualFree(chunk->code, 0, MEM_RELEASE);
+    }
+#else
+    if(chunk->mode == PSL_CodeHeapMode_DualMapping)
+    {
+        munmap(chunk->write, chunk->size);
+    }
+
+    munmap(chunk->code, chunk->size);
+#endif /* defined(PSL_WIN) */
+}
+
+/* Adds a chunk of at least size bytes at the front of the chunks */
+PSL_CodeChunk* psl_code_chunk_new(size_t size)
+{
+    PSL_CodeChunk* chunk = (PSL_CodeChunk*)calloc(1, sizeof(PSL_CodeChunk));
+
+    if(chunk == NULL)
+    {
+        return NULL;
+    }
+
+    chunk->size = size > PSL_CODE_HEAP_CHUNK_SIZE ? psl_code_heap_align(size, PSL_CODE_HEAP_CHUNK_SIZE) :
+                                                    PSL_CODE_HEAP_CHUNK_SIZE;
+    chunk->mode = _mode;
+
+    /* Without shared memory, later chunks are protected too */
+    if(chunk->mode == PSL_CodeHeapMode_DualMapping && !psl_code_chunk_map_dual(chunk))
+    {
+        _mode = PSL_CodeHeapMode_Protect;
+        chunk->mode = PSL_CodeHeapMode_Protect;
+    }
+
+    if(chunk->mode == PSL_CodeHeapMode_Protect && !psl_code_chunk_map_protected(chunk))
+    {
+        free(chunk);
+        return NULL;
+    }
+
+    chunk->next = _chunks;
+    _chunks = chunk;
+
+    return chunk;
+}
+
+void psl_code_chunk_release(PSL_CodeChunk* chunk)
+{
+    PSL_CodeChunk** link = &_chunks;
+
+    while(*link != chunk)
+    {
+        link = &(*link)->next;
+    }
+
+    *link = chunk->next;
+
+    psl_code_chunk_unmap(chunk);
+    free(chunk->free_blocks);
+    free(chunk);
+}
+
+/* Takes size bytes from the first free block large enough, or from the top */
+bool psl_code_chunk_take(PSL_CodeChunk* chunk, size_t size, bool from_top, size_t* offset)
+{
+    for(uint32_t i = 0; i < chunk->num_free_blocks; i++)
+    {
+        PSL_CodeBlock* block = &chunk->free_blocks[i];
+
+        if(block->size < size)
+        {
+            continue;
+        }
+
+        *offset = block->offset;
+        block->offset += size;
+        block->size -= size;
+
+        if(block->size == 0)
+        {
+            memmove(block, block + 1, (chunk->num_free_blocks - i - 1) * sizeof(PSL_CodeBlock));
+            chunk->num_free_blocks--;
+        }
+
+        return true;
+    }
+
+    if(!from_top || chunk->size - chunk->top < size)
+    {
+        return false;
+    }
+
+    *offset = chunk->top;
+    chunk->top += size;
+
+    return true;
+}
+
+/* Gives back size bytes at offset, merged with the adjacent free blocks and the top */
+void psl_code_chunk_give(PSL_CodeChunk* chunk, size_t offset, size_t size)
+{
+    uint32_t i = 0;
+
+    while(i < chunk->num_free_blocks && chunk->free_blocks[i].offset < offset)
+    {
+        i++;
+    }
+
+    const bool merge_prev = i > 0 && chunk->free_blocks[i - 1].offset + chunk->free_blocks[i - 1].size == offset;
+    const bool merge_next = i < chunk->num_free_blocks && offset + size == chunk->free_blocks[i].offset;
+
+    if(merge_prev && merge_next)
+    {
+        chunk->free_blocks[i - 1].size += size + chunk->free_blocks[i].size;
+        memmove(&chunk->free_blocks[i], &chunk->free_blocks[i + 1], (chunk->num_free_blocks - i - 1) * sizeof(PSL_CodeBlock));
+        chunk->num_free_blocks--;
+        i--;
+    }
+    else if(merge_prev)
+    {
+        chunk->free_blocks[--i].size += size;
+    }
+    else if(merge_next)
+    {
+        chunk->free_blocks[i].offset = offset;
+        chunk->free_blocks[i].size += size;
+    }
+    else
+    {
+        if(chunk->num_free_blocks == chunk->free_capacity)
+        {
+            chunk->free_capacity = chunk->free_capacity == 0 ? 16 : chunk->free_capacity * 2;
+            chunk->free_blocks = (PSL_CodeBlock*)realloc(chunk->free_blocks, chunk->free_capacity * sizeof(PSL_CodeBlock));
+
+            PSL_ASSERT(chunk->free_blocks != NULL, "Error during free blocks reallocation");
+        }
+
+        memmove(&chunk->free_blocks[i + 1], &chunk->free_blocks[i], (chunk->num_free_blocks - i) * sizeof(PSL_CodeBlock));
+        chunk->free_blocks[i].offset = offset;
+        chunk->free_blocks[i].size = size;
+        chunk->num_free_blocks++;
+    }
+
+    /* Only the last block can touch the top */
+    if(chunk->free_blocks[i].offset + chunk->free_blocks[i].size == chunk->top)
+    {
+        chunk->top = chunk->free_blocks[i].offset;
+        chunk->num_free_blocks--;
+    }
+}
+
+/* Copies the code to the allocated bytes, padded with int3 up to the granularity */
+bool psl_code_chunk_write(PSL_CodeChunk* chunk, size_t offset, const uint8_t* code, size_t size, size_t rounded)
+{
+    uint8_t* ptr = chunk->write + offset;
+
+#if defined(PSL_WIN)
+    if(chunk->mode == PSL_CodeHeapMode_Protect && VirtualAlloc(ptr, rounded, MEM_COMMIT, PAGE_READWRITE) == NULL)
+    {
+        return false;
+    }
+#else
+    if(chunk->mode == PSL_CodeHeapMode_Protect && mprotect(ptr, rounded, PROT_READ | PROT_WRITE) != 0)
+    {
+        return false;
+    }
+#endif /* defined(PSL_WIN) */
+
+    memcpy(ptr, code, size);
+    memset(ptr + size, PSL_CODE_HEAP_FILL, rounded - size);
+
+    if(chunk->mode == PSL_CodeHeapMode_Protect)
+    {
+#if defined(PSL_WIN)
+        DWORD old_protect;
+
+        if(!VirtualProtect(ptr, rounded, PAGE_EXECUTE_READ, &old_protect))
+        {
+            VirtualFree(ptr, rounded, MEM_DECOMMIT);
+            return false;
+        }
+#else
+        if(mprotect(ptr, rounded, PROT_READ | PROT_EXEC) != 0)
+        {
+            mprotect(ptr, rounded, PROT_NONE);
+            return false;
+        }
+#endif /* defined(PSL_WIN) */
+    }
+
+#if defined(PSL_WIN)
+    FlushInstructionCache(GetCurrentProcess(), chunk->code + offset, rounded);
+#endif /* defined(PSL_WIN) */
+
+    return true;
+}
+
+/* Fills freed code with int3, protected pages are returned to the system right away */
+void psl_code_chunk_erase(PSL_CodeChunk* chunk, size_t offset, size_t rounded)
+{
+    uint8_t* ptr = chunk->write + offset;
+
+    if(chunk->mode == PSL_CodeHeapMode_DualMapping)
+    {
+        memset(ptr, PSL_CODE_HEAP_FILL, rounded);
+        return;
+    }
+
+#if defined(PSL_WIN)
+    VirtualFree(ptr, rounded, MEM_DECOMMIT);
+#else
+    mprotect(ptr, rounded, PROT_NONE);
+    madvise(ptr, rounded, MADV_DONTNEED);
+#endif /* defined(PSL_WIN) */
+}
+
+void* psl_code_heap_alloc(const uint8_t* code, size_t size)
+{
+    if(size == 0)
+    {
+        return NULL;
+    }
+
+    psl_code_heap_lock();
+
+    const PSL_CodeHeapMode mode = _mode;
+    const size_t rounded = psl_code_heap_align(size, psl_code_heap_granularity(mode));
+
+    /* Freed code is reused before the tops of the chunks */
+    PSL_CodeChunk* chunk = NULL;
+    size_t offset = 0;
+
+    for(uint32_t pass = 0; chunk == NULL && pass < 2; pass++)
+    {
+        chunk = _chunks;
+
+        while(chunk != NULL && !(chunk->mode == mode && psl_code_chunk_take(chunk, rounded, pass == 1, &offset)))
+        {
+            chunk = chunk->next;
+        }
+    }
+
+    if(chunk == NULL)
+    {
+        chunk = psl_code_chunk_new(rounded);
+
+        /* The mode of the chunk differs when dual mapping is not available */
+        if(chunk == NULL || chunk->mode != mode)
+        {
+            psl_code_heap_unlock();
+            return chunk != NULL ? psl_code_heap_alloc(code, size) : NULL;
+        }
+
+        psl_code_chunk_take(chunk, rounded, true, &offset);
+    }
+
+    if(!psl_code_chunk_write(chunk, offset, code, size, rounded))
+    {
+        psl_code_chunk_give(chunk, offset, rounded);
+        psl_code_heap_unlock();
+        return NULL;
+    }
+
+    chunk->used += rounded;
+    chunk->num_allocations++;
+
+    psl_code_heap_unlock();
+
+    return chunk->code + offset;
+}
+
+void psl_code_heap_free(void* code, size_t size)
+{
+    if(code == NULL)
+    {
+        return;
+    }
+
+    psl_code_heap_lock();
+
+    PSL_CodeChunk* chunk = _chunks;
+
+    while(chunk != NULL && !((uint8_t*)code >= chunk->code && (uint8_t*)code < chunk->code + chunk->size))
+    {
+        chunk = chunk->next;
+    }
+
+    PSL_ASSERT(chunk != NULL, "Code has not been allocated from the code heap");
+
+    const size_t offset = (size_t)((uint8_t*)code - chunk->code);
+    const size_t rounded = psl_code_heap_align(size, psl_code_heap_granularity(chunk->mode));
+
+    psl_code_chunk_erase(chunk, offset, rounded);
+    psl_code_chunk_give(chunk, offset, rounded);
+
+    chunk->used -= rounded;
+    chunk->num_allocations--;
+
+    /* One empty chunk is kept for the next kernels, the others are released */
+    if(chunk->num_allocations == 0)
+    {
+        PSL_CodeChunk* other = _chunks;
+
+        while(other != NULL && (other == chunk || other->num_allocations != 0 || other->mode != chunk->mode))
+        {
+            other = other->next;
+        }
+
+        if(other != NULL)
+        {
+            psl_code_chunk_release(chunk);
+        }
+    }
+
+    psl_code_heap_unlock();
+}
+
+size_t psl_code_heap_compact(void)
+{
+    psl_code_heap_lock();
+
+    size_t released = 0;
+
+    PSL_CodeChunk* chunk = _chunks;
+
+    while(chunk != NULL)
+    {
+        PSL_CodeChunk* next = chunk->next;
+
+        if(chunk->num_allocations == 0)
+        {
+            released += chunk->size;
+            psl_code_chunk_release(chunk);
+        }
+#if defined(PSL_LINUX) && defined(MADV_REMOVE)
+        else if(chunk->mode == PSL_CodeHeapMode_DualMapping)
+        {
+            /* Whole pages of free blocks and above the top, their memory is dropped from the memfd */
+            const size_t page_size = psl_code_heap_page_size();
+
+            for(uint32_t i = 0; i <= chunk->num_free_blocks; i++)
+            {
+                const size_t start = i < chunk->num_free_blocks ? chunk->free_blocks[i].offset : chunk->top;
+                const size_t end = i < chunk->num_free_blocks ? start + chunk->free_blocks[i].size : chunk->size;
+
+                const size_t first = psl_code_heap_align(start, page_size);
+                const size_t last = end & ~(page_size - 1);
+
+                if(last > first)
+                {
+                    madvise(chunk->write + first, last - first, MADV_REMOVE);
+                }
+            }
+        }
+#endif /* defined(PSL_LINUX) && defined(MADV_REMOVE) */
+
+        chunk = next;
+    }
+
+    psl_code_heap_unlock();
+
+    return released;
+}
+
+void psl_code_heap_get_stats(PSL_CodeHeapStats* stats)
+{
+    memset(stats, 0, sizeof(PSL_CodeHeapStats));
+
+    psl_code_heap_lock();
+
+    for(PSL_CodeChunk* chunk = _chunks; chunk != NULL; chunk = chunk->next)
+    {
+        stats->reserved += chunk->size;
+        stats->used += chunk->used;
+        stats->free += chunk->top - chunk->used;
+        stats->num_chunks++;
+        stats->num_allocations += chunk->num_allocations;
+    }
+
+    psl_code_heap_unlock();
+}
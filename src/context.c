@@ -0,0 +1,88 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#include "psl/context.h"
+
+#include <stdlib.h>
+
+PSL_CompileContext* psl_compile_context_new(void)
+{
+    PSL_CompileContext* context = (PSL_CompileContext*)malloc(sizeof(PSL_CompileContext));
+    context->tokens = vector_new(1024, sizeof(PSL_Token));
+    context->ast = psl_ast_new();
+    psl_arena_init(&context->scratch, PSL_COMPILE_CONTEXT_SCRATCH_SIZE);
+    psl_code_buffer_init(&context->code, 4096);
+    context->error = NULL;
+
+    return context;
+}
+
+PSL_AST* psl_compile_context_parse(PSL_CompileContext* context, const char* source)
+{
+    psl_compile_context_reset(context);
+
+    PSL_Lexer lexer;
+    psl_lexer_init(&lexer, source);
+
+    if(!psl_lexer_lex(&lexer, context->tokens))
+    {
+        context->error = psl_lexer_get_error(&lexer);
+        return NULL;
+    }
+
+    if(!psl_ast_from_tokens(context->ast, context->tokens))
+    {
+        context->error = context->ast->error;
+        return NULL;
+    }
+
+    return context->ast;
+}
+
+bool psl_compile_context_compile(PSL_CompileContext* context,
+                                 PSL_Kernel* kernel,
+                                 const char* entry_point,
+                                 const PSL_CompileOptions* options)
+{
+    PSL_EntryPoint entry;
+    entry.ast = context->ast;
+    entry.name = entry_point;
+
+    return psl_compile_context_compile_fused(context, kernel, &entry, 1, options);
+}
+
+bool psl_compile_context_compile_fused(PSL_CompileContext* context,
+                                       PSL_Kernel* kernel,
+                                       const PSL_EntryPoint* entry_points,
+                                       uint32_t num_entry_points,
+                                       const PSL_CompileOptions* options)
+{
+    return psl_kernel_compile_with_buffers(kernel,
+                                           entry_points,
+                                           num_entry_points,
+                                           options,
+                                           &context->scratch,
+                                           &context->code);
+}
+
+void psl_compile_context_reset(PSL_CompileContext* context)
+{
+    vector_clear(context->tokens);
+    psl_ast_reset(context->ast);
+    psl_arena_reset(&context->scratch);
+    context->code.size = 0;
+    context->error = NULL;
+}
+
+void psl_compile_context_destroy(PSL_CompileContext* context)
+{
+    if(context != NULL)
+    {
+        vector_free(context->tokens);
+        psl_ast_destroy(context->ast);
+        psl_arena_destroy(&context->scratch);
+        psl_code_buffer_destroy(&context->code);
+        free(context);
+    }
+}
@@ -0,0 +1,391 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#include "psl/counters.h"
+#include "psl/profile.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(PSL_WIN)
+#include <Windows.h>
+#include <intrin.h>
+#else
+#include <pthread.h>
+#include <x86intrin.h>
+#endif /* defined(PSL_WIN) */
+
+/*
+   Distance between the slots. The counters of a slot take 40 bytes, 128 bytes apart they never
+   fall into the same cache line whatever the alignment of the allocation
+*/
+#define PSL_COUNTERS_SLOT_STRIDE 128
+
+/* Duration of the calibration of the time stamp counter against the monotonic clock */
+#define PSL_TSC_CALIBRATION_NS 2000000
+
+typedef struct {
+    uint64_t calls;
+    uint64_t elements;
+    uint64_t tail_iterations;
+    uint64_t timed_calls;
+    uint64_t timed_cycles;
+} PSL_CounterSlot;
+
+struct PSL_KernelCounters {
+    PSL_Kernel* kernel;
+    PSL_KernelCounters* prev;
+    PSL_KernelCounters* next;
+    PSL_KernelStats baseline; /* sums at the last reset, slots are only written by their threads */
+    uint8_t slots[PSL_COUNTERS_MAX_SLOTS * PSL_COUNTERS_SLOT_STRIDE];
+};
+
+static PSL_KernelCounters* _live_first = NULL;
+static PSL_KernelCounters* _live_last = NULL;
+
+#if defined(PSL_WIN)
+static SRWLOCK _live_lock = SRWLOCK_INIT;
+#else
+static pthread_mutex_t _live_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif /* defined(PSL_WIN) */
+
+/* Ticks per second of the time stamp counter, 0 until the first calibration */
+static uint64_t _tsc_frequency = 0;
+
+#if defined(PSL_WIN)
+static SRWLOCK _tsc_lock = SRWLOCK_INIT;
+#else
+static pthread_mutex_t _tsc_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif /* defined(PSL_WIN) */
+
+/* Slot of the calling thread plus one, 0 until its first execution */
+static PSL_THREAD_LOCAL uint32_t _thread_slot = 0;
+static PSL_THREAD_LOCAL uint32_t _thread_calls = 0;
+static uint32_t _num_threads = 0;
+
+void psl_counters_lock(void)
+{
+#if defined(PSL_WIN)
+    AcquireSRWLockExclusive(&_live_lock);
+#else
+    pthread_mutex_lock(&_live_lock);
+#endif /* defined(PSL_WIN) */
+}
+
+void psl_counters_unlock(void)
+{
+#if defined(PSL_WIN)
+    ReleaseSRWLockExclusive(&_live_lock);
+#else
+    pthread_mutex_unlock(&_live_lock);
+#endif /* defined(PSL_WIN) */
+}
+
+PSL_FORCE_INLINE void psl_counter_add(uint64_t* counter, uint64_t value)
+{
+#if defined(PSL_MSVC)
+    InterlockedExchangeAdd64((volatile LONG64*)counter, (LONG64)value);
+#else
+    __atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+#endif /* defined(PSL_MSVC) */
+}
+
+/* Update of a counter only written by the calling thread, a plain add that readers can race with */
+PSL_FORCE_INLINE void psl_counter_bump(uint64_t* counter, uint64_t value)
+{
+#if defined(PSL_MSVC)
+    *(volatile uint64_t*)counter += value;
+#else
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + value, __ATOMIC_RELAXED);
+#endif /* defined(PSL_MSVC) */
+}
+
+PSL_FORCE_INLINE uint64_t psl_counter_load(uint64_t* counter)
+{
+#if defined(PSL_MSVC)
+    return (uint64_t)InterlockedCompareExchange64((volatile LONG64*)counter, 0, 0);
+#else
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+#endif /* defined(PSL_MSVC) */
+}
+
+PSL_FORCE_INLINE PSL_CounterSlot* psl_counters_slot(PSL_KernelCounters* counters, uint32_t slot)
+{
+    return (PSL_CounterSlot*)(counters->slots + slot * PSL_COUNTERS_SLOT_STRIDE);
+}
+
+uint64_t psl_tsc_now(void)
+{
+    return (uint64_t)__rdtsc();
+}
+
+/* Busy waits PSL_TSC_CALIBRATION_NS and returns the ticks per second measured meanwhile */
+uint64_t psl_tsc_measure_frequency(void)
+{
+    const uint64_t start_ns = psl_profile_now_ns();
+    const uint64_t start_tsc = psl_tsc_now();
+
+    uint64_t now_ns = start_ns;
+
+    while(now_ns - start_ns < PSL_TSC_CALIBRATION_NS)
+    {
+        now_ns = psl_profile_now_ns();
+    }
+
+    const uint64_t ticks = psl_tsc_now() - start_tsc;
+
+    return (uint64_t)((double)ticks * 1e9 / (double)(now_ns - start_ns));
+}
+
+void psl_tsc_lock(void)
+{
+#if defined(PSL_WIN)
+    AcquireSRWLockExclusive(&_tsc_lock);
+#else
+    pthread_mutex_lock(&_tsc_lock);
+#endif /* defined(PSL_WIN) */
+}
+
+void psl_tsc_unlock(void)
+{
+#if defined(PSL_WIN)
+    ReleaseSRWLockExclusive(&_tsc_lock);
+#else
+    pthread_mutex_unlock(&_tsc_lock);
+#endif /* defined(PSL_WIN) */
+}
+
+void psl_tsc_store_frequency(uint64_t frequency)
+{
+#if defined(PSL_MSVC)
+    InterlockedExchange64((volatile LONG64*)&_tsc_frequency, (LONG64)frequency);
+#else
+    __atomic_store_n(&_tsc_frequency, frequency, __ATOMIC_RELAXED);
+#endif /* defined(PSL_MSVC) */
+}
+
+void psl_tsc_calibrate(void)
+{
+    psl_tsc_lock();
+    psl_tsc_store_frequency(psl_tsc_measure_frequency());
+    psl_tsc_unlock();
+}
+
+double psl_tsc_frequency(void)
+{
+    uint64_t frequency = psl_counter_load(&_tsc_frequency);
+
+    if(frequency != 0)
+    {
+        return (double)frequency;
+    }
+
+    /* First call, the threads racing for it wait for a single calibration */
+    psl_tsc_lock();
+
+    frequency = psl_counter_load(&_tsc_frequency);
+
+    if(frequency == 0)
+    {
+        frequency = psl_tsc_measure_frequency();
+        psl_tsc_store_frequency(frequency);
+    }
+
+    psl_tsc_unlock();
+
+    return (double)frequency;
+}
+
+void psl_kernel_counters_init(PSL_Kernel* kernel)
+{
+    PSL_KernelCounters* counters = (PSL_KernelCounters*)calloc(1, sizeof(PSL_KernelCounters));
+    counters->kernel = kernel;
+
+    psl_counters_lock();
+
+    counters->prev = _live_last;
+
+    if(_live_last != NULL)
+    {
+        _live_last->next = counters;
+    }
+    else
+    {
+        _live_first = counters;
+    }
+
+    _live_last = counters;
+
+    psl_counters_unlock();
+
+    kernel->counters = counters;
+}
+
+void psl_kernel_counters_release(PSL_Kernel* kernel)
+{
+    PSL_KernelCounters* counters = kernel->counters;
+
+    if(counters == NULL)
+    {
+        return;
+    }
+
+    psl_counters_lock();
+
+    if(counters->prev != NULL)
+    {
+        counters->prev->next = counters->next;
+    }
+    else
+    {
+        _live_first = counters->next;
+    }
+
+    if(counters->next != NULL)
+    {
+        counters->next->prev = counters->prev;
+    }
+    else
+    {
+        _live_last = counters->prev;
+    }
+
+    psl_counters_unlock();
+
+    free(counters);
+    kernel->counters = NULL;
+}
+
+uint64_t psl_kernel_counters_begin(PSL_Kernel* kernel)
+{
+    if(kernel->counters == NULL || (_thread_calls++ % PSL_COUNTERS_SAMPLE_PERIOD) != 0)
+    {
+        return 0;
+    }
+
+    return psl_tsc_now();
+}
+
+void psl_kernel_counters_end(PSL_Kernel* kernel, uint64_t start, size_t count, bool tail)
+{
+    if(kernel->counters == NULL)
+    {
+        return;
+    }
+
+    const uint64_t cycles = start != 0 ? psl_tsc_now() - start : 0;
+
+    if(_thread_slot == 0)
+    {
+#if defined(PSL_MSVC)
+        _thread_slot = (uint32_t)InterlockedIncrement((volatile LONG*)&_num_threads);
+#else
+        _thread_slot = __atomic_add_fetch(&_num_threads, 1, __ATOMIC_RELAXED);
+#endif /* defined(PSL_MSVC) */
+    }
+
+    if(_thread_slot < PSL_COUNTERS_MAX_SLOTS)
+    {
+        PSL_CounterSlot* slot = psl_counters_slot(kernel->counters, _thread_slot - 1);
+
+        psl_counter_bump(&slot->calls, 1);
+        psl_counter_bump(&slot->elements, count);
+        psl_counter_bump(&slot->tail_iterations, tail ? 1 : 0);
+
+        if(start != 0)
+        {
+            psl_counter_bump(&slot->timed_calls, 1);
+            psl_counter_bump(&slot->timed_cycles, cycles);
+        }
+    }
+    else
+    {
+        PSL_CounterSlot* slot = psl_counters_slot(kernel->counters, PSL_COUNTERS_MAX_SLOTS - 1);
+
+        psl_counter_add(&slot->calls, 1);
+        psl_counter_add(&slot->elements, count);
+        psl_counter_add(&slot->tail_iterations, tail ? 1 : 0);
+
+        if(start != 0)
+        {
+            psl_counter_add(&slot->timed_calls, 1);
+            psl_counter_add(&slot->timed_cycles, cycles);
+        }
+    }
+}
+
+/* Sums the slots, the caller holds the lock of the live kernels */
+void psl_kernel_counters_sum(PSL_KernelCounters* counters, PSL_KernelStats* stats)
+{
+    memset(stats, 0, sizeof(PSL_KernelStats));
+
+    if(counters == NULL)
+    {
+        return;
+    }
+
+    for(uint32_t i = 0; i < PSL_COUNTERS_MAX_SLOTS; i++)
+    {
+        PSL_CounterSlot* slot = psl_counters_slot(counters, i);
+
+        stats->calls += psl_counter_load(&slot->calls);
+        stats->elements += psl_counter_load(&slot->elements);
+        stats->tail_iterations += psl_counter_load(&slot->tail_iterations);
+        stats->timed_calls += psl_counter_load(&slot->timed_calls);
+        stats->timed_cycles += psl_counter_load(&slot->timed_cycles);
+    }
+
+    stats->calls -= counters->baseline.calls;
+    stats->elements -= counters->baseline.elements;
+    stats->tail_iterations -= counters->baseline.tail_iterations;
+    stats->timed_calls -= counters->baseline.timed_calls;
+    stats->timed_cycles -= counters->baseline.timed_cycles;
+
+    stats->cycles = stats->timed_calls == 0 ?
+                    0 :
+                    (uint64_t)((double)stats->timed_cycles * (double)stats->calls / (double)stats->timed_calls);
+}
+
+void psl_kernel_get_stats(PSL_Kernel* kernel, PSL_KernelStats* stats)
+{
+    psl_counters_lock();
+    psl_kernel_counters_sum(kernel->counters, stats);
+    psl_counters_unlock();
+}
+
+void psl_kernel_reset_stats(PSL_Kernel* kernel)
+{
+    if(kernel->counters == NULL)
+    {
+        return;
+    }
+
+    psl_counters_lock();
+
+    PSL_KernelStats stats;
+    psl_kernel_counters_sum(kernel->counters, &stats);
+
+    kernel->counters->baseline.calls += stats.calls;
+    kernel->counters->baseline.elements += stats.elements;
+    kernel->counters->baseline.tail_iterations += stats.tail_iterations;
+    kernel->counters->baseline.timed_calls += stats.timed_calls;
+    kernel->counters->baseline.timed_cycles += stats.timed_cycles;
+
+    psl_counters_unlock();
+}
+
+void psl_kernel_for_each_live(PSL_KernelStatsFunc func, void* user_data)
+{
+    psl_counters_lock();
+
+    for(PSL_KernelCounters* counters = _live_first; counters != NULL; counters = counters->next)
+    {
+        PSL_KernelStats stats;
+        psl_kernel_counters_sum(counters, &stats);
+
+        func(counters->kernel, &stats, user_data);
+    }
+
+    psl_counters_unlock();
+}
@@ -3,6 +3,8 @@
 /* All rights reserved. */
 
 #include "psl/lexer.h"
+#include "psl/codeheap.h"
+#include "psl/perf.h"
 
 #include <stdio.h>
 
@@ -24,6 +26,8 @@ void PSL_LIB_ENTRY lib_entry(void)
     printf("psl entry\n");
 #endif // PSL_DEBUG
     psl_lexer_init_keywords_table();
+    psl_perf_init_from_env();
+    psl_code_heap_init_from_env();
 }
 
 void PSL_LIB_EXIT lib_exit(void)
@@ -32,6 +36,7 @@ void PSL_LIB_EXIT lib_exit(void)
     printf("psl exit\n");
 #endif // PSL_DEBUG
     psl_lexer_destroy_keywords_table();
+    psl_perf_disable();
 }
 
 #if defined(PSL_WIN)
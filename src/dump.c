@@ -0,0 +1,426 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#include "psl/dump.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define PSL_P0 (1 << 0)
+#define PSL_P1 (1 << 1)
+#define PSL_P5 (1 << 5)
+#define PSL_P6 (1 << 6)
+#define PSL_P01 (PSL_P0 | PSL_P1)
+#define PSL_P015 (PSL_P0 | PSL_P1 | PSL_P5)
+#define PSL_P0156 (PSL_P0 | PSL_P1 | PSL_P5 | PSL_P6)
+#define PSL_P23 ((1 << 2) | (1 << 3))
+#define PSL_P237 ((1 << 2) | (1 << 3) | (1 << 7))
+#define PSL_P4 (1 << 4)
+
+/* Most bytes of an instruction shown in the disassembly, longer ones are cut */
+#define PSL_DUMP_MAX_BYTES 10
+
+typedef struct {
+    uint8_t uops[2]; /* ports each uop can go to, besides the memory access, 0 if unused */
+    uint8_t cycles; /* cycles each uop keeps its port busy */
+    bool store; /* the memory operand is written */
+    bool memory_only; /* the memory form is a single load or store, without the uops */
+} PSL_PortUsage;
+
+static const PSL_PortUsage _vex_ports[PSL_X64VexOp_Count] = {
+    /* vmovups */          { { PSL_P015, 0 }, 1, false, true },
+    /* vmovups_store */    { { 0, 0 }, 1, true, true },
+    /* vmovaps */          { { PSL_P015, 0 }, 1, false, true },
+    /* vmovaps_store */    { { 0, 0 }, 1, true, true },
+    /* vaddps */           { { PSL_P01, 0 }, 1, false, false },
+    /* vsubps */           { { PSL_P01, 0 }, 1, false, false },
+    /* vmulps */           { { PSL_P01, 0 }, 1, false, false },
+    /* vdivps */           { { PSL_P0, 0 }, 5, false, false },
+    /* vminps */           { { PSL_P01, 0 }, 1, false, false },
+    /* vmaxps */           { { PSL_P01, 0 }, 1, false, false },
+    /* vsqrtps */          { { PSL_P0, 0 }, 6, false, false },
+    /* vandps */           { { PSL_P015, 0 }, 1, false, false },
+    /* vandnps */          { { PSL_P015, 0 }, 1, false, false },
+    /* vorps */            { { PSL_P015, 0 }, 1, false, false },
+    /* vxorps */           { { PSL_P015, 0 }, 1, false, false },
+    /* vroundps */         { { PSL_P01, PSL_P01 }, 1, false, false },
+    /* vcmpps */           { { PSL_P01, 0 }, 1, false, false },
+    /* vblendvps */        { { PSL_P015, PSL_P015 }, 1, false, false },
+    /* vbroadcastss */     { { PSL_P5, 0 }, 1, false, true },
+    /* vpbroadcastd */     { { PSL_P5, 0 }, 1, false, true },
+    /* vmovd */            { { PSL_P5, 0 }, 1, false, true },
+    /* vaddpd */           { { PSL_P01, 0 }, 1, false, false },
+    /* vsubpd */           { { PSL_P01, 0 }, 1, false, false },
+    /* vmulpd */           { { PSL_P01, 0 }, 1, false, false },
+    /* vdivpd */           { { PSL_P0, 0 }, 8, false, false },
+    /* vminpd */           { { PSL_P01, 0 }, 1, false, false },
+    /* vmaxpd */           { { PSL_P01, 0 }, 1, false, false },
+    /* vsqrtpd */          { { PSL_P0, 0 }, 12, false, false },
+    /* vandpd */           { { PSL_P015, 0 }, 1, false, false },
+    /* vxorpd */           { { PSL_P015, 0 }, 1, false, false },
+    /* vroundpd */         { { PSL_P01, PSL_P01 }, 1, false, false },
+    /* vcmppd */           { { PSL_P01, 0 }, 1, false, false },
+    /* vblendvpd */        { { PSL_P015, PSL_P015 }, 1, false, false },
+    /* vpbroadcastq */     { { PSL_P5, 0 }, 1, false, true },
+    /* vbroadcastsd */     { { PSL_P5, 0 }, 1, false, true },
+    /* vmovq */            { { PSL_P5, 0 }, 1, false, true },
+    /* vcvtps2pd */        { { PSL_P0, PSL_P5 }, 1, false, false },
+    /* vcvtpd2ps */        { { PSL_P01, PSL_P5 }, 1, false, false },
+    /* vinsertf128 */      { { PSL_P5, 0 }, 1, false, true },
+    /* vextractf128 */     { { PSL_P5, 0 }, 1, true, true },
+    /* vcvtph2ps */        { { PSL_P0, PSL_P5 }, 1, false, false },
+    /* vcvtps2ph */        { { PSL_P01, PSL_P5 }, 1, true, false },
+    /* vcvtdq2ps */        { { PSL_P01, 0 }, 1, false, false },
+    /* vcvtps2dq */        { { PSL_P01, 0 }, 1, false, false },
+    /* vpmovzxbd */        { { PSL_P5, 0 }, 1, false, false },
+    /* vpmovzxwd */        { { PSL_P5, 0 }, 1, false, false },
+    /* vpackusdw */        { { PSL_P5, 0 }, 1, false, false },
+    /* vpackuswb */        { { PSL_P5, 0 }, 1, false, false },
+    /* vmovq_store */      { { 0, 0 }, 1, true, true },
+    /* vmovups_store128 */ { { 0, 0 }, 1, true, true },
+    /* vfmadd231ps */      { { PSL_P01, 0 }, 1, false, false },
+    /* vfmadd231pd */      { { PSL_P01, 0 }, 1, false, false },
+    /* vfnmadd231ps */     { { PSL_P01, 0 }, 1, false, false },
+    /* vfnmadd231pd */     { { PSL_P01, 0 }, 1, false, false },
+    /* vrcpps */           { { PSL_P0, 0 }, 1, false, false },
+    /* vrsqrtps */         { { PSL_P0, 0 }, 1, false, false },
+    /* vmovntps */         { { 0, 0 }, 1, true, true },
+};
+
+/* Spreads cycles evenly over the ports of mask */
+void psl_cost_add_uop(PSL_KernelCost* cost, uint32_t mask, double cycles)
+{
+    uint32_t num_ports = 0;
+
+    for(uint32_t port = 0; port < PSL_NUM_PORTS; port++)
+    {
+        num_ports += (mask >> port) & 1;
+    }
+
+    for(uint32_t port = 0; port < PSL_NUM_PORTS && num_ports > 0; port++)
+    {
+        cost->ports[port] += ((mask >> port) & 1) != 0 ? cycles / (double)num_ports : 0.0;
+    }
+}
+
+void psl_cost_add_load(PSL_KernelCost* cost)
+{
+    psl_cost_add_uop(cost, PSL_P23, 1.0);
+    cost->num_loads++;
+}
+
+void psl_cost_add_store(PSL_KernelCost* cost)
+{
+    psl_cost_add_uop(cost, PSL_P4, 1.0);
+    psl_cost_add_uop(cost, PSL_P237, 1.0);
+    cost->num_stores++;
+}
+
+void psl_cost_add_inst(PSL_KernelCost* cost, const PSL_X64Inst* inst)
+{
+    cost->num_insts++;
+
+    switch(inst->inst_class)
+    {
+        case PSL_X64InstClass_Vex:
+        {
+            const PSL_PortUsage* usage = &_vex_ports[inst->vex_op];
+
+            if(inst->memory)
+            {
+                if(usage->store)
+                {
+                    psl_cost_add_store(cost);
+                }
+                else
+                {
+                    psl_cost_add_load(cost);
+                }
+            }
+
+            for(uint32_t i = 0; i < 2 && !(inst->memory && usage->memory_only); i++)
+            {
+                psl_cost_add_uop(cost, usage->uops[i], (double)usage->cycles);
+            }
+
+            return;
+        }
+        case PSL_X64InstClass_Load:
+            psl_cost_add_load(cost);
+            return;
+        case PSL_X64InstClass_Store:
+            psl_cost_add_store(cost);
+            return;
+        case PSL_X64InstClass_Branch:
+            psl_cost_add_uop(cost, PSL_P6, 1.0);
+            return;
+        case PSL_X64InstClass_Call:
+            psl_cost_add_store(cost);
+            psl_cost_add_uop(cost, PSL_P6, 1.0);
+            cost->num_calls++;
+            return;
+        default:
+            psl_cost_add_uop(cost, PSL_P0156, 1.0);
+            return;
+    }
+}
+
+/* Emits the code of the kernel again to map it to its IR and get its layout */
+bool psl_dump_map_code(PSL_Kernel* kernel, PSL_CodeMap* map)
+{
+    psl_code_map_init(map);
+
+    if(kernel->code == NULL)
+    {
+        return false;
+    }
+
+    PSL_CodeBuffer buffer;
+    psl_code_buffer_init(&buffer, kernel->code_size);
+
+    char* error = NULL;
+
+    const bool success = psl_codegen_emit(&kernel->ir, &kernel->codegen, &buffer, map, &error) &&
+                         buffer.size == kernel->code_size;
+
+    psl_code_buffer_destroy(&buffer);
+
+    if(!success)
+    {
+        psl_code_map_destroy(map);
+    }
+
+    return success;
+}
+
+void psl_dump_estimate_cost(PSL_Kernel* kernel, const PSL_CodeMap* map, PSL_KernelCost* cost)
+{
+    memset(cost, 0, sizeof(PSL_KernelCost));
+
+    cost->lanes = map->num_groups * PSL_LANES;
+
+    PSL_X64Inst inst;
+
+    for(size_t offset = map->loop_start; offset < map->loop_end; offset += inst.size)
+    {
+        if(!psl_x64_decode((const uint8_t*)kernel->code, map->loop_end, offset, &inst))
+        {
+            break;
+        }
+
+        psl_cost_add_inst(cost, &inst);
+    }
+
+    for(uint32_t port = 0; port < PSL_NUM_PORTS; port++)
+    {
+        cost->bottleneck = cost->ports[port] > cost->ports[cost->bottleneck] ? port : cost->bottleneck;
+    }
+
+    cost->insts_per_lane = (double)cost->num_insts / (double)cost->lanes;
+    cost->cycles_per_lane = cost->ports[cost->bottleneck] / (double)cost->lanes;
+}
+
+bool psl_kernel_estimate_cost(PSL_Kernel* kernel, PSL_KernelCost* cost)
+{
+    PSL_CodeMap map;
+
+    if(!psl_dump_map_code(kernel, &map))
+    {
+        return false;
+    }
+
+    psl_dump_estimate_cost(kernel, &map, cost);
+    psl_code_map_destroy(&map);
+
+    return true;
+}
+
+void psl_dump_ir(PSL_Kernel* kernel, const PSL_CodeMap* map, FILE* file)
+{
+    PSL_IR* ir = &kernel->ir;
+
+    fprintf(file, "ir:\n");
+
+    for(uint32_t i = 0; i < ir->num_insts; i++)
+    {
+        const PSL_IRInst* inst = &ir->insts[i];
+
+        fprintf(file, "  ");
+        psl_ir_print_inst(ir, i, file);
+
+        if(inst->line != 0)
+        {
+            fprintf(file, "  ; line %u", inst->line);
+        }
+
+        /* Stores and reductions write their slot but nothing reads it */
+        if(inst->opcode != PSL_IROpcode_Store && inst->opcode != PSL_IROpcode_Reduce)
+        {
+            fprintf(file, "%s [rsp+0x%x]", inst->line != 0 ? "," : "  ;", map->slots[i]);
+
+            if(map->strides[i] != 0)
+            {
+                fprintf(file, " +0x%x per group", map->strides[i]);
+            }
+            else
+            {
+                fprintf(file, " invariant");
+            }
+        }
+
+        fprintf(file, "\n");
+    }
+
+    fprintf(file, "\nregisters:\n");
+    fprintf(file, "  ymm0-ymm2 scratch, values are loaded from and stored to their slot\n");
+
+    for(uint32_t i = 0; i < ir->num_reductions; i++)
+    {
+        const PSL_IRParam* param = psl_ir_find_reduction(ir, i);
+
+        if(param == NULL)
+        {
+            continue;
+        }
+
+        if(map->accumulators[i] == 0)
+        {
+            fprintf(file, "  reduction %u accumulates in its partials\n", i);
+        }
+        else if(param->type == PSL_IRType_F64)
+        {
+            fprintf(file, "  reduction %u accumulates in ymm%u-ymm%u\n", i, map->accumulators[i], map->accumulators[i] + 1);
+        }
+        else
+        {
+            fprintf(file, "  reduction %u accumulates in ymm%u\n", i, map->accumulators[i]);
+        }
+    }
+}
+
+void psl_dump_code(PSL_Kernel* kernel, const PSL_CodeMap* map, FILE* file)
+{
+    const uint8_t* code = (const uint8_t*)kernel->code;
+
+    fprintf(file, "\ncode:\n");
+
+    uint32_t entry = 0;
+    PSL_X64Inst inst;
+
+    for(size_t offset = 0; offset < kernel->code_size; offset += inst.size != 0 ? inst.size : 1)
+    {
+        if(offset == map->loop_start)
+        {
+            fprintf(file, "  ; main loop, %u lanes per iteration\n", map->num_groups * PSL_LANES);
+        }
+
+        if(offset == map->loop_end)
+        {
+            fprintf(file, "  ; end of the main loop\n");
+        }
+
+        /* Header of the instruction of the IR the code is emitted for */
+        while(entry < map->num_entries && map->entries[entry].offset <= offset)
+        {
+            const uint32_t value = map->entries[entry].value;
+
+            if(map->entries[entry].offset == offset && value != PSL_IR_INVALID_VALUE)
+            {
+                fprintf(file, "  ; ");
+                psl_ir_print_inst(&kernel->ir, value, file);
+
+                if(kernel->ir.insts[value].line != 0)
+                {
+                    fprintf(file, ", line %u", kernel->ir.insts[value].line);
+                }
+
+                fprintf(file, "\n");
+            }
+
+            entry++;
+        }
+
+        psl_x64_decode(code, kernel->code_size, offset, &inst);
+
+        const uint32_t num_bytes = inst.size != 0 ? inst.size : 1;
+
+        fprintf(file, "  %04zx  ", offset);
+
+        for(uint32_t i = 0; i < PSL_DUMP_MAX_BYTES; i++)
+        {
+            if(i < num_bytes)
+            {
+                fprintf(file, "%02x ", code[offset + i]);
+            }
+            else
+            {
+                fprintf(file, "   ");
+            }
+        }
+
+        fprintf(file, "%s %s\n", num_bytes > PSL_DUMP_MAX_BYTES ? "+" : " ", inst.text);
+    }
+}
+
+void psl_dump_cost(const PSL_KernelCost* cost, FILE* file)
+{
+    fprintf(file, "\ncost of an iteration of the main loop:\n");
+    fprintf(file,
+            "  %u instructions for %u lanes, %.2f per lane\n",
+            cost->num_insts,
+            cost->lanes,
+            cost->insts_per_lane);
+    fprintf(file,
+            "  %u loads, %u stores, %u helper calls%s\n",
+            cost->num_loads,
+            cost->num_stores,
+            cost->num_calls,
+            cost->num_calls != 0 ? " (not estimated)" : "");
+    fprintf(file, "  port   ");
+
+    for(uint32_t port = 0; port < PSL_NUM_PORTS; port++)
+    {
+        fprintf(file, "   p%u", port);
+    }
+
+    fprintf(file, "\n  cycles ");
+
+    for(uint32_t port = 0; port < PSL_NUM_PORTS; port++)
+    {
+        fprintf(file, " %4.1f", cost->ports[port]);
+    }
+
+    fprintf(file,
+            "\n  bound by p%u: %.2f cycles per iteration, %.3f per lane\n",
+            cost->bottleneck,
+            cost->ports[cost->bottleneck],
+            cost->cycles_per_lane);
+}
+
+bool psl_kernel_dump(PSL_Kernel* kernel, FILE* file)
+{
+    PSL_CodeMap map;
+
+    if(!psl_dump_map_code(kernel, &map))
+    {
+        return false;
+    }
+
+    PSL_KernelCost cost;
+    psl_dump_estimate_cost(kernel, &map, &cost);
+
+    fprintf(file,
+            "kernel %s: %u instructions, %zu bytes of code\n\n",
+            kernel->name,
+            kernel->ir.num_insts,
+            kernel->code_size);
+
+    psl_dump_ir(kernel, &map, file);
+    psl_dump_code(kernel, &map, file);
+    psl_dump_cost(&cost, file);
+
+    psl_code_map_destroy(&map);
+
+    return true;
+}
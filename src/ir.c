@@ -0,0 +1,2598 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#include "psl/ir.h"
+#include "psl/profile.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PSL_IR_MAX_INLINING_DEPTH 64
+
+/* Arrays pushed into the scratch arena are aligned for any of the IR structures */
+#define PSL_IR_SCRATCH_ALIGNMENT 16
+
+size_t psl_column_format_size(PSL_ColumnFormat format)
+{
+    switch(format)
+    {
+        case PSL_ColumnFormat_F64:
+            return sizeof(double);
+        case PSL_ColumnFormat_F16:
+        case PSL_ColumnFormat_Unorm16:
+            return sizeof(uint16_t);
+        case PSL_ColumnFormat_Unorm8:
+            return sizeof(uint8_t);
+        default:
+            return sizeof(float);
+    }
+}
+
+void psl_ir_init(PSL_IR* ir)
+{
+    ir->insts = NULL;
+    ir->num_insts = 0;
+    ir->capacity = 0;
+    ir->params = NULL;
+    ir->num_params = 0;
+    ir->num_columns = 0;
+    ir->num_uniforms = 0;
+    ir->num_reductions = 0;
+    ir->line = 0;
+    ir->error = NULL;
+    ir->scratch = NULL;
+}
+
+void* psl_ir_alloc(PSL_IR* ir, size_t size)
+{
+    if(ir->scratch != NULL)
+    {
+        const size_t aligned = (size + PSL_IR_SCRATCH_ALIGNMENT - 1) & ~((size_t)PSL_IR_SCRATCH_ALIGNMENT - 1);
+
+        return psl_arena_push(ir->scratch, NULL, aligned);
+    }
+
+    psl_profile_alloc(size);
+
+    return malloc(size + 1);
+}
+
+void* psl_ir_alloc_zeroed(PSL_IR* ir, size_t size)
+{
+    void* ptr = psl_ir_alloc(ir, size);
+    memset(ptr, 0, size);
+
+    return ptr;
+}
+
+void* psl_ir_realloc(PSL_IR* ir, void* ptr, size_t old_size, size_t new_size)
+{
+    if(ir->scratch != NULL)
+    {
+        /* The old array stays in the arena until it is rolled back */
+        void* new_ptr = psl_ir_alloc(ir, new_size);
+
+        if(ptr != NULL)
+        {
+            memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+        }
+
+        return new_ptr;
+    }
+
+    void* new_ptr = realloc(ptr, new_size);
+
+    PSL_ASSERT(new_ptr != NULL, "Error during IR reallocation");
+
+    psl_profile_alloc(new_size);
+
+    return new_ptr;
+}
+
+void psl_ir_free(PSL_IR* ir, void* ptr)
+{
+    if(ir->scratch == NULL)
+    {
+        free(ptr);
+    }
+}
+
+void psl_ir_copy(PSL_IR* dst, const PSL_IR* src)
+{
+    *dst = *src;
+
+    /* The copy is trimmed to the instructions of src, and owned by the heap */
+    dst->capacity = src->num_insts;
+    dst->scratch = NULL;
+    dst->insts = (PSL_IRInst*)malloc(src->num_insts * sizeof(PSL_IRInst) + 1);
+    dst->params = (PSL_IRParam*)malloc(src->num_params * sizeof(PSL_IRParam) + 1);
+
+    psl_profile_alloc(src->num_insts * sizeof(PSL_IRInst) + src->num_params * sizeof(PSL_IRParam));
+
+    memcpy(dst->insts, src->insts, src->num_insts * sizeof(PSL_IRInst));
+    memcpy(dst->params, src->params, src->num_params * sizeof(PSL_IRParam));
+}
+
+uint32_t psl_ir_push(PSL_IR* ir, const PSL_IRInst* inst)
+{
+    if(ir->num_insts == ir->capacity)
+    {
+        const uint32_t new_capacity = ir->capacity == 0 ? 64 : ir->capacity * 2;
+
+        ir->insts = (PSL_IRInst*)psl_ir_realloc(ir,
+                                                ir->insts,
+                                                ir->capacity * sizeof(PSL_IRInst),
+                                                new_capacity * sizeof(PSL_IRInst));
+        ir->capacity = new_capacity;
+    }
+
+    ir->insts[ir->num_insts] = *inst;
+
+    if(inst->line == 0)
+    {
+        ir->insts[ir->num_insts].line = ir->line;
+    }
+
+    return ir->num_insts++;
+}
+
+PSL_FORCE_INLINE PSL_IRInst psl_ir_make_inst(PSL_IROpcode opcode)
+{
+    PSL_IRInst inst;
+    memset(&inst, 0, sizeof(PSL_IRInst));
+    inst.opcode = opcode;
+
+    return inst;
+}
+
+PSL_FORCE_INLINE uint32_t psl_ir_push_const(PSL_IR* ir, PSL_IRType type, double value)
+{
+    PSL_IRInst inst = psl_ir_make_inst(PSL_IROpcode_Const);
+    inst.type = type;
+    inst.constant = value;
+
+    return psl_ir_push(ir, &inst);
+}
+
+/* Operands must have the same type */
+PSL_FORCE_INLINE uint32_t psl_ir_push_binary(PSL_IR* ir, PSL_IROpcode opcode, uint32_t a, uint32_t b)
+{
+    PSL_IRInst inst = psl_ir_make_inst(opcode);
+    inst.type = ir->insts[a].type;
+    inst.num_args = 2;
+    inst.args[0] = a;
+    inst.args[1] = b;
+
+    return psl_ir_push(ir, &inst);
+}
+
+PSL_FORCE_INLINE bool psl_ir_is_mask(PSL_IR* ir, uint32_t value)
+{
+    return ir->insts[value].opcode == PSL_IROpcode_Cmp;
+}
+
+PSL_FORCE_INLINE PSL_IRType psl_ir_common_type(PSL_IRType a, PSL_IRType b)
+{
+    return a == PSL_IRType_F64 || b == PSL_IRType_F64 ? PSL_IRType_F64 : PSL_IRType_F32;
+}
+
+PSL_FORCE_INLINE PSL_IRType psl_ir_type_from_ast(PSL_ASTValueType value_type)
+{
+    return value_type == PSL_ASTValueType_F64 ? PSL_IRType_F64 : PSL_IRType_F32;
+}
+
+PSL_FORCE_INLINE PSL_IRReduceOp psl_ir_reduce_op_from_ast(PSL_ASTReduceOp reduce_op)
+{
+    switch(reduce_op)
+    {
+        case PSL_ASTReduceOp_Min:
+            return PSL_IRReduceOp_Min;
+        case PSL_ASTReduceOp_Max:
+            return PSL_IRReduceOp_Max;
+        default:
+            return PSL_IRReduceOp_Sum;
+    }
+}
+
+/* Converts value to type, implicit conversions can only widen */
+uint32_t psl_ir_convert(PSL_IR* ir, uint32_t value, PSL_IRType type, bool explicit)
+{
+    if(value == PSL_IR_INVALID_VALUE || ir->insts[value].type == type)
+    {
+        return value;
+    }
+
+    if(type == PSL_IRType_F32 && !explicit)
+    {
+        ir->error = "Implicit conversion from f64 to f32, use f32() to narrow";
+        return PSL_IR_INVALID_VALUE;
+    }
+
+    /* Widened literals keep their full precision, without relying on constant folding */
+    if(ir->insts[value].opcode == PSL_IROpcode_Const)
+    {
+        return psl_ir_push_const(ir, type, ir->insts[value].constant);
+    }
+
+    PSL_IRInst inst = psl_ir_make_inst(PSL_IROpcode_Convert);
+    inst.type = type;
+    inst.num_args = 1;
+    inst.args[0] = value;
+
+    return psl_ir_push(ir, &inst);
+}
+
+/* Lowering */
+
+#define PSL_IR_MAX_COMPONENTS PSL_AST_MAX_COMPONENTS
+
+/* Value of an expression, vectors are lowered to one scalar value per component */
+typedef struct {
+    uint32_t components[PSL_IR_MAX_COMPONENTS];
+    uint32_t width;
+} PSL_IRVector;
+
+PSL_FORCE_INLINE PSL_IRVector psl_ir_scalar(uint32_t value)
+{
+    PSL_IRVector vector;
+    vector.components[0] = value;
+    vector.width = 1;
+
+    return vector;
+}
+
+/* Components of exports are invalid until they are assigned */
+PSL_FORCE_INLINE bool psl_ir_vector_is_assigned(const PSL_IRVector* vector)
+{
+    for(uint32_t i = 0; i < vector->width; i++)
+    {
+        if(vector->components[i] == PSL_IR_INVALID_VALUE)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+typedef struct {
+    char* name;
+    uint32_t name_length;
+    PSL_IRVector value;
+    PSL_IRType type; /* of the components */
+} PSL_IRBinding;
+
+typedef struct {
+    PSL_IR* ir;
+    PSL_ASTSource* source;
+    PSL_IRBinding* bindings;
+    uint32_t num_bindings;
+    uint32_t bindings_capacity;
+    uint32_t depth;
+} PSL_IRLowering;
+
+PSL_FORCE_INLINE bool psl_ir_name_equals(const char* a, uint32_t a_length, const char* b, uint32_t b_length)
+{
+    return a_length == b_length && memcmp(a, b, a_length) == 0;
+}
+
+PSL_IRBinding* psl_ir_lowering_find(PSL_IRLowering* lowering,
+                                    uint32_t scope_start,
+                                    char* name,
+                                    uint32_t name_length)
+{
+    for(uint32_t i = lowering->num_bindings; i > scope_start; i--)
+    {
+        PSL_IRBinding* binding = &lowering->bindings[i - 1];
+
+        if(psl_ir_name_equals(binding->name, binding->name_length, name, name_length))
+        {
+            return binding;
+        }
+    }
+
+    return NULL;
+}
+
+/* Binds value to name, existing bindings keep their type and value must already be converted to it */
+void psl_ir_lowering_bind(PSL_IRLowering* lowering,
+                          uint32_t scope_start,
+                          char* name,
+                          uint32_t name_length,
+                          const PSL_IRVector* value,
+                          PSL_IRType type)
+{
+    PSL_IRBinding* existing = psl_ir_lowering_find(lowering, scope_start, name, name_length);
+
+    if(existing != NULL)
+    {
+        existing->value = *value;
+        return;
+    }
+
+    if(lowering->num_bindings == lowering->bindings_capacity)
+    {
+        const uint32_t new_capacity = lowering->bindings_capacity == 0 ? 32 : lowering->bindings_capacity * 2;
+
+        lowering->bindings = (PSL_IRBinding*)psl_ir_realloc(lowering->ir,
+                                                            lowering->bindings,
+                                                            lowering->bindings_capacity * sizeof(PSL_IRBinding),
+                                                            new_capacity * sizeof(PSL_IRBinding));
+        lowering->bindings_capacity = new_capacity;
+    }
+
+    PSL_IRBinding* binding = &lowering->bindings[lowering->num_bindings++];
+    binding->name = name;
+    binding->name_length = name_length;
+    binding->value = *value;
+    binding->type = type;
+}
+
+PSL_ASTFunction* psl_ir_lowering_find_function(PSL_IRLowering* lowering, char* name, uint32_t name_length)
+{
+    for(uint32_t i = 0; i < lowering->source->num_functions; i++)
+    {
+        PSL_ASTFunction* func = PSL_AST_CAST(PSL_ASTFunction, lowering->source->functions[i]);
+
+        if(func != NULL &&
+           !func->is_entry_point &&
+           psl_ir_name_equals(func->name, func->name_length, name, name_length))
+        {
+            return func;
+        }
+    }
+
+    return NULL;
+}
+
+bool psl_ir_lower_expression(PSL_IRLowering* lowering, uint32_t scope_start, PSL_ASTNode* node, PSL_IRVector* value);
+
+/* Lowers an expression used as a number, masks can only be used as select conditions */
+bool psl_ir_lower_operand(PSL_IRLowering* lowering, uint32_t scope_start, PSL_ASTNode* node, PSL_IRVector* value)
+{
+    if(!psl_ir_lower_expression(lowering, scope_start, node, value))
+    {
+        return false;
+    }
+
+    if(value->width == 1 && psl_ir_is_mask(lowering->ir, value->components[0]))
+    {
+        lowering->ir->error = "Comparison results can only be used as select conditions";
+        return false;
+    }
+
+    return true;
+}
+
+/* Lowers an expression that must have a single component, masks included */
+bool psl_ir_lower_scalar(PSL_IRLowering* lowering, uint32_t scope_start, PSL_ASTNode* node, uint32_t* value)
+{
+    PSL_IRVector vector;
+
+    if(!psl_ir_lower_expression(lowering, scope_start, node, &vector))
+    {
+        return false;
+    }
+
+    if(vector.width != 1)
+    {
+        lowering->ir->error = "Comparisons and select conditions operate on scalars, not vectors";
+        return false;
+    }
+
+    *value = vector.components[0];
+
+    return true;
+}
+
+/* Broadcasts the scalars among vectors to the width of the others, which must all have the same */
+bool psl_ir_broadcast(PSL_IR* ir, PSL_IRVector* vectors, uint32_t num_vectors)
+{
+    uint32_t width = 1;
+
+    for(uint32_t i = 0; i < num_vectors; i++)
+    {
+        if(vectors[i].width == 1)
+        {
+            continue;
+        }
+
+        if(width != 1 && vectors[i].width != width)
+        {
+            ir->error = "Operands have different numbers of components";
+            return false;
+        }
+
+        width = vectors[i].width;
+    }
+
+    for(uint32_t i = 0; i < num_vectors; i++)
+    {
+        for(uint32_t j = vectors[i].width; j < width; j++)
+        {
+            vectors[i].components[j] = vectors[i].components[0];
+        }
+
+        vectors[i].width = width;
+    }
+
+    return true;
+}
+
+/* Pushes one copy of inst per component of the operands, converted to their common type */
+void psl_ir_push_componentwise(PSL_IR* ir, PSL_IRInst* inst, const PSL_IRVector* operands, PSL_IRVector* value)
+{
+    value->width = operands[0].width;
+
+    for(uint32_t i = 0; i < value->width; i++)
+    {
+        inst->type = PSL_IRType_F32;
+
+        for(uint32_t j = 0; j < inst->num_args; j++)
+        {
+            inst->type = psl_ir_common_type(inst->type, ir->insts[operands[j].components[i]].type);
+        }
+
+        for(uint32_t j = 0; j < inst->num_args; j++)
+        {
+            inst->args[j] = psl_ir_convert(ir, operands[j].components[i], inst->type, false);
+        }
+
+        value->components[i] = psl_ir_push(ir, inst);
+    }
+}
+
+bool psl_ir_lower_select(PSL_IRLowering* lowering,
+                         uint32_t scope_start,
+                         PSL_ASTNode* condition,
+                         PSL_ASTNode* if_true,
+                         PSL_ASTNode* if_false,
+                         PSL_IRVector* value)
+{
+    PSL_IR* ir = lowering->ir;
+
+    uint32_t mask;
+
+    if(!psl_ir_lower_scalar(lowering, scope_start, condition, &mask))
+    {
+        return false;
+    }
+
+    if(!psl_ir_is_mask(ir, mask))
+    {
+        ir->error = "Select condition must be a comparison";
+        return false;
+    }
+
+    PSL_IRVector branches[2];
+
+    if(!psl_ir_lower_operand(lowering, scope_start, if_true, &branches[0]) ||
+       !psl_ir_lower_operand(lowering, scope_start, if_false, &branches[1]) ||
+       !psl_ir_broadcast(ir, branches, 2))
+    {
+        return false;
+    }
+
+    /* Components are blended with the same mask */
+    value->width = branches[0].width;
+
+    for(uint32_t i = 0; i < value->width; i++)
+    {
+        PSL_IRInst inst = psl_ir_make_inst(PSL_IROpcode_Select);
+        inst.num_args = 3;
+
+        /* Masks are converted like values, only the sign bit of each lane is used to blend */
+        inst.type = psl_ir_common_type(ir->insts[branches[0].components[i]].type, ir->insts[branches[1].components[i]].type);
+        inst.args[0] = psl_ir_convert(ir, mask, inst.type, true);
+        inst.args[1] = psl_ir_convert(ir, branches[0].components[i], inst.type, false);
+        inst.args[2] = psl_ir_convert(ir, branches[1].components[i], inst.type, false);
+
+        value->components[i] = psl_ir_push(ir, &inst);
+    }
+
+    return true;
+}
+
+/*
+   Lowers the arguments of a builtin call, broadcasts scalars to the width of the vectors, and
+   converts all the components to their common type, returned in type
+*/
+bool psl_ir_lower_builtin_arguments(PSL_IRLowering* lowering,
+                                    uint32_t scope_start,
+                                    PSL_ASTFunctionCall* call,
+                                    PSL_IRVector* args,
+                                    PSL_IRType* type)
+{
+    PSL_IR* ir = lowering->ir;
+
+    *type = PSL_IRType_F32;
+
+    for(uint32_t i = 0; i < call->num_arguments; i++)
+    {
+        if(!psl_ir_lower_operand(lowering, scope_start, call->arguments[i], &args[i]))
+        {
+            return false;
+        }
+
+        for(uint32_t j = 0; j < args[i].width; j++)
+        {
+            *type = psl_ir_common_type(*type, ir->insts[args[i].components[j]].type);
+        }
+    }
+
+    if(!psl_ir_broadcast(ir, args, call->num_arguments))
+    {
+        return false;
+    }
+
+    for(uint32_t i = 0; i < call->num_arguments; i++)
+    {
+        for(uint32_t j = 0; j < args[i].width; j++)
+        {
+            args[i].components[j] = psl_ir_convert(ir, args[i].components[j], *type, false);
+        }
+    }
+
+    return true;
+}
+
+PSL_FORCE_INLINE uint32_t psl_ir_push_sqrt(PSL_IR* ir, uint32_t value)
+{
+    PSL_IRInst inst = psl_ir_make_inst(PSL_IROpcode_Call);
+    inst.type = ir->insts[value].type;
+    inst.index = (uint32_t)PSL_BuiltinID_Sqrt;
+    inst.num_args = 1;
+    inst.args[0] = value;
+
+    return psl_ir_push(ir, &inst);
+}
+
+/* Sum of the products of the components, in order */
+uint32_t psl_ir_push_dot(PSL_IR* ir, const PSL_IRVector* a, const PSL_IRVector* b)
+{
+    uint32_t sum = psl_ir_push_binary(ir, PSL_IROpcode_Mul, a->components[0], b->components[0]);
+
+    for(uint32_t i = 1; i < a->width; i++)
+    {
+        sum = psl_ir_push_binary(ir,
+                                 PSL_IROpcode_Add,
+                                 sum,
+                                 psl_ir_push_binary(ir, PSL_IROpcode_Mul, a->components[i], b->components[i]));
+    }
+
+    return sum;
+}
+
+/* Builtins that map to IR instructions instead of calls, applied per component or across them */
+bool psl_ir_lower_builtin(PSL_IRLowering* lowering,
+                          uint32_t scope_start,
+                          PSL_BuiltinID id,
+                          PSL_ASTFunctionCall* call,
+                          PSL_IRVector* value)
+{
+    PSL_IR* ir = lowering->ir;
+
+    if(id == PSL_BuiltinID_Select)
+    {
+        return psl_ir_lower_select(lowering,
+                                   scope_start,
+                                   call->arguments[0],
+                                   call->arguments[1],
+                                   call->arguments[2],
+                                   value);
+    }
+
+    PSL_IRVector args[PSL_IR_MAX_ARGS];
+    PSL_IRType type;
+
+    if(!psl_ir_lower_builtin_arguments(lowering, scope_start, call, args, &type))
+    {
+        return false;
+    }
+
+    const uint32_t width = args[0].width;
+
+    value->width = width;
+
+    switch(id)
+    {
+        case PSL_BuiltinID_Dot:
+            *value = psl_ir_scalar(psl_ir_push_dot(ir, &args[0], &args[1]));
+            return true;
+        case PSL_BuiltinID_Length:
+            *value = psl_ir_scalar(psl_ir_push_sqrt(ir, psl_ir_push_dot(ir, &args[0], &args[0])));
+            return true;
+        case PSL_BuiltinID_Normalize:
+        {
+            /* Components are scaled by the inverse of the length, computed once */
+            const uint32_t length = psl_ir_push_sqrt(ir, psl_ir_push_dot(ir, &args[0], &args[0]));
+            const uint32_t inverse = psl_ir_push_binary(ir, PSL_IROpcode_Div, psl_ir_push_const(ir, type, 1.0), length);
+
+            for(uint32_t i = 0; i < width; i++)
+            {
+                value->components[i] = psl_ir_push_binary(ir, PSL_IROpcode_Mul, args[0].components[i], inverse);
+            }
+
+            return true;
+        }
+        case PSL_BuiltinID_Cross:
+        {
+            if(width != 3)
+            {
+                ir->error = "Cross product of vectors that do not have 3 components";
+                return false;
+            }
+
+            for(uint32_t i = 0; i < 3; i++)
+            {
+                const uint32_t j = (i + 1) % 3;
+                const uint32_t k = (i + 2) % 3;
+
+                value->components[i] = psl_ir_push_binary(ir,
+                                                          PSL_IROpcode_Sub,
+                                                          psl_ir_push_binary(ir, PSL_IROpcode_Mul, args[0].components[j], args[1].components[k]),
+                                                          psl_ir_push_binary(ir, PSL_IROpcode_Mul, args[0].components[k], args[1].components[j]));
+            }
+
+            return true;
+        }
+        default:
+            break;
+    }
+
+    for(uint32_t i = 0; i < width; i++)
+    {
+        switch(id)
+        {
+            case PSL_BuiltinID_Min:
+                value->components[i] = psl_ir_push_binary(ir, PSL_IROpcode_Min, args[0].components[i], args[1].components[i]);
+                break;
+            case PSL_BuiltinID_Max:
+                value->components[i] = psl_ir_push_binary(ir, PSL_IROpcode_Max, args[0].components[i], args[1].components[i]);
+                break;
+            case PSL_BuiltinID_Clamp:
+                value->components[i] = psl_ir_push_binary(ir,
+                                                          PSL_IROpcode_Min,
+                                                          psl_ir_push_binary(ir, PSL_IROpcode_Max, args[0].components[i], args[1].components[i]),
+                                                          args[2].components[i]);
+                break;
+            case PSL_BuiltinID_Saturate:
+                value->components[i] = psl_ir_push_binary(ir,
+                                                          PSL_IROpcode_Min,
+                                                          psl_ir_push_binary(ir, PSL_IROpcode_Max, args[0].components[i], psl_ir_push_const(ir, type, 0.0)),
+                                                          psl_ir_push_const(ir, type, 1.0));
+                break;
+            default:
+                ir->error = "Builtin cannot be expanded to IR instructions";
+                return false;
+        }
+    }
+
+    return true;
+}
+
+bool psl_ir_lower_block(PSL_IRLowering* lowering, uint32_t scope_start, PSL_ASTBlock* block, PSL_IRVector* return_value);
+
+bool psl_ir_lower_call(PSL_IRLowering* lowering, uint32_t scope_start, PSL_ASTFunctionCall* call, PSL_IRVector* value)
+{
+    PSL_IR* ir = lowering->ir;
+
+    PSL_BuiltinID builtin_id;
+    const PSL_Builtin* builtin = psl_builtin_find(call->name, call->name_length, &builtin_id);
+
+    if(builtin != NULL)
+    {
+        if(call->num_arguments != builtin->num_arguments)
+        {
+            ir->error = "Wrong number of arguments in builtin call";
+            return false;
+        }
+
+        if(builtin->scalar_func == NULL)
+        {
+            return psl_ir_lower_builtin(lowering, scope_start, builtin_id, call, value);
+        }
+
+        PSL_IRVector args[PSL_IR_MAX_ARGS];
+
+        PSL_IRInst inst = psl_ir_make_inst(PSL_IROpcode_Call);
+        inst.index = (uint32_t)builtin_id;
+        inst.num_args = call->num_arguments;
+
+        if(!psl_ir_lower_builtin_arguments(lowering, scope_start, call, args, &inst.type))
+        {
+            return false;
+        }
+
+        psl_ir_push_componentwise(ir, &inst, args, value);
+
+        return true;
+    }
+
+    PSL_ASTFunction* func = psl_ir_lowering_find_function(lowering, call->name, call->name_length);
+
+    if(func == NULL)
+    {
+        ir->error = "Call to an undefined function";
+        return false;
+    }
+
+    if(call->num_arguments != func->num_parameters)
+    {
+        ir->error = "Wrong number of arguments in function call";
+        return false;
+    }
+
+    if(lowering->depth >= PSL_IR_MAX_INLINING_DEPTH)
+    {
+        ir->error = "Maximum inlining depth reached, recursive calls are not supported";
+        return false;
+    }
+
+    /* Arguments are evaluated in the caller scope before binding them in the callee one */
+    PSL_IRVector* values = (PSL_IRVector*)psl_ir_alloc(ir, call->num_arguments * sizeof(PSL_IRVector));
+
+    for(uint32_t i = 0; i < call->num_arguments; i++)
+    {
+        if(!psl_ir_lower_expression(lowering, scope_start, call->arguments[i], &values[i]))
+        {
+            psl_ir_free(ir, values);
+            return false;
+        }
+    }
+
+    const uint32_t callee_scope_start = lowering->num_bindings;
+
+    bool success = true;
+
+    for(uint32_t i = 0; success && i < func->num_parameters; i++)
+    {
+        PSL_ASTParameter* param = PSL_AST_CAST(PSL_ASTParameter, func->parameters[i]);
+        PSL_ASSERT(param != NULL, "Wrong type casting, should be PSL_ASTParameter*");
+
+        const PSL_IRType type = psl_ir_type_from_ast(param->value_type);
+
+        if(values[i].width != psl_ast_value_type_width(param->value_type))
+        {
+            ir->error = "Argument does not have the number of components of its parameter";
+            success = false;
+            break;
+        }
+
+        /* Masks are forwarded as they are, to be used as select conditions */
+        for(uint32_t j = 0; success && j < values[i].width; j++)
+        {
+            if(!psl_ir_is_mask(ir, values[i].components[j]))
+            {
+                values[i].components[j] = psl_ir_convert(ir, values[i].components[j], type, false);
+                success = values[i].components[j] != PSL_IR_INVALID_VALUE;
+            }
+        }
+
+        psl_ir_lowering_bind(lowering, callee_scope_start, param->name, param->name_length, &values[i], type);
+    }
+
+    psl_ir_free(ir, values);
+
+    if(!success)
+    {
+        lowering->num_bindings = callee_scope_start;
+        return false;
+    }
+
+    PSL_ASTBlock* body = PSL_AST_CAST(PSL_ASTBlock, func->body);
+    PSL_ASSERT(body != NULL, "Wrong type casting, should be PSL_ASTBlock*");
+
+    value->width = 0;
+
+    lowering->depth++;
+
+    /* Inlined instructions keep the lines of the callee */
+    const uint32_t caller_line = ir->line;
+
+    success = psl_ir_lower_block(lowering, callee_scope_start, body, value);
+
+    ir->line = caller_line;
+
+    lowering->depth--;
+    lowering->num_bindings = callee_scope_start;
+
+    if(!success)
+    {
+        return false;
+    }
+
+    if(value->width == 0)
+    {
+        ir->error = "Function called in an expression does not return a value";
+        return false;
+    }
+
+    if(value->width == 1 && psl_ir_is_mask(ir, value->components[0]))
+    {
+        return true;
+    }
+
+    if(value->width != psl_ast_value_type_width(func->return_type))
+    {
+        ir->error = "Returned value does not have the number of components of the return type";
+        return false;
+    }
+
+    for(uint32_t i = 0; i < value->width; i++)
+    {
+        value->components[i] = psl_ir_convert(ir, value->components[i], psl_ir_type_from_ast(func->return_type), false);
+
+        if(value->components[i] == PSL_IR_INVALID_VALUE)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool psl_ir_lower_constructor(PSL_IRLowering* lowering,
+                              uint32_t scope_start,
+                              PSL_ASTConstructor* constructor,
+                              PSL_IRVector* value)
+{
+    PSL_IR* ir = lowering->ir;
+
+    const uint32_t width = psl_ast_value_type_width(constructor->value_type);
+
+    value->width = 0;
+
+    for(uint32_t i = 0; i < constructor->num_arguments; i++)
+    {
+        PSL_IRVector arg;
+
+        if(!psl_ir_lower_operand(lowering, scope_start, constructor->arguments[i], &arg))
+        {
+            return false;
+        }
+
+        if(value->width + arg.width > width)
+        {
+            ir->error = "Too many components in vector constructor";
+            return false;
+        }
+
+        memcpy(&value->components[value->width], arg.components, arg.width * sizeof(uint32_t));
+        value->width += arg.width;
+    }
+
+    if(value->width == 1)
+    {
+        for(uint32_t i = 1; i < width; i++)
+        {
+            value->components[i] = value->components[0];
+        }
+
+        value->width = width;
+    }
+
+    if(value->width != width)
+    {
+        ir->error = "Not enough components in vector constructor";
+        return false;
+    }
+
+    /* Naming the vector type converts like f32() */
+    for(uint32_t i = 0; i < width; i++)
+    {
+        value->components[i] = psl_ir_convert(ir, value->components[i], psl_ir_type_from_ast(constructor->value_type), true);
+    }
+
+    return true;
+}
+
+bool psl_ir_lower_swizzle(PSL_IRLowering* lowering, uint32_t scope_start, PSL_ASTSwizzle* swizzle, PSL_IRVector* value)
+{
+    PSL_IR* ir = lowering->ir;
+
+    PSL_IRVector operand;
+
+    /* Components of exports can be read as soon as they are assigned, without the others */
+    PSL_ASTVariable* var = PSL_AST_CAST(PSL_ASTVariable, swizzle->operand);
+    PSL_IRBinding* binding = var != NULL ? psl_ir_lowering_find(lowering, scope_start, var->name, var->name_length) : NULL;
+
+    if(binding != NULL)
+    {
+        operand = binding->value;
+    }
+    else if(!psl_ir_lower_operand(lowering, scope_start, swizzle->operand, &operand))
+    {
+        return false;
+    }
+
+    value->width = swizzle->num_components;
+
+    for(uint32_t i = 0; i < swizzle->num_components; i++)
+    {
+        if(swizzle->components[i] >= operand.width)
+        {
+            ir->error = "Swizzle selects a component the value does not have";
+            return false;
+        }
+
+        value->components[i] = operand.components[swizzle->components[i]];
+
+        if(value->components[i] == PSL_IR_INVALID_VALUE)
+        {
+            ir->error = "Export parameter read before being assigned";
+            return false;
+        }
+
+        if(psl_ir_is_mask(ir, value->components[i]))
+        {
+            ir->error = "Comparison results can only be used as select conditions";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool psl_ir_lower_expression(PSL_IRLowering* lowering, uint32_t scope_start, PSL_ASTNode* node, PSL_IRVector* value)
+{
+    PSL_IR* ir = lowering->ir;
+
+    switch(node->type)
+    {
+        case PSL_ASTNodeType_PSL_ASTLiteral:
+        {
+            PSL_ASTLiteral* lit = PSL_AST_CAST(PSL_ASTLiteral, node);
+
+            *value = psl_ir_scalar(psl_ir_push_const(ir, PSL_IRType_F32, lit->value));
+
+            return true;
+        }
+        case PSL_ASTNodeType_PSL_ASTVariable:
+        {
+            PSL_ASTVariable* var = PSL_AST_CAST(PSL_ASTVariable, node);
+
+            PSL_IRBinding* binding = psl_ir_lowering_find(lowering, scope_start, var->name, var->name_length);
+
+            if(binding == NULL)
+            {
+                ir->error = "Use of an undefined variable";
+                return false;
+            }
+
+            if(!psl_ir_vector_is_assigned(&binding->value))
+            {
+                ir->error = "Export parameter read before being assigned";
+                return false;
+            }
+
+            *value = binding->value;
+
+            return true;
+        }
+        case PSL_ASTNodeType_PSL_ASTBinOP:
+        {
+            PSL_ASTBinOP* binop = PSL_AST_CAST(PSL_ASTBinOP, node);
+
+            PSL_IRInst inst;
+
+            switch(binop->op)
+            {
+                case PSL_ASTBinOPType_Add:
+                    inst = psl_ir_make_inst(PSL_IROpcode_Add);
+                    break;
+                case PSL_ASTBinOPType_Sub:
+                    inst = psl_ir_make_inst(PSL_IROpcode_Sub);
+                    break;
+                case PSL_ASTBinOPType_Mul:
+                    inst = psl_ir_make_inst(PSL_IROpcode_Mul);
+                    break;
+                case PSL_ASTBinOPType_Div:
+                    inst = psl_ir_make_inst(PSL_IROpcode_Div);
+                    break;
+                case PSL_ASTBinOPType_Lt:
+                case PSL_ASTBinOPType_Le:
+                case PSL_ASTBinOPType_Gt:
+                case PSL_ASTBinOPType_Ge:
+                case PSL_ASTBinOPType_Eq:
+                case PSL_ASTBinOPType_Neq:
+                    inst = psl_ir_make_inst(PSL_IROpcode_Cmp);
+                    inst.index = (uint32_t)PSL_IRCmp_Lt + (uint32_t)(binop->op - PSL_ASTBinOPType_Lt);
+                    break;
+                default:
+                    ir->error = "Unsupported binary operation";
+                    return false;
+            }
+
+            inst.num_args = 2;
+
+            PSL_IRVector operands[2];
+
+            if(!psl_ir_lower_operand(lowering, scope_start, binop->left, &operands[0]) ||
+               !psl_ir_lower_operand(lowering, scope_start, binop->right, &operands[1]))
+            {
+                return false;
+            }
+
+            if(inst.opcode == PSL_IROpcode_Cmp && (operands[0].width != 1 || operands[1].width != 1))
+            {
+                ir->error = "Comparisons operate on scalars, not vectors";
+                return false;
+            }
+
+            /* Vectors are computed component by component, scalars apply to every component */
+            if(!psl_ir_broadcast(ir, operands, 2))
+            {
+                return false;
+            }
+
+            psl_ir_push_componentwise(ir, &inst, operands, value);
+
+            return true;
+        }
+        case PSL_ASTNodeType_PSL_ASTUnOP:
+        {
+            PSL_ASTUnOP* unop = PSL_AST_CAST(PSL_ASTUnOP, node);
+
+            PSL_IRInst inst = psl_ir_make_inst(PSL_IROpcode_Neg);
+            inst.num_args = 1;
+
+            PSL_IRVector operand;
+
+            if(!psl_ir_lower_operand(lowering, scope_start, unop->operand, &operand))
+            {
+                return false;
+            }
+
+            psl_ir_push_componentwise(ir, &inst, &operand, value);
+
+            return true;
+        }
+        case PSL_ASTNodeType_PSL_ASTFunctionCall:
+        {
+            PSL_ASTFunctionCall* call = PSL_AST_CAST(PSL_ASTFunctionCall, node);
+
+            return psl_ir_lower_call(lowering, scope_start, call, value);
+        }
+        case PSL_ASTNodeType_PSL_ASTTernary:
+        {
+            PSL_ASTTernary* ternary = PSL_AST_CAST(PSL_ASTTernary, node);
+
+            return psl_ir_lower_select(lowering,
+                                       scope_start,
+                                       ternary->condition,
+                                       ternary->if_true,
+                                       ternary->if_false,
+                                       value);
+        }
+        case PSL_ASTNodeType_PSL_ASTCast:
+        {
+            PSL_ASTCast* cast = PSL_AST_CAST(PSL_ASTCast, node);
+
+            if(!psl_ir_lower_operand(lowering, scope_start, cast->operand, value))
+            {
+                return false;
+            }
+
+            const PSL_IRType type = psl_ir_type_from_ast(cast->value_type);
+
+            for(uint32_t i = 0; i < value->width; i++)
+            {
+                uint32_t component = psl_ir_convert(ir, value->components[i], type, true);
+
+                /* Narrowed literals are rounded, only the ones never narrowed are widened with their full precision */
+                if(type == PSL_IRType_F32 &&
+                   component != PSL_IR_INVALID_VALUE &&
+                   ir->insts[component].opcode == PSL_IROpcode_Const &&
+                   ir->insts[component].constant != (double)(float)ir->insts[component].constant)
+                {
+                    component = psl_ir_push_const(ir, type, (double)(float)ir->insts[component].constant);
+                }
+
+                value->components[i] = component;
+            }
+
+            return true;
+        }
+        case PSL_ASTNodeType_PSL_ASTConstructor:
+        {
+            PSL_ASTConstructor* constructor = PSL_AST_CAST(PSL_ASTConstructor, node);
+
+            return psl_ir_lower_constructor(lowering, scope_start, constructor, value);
+        }
+        case PSL_ASTNodeType_PSL_ASTSwizzle:
+        {
+            PSL_ASTSwizzle* swizzle = PSL_AST_CAST(PSL_ASTSwizzle, node);
+
+            return psl_ir_lower_swizzle(lowering, scope_start, swizzle, value);
+        }
+        default:
+        {
+            ir->error = "Unexpected node in expression";
+            return false;
+        }
+    }
+}
+
+/* v.xy = value, the other components of v keep their value */
+bool psl_ir_lower_swizzle_assignment(PSL_IRLowering* lowering,
+                                     uint32_t scope_start,
+                                     PSL_ASTSwizzle* swizzle,
+                                     PSL_IRVector* value)
+{
+    PSL_IR* ir = lowering->ir;
+
+    PSL_ASTVariable* var = PSL_AST_CAST(PSL_ASTVariable, swizzle->operand);
+    PSL_IRBinding* existing = psl_ir_lowering_find(lowering, scope_start, var->name, var->name_length);
+
+    if(existing == NULL)
+    {
+        ir->error = "Assignment to a component of an undefined variable";
+        return false;
+    }
+
+    if(value->width == 1 && psl_ir_is_mask(ir, value->components[0]))
+    {
+        ir->error = "Comparison results cannot be assigned to components";
+        return false;
+    }
+
+    if(value->width == 1)
+    {
+        for(uint32_t i = 1; i < swizzle->num_components; i++)
+        {
+            value->components[i] = value->components[0];
+        }
+
+        value->width = swizzle->num_components;
+    }
+
+    if(value->width != swizzle->num_components)
+    {
+        ir->error = "Assigned value does not have the number of components of the swizzle";
+        return false;
+    }
+
+    PSL_IRVector updated = existing->value;
+    uint32_t assigned = 0;
+
+    for(uint32_t i = 0; i < swizzle->num_components; i++)
+    {
+        const uint32_t component = swizzle->components[i];
+
+        if(component >= updated.width)
+        {
+            ir->error = "Swizzle selects a component the value does not have";
+            return false;
+        }
+
+        if(assigned & (1u << component))
+        {
+            ir->error = "Swizzle assigns the same component twice";
+            return false;
+        }
+
+        assigned |= 1u << component;
+
+        updated.components[component] = psl_ir_convert(ir, value->components[i], existing->type, false);
+
+        if(updated.components[component] == PSL_IR_INVALID_VALUE)
+        {
+            return false;
+        }
+    }
+
+    existing->value = updated;
+
+    return true;
+}
+
+bool psl_ir_lower_block(PSL_IRLowering* lowering, uint32_t scope_start, PSL_ASTBlock* block, PSL_IRVector* return_value)
+{
+    PSL_IR* ir = lowering->ir;
+
+    for(uint32_t i = 0; i < block->num_statements; i++)
+    {
+        PSL_ASTNode* statement = block->statements[i];
+
+        ir->line = statement->line;
+
+        switch(statement->type)
+        {
+            case PSL_ASTNodeType_PSL_ASTAssignment:
+            {
+                PSL_ASTAssignment* assignment = PSL_AST_CAST(PSL_ASTAssignment, statement);
+                PSL_ASTSwizzle* swizzle = PSL_AST_CAST(PSL_ASTSwizzle, assignment->lvalue);
+                PSL_ASTVariable* lvalue = PSL_AST_CAST(PSL_ASTVariable, swizzle != NULL ? swizzle->operand : assignment->lvalue);
+
+                if(lvalue == NULL)
+                {
+                    ir->error = "Expected a variable on the left side of an assignment";
+                    return false;
+                }
+
+                PSL_IRVector value;
+
+                if(!psl_ir_lower_expression(lowering, scope_start, assignment->rvalue, &value))
+                {
+                    return false;
+                }
+
+                if(swizzle != NULL)
+                {
+                    if(!psl_ir_lower_swizzle_assignment(lowering, scope_start, swizzle, &value))
+                    {
+                        return false;
+                    }
+
+                    break;
+                }
+
+                /* Assigning to a parameter converts to its type, other variables take the type of their value */
+                PSL_IRBinding* existing = psl_ir_lowering_find(lowering, scope_start, lvalue->name, lvalue->name_length);
+                PSL_IRType type = PSL_IRType_F32;
+
+                for(uint32_t j = 0; j < value.width; j++)
+                {
+                    type = psl_ir_common_type(type, ir->insts[value.components[j]].type);
+                }
+
+                if(existing != NULL && existing->value.width != value.width)
+                {
+                    ir->error = "Assigned value does not have the number of components of the variable";
+                    return false;
+                }
+
+                if(existing != NULL && !psl_ir_is_mask(ir, value.components[0]))
+                {
+                    type = existing->type;
+
+                    for(uint32_t j = 0; j < value.width; j++)
+                    {
+                        value.components[j] = psl_ir_convert(ir, value.components[j], type, false);
+
+                        if(value.components[j] == PSL_IR_INVALID_VALUE)
+                        {
+                            return false;
+                        }
+                    }
+                }
+
+                psl_ir_lowering_bind(lowering, scope_start, lvalue->name, lvalue->name_length, &value, type);
+
+                break;
+            }
+            case PSL_ASTNodeType_PSL_ASTReturn:
+            {
+                PSL_ASTReturn* ret = PSL_AST_CAST(PSL_ASTReturn, statement);
+
+                if(return_value == NULL)
+                {
+                    ir->error = "Main functions cannot return a value";
+                    return false;
+                }
+
+                return psl_ir_lower_expression(lowering, scope_start, ret->statement, return_value);
+            }
+            default:
+            {
+                ir->error = "Unexpected statement";
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+PSL_ASTFunction* psl_ir_find_entry_point(PSL_ASTSource* source, const char* entry_point)
+{
+    for(uint32_t i = 0; i < source->num_functions; i++)
+    {
+        PSL_ASTFunction* func = PSL_AST_CAST(PSL_ASTFunction, source->functions[i]);
+
+        if(func == NULL || !func->is_entry_point)
+        {
+            continue;
+        }
+
+        if(entry_point == NULL ||
+           psl_ir_name_equals(func->name, func->name_length, entry_point, (uint32_t)strlen(entry_point)))
+        {
+            return func;
+        }
+    }
+
+    return NULL;
+}
+
+/* Number of components of the parameter, whose other components follow it */
+PSL_FORCE_INLINE uint32_t psl_ir_param_width(const PSL_IR* ir, const PSL_IRParam* param)
+{
+    uint32_t width = 1;
+
+    while(param + width < ir->params + ir->num_params && param[width].component != 0)
+    {
+        width++;
+    }
+
+    return width;
+}
+
+/*
+   Binds a parameter of a fused entry point to the parameter of the same name of a previous one.
+   Inputs and uniforms are shared, inputs named like a previous export read the exported value
+*/
+bool psl_ir_bind_shared_param(PSL_IR* ir, PSL_IRParam* shared, PSL_ASTParameter* param, PSL_IRType type)
+{
+    if(shared->type != type || psl_ir_param_width(ir, shared) != psl_ast_value_type_width(param->value_type))
+    {
+        ir->error = "Parameters shared by fused entry points must have the same type";
+        return false;
+    }
+
+    if(param->uniform)
+    {
+        if(shared->kind != PSL_IRParamKind_Uniform)
+        {
+            ir->error = "Uniform parameter shares its name with a column of a fused entry point";
+            return false;
+        }
+
+        return true;
+    }
+
+    if(param->exportable)
+    {
+        ir->error = "Exports of fused entry points must have distinct names";
+        return false;
+    }
+
+    if(shared->kind != PSL_IRParamKind_Input && shared->kind != PSL_IRParamKind_Export)
+    {
+        ir->error = "Input parameter shares its name with a uniform or a reduction of a fused entry point";
+        return false;
+    }
+
+    return true;
+}
+
+bool psl_ir_lower_entry(PSL_IR* ir, PSL_ASTSource* source, PSL_ASTFunction* main, uint32_t* values)
+{
+    /* Parameters are loaded on the line of the function */
+    ir->line = main->base.line;
+
+    PSL_IRLowering lowering;
+    lowering.ir = ir;
+    lowering.source = source;
+    lowering.bindings = NULL;
+    lowering.num_bindings = 0;
+    lowering.bindings_capacity = 0;
+    lowering.depth = 0;
+
+    /* Parameters of previous entry points */
+    const uint32_t num_shared = ir->num_params;
+
+    bool success = true;
+
+    for(uint32_t i = 0; success && i < main->num_parameters; i++)
+    {
+        PSL_ASTParameter* param = PSL_AST_CAST(PSL_ASTParameter, main->parameters[i]);
+        PSL_ASSERT(param != NULL, "Wrong type casting, should be PSL_ASTParameter*");
+
+        const PSL_IRType type = psl_ir_type_from_ast(param->value_type);
+
+        PSL_IRParam* shared = NULL;
+
+        for(uint32_t j = 0; j < num_shared && shared == NULL; j++)
+        {
+            if(psl_ir_name_equals(ir->params[j].name, ir->params[j].name_length, param->name, param->name_length))
+            {
+                shared = &ir->params[j];
+            }
+        }
+
+        PSL_IRVector value;
+        value.width = psl_ast_value_type_width(param->value_type);
+
+        if(shared != NULL)
+        {
+            success = psl_ir_bind_shared_param(ir, shared, param, type);
+
+            for(uint32_t c = 0; success && c < value.width; c++)
+            {
+                value.components[c] = values[shared - ir->params + c];
+            }
+
+            if(success)
+            {
+                psl_ir_lowering_bind(&lowering, 0, param->name, param->name_length, &value, type);
+            }
+
+            continue;
+        }
+
+        /* Vectors take one parameter per component */
+        for(uint32_t c = 0; c < value.width; c++)
+        {
+            PSL_IRParam* ir_param = &ir->params[ir->num_params];
+            ir_param->name = param->name;
+            ir_param->name_length = param->name_length;
+            ir_param->type = type;
+            ir_param->format = ir_param->type == PSL_IRType_F64 ? PSL_ColumnFormat_F64 : PSL_ColumnFormat_F32;
+            ir_param->reduce_op = PSL_IRReduceOp_Sum;
+            ir_param->reduction = 0;
+            ir_param->component = c;
+
+            value.components[c] = PSL_IR_INVALID_VALUE;
+
+            if(param->uniform)
+            {
+                ir_param->kind = PSL_IRParamKind_Uniform;
+                ir_param->index = ir->num_uniforms++;
+
+                PSL_IRInst inst = psl_ir_make_inst(PSL_IROpcode_Uniform);
+                inst.type = ir_param->type;
+                inst.index = ir_param->index;
+                value.components[c] = psl_ir_push(ir, &inst);
+            }
+            else if(param->reduce_op != PSL_ASTReduceOp_None)
+            {
+                ir_param->kind = PSL_IRParamKind_Reduction;
+                ir_param->reduce_op = psl_ir_reduce_op_from_ast(param->reduce_op);
+                ir_param->index = ir->num_columns++;
+                ir_param->reduction = ir->num_reductions++;
+            }
+            else if(param->exportable)
+            {
+                ir_param->kind = PSL_IRParamKind_Export;
+                ir_param->index = ir->num_columns++;
+            }
+            else
+            {
+                ir_param->kind = PSL_IRParamKind_Input;
+                ir_param->index = ir->num_columns++;
+
+                PSL_IRInst inst = psl_ir_make_inst(PSL_IROpcode_Load);
+                inst.type = ir_param->type;
+                inst.index = ir_param->index;
+                value.components[c] = psl_ir_push(ir, &inst);
+            }
+
+            values[ir->num_params++] = value.components[c];
+        }
+
+        psl_ir_lowering_bind(&lowering, 0, param->name, param->name_length, &value, type);
+    }
+
+    PSL_ASTBlock* body = PSL_AST_CAST(PSL_ASTBlock, main->body);
+    PSL_ASSERT(body != NULL, "Wrong type casting, should be PSL_ASTBlock*");
+
+    success = success && psl_ir_lower_block(&lowering, 0, body, NULL);
+
+    /* Exports are stored, and reductions accumulated, with the last value they have been assigned */
+    for(uint32_t i = num_shared; success && i < ir->num_params; i++)
+    {
+        PSL_IRParam* param = &ir->params[i];
+
+        if(param->kind != PSL_IRParamKind_Export && param->kind != PSL_IRParamKind_Reduction)
+        {
+            continue;
+        }
+
+        PSL_IRBinding* binding = psl_ir_lowering_find(&lowering, 0, param->name, param->name_length);
+        const uint32_t value = binding != NULL ? binding->value.components[param->component] : PSL_IR_INVALID_VALUE;
+
+        if(value == PSL_IR_INVALID_VALUE)
+        {
+            ir->error = "Export parameter is never assigned";
+            success = false;
+            break;
+        }
+
+        if(psl_ir_is_mask(ir, value))
+        {
+            ir->error = "Comparison results cannot be exported";
+            success = false;
+            break;
+        }
+
+        const bool reduction = param->kind == PSL_IRParamKind_Reduction;
+
+        PSL_IRInst inst = psl_ir_make_inst(reduction ? PSL_IROpcode_Reduce : PSL_IROpcode_Store);
+        inst.type = param->type;
+        inst.index = reduction ? param->reduction : param->index;
+        inst.num_args = 1;
+        inst.args[0] = value;
+        psl_ir_push(ir, &inst);
+
+        /* Read by the inputs of the same name of the next entry points */
+        values[i] = reduction ? PSL_IR_INVALID_VALUE : value;
+    }
+
+    psl_ir_free(ir, lowering.bindings);
+
+    return success;
+}
+
+bool psl_ir_from_entry_points(PSL_IR* ir, const PSL_EntryPoint* entry_points, uint32_t num_entry_points)
+{
+    uint32_t max_params = 0;
+
+    for(uint32_t i = 0; i < num_entry_points; i++)
+    {
+        PSL_AST* ast = entry_points[i].ast;
+        PSL_ASTSource* source = ast->root != NULL ? PSL_AST_CAST(PSL_ASTSource, ast->root) : NULL;
+
+        if(source == NULL)
+        {
+            ir->error = "AST has no source to lower";
+            return false;
+        }
+
+        PSL_ASTFunction* main = psl_ir_find_entry_point(source, entry_points[i].name);
+
+        if(main == NULL)
+        {
+            ir->error = "Cannot find the entry point";
+            return false;
+        }
+
+        for(uint32_t j = 0; j < main->num_parameters; j++)
+        {
+            PSL_ASTParameter* param = PSL_AST_CAST(PSL_ASTParameter, main->parameters[j]);
+            PSL_ASSERT(param != NULL, "Wrong type casting, should be PSL_ASTParameter*");
+
+            max_params += psl_ast_value_type_width(param->value_type);
+        }
+    }
+
+    ir->params = (PSL_IRParam*)psl_ir_alloc(ir, max_params * sizeof(PSL_IRParam));
+    ir->num_params = 0;
+
+    /* Value every parameter is bound to */
+    uint32_t* values = (uint32_t*)psl_ir_alloc(ir, max_params * sizeof(uint32_t));
+
+    bool success = true;
+
+    for(uint32_t i = 0; success && i < num_entry_points; i++)
+    {
+        PSL_ASTSource* source = PSL_AST_CAST(PSL_ASTSource, entry_points[i].ast->root);
+
+        success = psl_ir_lower_entry(ir, source, psl_ir_find_entry_point(source, entry_points[i].name), values);
+    }
+
+    psl_ir_free(ir, values);
+
+    return success;
+}
+
+bool psl_ir_from_ast(PSL_IR* ir, PSL_AST* ast, const char* entry_point)
+{
+    PSL_EntryPoint entry;
+    entry.ast = ast;
+    entry.name = entry_point;
+
+    return psl_ir_from_entry_points(ir, &entry, 1);
+}
+
+PSL_IRParam* psl_ir_find_param(PSL_IR* ir, const char* name, uint32_t name_length)
+{
+    for(uint32_t i = 0; i < ir->num_params; i++)
+    {
+        if(psl_ir_name_equals(ir->params[i].name, ir->params[i].name_length, name, name_length))
+        {
+            return &ir->params[i];
+        }
+    }
+
+    return NULL;
+}
+
+PSL_IRParam* psl_ir_find_column(PSL_IR* ir, uint32_t column)
+{
+    for(uint32_t i = 0; i < ir->num_params; i++)
+    {
+        if(ir->params[i].kind != PSL_IRParamKind_Uniform && ir->params[i].index == column)
+        {
+            return &ir->params[i];
+        }
+    }
+
+    return NULL;
+}
+
+PSL_IRParam* psl_ir_find_reduction(PSL_IR* ir, uint32_t reduction)
+{
+    for(uint32_t i = 0; i < ir->num_params; i++)
+    {
+        if(ir->params[i].kind == PSL_IRParamKind_Reduction && ir->params[i].reduction == reduction)
+        {
+            return &ir->params[i];
+        }
+    }
+
+    return NULL;
+}
+
+bool psl_ir_set_column_format(PSL_IR* ir, const char* name, PSL_ColumnFormat format)
+{
+    PSL_IRParam* param = psl_ir_find_param(ir, name, (uint32_t)strlen(name));
+
+    if(param == NULL || (param->kind != PSL_IRParamKind_Input && param->kind != PSL_IRParamKind_Export))
+    {
+        ir->error = "Column format set on an unknown input or export parameter";
+        return false;
+    }
+
+    if(format == PSL_ColumnFormat_Default)
+    {
+        format = param->type == PSL_IRType_F64 ? PSL_ColumnFormat_F64 : PSL_ColumnFormat_F32;
+    }
+
+    const uint32_t width = psl_ir_param_width(ir, param);
+
+    for(uint32_t i = 0; i < width; i++)
+    {
+        param[i].format = format;
+    }
+
+    return true;
+}
+
+bool psl_ir_specialize(PSL_IR* ir, const char* name, double value)
+{
+    PSL_IRParam* param = psl_ir_find_param(ir, name, (uint32_t)strlen(name));
+
+    if(param == NULL || param->kind != PSL_IRParamKind_Uniform)
+    {
+        ir->error = "Specialization of an unknown uniform parameter";
+        return false;
+    }
+
+    const uint32_t width = psl_ir_param_width(ir, param);
+
+    for(uint32_t i = 0; i < ir->num_insts; i++)
+    {
+        PSL_IRInst* inst = &ir->insts[i];
+
+        if(inst->opcode == PSL_IROpcode_Uniform && inst->index >= param->index && inst->index < param->index + width)
+        {
+            const uint32_t line = inst->line;
+
+            *inst = psl_ir_make_inst(PSL_IROpcode_Const);
+            inst->type = param->type;
+            inst->line = line;
+            inst->constant = param->type == PSL_IRType_F32 ? (double)(float)value : value;
+        }
+    }
+
+    return true;
+}
+
+/* Passes */
+
+/* Value of a constant as it is evaluated, rounded to its type */
+PSL_FORCE_INLINE double psl_ir_const_value(PSL_IR* ir, uint32_t value)
+{
+    const PSL_IRInst* inst = &ir->insts[value];
+
+    return inst->type == PSL_IRType_F32 ? (double)(float)inst->constant : inst->constant;
+}
+
+PSL_FORCE_INLINE bool psl_ir_is_const(PSL_IR* ir, uint32_t value, double constant)
+{
+    return ir->insts[value].opcode == PSL_IROpcode_Const && psl_ir_const_value(ir, value) == constant;
+}
+
+PSL_FORCE_INLINE double psl_ir_mask_constant(bool set)
+{
+    const uint64_t bits = set ? 0xFFFFFFFFFFFFFFFF : 0;
+
+    double mask;
+    memcpy(&mask, &bits, sizeof(double));
+
+    return mask;
+}
+
+PSL_FORCE_INLINE bool psl_ir_mask_is_set(double mask)
+{
+    uint64_t bits;
+    memcpy(&bits, &mask, sizeof(double));
+
+    return bits != 0;
+}
+
+PSL_FORCE_INLINE bool psl_ir_is_widened(PSL_IR* ir, uint32_t value)
+{
+    return ir->insts[value].opcode == PSL_IROpcode_Convert &&
+           ir->insts[value].type == PSL_IRType_F64 &&
+           ir->insts[ir->insts[value].args[0]].type == PSL_IRType_F32;
+}
+
+/* Returns the value inst can be replaced with, or PSL_IR_INVALID_VALUE */
+uint32_t psl_ir_simplify(PSL_IR* ir, PSL_IRInst* inst)
+{
+    switch(inst->opcode)
+    {
+        case PSL_IROpcode_Select:
+            if(inst->args[1] == inst->args[2])
+            {
+                return inst->args[1];
+            }
+
+            if(ir->insts[inst->args[0]].opcode == PSL_IROpcode_Const)
+            {
+                return psl_ir_mask_is_set(ir->insts[inst->args[0]].constant) ? inst->args[1] : inst->args[2];
+            }
+
+            return PSL_IR_INVALID_VALUE;
+        case PSL_IROpcode_Mul:
+            if(psl_ir_is_const(ir, inst->args[1], 1.0))
+            {
+                return inst->args[0];
+            }
+
+            if(psl_ir_is_const(ir, inst->args[0], 1.0))
+            {
+                return inst->args[1];
+            }
+
+            return PSL_IR_INVALID_VALUE;
+        case PSL_IROpcode_Div:
+            return psl_ir_is_const(ir, inst->args[1], 1.0) ? inst->args[0] : PSL_IR_INVALID_VALUE;
+        case PSL_IROpcode_Sub:
+            /* x - 0 == x even for -0, which is not true for x + 0 */
+            return psl_ir_is_const(ir, inst->args[1], 0.0) && !signbit(ir->insts[inst->args[1]].constant) ?
+                   inst->args[0] : PSL_IR_INVALID_VALUE;
+        case PSL_IROpcode_Convert:
+            /* f32(f64(x)) == x */
+            return inst->type == PSL_IRType_F32 && psl_ir_is_widened(ir, inst->args[0]) ?
+                   ir->insts[inst->args[0]].args[0] : PSL_IR_INVALID_VALUE;
+        default:
+            return PSL_IR_INVALID_VALUE;
+    }
+}
+
+/* Computes the constant inst evaluates to, before rounding it to the type of inst */
+bool psl_ir_fold_value(PSL_IR* ir, PSL_IRInst* inst, double* result)
+{
+    for(uint32_t i = 0; i < inst->num_args; i++)
+    {
+        if(ir->insts[inst->args[i]].opcode != PSL_IROpcode_Const)
+        {
+            return false;
+        }
+    }
+
+    const double a = inst->num_args > 0 ? psl_ir_const_value(ir, inst->args[0]) : 0.0;
+    const double b = inst->num_args > 1 ? psl_ir_const_value(ir, inst->args[1]) : 0.0;
+
+    switch(inst->opcode)
+    {
+        case PSL_IROpcode_Convert:
+            /* Widened literals keep their full precision */
+            *result = ir->insts[inst->args[0]].constant;
+            return true;
+        case PSL_IROpcode_Min:
+            *result = a < b ? a : b;
+            return true;
+        case PSL_IROpcode_Max:
+            *result = a > b ? a : b;
+            return true;
+        case PSL_IROpcode_Cmp:
+            switch((PSL_IRCmp)inst->index)
+            {
+                case PSL_IRCmp_Lt:
+                    *result = psl_ir_mask_constant(a < b);
+                    return true;
+                case PSL_IRCmp_Le:
+                    *result = psl_ir_mask_constant(a <= b);
+                    return true;
+                case PSL_IRCmp_Gt:
+                    *result = psl_ir_mask_constant(a > b);
+                    return true;
+                case PSL_IRCmp_Ge:
+                    *result = psl_ir_mask_constant(a >= b);
+                    return true;
+                case PSL_IRCmp_Eq:
+                    *result = psl_ir_mask_constant(a == b);
+                    return true;
+                case PSL_IRCmp_Neq:
+                    *result = psl_ir_mask_constant(a != b);
+                    return true;
+                default:
+                    return false;
+            }
+        case PSL_IROpcode_Add:
+            *result = a + b;
+            return true;
+        case PSL_IROpcode_Sub:
+            *result = a - b;
+            return true;
+        case PSL_IROpcode_Mul:
+            *result = a * b;
+            return true;
+        case PSL_IROpcode_Div:
+            *result = a / b;
+            return true;
+        case PSL_IROpcode_Neg:
+            *result = -a;
+            return true;
+        case PSL_IROpcode_Call:
+        {
+            const PSL_Builtin* builtin = psl_builtin_get((PSL_BuiltinID)inst->index);
+
+            *result = inst->type == PSL_IRType_F64 ? builtin->scalar_func_f64(a, b) :
+                                                     (double)builtin->scalar_func((float)a, (float)b);
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+bool psl_ir_fold(PSL_IR* ir, PSL_IRInst* inst, double* result)
+{
+    if(!psl_ir_fold_value(ir, inst, result))
+    {
+        return false;
+    }
+
+    /* Masks are kept as bit patterns */
+    if(inst->type == PSL_IRType_F32 && inst->opcode != PSL_IROpcode_Cmp)
+    {
+        *result = (double)(float)*result;
+    }
+
+    return true;
+}
+
+/*
+   f32(op(f64(a), f64(b))) is computed as op(a, b) in f32 when a and b are f32 values. For add, sub,
+   mul, div and sqrt this is exact as double has more than twice the precision of float, the other
+   builtins stay within the precision of their f32 version
+*/
+bool psl_ir_narrow(PSL_IR* ir, PSL_IRInst* inst)
+{
+    if(inst->opcode != PSL_IROpcode_Convert || inst->type != PSL_IRType_F32)
+    {
+        return false;
+    }
+
+    const PSL_IRInst* wide = &ir->insts[inst->args[0]];
+
+    switch(wide->opcode)
+    {
+        case PSL_IROpcode_Add:
+        case PSL_IROpcode_Sub:
+        case PSL_IROpcode_Mul:
+        case PSL_IROpcode_Div:
+        case PSL_IROpcode_Neg:
+        case PSL_IROpcode_Min:
+        case PSL_IROpcode_Max:
+        case PSL_IROpcode_Call:
+            break;
+        default:
+            return false;
+    }
+
+    for(uint32_t i = 0; i < wide->num_args; i++)
+    {
+        if(!psl_ir_is_widened(ir, wide->args[i]))
+        {
+            return false;
+        }
+    }
+
+    PSL_IRInst narrow = *wide;
+    narrow.type = PSL_IRType_F32;
+
+    for(uint32_t i = 0; i < wide->num_args; i++)
+    {
+        narrow.args[i] = ir->insts[wide->args[i]].args[0];
+    }
+
+    *inst = narrow;
+
+    return true;
+}
+
+void psl_ir_fold_constants(PSL_IR* ir)
+{
+    uint32_t* remap = (uint32_t*)psl_ir_alloc(ir, ir->num_insts * sizeof(uint32_t));
+
+    for(uint32_t i = 0; i < ir->num_insts; i++)
+    {
+        PSL_IRInst* inst = &ir->insts[i];
+
+        remap[i] = i;
+
+        for(uint32_t j = 0; j < inst->num_args; j++)
+        {
+            inst->args[j] = remap[inst->args[j]];
+        }
+
+        double result;
+
+        if(psl_ir_fold(ir, inst, &result))
+        {
+            const PSL_IRType type = inst->type;
+            const uint32_t line = inst->line;
+
+            *inst = psl_ir_make_inst(PSL_IROpcode_Const);
+            inst->type = type;
+            inst->line = line;
+            inst->constant = result;
+            continue;
+        }
+
+        if(psl_ir_narrow(ir, inst))
+        {
+            continue;
+        }
+
+        const uint32_t replacement = psl_ir_simplify(ir, inst);
+
+        if(replacement != PSL_IR_INVALID_VALUE)
+        {
+            remap[i] = replacement;
+        }
+    }
+
+    psl_ir_free(ir, remap);
+}
+
+/* Fast math rewriting state, the instructions of ir are rebuilt into out */
+typedef struct {
+    PSL_IR* ir;
+    PSL_IR out;
+    uint32_t flags;
+    uint32_t* uses;     /* number of uses of each instruction of ir */
+    uint32_t* users;    /* last user of each instruction of ir */
+    uint32_t* remap;    /* value of out computing each instruction of ir */
+    bool* contractible; /* values of out that are products used once */
+    uint32_t* leaves;
+} PSL_IRFastMath;
+
+PSL_FORCE_INLINE uint32_t psl_ir_fast_math_push(PSL_IRFastMath* fast_math, const PSL_IRInst* inst, bool contractible)
+{
+    const uint32_t value = psl_ir_push(&fast_math->out, inst);
+
+    fast_math->contractible[value] = contractible;
+
+    return value;
+}
+
+/* Pushes a + b into out, as a fused multiply add when contraction is enabled and one side allows it */
+uint32_t psl_ir_fast_math_add(PSL_IRFastMath* fast_math, uint32_t a, uint32_t b)
+{
+    PSL_IR* out = &fast_math->out;
+
+    if(fast_math->flags & PSL_FastMath_Contract)
+    {
+        const uint32_t product = fast_math->contractible[a] ? a : fast_math->contractible[b] ? b : PSL_IR_INVALID_VALUE;
+
+        if(product != PSL_IR_INVALID_VALUE)
+        {
+            PSL_IRInst fma = psl_ir_make_inst(PSL_IROpcode_Fma);
+            fma.type = out->insts[product].type;
+            fma.num_args = 3;
+            fma.args[0] = out->insts[product].args[0];
+            fma.args[1] = out->insts[product].args[1];
+            fma.args[2] = product == a ? b : a;
+
+            /* The product is left to dead code elimination */
+            fast_math->contractible[product] = false;
+
+            return psl_ir_fast_math_push(fast_math, &fma, false);
+        }
+    }
+
+    PSL_IRInst add = psl_ir_make_inst(PSL_IROpcode_Add);
+    add.type = out->insts[a].type;
+    add.num_args = 2;
+    add.args[0] = a;
+    add.args[1] = b;
+
+    return psl_ir_fast_math_push(fast_math, &add, false);
+}
+
+/* An addition only used by another addition of the same type is part of the chain of that addition */
+PSL_FORCE_INLINE bool psl_ir_fast_math_in_chain(PSL_IRFastMath* fast_math, uint32_t value)
+{
+    const PSL_IRInst* inst = &fast_math->ir->insts[value];
+
+    if(inst->opcode != PSL_IROpcode_Add || fast_math->uses[value] != 1)
+    {
+        return false;
+    }
+
+    const PSL_IRInst* user = &fast_math->ir->insts[fast_math->users[value]];
+
+    return user->opcode == PSL_IROpcode_Add && user->type == inst->type;
+}
+
+/* Appends the values of out summed by the chain of additions ending at value, left to right */
+void psl_ir_fast_math_collect(PSL_IRFastMath* fast_math, uint32_t value, uint32_t* num_leaves)
+{
+    const PSL_IRInst* inst = &fast_math->ir->insts[value];
+
+    for(uint32_t i = 0; i < 2; i++)
+    {
+        if(psl_ir_fast_math_in_chain(fast_math, inst->args[i]))
+        {
+            psl_ir_fast_math_collect(fast_math, inst->args[i], num_leaves);
+        }
+        else
+        {
+            fast_math->leaves[(*num_leaves)++] = fast_math->remap[inst->args[i]];
+        }
+    }
+}
+
+/* Sums a chain of additions pairwise, which halves its depth at each level */
+uint32_t psl_ir_fast_math_reassociate(PSL_IRFastMath* fast_math, uint32_t value)
+{
+    uint32_t num_leaves = 0;
+    psl_ir_fast_math_collect(fast_math, value, &num_leaves);
+
+    uint32_t* leaves = fast_math->leaves;
+
+    while(num_leaves > 1)
+    {
+        uint32_t num_sums = 0;
+
+        for(uint32_t i = 0; i + 1 < num_leaves; i += 2)
+        {
+            leaves[num_sums++] = psl_ir_fast_math_add(fast_math, leaves[i], leaves[i + 1]);
+        }
+
+        if(num_leaves & 1)
+        {
+            leaves[num_sums++] = leaves[num_leaves - 1];
+        }
+
+        num_leaves = num_sums;
+    }
+
+    return leaves[0];
+}
+
+/* Rewrites a division into approximations or a multiplication, returns PSL_IR_INVALID_VALUE if it is kept */
+uint32_t psl_ir_fast_math_div(PSL_IRFastMath* fast_math, const PSL_IRInst* inst)
+{
+    PSL_IR* ir = fast_math->ir;
+    PSL_IR* out = &fast_math->out;
+
+    const uint32_t a = fast_math->remap[inst->args[0]];
+    const PSL_IRInst* divisor = &ir->insts[inst->args[1]];
+
+    uint32_t reciprocal = PSL_IR_INVALID_VALUE;
+
+    if((fast_math->flags & PSL_FastMath_ApproxRsqrt) &&
+       inst->type == PSL_IRType_F32 &&
+       divisor->opcode == PSL_IROpcode_Call &&
+       divisor->index == PSL_BuiltinID_Sqrt &&
+       divisor->type == PSL_IRType_F32)
+    {
+        PSL_IRInst rsqrt = psl_ir_make_inst(PSL_IROpcode_Rsqrt);
+        rsqrt.type = PSL_IRType_F32;
+        rsqrt.num_args = 1;
+        rsqrt.args[0] = fast_math->remap[divisor->args[0]];
+
+        reciprocal = psl_ir_fast_math_push(fast_math, &rsqrt, false);
+    }
+    else if((fast_math->flags & PSL_FastMath_ApproxRcp) && divisor->opcode == PSL_IROpcode_Const)
+    {
+        const double value = 1.0 / psl_ir_const_value(ir, inst->args[1]);
+
+        reciprocal = psl_ir_push_const(out, inst->type, inst->type == PSL_IRType_F32 ? (double)(float)value : value);
+        fast_math->contractible[reciprocal] = false;
+    }
+    else if((fast_math->flags & PSL_FastMath_ApproxRcp) && inst->type == PSL_IRType_F32)
+    {
+        PSL_IRInst rcp = psl_ir_make_inst(PSL_IROpcode_Rcp);
+        rcp.type = PSL_IRType_F32;
+        rcp.num_args = 1;
+        rcp.args[0] = fast_math->remap[inst->args[1]];
+
+        reciprocal = psl_ir_fast_math_push(fast_math, &rcp, false);
+    }
+
+    if(reciprocal == PSL_IR_INVALID_VALUE)
+    {
+        return PSL_IR_INVALID_VALUE;
+    }
+
+    if(psl_ir_is_const(out, a, 1.0))
+    {
+        return reciprocal;
+    }
+
+    PSL_IRInst mul = psl_ir_make_inst(PSL_IROpcode_Mul);
+    mul.type = inst->type;
+    mul.num_args = 2;
+    mul.args[0] = a;
+    mul.args[1] = reciprocal;
+
+    return psl_ir_fast_math_push(fast_math, &mul, false);
+}
+
+void psl_ir_fast_math(PSL_IR* ir, uint32_t flags)
+{
+    if(flags == 0 || ir->num_insts == 0)
+    {
+        return;
+    }
+
+    PSL_IRFastMath fast_math;
+    fast_math.ir = ir;
+    fast_math.flags = flags;
+    fast_math.uses = (uint32_t*)psl_ir_alloc_zeroed(ir, ir->num_insts * sizeof(uint32_t));
+    fast_math.users = (uint32_t*)psl_ir_alloc(ir, ir->num_insts * sizeof(uint32_t));
+    fast_math.remap = (uint32_t*)psl_ir_alloc(ir, ir->num_insts * sizeof(uint32_t));
+    fast_math.leaves = (uint32_t*)psl_ir_alloc(ir, ir->num_insts * sizeof(uint32_t));
+
+    /* Each instruction pushes at most three values */
+    fast_math.contractible = (bool*)psl_ir_alloc_zeroed(ir, ir->num_insts * 3 * sizeof(bool));
+
+    psl_ir_init(&fast_math.out);
+    fast_math.out.scratch = ir->scratch;
+
+    for(uint32_t i = 0; i < ir->num_insts; i++)
+    {
+        for(uint32_t j = 0; j < ir->insts[i].num_args; j++)
+        {
+            fast_math.uses[ir->insts[i].args[j]]++;
+            fast_math.users[ir->insts[i].args[j]] = i;
+        }
+    }
+
+    for(uint32_t i = 0; i < ir->num_insts; i++)
+    {
+        PSL_IRInst inst = ir->insts[i];
+
+        fast_math.remap[i] = PSL_IR_INVALID_VALUE;
+        fast_math.out.line = inst.line;
+
+        if(inst.opcode == PSL_IROpcode_Add)
+        {
+            if(flags & PSL_FastMath_Reassoc)
+            {
+                /* Additions of a chain are summed by its last addition */
+                if(!psl_ir_fast_math_in_chain(&fast_math, i))
+                {
+                    fast_math.remap[i] = psl_ir_fast_math_reassociate(&fast_math, i);
+                }
+            }
+            else
+            {
+                fast_math.remap[i] = psl_ir_fast_math_add(&fast_math,
+                                                          fast_math.remap[inst.args[0]],
+                                                          fast_math.remap[inst.args[1]]);
+            }
+
+            continue;
+        }
+
+        if(inst.opcode == PSL_IROpcode_Div)
+        {
+            fast_math.remap[i] = psl_ir_fast_math_div(&fast_math, &inst);
+
+            if(fast_math.remap[i] != PSL_IR_INVALID_VALUE)
+            {
+                continue;
+            }
+        }
+
+        for(uint32_t j = 0; j < inst.num_args; j++)
+        {
+            inst.args[j] = fast_math.remap[inst.args[j]];
+        }
+
+        fast_math.remap[i] = psl_ir_fast_math_push(&fast_math,
+                                                   &inst,
+                                                   inst.opcode == PSL_IROpcode_Mul && fast_math.uses[i] == 1);
+    }
+
+    psl_ir_free(ir, ir->insts);
+    ir->insts = fast_math.out.insts;
+    ir->num_insts = fast_math.out.num_insts;
+    ir->capacity = fast_math.out.capacity;
+
+    psl_ir_free(ir, fast_math.leaves);
+    psl_ir_free(ir, fast_math.contractible);
+    psl_ir_free(ir, fast_math.remap);
+    psl_ir_free(ir, fast_math.users);
+    psl_ir_free(ir, fast_math.uses);
+}
+
+PSL_FORCE_INLINE bool psl_ir_is_commutative(PSL_IROpcode opcode)
+{
+    return opcode == PSL_IROpcode_Add || opcode == PSL_IROpcode_Mul;
+}
+
+/* FNV-1a over the fields identifying the value computed by inst */
+uint64_t psl_ir_inst_hash(const PSL_IRInst* inst)
+{
+    uint64_t words[PSL_IR_MAX_ARGS + 4];
+    uint32_t num_words = 0;
+
+    words[num_words++] = ((uint64_t)inst->opcode << 32) | (uint64_t)inst->type;
+    words[num_words++] = ((uint64_t)inst->num_args << 32) | (uint64_t)inst->index;
+    memcpy(&words[num_words++], &inst->constant, sizeof(double));
+
+    for(uint32_t i = 0; i < inst->num_args; i++)
+    {
+        words[num_words++] = inst->args[i];
+    }
+
+    uint64_t hash = 14695981039346656037ULL;
+
+    for(uint32_t i = 0; i < num_words; i++)
+    {
+        hash = (hash ^ words[i]) * 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+/* Constants are compared bitwise, so that 0.0 and -0.0 are kept apart */
+bool psl_ir_inst_equals(const PSL_IRInst* a, const PSL_IRInst* b)
+{
+    if(a->opcode != b->opcode ||
+       a->type != b->type ||
+       a->num_args != b->num_args ||
+       a->index != b->index ||
+       memcmp(&a->constant, &b->constant, sizeof(double)) != 0)
+    {
+        return false;
+    }
+
+    for(uint32_t i = 0; i < a->num_args; i++)
+    {
+        if(a->args[i] != b->args[i])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void psl_ir_eliminate_common_subexpressions(PSL_IR* ir)
+{
+    uint32_t capacity = 64;
+
+    while(capacity < ir->num_insts * 2)
+    {
+        capacity *= 2;
+    }
+
+    /* Open addressing table of the first instruction of each value */
+    uint32_t* table = (uint32_t*)psl_ir_alloc(ir, capacity * sizeof(uint32_t));
+    uint32_t* remap = (uint32_t*)psl_ir_alloc(ir, ir->num_insts * sizeof(uint32_t));
+
+    memset(table, 0xFF, capacity * sizeof(uint32_t));
+
+    for(uint32_t i = 0; i < ir->num_insts; i++)
+    {
+        PSL_IRInst* inst = &ir->insts[i];
+
+        remap[i] = i;
+
+        for(uint32_t j = 0; j < inst->num_args; j++)
+        {
+            inst->args[j] = remap[inst->args[j]];
+        }
+
+        if(inst->opcode == PSL_IROpcode_Store || inst->opcode == PSL_IROpcode_Reduce)
+        {
+            continue;
+        }
+
+        if(psl_ir_is_commutative(inst->opcode) && inst->args[0] > inst->args[1])
+        {
+            const uint32_t tmp = inst->args[0];
+            inst->args[0] = inst->args[1];
+            inst->args[1] = tmp;
+        }
+
+        uint32_t slot = (uint32_t)psl_ir_inst_hash(inst) & (capacity - 1);
+
+        while(table[slot] != PSL_IR_INVALID_VALUE && !psl_ir_inst_equals(&ir->insts[table[slot]], inst))
+        {
+            slot = (slot + 1) & (capacity - 1);
+        }
+
+        if(table[slot] == PSL_IR_INVALID_VALUE)
+        {
+            table[slot] = i;
+        }
+        else
+        {
+            remap[i] = table[slot];
+        }
+    }
+
+    psl_ir_free(ir, remap);
+    psl_ir_free(ir, table);
+}
+
+void psl_ir_drop_exports(PSL_IR* ir, uint64_t export_mask)
+{
+    for(uint32_t i = 0; i < ir->num_params; i++)
+    {
+        PSL_IRParam* param = &ir->params[i];
+
+        if((param->kind == PSL_IRParamKind_Export || param->kind == PSL_IRParamKind_Reduction) &&
+           param->index < 64 &&
+           (export_mask & ((uint64_t)1 << param->index)) == 0)
+        {
+            param->kind = PSL_IRParamKind_Dropped;
+        }
+    }
+}
+
+/* Stores and reductions are the roots of the IR, unless their export has been dropped */
+PSL_FORCE_INLINE bool psl_ir_is_root(PSL_IR* ir, const PSL_IRInst* inst)
+{
+    switch(inst->opcode)
+    {
+        case PSL_IROpcode_Store:
+            return psl_ir_find_column(ir, inst->index)->kind != PSL_IRParamKind_Dropped;
+        case PSL_IROpcode_Reduce:
+            return psl_ir_find_reduction(ir, inst->index) != NULL;
+        default:
+            return false;
+    }
+}
+
+void psl_ir_eliminate_dead_code(PSL_IR* ir)
+{
+    bool* live = (bool*)psl_ir_alloc_zeroed(ir, (ir->num_insts + 1) * sizeof(bool));
+    uint32_t* remap = (uint32_t*)psl_ir_alloc(ir, ir->num_insts * sizeof(uint32_t));
+
+    for(uint32_t i = ir->num_insts; i > 0; i--)
+    {
+        PSL_IRInst* inst = &ir->insts[i - 1];
+
+        if(psl_ir_is_root(ir, inst))
+        {
+            live[i - 1] = true;
+        }
+
+        if(!live[i - 1])
+        {
+            continue;
+        }
+
+        for(uint32_t j = 0; j < inst->num_args; j++)
+        {
+            live[inst->args[j]] = true;
+        }
+    }
+
+    uint32_t num_live = 0;
+
+    for(uint32_t i = 0; i < ir->num_insts; i++)
+    {
+        if(!live[i])
+        {
+            continue;
+        }
+
+        PSL_IRInst inst = ir->insts[i];
+
+        for(uint32_t j = 0; j < inst.num_args; j++)
+        {
+            inst.args[j] = remap[inst.args[j]];
+        }
+
+        remap[i] = num_live;
+        ir->insts[num_live++] = inst;
+    }
+
+    ir->num_insts = num_live;
+
+    for(uint32_t i = 0; i < ir->num_params; i++)
+    {
+        PSL_IRParam* param = &ir->params[i];
+
+        if(param->kind != PSL_IRParamKind_Input)
+        {
+            continue;
+        }
+
+        bool loaded = false;
+
+        for(uint32_t j = 0; j < ir->num_insts; j++)
+        {
+            loaded |= ir->insts[j].opcode == PSL_IROpcode_Load && ir->insts[j].index == param->index;
+        }
+
+        if(!loaded)
+        {
+            param->kind = PSL_IRParamKind_Dropped;
+        }
+    }
+
+    psl_ir_free(ir, remap);
+    psl_ir_free(ir, live);
+}
+
+void psl_ir_find_invariants(PSL_IR* ir, bool* invariant)
+{
+    for(uint32_t i = 0; i < ir->num_insts; i++)
+    {
+        PSL_IRInst* inst = &ir->insts[i];
+
+        switch(inst->opcode)
+        {
+            case PSL_IROpcode_Const:
+            case PSL_IROpcode_Uniform:
+                invariant[i] = true;
+                break;
+            case PSL_IROpcode_Load:
+            case PSL_IROpcode_Store:
+            case PSL_IROpcode_Reduce:
+                invariant[i] = false;
+                break;
+            default:
+                invariant[i] = true;
+
+                for(uint32_t j = 0; j < inst->num_args; j++)
+                {
+                    invariant[i] &= invariant[inst->args[j]];
+                }
+
+                break;
+        }
+    }
+}
+
+const char* psl_ir_opcode_to_string(PSL_IROpcode opcode)
+{
+    switch(opcode)
+    {
+        case PSL_IROpcode_Const:
+            return "const";
+        case PSL_IROpcode_Load:
+            return "load";
+        case PSL_IROpcode_Uniform:
+            return "uniform";
+        case PSL_IROpcode_Store:
+            return "store";
+        case PSL_IROpcode_Reduce:
+            return "reduce";
+        case PSL_IROpcode_Add:
+            return "add";
+        case PSL_IROpcode_Sub:
+            return "sub";
+        case PSL_IROpcode_Mul:
+            return "mul";
+        case PSL_IROpcode_Div:
+            return "div";
+        case PSL_IROpcode_Neg:
+            return "neg";
+        case PSL_IROpcode_Convert:
+            return "convert";
+        case PSL_IROpcode_Min:
+            return "min";
+        case PSL_IROpcode_Max:
+            return "max";
+        case PSL_IROpcode_Cmp:
+            return "cmp";
+        case PSL_IROpcode_Select:
+            return "select";
+        case PSL_IROpcode_Call:
+            return "call";
+        case PSL_IROpcode_Fma:
+            return "fma";
+        case PSL_IROpcode_Rcp:
+            return "rcp";
+        case PSL_IROpcode_Rsqrt:
+            return "rsqrt";
+        default:
+            return "unknown";
+    }
+}
+
+const char* psl_ir_reduce_op_to_string(PSL_IRReduceOp reduce_op)
+{
+    switch(reduce_op)
+    {
+        case PSL_IRReduceOp_Sum:
+            return "sum";
+        case PSL_IRReduceOp_Min:
+            return "min";
+        case PSL_IRReduceOp_Max:
+            return "max";
+        default:
+            return "unknown";
+    }
+}
+
+const char* psl_ir_cmp_to_string(PSL_IRCmp cmp)
+{
+    switch(cmp)
+    {
+        case PSL_IRCmp_Lt:
+            return "lt";
+        case PSL_IRCmp_Le:
+            return "le";
+        case PSL_IRCmp_Gt:
+            return "gt";
+        case PSL_IRCmp_Ge:
+            return "ge";
+        case PSL_IRCmp_Eq:
+            return "eq";
+        case PSL_IRCmp_Neq:
+            return "neq";
+        default:
+            return "unknown";
+    }
+}
+
+void psl_ir_print_inst(PSL_IR* ir, uint32_t value, FILE* file)
+{
+    PSL_IRInst* inst = &ir->insts[value];
+
+    fprintf(file,
+            "%%%u = %s %s",
+            value,
+            inst->type == PSL_IRType_F64 ? "f64" : "f32",
+            psl_ir_opcode_to_string(inst->opcode));
+
+    switch(inst->opcode)
+    {
+        case PSL_IROpcode_Const:
+            fprintf(file, " %f", inst->constant);
+            break;
+        case PSL_IROpcode_Load:
+        case PSL_IROpcode_Store:
+            fprintf(file, " column %u", inst->index);
+            break;
+        case PSL_IROpcode_Uniform:
+            fprintf(file, " %u", inst->index);
+            break;
+        case PSL_IROpcode_Reduce:
+            fprintf(file,
+                    " %s %u",
+                    psl_ir_reduce_op_to_string(psl_ir_find_reduction(ir, inst->index)->reduce_op),
+                    inst->index);
+            break;
+        case PSL_IROpcode_Call:
+            fprintf(file, " %s", psl_builtin_get((PSL_BuiltinID)inst->index)->name);
+            break;
+        case PSL_IROpcode_Cmp:
+            fprintf(file, " %s", psl_ir_cmp_to_string((PSL_IRCmp)inst->index));
+            break;
+        default:
+            break;
+    }
+
+    for(uint32_t j = 0; j < inst->num_args; j++)
+    {
+        fprintf(file, "%s%%%u", j == 0 ? " " : ", ", inst->args[j]);
+    }
+}
+
+void psl_ir_print(PSL_IR* ir)
+{
+    for(uint32_t i = 0; i < ir->num_insts; i++)
+    {
+        psl_ir_print_inst(ir, i, stdout);
+        printf("\n");
+    }
+}
+
+void psl_ir_destroy(PSL_IR* ir)
+{
+    psl_ir_free(ir, ir->insts);
+    psl_ir_free(ir, ir->params);
+    psl_ir_init(ir);
+}
@@ -0,0 +1,717 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#include "psl/kernel.h"
+#include "psl/codeheap.h"
+#include "psl/counters.h"
+#include "psl/perf.h"
+#include "psl/profile.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(PSL_MSVC)
+#include <Windows.h>
+#endif /* defined(PSL_MSVC) */
+
+/* Above this many columns, the tail scratch columns are allocated on the heap */
+#define PSL_KERNEL_TAIL_STACK_COLUMNS 32
+
+/* Above this many reductions, the partials are allocated on the heap */
+#define PSL_KERNEL_STACK_REDUCTIONS 16
+
+/* Default bytes of exports above which they are streamed to memory, larger than most last level caches */
+#define PSL_KERNEL_STREAMING_THRESHOLD ((size_t)64 << 20)
+
+void psl_compile_options_init(PSL_CompileOptions* options)
+{
+    options->specializations = NULL;
+    options->num_specializations = 0;
+    options->column_formats = NULL;
+    options->num_column_formats = 0;
+    options->fast_math = 0;
+    options->unroll = 0;
+    options->opt_level = PSL_OptLevel_2;
+}
+
+void psl_execute_options_init(PSL_ExecuteOptions* options)
+{
+    options->streaming_threshold = PSL_KERNEL_STREAMING_THRESHOLD;
+    options->prefetch_distance = 0;
+}
+
+PSL_Kernel* psl_kernel_new()
+{
+    PSL_Kernel* kernel = (PSL_Kernel*)malloc(sizeof(PSL_Kernel));
+    kernel->name[0] = '\0';
+    psl_ir_init(&kernel->ir);
+    kernel->func = NULL;
+    kernel->code = NULL;
+    kernel->code_size = 0;
+    kernel->error = NULL;
+    kernel->export_mask = 0;
+    psl_codegen_options_init(&kernel->codegen);
+    kernel->variants = NULL;
+    kernel->counters = NULL;
+
+    return kernel;
+}
+
+/* Emits the code of the optimized IR of the kernel through buffer, a temporary one if NULL */
+bool psl_kernel_emit(PSL_Kernel* kernel, PSL_CodeBuffer* buffer)
+{
+    PSL_CodeBuffer temporary;
+
+    if(buffer == NULL)
+    {
+        psl_code_buffer_init(&temporary, 4096);
+        buffer = &temporary;
+    }
+
+    buffer->size = 0;
+
+    /* Source lines are only needed by the jitdump */
+    PSL_CodeMap map;
+    psl_code_map_init(&map);
+
+    PSL_CodeMap* lines = (psl_perf_outputs() & PSL_PerfOutput_JitDump) != 0 ? &map : NULL;
+
+    const bool emitted = psl_codegen_emit(&kernel->ir, &kernel->codegen, buffer, lines, &kernel->error);
+
+    if(emitted)
+    {
+        kernel->code = psl_code_heap_alloc(buffer->data, buffer->size);
+        kernel->code_size = buffer->size;
+
+        psl_profile_alloc(buffer->size);
+        psl_profile_counts(0, kernel->ir.num_insts, buffer->size);
+    }
+
+    if(buffer == &temporary)
+    {
+        psl_code_buffer_destroy(&temporary);
+    }
+
+    if(!emitted)
+    {
+        psl_code_map_destroy(&map);
+        return false;
+    }
+
+    if(kernel->code == NULL)
+    {
+        psl_code_map_destroy(&map);
+        kernel->error = "Cannot allocate executable memory";
+        return false;
+    }
+
+    psl_perf_register(kernel->name, kernel->code, kernel->code_size, &kernel->ir, lines);
+    psl_code_map_destroy(&map);
+
+    kernel->func = (PSL_KernelFunc)kernel->code;
+    kernel->export_mask = 0;
+
+    for(uint32_t i = 0; i < kernel->ir.num_params; i++)
+    {
+        const PSL_IRParam* param = &kernel->ir.params[i];
+
+        if((param->kind == PSL_IRParamKind_Export || param->kind == PSL_IRParamKind_Reduction) && param->index < 64)
+        {
+            kernel->export_mask |= (uint64_t)1 << param->index;
+        }
+    }
+
+    return true;
+}
+
+bool psl_kernel_compile(PSL_Kernel* kernel,
+                        PSL_AST* ast,
+                        const char* entry_point,
+                        const PSL_CompileOptions* options)
+{
+    PSL_EntryPoint entry;
+    entry.ast = ast;
+    entry.name = entry_point;
+
+    return psl_kernel_compile_fused(kernel, &entry, 1, options);
+}
+
+/* Names the kernel after its entry points, truncated to PSL_KERNEL_NAME_SIZE */
+void psl_kernel_set_name(PSL_Kernel* kernel, const PSL_EntryPoint* entry_points, uint32_t num_entry_points)
+{
+    size_t length = 0;
+
+    for(uint32_t i = 0; i < num_entry_points; i++)
+    {
+        PSL_ASTSource* source = PSL_AST_CAST(PSL_ASTSource, entry_points[i].ast->root);
+        PSL_ASTFunction* main = psl_ir_find_entry_point(source, entry_points[i].name);
+
+        const int written = snprintf(kernel->name + length,
+                                     PSL_KERNEL_NAME_SIZE - length,
+                                     "%s%.*s",
+                                     i == 0 ? "" : "+",
+                                     (int)main->name_length,
+                                     main->name);
+
+        length += written > 0 ? (size_t)written : 0;
+
+        if(length >= PSL_KERNEL_NAME_SIZE)
+        {
+            break;
+        }
+    }
+}
+
+/* Lowers, optimizes and emits the entry points, the arrays of the IR come from kernel->ir.scratch when set */
+bool psl_kernel_compile_pipeline(PSL_Kernel* kernel,
+                                 const PSL_EntryPoint* entry_points,
+                                 uint32_t num_entry_points,
+                                 const PSL_CompileOptions* options,
+                                 PSL_CodeBuffer* buffer)
+{
+    PSL_ProfileScope scope;
+    psl_profile_phase_begin(&scope);
+
+    const bool lowered = psl_ir_from_entry_points(&kernel->ir, entry_points, num_entry_points);
+
+    psl_profile_phase_end(&scope, PSL_CompilePhase_Lower);
+
+    if(!lowered)
+    {
+        kernel->error = kernel->ir.error;
+        return false;
+    }
+
+    psl_kernel_set_name(kernel, entry_points, num_entry_points);
+
+    const PSL_OptLevel opt_level = options != NULL ? options->opt_level : PSL_OptLevel_2;
+
+    if(options != NULL)
+    {
+        /* Below level 2 the loop body is emitted once unless unrolling is forced, a fraction of the code to encode */
+        kernel->codegen.unroll = options->unroll == 0 && opt_level < PSL_OptLevel_2 ? 1 : options->unroll;
+
+        psl_profile_phase_begin(&scope);
+
+        for(uint32_t i = 0; i < options->num_specializations; i++)
+        {
+            if(!psl_ir_specialize(&kernel->ir,
+                                  options->specializations[i].name,
+                                  options->specializations[i].value))
+            {
+                kernel->error = kernel->ir.error;
+                return false;
+            }
+        }
+
+        for(uint32_t i = 0; i < options->num_column_formats; i++)
+        {
+            if(!psl_ir_set_column_format(&kernel->ir,
+                                         options->column_formats[i].name,
+                                         options->column_formats[i].format))
+            {
+                kernel->error = kernel->ir.error;
+                return false;
+            }
+        }
+
+        psl_profile_phase_end(&scope, PSL_CompilePhase_Specialize);
+    }
+
+    if(opt_level >= PSL_OptLevel_1)
+    {
+        psl_profile_phase_begin(&scope);
+        psl_ir_fold_constants(&kernel->ir);
+        psl_profile_phase_end(&scope, PSL_CompilePhase_FoldConstants);
+    }
+
+    if(opt_level >= PSL_OptLevel_2)
+    {
+        psl_profile_phase_begin(&scope);
+        psl_ir_eliminate_common_subexpressions(&kernel->ir);
+        psl_profile_phase_end(&scope, PSL_CompilePhase_CSE);
+    }
+
+    if(opt_level >= PSL_OptLevel_1)
+    {
+        psl_profile_phase_begin(&scope);
+        psl_ir_eliminate_dead_code(&kernel->ir);
+        psl_profile_phase_end(&scope, PSL_CompilePhase_DCE);
+    }
+
+    if(opt_level >= PSL_OptLevel_2 && options != NULL && options->fast_math != 0)
+    {
+        /* Rewrites rely on use counts of live values, and leave the replaced ones dead */
+        psl_profile_phase_begin(&scope);
+        psl_ir_fast_math(&kernel->ir, options->fast_math);
+        psl_profile_phase_end(&scope, PSL_CompilePhase_FastMath);
+
+        psl_profile_phase_begin(&scope);
+        psl_ir_eliminate_dead_code(&kernel->ir);
+        psl_profile_phase_end(&scope, PSL_CompilePhase_DCE);
+    }
+
+    if(!psl_kernel_emit(kernel, buffer))
+    {
+        return false;
+    }
+
+    psl_kernel_counters_init(kernel);
+
+    return true;
+}
+
+bool psl_kernel_compile_fused(PSL_Kernel* kernel,
+                              const PSL_EntryPoint* entry_points,
+                              uint32_t num_entry_points,
+                              const PSL_CompileOptions* options)
+{
+    return psl_kernel_compile_pipeline(kernel, entry_points, num_entry_points, options, NULL);
+}
+
+bool psl_kernel_compile_with_buffers(PSL_Kernel* kernel,
+                                     const PSL_EntryPoint* entry_points,
+                                     uint32_t num_entry_points,
+                                     const PSL_CompileOptions* options,
+                                     Arena* scratch,
+                                     PSL_CodeBuffer* buffer)
+{
+    const ArenaMark mark = psl_arena_mark(scratch);
+
+    kernel->ir.scratch = scratch;
+
+    const bool success = psl_kernel_compile_pipeline(kernel, entry_points, num_entry_points, options, buffer);
+
+    /* The kernel keeps a copy of its optimized IR, everything else is released with the scratch */
+    if(success)
+    {
+        const PSL_IR ir = kernel->ir;
+        psl_ir_copy(&kernel->ir, &ir);
+    }
+    else
+    {
+        psl_ir_init(&kernel->ir);
+    }
+
+    psl_arena_rollback(scratch, &mark);
+
+    return success;
+}
+
+bool psl_kernel_compile_ir(PSL_Kernel* kernel)
+{
+    if(!psl_kernel_emit(kernel, NULL))
+    {
+        return false;
+    }
+
+    psl_kernel_counters_init(kernel);
+
+    return true;
+}
+
+PSL_FORCE_INLINE bool psl_kernel_codegen_equals(const PSL_CodegenOptions* a, const PSL_CodegenOptions* b)
+{
+    return a->unroll == b->unroll && a->streaming == b->streaming && a->prefetch_distance == b->prefetch_distance;
+}
+
+/*
+   Variants are published at the head of the list with a compare and swap, and never unlinked until
+   the kernel is destroyed, so that executions on other threads can look them up without a lock
+*/
+PSL_FORCE_INLINE PSL_Kernel* psl_kernel_load_variants(PSL_Kernel* kernel)
+{
+#if defined(PSL_MSVC)
+    return (PSL_Kernel*)InterlockedCompareExchangePointer((PVOID volatile*)&kernel->variants, NULL, NULL);
+#else
+    return __atomic_load_n(&kernel->variants, __ATOMIC_ACQUIRE);
+#endif /* defined(PSL_MSVC) */
+}
+
+PSL_FORCE_INLINE bool psl_kernel_publish_variant(PSL_Kernel* kernel, PSL_Kernel* head, PSL_Kernel* variant)
+{
+#if defined(PSL_MSVC)
+    return InterlockedCompareExchangePointer((PVOID volatile*)&kernel->variants, variant, head) == head;
+#else
+    return __atomic_compare_exchange_n(&kernel->variants, &head, variant, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+#endif /* defined(PSL_MSVC) */
+}
+
+/* Returns the variant matching export_mask and codegen from first up to last excluded, NULL if there is none */
+PSL_Kernel* psl_kernel_scan_variants(PSL_Kernel* first, PSL_Kernel* last, uint64_t export_mask, const PSL_CodegenOptions* codegen)
+{
+    for(PSL_Kernel* variant = first; variant != last; variant = variant->variants)
+    {
+        if(variant->export_mask == export_mask && psl_kernel_codegen_equals(codegen, &variant->codegen))
+        {
+            return variant;
+        }
+    }
+
+    return NULL;
+}
+
+/* Returns the variant writing the exports of export_mask emitted with codegen, compiled on first use */
+PSL_Kernel* psl_kernel_find_variant(PSL_Kernel* kernel, uint64_t export_mask, const PSL_CodegenOptions* codegen)
+{
+    if(export_mask == kernel->export_mask && psl_kernel_codegen_equals(codegen, &kernel->codegen))
+    {
+        return kernel;
+    }
+
+    PSL_ProfileScope scope;
+    psl_profile_phase_begin(&scope);
+
+    PSL_Kernel* head = psl_kernel_load_variants(kernel);
+    PSL_Kernel* variant = psl_kernel_scan_variants(head, NULL, export_mask, codegen);
+
+    psl_profile_phase_end(&scope, PSL_CompilePhase_CacheLookup);
+
+    if(variant != NULL)
+    {
+        return variant;
+    }
+
+    /* The IR of the kernel is already optimized, dropping exports only leaves dead code behind */
+    variant = psl_kernel_new();
+    psl_ir_copy(&variant->ir, &kernel->ir);
+    variant->codegen = *codegen;
+    memcpy(variant->name, kernel->name, PSL_KERNEL_NAME_SIZE);
+    psl_ir_drop_exports(&variant->ir, export_mask);
+
+    psl_profile_phase_begin(&scope);
+    psl_ir_eliminate_dead_code(&variant->ir);
+    psl_profile_phase_end(&scope, PSL_CompilePhase_DCE);
+
+    if(!psl_kernel_emit(variant, NULL))
+    {
+        kernel->error = variant->error;
+        psl_kernel_destroy(variant);
+        return NULL;
+    }
+
+    while(true)
+    {
+        variant->variants = head;
+
+        if(psl_kernel_publish_variant(kernel, head, variant))
+        {
+            return variant;
+        }
+
+        /* Another thread published variants meanwhile, one of them may be the same */
+        PSL_Kernel* current = psl_kernel_load_variants(kernel);
+        PSL_Kernel* concurrent = psl_kernel_scan_variants(current, head, export_mask, codegen);
+
+        if(concurrent != NULL)
+        {
+            variant->variants = NULL;
+            psl_kernel_destroy(variant);
+            return concurrent;
+        }
+
+        head = current;
+    }
+}
+
+PSL_Kernel* psl_kernel_variant(PSL_Kernel* kernel, uint64_t export_mask)
+{
+    PSL_ASSERT(kernel->func != NULL, "Kernel has not been compiled");
+
+    return psl_kernel_find_variant(kernel, export_mask & kernel->export_mask, &kernel->codegen);
+}
+
+bool psl_kernel_prepare(PSL_Kernel* kernel, const PSL_ExecuteOptions* options)
+{
+    PSL_ASSERT(kernel->func != NULL, "Kernel has not been compiled");
+
+    PSL_CodegenOptions codegen = kernel->codegen;
+    codegen.prefetch_distance = options->prefetch_distance;
+
+    bool success = psl_kernel_find_variant(kernel, kernel->export_mask, &codegen) != NULL;
+
+    if(options->streaming_threshold != 0)
+    {
+        codegen.streaming = true;
+        success &= psl_kernel_find_variant(kernel, kernel->export_mask, &codegen) != NULL;
+    }
+
+    return success;
+}
+
+/*
+   The generated loop only processes full vectors, the remaining elements are copied into
+   scratch columns padded to PSL_LANES, processed, and the exports copied back. The partials of
+   the reductions then hold one lane per element
+*/
+void psl_kernel_execute_tail(PSL_Kernel* kernel,
+                             const PSL_Bindings* bindings,
+                             void* partials,
+                             size_t start,
+                             size_t count)
+{
+    const uint32_t num_columns = kernel->ir.num_columns;
+
+    /* Sized for the widest type */
+    double stack_scratch[PSL_KERNEL_TAIL_STACK_COLUMNS * PSL_LANES];
+    void* stack_columns[PSL_KERNEL_TAIL_STACK_COLUMNS];
+
+    double* scratch = stack_scratch;
+    void** columns = stack_columns;
+
+    if(num_columns > PSL_KERNEL_TAIL_STACK_COLUMNS)
+    {
+        scratch = (double*)malloc(num_columns * PSL_LANES * sizeof(double));
+        columns = (void**)malloc(num_columns * sizeof(void*));
+    }
+
+    memset(scratch, 0, num_columns * PSL_LANES * sizeof(double));
+
+    for(uint32_t i = 0; i < kernel->ir.num_params; i++)
+    {
+        const PSL_IRParam* param = &kernel->ir.params[i];
+
+        if(param->kind == PSL_IRParamKind_Uniform)
+        {
+            continue;
+        }
+
+        const size_t element_size = psl_column_format_size(param->format);
+
+        columns[param->index] = scratch + param->index * PSL_LANES;
+
+        if(param->kind == PSL_IRParamKind_Input)
+        {
+            memcpy(columns[param->index],
+                   (uint8_t*)bindings->columns[param->index] + start * element_size,
+                   count * element_size);
+        }
+    }
+
+    PSL_KernelArgs args;
+    args.columns = columns;
+    args.uniforms = bindings->uniforms;
+    args.count = PSL_LANES;
+    args.partials = partials;
+
+    kernel->func(&args);
+
+    for(uint32_t i = 0; i < kernel->ir.num_params; i++)
+    {
+        const PSL_IRParam* param = &kernel->ir.params[i];
+
+        if(param->kind == PSL_IRParamKind_Export)
+        {
+            const size_t element_size = psl_column_format_size(param->format);
+
+            memcpy((uint8_t*)bindings->columns[param->index] + start * element_size,
+                   columns[param->index],
+                   count * element_size);
+        }
+    }
+
+    if(num_columns > PSL_KERNEL_TAIL_STACK_COLUMNS)
+    {
+        free(scratch);
+        free(columns);
+    }
+}
+
+PSL_FORCE_INLINE double psl_kernel_reduce(PSL_IRReduceOp op, double a, double b)
+{
+    switch(op)
+    {
+        case PSL_IRReduceOp_Min:
+            return b < a ? b : a;
+        case PSL_IRReduceOp_Max:
+            return b > a ? b : a;
+        default:
+            return a + b;
+    }
+}
+
+/* Sets the result of every reduction to the identity of its aggregate */
+void psl_kernel_reset_reductions(PSL_Kernel* kernel, const PSL_Bindings* bindings)
+{
+    for(uint32_t i = 0; i < kernel->ir.num_params; i++)
+    {
+        const PSL_IRParam* param = &kernel->ir.params[i];
+
+        if(param->kind != PSL_IRParamKind_Reduction)
+        {
+            continue;
+        }
+
+        double identity = 0.0;
+
+        if(param->reduce_op != PSL_IRReduceOp_Sum)
+        {
+            identity = param->reduce_op == PSL_IRReduceOp_Min ? INFINITY : -INFINITY;
+        }
+
+        if(param->type == PSL_IRType_F64)
+        {
+            *(double*)bindings->columns[param->index] = identity;
+        }
+        else
+        {
+            *(float*)bindings->columns[param->index] = (float)identity;
+        }
+    }
+}
+
+/*
+   Combines the first count lanes of the partials of every reduction into its result. Lanes are
+   combined in order, in the precision of the reduction, so results only depend on the data
+*/
+void psl_kernel_merge_partials(PSL_Kernel* kernel, const PSL_Bindings* bindings, const double* partials, size_t count)
+{
+    for(uint32_t i = 0; i < kernel->ir.num_params; i++)
+    {
+        const PSL_IRParam* param = &kernel->ir.params[i];
+
+        if(param->kind != PSL_IRParamKind_Reduction)
+        {
+            continue;
+        }
+
+        const double* lanes = partials + param->reduction * PSL_LANES;
+
+        if(param->type == PSL_IRType_F64)
+        {
+            double* result = (double*)bindings->columns[param->index];
+
+            for(size_t j = 0; j < count; j++)
+            {
+                *result = psl_kernel_reduce(param->reduce_op, *result, lanes[j]);
+            }
+        }
+        else
+        {
+            float* result = (float*)bindings->columns[param->index];
+
+            for(size_t j = 0; j < count; j++)
+            {
+                /* Exact in double, so the rounding is the one of the f32 operation */
+                *result = (float)psl_kernel_reduce(param->reduce_op, *result, ((const float*)lanes)[j]);
+            }
+        }
+    }
+}
+
+/* Whether the f32 and f64 exports are written with non-temporal stores, which needs them aligned */
+bool psl_kernel_use_streaming(PSL_Kernel* kernel, const PSL_Bindings* bindings, size_t count, size_t threshold)
+{
+    if(threshold == 0)
+    {
+        return false;
+    }
+
+    size_t streamed_size = 0;
+
+    for(uint32_t i = 0; i < kernel->ir.num_params; i++)
+    {
+        const PSL_IRParam* param = &kernel->ir.params[i];
+
+        if(param->kind != PSL_IRParamKind_Export ||
+           (param->format != PSL_ColumnFormat_F32 && param->format != PSL_ColumnFormat_F64))
+        {
+            continue;
+        }
+
+        if(((uintptr_t)bindings->columns[param->index] & 31) != 0)
+        {
+            return false;
+        }
+
+        streamed_size += count * psl_column_format_size(param->format);
+    }
+
+    return streamed_size >= threshold;
+}
+
+void psl_kernel_execute(PSL_Kernel* kernel, const PSL_Bindings* bindings, size_t count)
+{
+    PSL_ExecuteOptions options;
+    psl_execute_options_init(&options);
+
+    psl_kernel_execute_with_options(kernel, bindings, count, &options);
+}
+
+void psl_kernel_execute_with_options(PSL_Kernel* kernel,
+                                     const PSL_Bindings* bindings,
+                                     size_t count,
+                                     const PSL_ExecuteOptions* options)
+{
+    psl_kernel_reset_reductions(kernel, bindings);
+    psl_kernel_accumulate(kernel, bindings, count, options);
+}
+
+void psl_kernel_accumulate(PSL_Kernel* kernel,
+                           const PSL_Bindings* bindings,
+                           size_t count,
+                           const PSL_ExecuteOptions* options)
+{
+    PSL_ASSERT(kernel->func != NULL, "Kernel has not been compiled");
+
+    const uint64_t start = psl_kernel_counters_begin(kernel);
+
+    const uint32_t num_reductions = kernel->ir.num_reductions;
+
+    double stack_partials[PSL_KERNEL_STACK_REDUCTIONS * PSL_LANES];
+    double* partials = stack_partials;
+
+    if(num_reductions > PSL_KERNEL_STACK_REDUCTIONS)
+    {
+        partials = (double*)malloc(num_reductions * PSL_LANES * sizeof(double));
+    }
+
+    PSL_KernelArgs args;
+    args.columns = bindings->columns;
+    args.uniforms = bindings->uniforms;
+    args.count = count - (count % PSL_LANES);
+    args.partials = partials;
+
+    if(args.count > 0)
+    {
+        PSL_CodegenOptions codegen = kernel->codegen;
+        codegen.streaming = psl_kernel_use_streaming(kernel, bindings, args.count, options->streaming_threshold);
+        codegen.prefetch_distance = options->prefetch_distance;
+
+        /* Falls back to the kernel itself if the variant cannot be compiled */
+        PSL_Kernel* loop = psl_kernel_find_variant(kernel, kernel->export_mask, &codegen);
+
+        (loop != NULL ? loop : kernel)->func(&args);
+        psl_kernel_merge_partials(kernel, bindings, partials, PSL_LANES);
+    }
+
+    /* The scratch columns of the tail are not aligned for non-temporal stores */
+    if(args.count < count)
+    {
+        psl_kernel_execute_tail(kernel, bindings, partials, args.count, count - args.count);
+        psl_kernel_merge_partials(kernel, bindings, partials, count - args.count);
+    }
+
+    if(num_reductions > PSL_KERNEL_STACK_REDUCTIONS)
+    {
+        free(partials);
+    }
+
+    psl_kernel_counters_end(kernel, start, count, args.count < count);
+}
+
+void psl_kernel_destroy(PSL_Kernel* kernel)
+{
+    if(kernel != NULL)
+    {
+        psl_code_heap_free(kernel->code, kernel->code_size);
+
+        psl_kernel_counters_release(kernel);
+        psl_ir_destroy(&kernel->ir);
+        psl_kernel_destroy(kernel->variants);
+
+        free(kernel);
+    }
+}
@@ -3,6 +3,7 @@
 /* All rights reserved. */
 
 #include "psl/lexer.h"
+#include "psl/profile.h"
 
 #include "libromano/hashmap.h"
 #include "libromano/logger.h"
@@ -25,10 +26,20 @@ void psl_lexer_init_keywords_table()
     hashmap_insert(_keywords_table, "f32", 3, &value, sizeof(uint32_t));
     value = (uint32_t)PSL_KeywordType_f64;
     hashmap_insert(_keywords_table, "f64", 3, &value, sizeof(uint32_t));
+    value = (uint32_t)PSL_KeywordType_Vec2;
+    hashmap_insert(_keywords_table, "vec2", 4, &value, sizeof(uint32_t));
+    value = (uint32_t)PSL_KeywordType_Vec3;
+    hashmap_insert(_keywords_table, "vec3", 4, &value, sizeof(uint32_t));
+    value = (uint32_t)PSL_KeywordType_Vec4;
+    hashmap_insert(_keywords_table, "vec4", 4, &value, sizeof(uint32_t));
     value = (uint32_t)PSL_KeywordType_Main;
     hashmap_insert(_keywords_table, "main", 4, &value, sizeof(uint32_t));
     value = (uint32_t)PSL_KeywordType_Export;
     hashmap_insert(_keywords_table, "export", 6, &value, sizeof(uint32_t));
+    value = (uint32_t)PSL_KeywordType_Uniform;
+    hashmap_insert(_keywords_table, "uniform", 7, &value, sizeof(uint32_t));
+    value = (uint32_t)PSL_KeywordType_Reduce;
+    hashmap_insert(_keywords_table, "reduce", 6, &value, sizeof(uint32_t));
     value = (uint32_t)PSL_KeywordType_Return;
     hashmap_insert(_keywords_table, "return", 6, &value, sizeof(uint32_t));
 }
@@ -266,7 +277,24 @@ PSL_Token lexer_scan_token(PSL_Lexer* lexer)
         case '+':
         case '/':
         case '*': return lexer_make_token(lexer, PSL_TokenType_Operator, 0);
-        case '=': return lexer_make_token(lexer, PSL_TokenType_Assign, 0);
+        case '?': return lexer_make_token(lexer, PSL_TokenType_Question, 0);
+        case ':': return lexer_make_token(lexer, PSL_TokenType_Colon, 0);
+        case '.': return lexer_make_token(lexer, PSL_TokenType_Dot, 0);
+        case '<':
+        case '>':
+            lexer_match_char(lexer, '=');
+            return lexer_make_token(lexer, PSL_TokenType_Operator, 0);
+        case '=':
+            return lexer_make_token(lexer,
+                                    lexer_match_char(lexer, '=') ? PSL_TokenType_Operator : PSL_TokenType_Assign,
+                                    0);
+        case '!':
+            if(lexer_match_char(lexer, '='))
+            {
+                return lexer_make_token(lexer, PSL_TokenType_Operator, 0);
+            }
+
+            break;
     }
 
     return lexer_make_error_token(lexer, "Unexpected character");
@@ -282,21 +310,31 @@ void psl_lexer_init(PSL_Lexer* lexer, const char* source)
 
 bool psl_lexer_lex(PSL_Lexer* lexer, Vector* tokens)
 {
+    PSL_ProfileScope scope;
+    psl_profile_phase_begin(&scope);
+
+    uint32_t num_tokens = 0;
+    bool success = true;
+
     while(true)
     {
         PSL_Token token = lexer_scan_token(lexer);
         vector_push_back(tokens, &token);
+        num_tokens++;
 
-        switch(token.type)
+        if(token.type == PSL_TokenType_Eof || token.type == PSL_TokenType_Error)
         {
-            case PSL_TokenType_Eof:
-                return true;
-            case PSL_TokenType_Error:
-                return false;
-            default:
-                break;
+            success = token.type == PSL_TokenType_Eof;
+            break;
         }
     }
+
+    /* Tokens are stored by the vector, its growth policy is not visible from here */
+    psl_profile_alloc(num_tokens * sizeof(PSL_Token));
+    psl_profile_counts(num_tokens, 0, 0);
+    psl_profile_phase_end(&scope, PSL_CompilePhase_Lex);
+
+    return success;
 }
 
 const char* psl_token_type_to_string(PSL_TokenType type)
@@ -329,6 +367,12 @@ const char* psl_token_type_to_string(PSL_TokenType type)
             return "COMMA";
         case PSL_TokenType_Semicolon:
             return "SEMICOLON";
+        case PSL_TokenType_Question:
+            return "QUESTION";
+        case PSL_TokenType_Colon:
+            return "COLON";
+        case PSL_TokenType_Dot:
+            return "DOT";
         default:
             return "UNKNOWN";
     }
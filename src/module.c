@@ -0,0 +1,656 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#include "psl/module.h"
+#include "psl/profile.h"
+
+#include "libromano/hashmap.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(PSL_WIN)
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif /* defined(PSL_WIN) */
+
+/* Records are read in place, every offset is aligned on the one of the doubles of the instructions */
+#define PSL_MODULE_ALIGNMENT 8
+
+/* Returns the offset of string in the string table, adding it if it is not there yet */
+uint32_t psl_module_intern(PSL_CodeBuffer* strings, HashMap* interned, const char* string, uint32_t length)
+{
+    uint32_t* existing = (uint32_t*)hashmap_get(interned, string, length, NULL);
+
+    if(existing != NULL)
+    {
+        return *existing;
+    }
+
+    uint32_t offset = (uint32_t)strings->size;
+
+    for(uint32_t i = 0; i < length; i++)
+    {
+        psl_code_buffer_emit8(strings, (uint8_t)string[i]);
+    }
+
+    psl_code_buffer_emit8(strings, 0);
+
+    hashmap_insert(interned, string, length, &offset, sizeof(uint32_t));
+
+    return offset;
+}
+
+bool psl_module_write_kernel(FILE* file, const PSL_IR* ir, const uint32_t* param_names)
+{
+    for(uint32_t i = 0; i < ir->num_insts; i++)
+    {
+        const PSL_IRInst* inst = &ir->insts[i];
+
+        PSL_ModuleInst record;
+        memset(&record, 0, sizeof(PSL_ModuleInst));
+        record.opcode = (uint8_t)inst->opcode;
+        record.type = (uint8_t)inst->type;
+        record.num_args = (uint8_t)inst->num_args;
+        memcpy(record.args, inst->args, sizeof(record.args));
+        record.index = inst->index;
+        record.line = inst->line;
+        record.constant = inst->constant;
+
+        if(fwrite(&record, sizeof(PSL_ModuleInst), 1, file) != 1)
+        {
+            return false;
+        }
+    }
+
+    for(uint32_t i = 0; i < ir->num_params; i++)
+    {
+        const PSL_IRParam* param = &ir->params[i];
+
+        PSL_ModuleParam record;
+        memset(&record, 0, sizeof(PSL_ModuleParam));
+        record.name = param_names[i];
+        record.name_length = param->name_length;
+        record.kind = (uint8_t)param->kind;
+        record.type = (uint8_t)param->type;
+        record.format = (uint8_t)param->format;
+        record.reduce_op = (uint8_t)param->reduce_op;
+        record.index = param->index;
+        record.reduction = param->reduction;
+        record.component = param->component;
+
+        if(fwrite(&record, sizeof(PSL_ModuleParam), 1, file) != 1)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool psl_module_save(PSL_Kernel** kernels, uint32_t num_kernels, const char* path, char** error)
+{
+    uint32_t num_params = 0;
+
+    for(uint32_t i = 0; i < num_kernels; i++)
+    {
+        if(kernels[i]->code == NULL)
+        {
+            *error = "Cannot save a kernel that has not been compiled";
+            return false;
+        }
+
+        num_params += kernels[i]->ir.num_params;
+    }
+
+    PSL_CodeBuffer strings;
+    psl_code_buffer_init(&strings, 256);
+
+    HashMap* interned = hashmap_new(64);
+
+    PSL_ModuleKernel* records = (PSL_ModuleKernel*)calloc(num_kernels + 1, sizeof(PSL_ModuleKernel));
+    uint32_t* param_names = (uint32_t*)malloc(num_params * sizeof(uint32_t) + 1);
+
+    /* Records of the instructions and parameters follow the ones of the kernels, in order */
+    uint64_t offset = sizeof(PSL_ModuleHeader) + num_kernels * sizeof(PSL_ModuleKernel);
+    uint32_t num_names = 0;
+
+    for(uint32_t i = 0; i < num_kernels; i++)
+    {
+        const PSL_Kernel* kernel = kernels[i];
+
+        records[i].name = psl_module_intern(&strings, interned, kernel->name, (uint32_t)strlen(kernel->name));
+        records[i].num_insts = kernel->ir.num_insts;
+        records[i].num_params = kernel->ir.num_params;
+        records[i].num_columns = kernel->ir.num_columns;
+        records[i].num_uniforms = kernel->ir.num_uniforms;
+        records[i].num_reductions = kernel->ir.num_reductions;
+        records[i].unroll = kernel->codegen.unroll;
+        records[i].insts_offset = offset;
+
+        offset += kernel->ir.num_insts * sizeof(PSL_ModuleInst);
+
+        records[i].params_offset = offset;
+
+        offset += kernel->ir.num_params * sizeof(PSL_ModuleParam);
+
+        for(uint32_t j = 0; j < kernel->ir.num_params; j++)
+        {
+            param_names[num_names++] = psl_module_intern(&strings,
+                                                         interned,
+                                                         kernel->ir.params[j].name,
+                                                         kernel->ir.params[j].name_length);
+        }
+    }
+
+    PSL_ModuleHeader header;
+    memset(&header, 0, sizeof(PSL_ModuleHeader));
+    header.magic = PSL_MODULE_MAGIC;
+    header.version = PSL_MODULE_VERSION;
+    header.num_kernels = num_kernels;
+    header.strings_size = (uint32_t)strings.size;
+    header.size = offset + strings.size;
+    header.strings_offset = offset;
+
+    bool success = true;
+
+    FILE* file = fopen(path, "wb");
+
+    if(file == NULL)
+    {
+        *error = "Cannot open the module file";
+        success = false;
+    }
+    else
+    {
+        success = fwrite(&header, sizeof(PSL_ModuleHeader), 1, file) == 1 &&
+                  fwrite(records, sizeof(PSL_ModuleKernel), num_kernels, file) == num_kernels;
+
+        num_names = 0;
+
+        for(uint32_t i = 0; success && i < num_kernels; i++)
+        {
+            success = psl_module_write_kernel(file, &kernels[i]->ir, param_names + num_names);
+            num_names += kernels[i]->ir.num_params;
+        }
+
+        success = success && fwrite(strings.data, 1, strings.size, file) == strings.size;
+        success &= fclose(file) == 0;
+
+        if(!success)
+        {
+            *error = "Cannot write the module file";
+        }
+    }
+
+    free(param_names);
+    free(records);
+    hashmap_free(interned);
+    psl_code_buffer_destroy(&strings);
+
+    return success;
+}
+
+/* Checks that count records of size bytes at offset lie in the module */
+PSL_FORCE_INLINE bool psl_module_check_range(const PSL_ModuleHeader* header, uint64_t offset, uint64_t count, size_t size)
+{
+    return offset % PSL_MODULE_ALIGNMENT == 0 &&
+           offset <= header->strings_offset &&
+           count <= (header->strings_offset - offset) / size;
+}
+
+PSL_FORCE_INLINE uint32_t psl_module_num_args(const PSL_ModuleInst* inst)
+{
+    switch(inst->opcode)
+    {
+        case PSL_IROpcode_Const:
+        case PSL_IROpcode_Load:
+        case PSL_IROpcode_Uniform:
+            return 0;
+        case PSL_IROpcode_Store:
+        case PSL_IROpcode_Reduce:
+        case PSL_IROpcode_Neg:
+        case PSL_IROpcode_Convert:
+        case PSL_IROpcode_Rcp:
+        case PSL_IROpcode_Rsqrt:
+            return 1;
+        case PSL_IROpcode_Select:
+        case PSL_IROpcode_Fma:
+            return 3;
+        case PSL_IROpcode_Call:
+            return psl_builtin_get((PSL_BuiltinID)inst->index)->num_arguments;
+        default:
+            return 2;
+    }
+}
+
+/* Parameter backing a column, a uniform or a reduction */
+typedef struct {
+    uint8_t kind; /* PSL_IRParamKind plus one, 0 without parameter */
+    uint8_t type;
+} PSL_ModuleSlot;
+
+/* Whether the arguments of inst have its type, lowering converts them to it */
+PSL_FORCE_INLINE bool psl_module_check_arg_types(const PSL_ModuleInst* insts, const PSL_ModuleInst* inst)
+{
+    for(uint32_t i = 0; i < inst->num_args; i++)
+    {
+        if(insts[inst->args[i]].type != inst->type)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Masks of selects are comparisons, converted to the type of the select when it differs */
+PSL_FORCE_INLINE bool psl_module_is_mask(const PSL_ModuleInst* insts, uint32_t value)
+{
+    const PSL_ModuleInst* inst = &insts[value];
+
+    return inst->opcode == PSL_IROpcode_Cmp ||
+           (inst->opcode == PSL_IROpcode_Convert && insts[inst->args[0]].opcode == PSL_IROpcode_Cmp);
+}
+
+/*
+   Code generation relies on the IR being well formed, a module is checked like the passes leave it:
+   each column, uniform and reduction has its own parameter, and operands have the types code
+   generation reads them with
+*/
+bool psl_module_check_kernel(const PSL_ModuleHeader* header, const uint8_t* data, const PSL_ModuleKernel* kernel)
+{
+    const char* strings = (const char*)data + header->strings_offset;
+
+    if(kernel->name >= header->strings_size ||
+       kernel->unroll > PSL_CODEGEN_MAX_UNROLL ||
+       !psl_module_check_range(header, kernel->insts_offset, kernel->num_insts, sizeof(PSL_ModuleInst)) ||
+       !psl_module_check_range(header, kernel->params_offset, kernel->num_params, sizeof(PSL_ModuleParam)) ||
+       kernel->num_columns > kernel->num_params ||
+       kernel->num_uniforms > kernel->num_params ||
+       kernel->num_reductions > kernel->num_params)
+    {
+        return false;
+    }
+
+    const PSL_ModuleParam* params = (const PSL_ModuleParam*)(data + kernel->params_offset);
+
+    /* Bounded by the number of parameter records the module holds */
+    PSL_ModuleSlot* columns = (PSL_ModuleSlot*)calloc((size_t)kernel->num_columns + kernel->num_uniforms + kernel->num_reductions + 1,
+                                                      sizeof(PSL_ModuleSlot));
+    PSL_ModuleSlot* uniforms = columns + kernel->num_columns;
+    PSL_ModuleSlot* reductions = uniforms + kernel->num_uniforms;
+
+    bool valid = true;
+
+    for(uint32_t i = 0; valid && i < kernel->num_params; i++)
+    {
+        const PSL_ModuleParam* param = &params[i];
+
+        valid = param->name < header->strings_size &&
+                param->name_length < header->strings_size - param->name &&
+                strings[param->name + param->name_length] == '\0' &&
+                param->kind <= PSL_IRParamKind_Dropped &&
+                param->type <= PSL_IRType_F64 &&
+                param->format > PSL_ColumnFormat_Default &&
+                param->format <= PSL_ColumnFormat_Unorm16 &&
+                param->reduce_op <= PSL_IRReduceOp_Max;
+
+        if(!valid)
+        {
+            break;
+        }
+
+        const PSL_ModuleSlot slot = { (uint8_t)(param->kind + 1), param->type };
+
+        if(param->kind == PSL_IRParamKind_Uniform)
+        {
+            valid = param->index < kernel->num_uniforms && uniforms[param->index].kind == 0;
+
+            if(valid)
+            {
+                uniforms[param->index] = slot;
+            }
+
+            continue;
+        }
+
+        valid = param->index < kernel->num_columns &&
+                columns[param->index].kind == 0 &&
+                (param->kind != PSL_IRParamKind_Reduction ||
+                 (param->reduction < kernel->num_reductions && reductions[param->reduction].kind == 0));
+
+        if(valid)
+        {
+            columns[param->index] = slot;
+
+            if(param->kind == PSL_IRParamKind_Reduction)
+            {
+                reductions[param->reduction] = slot;
+            }
+        }
+    }
+
+    const PSL_ModuleInst* insts = (const PSL_ModuleInst*)(data + kernel->insts_offset);
+
+    for(uint32_t i = 0; valid && i < kernel->num_insts; i++)
+    {
+        const PSL_ModuleInst* inst = &insts[i];
+
+        valid = inst->opcode < PSL_IROpcode_Count &&
+                inst->type <= PSL_IRType_F64 &&
+                (inst->opcode != PSL_IROpcode_Call || inst->index < PSL_BuiltinID_Count);
+
+        valid = valid && inst->num_args == psl_module_num_args(inst);
+
+        for(uint32_t j = 0; valid && j < inst->num_args; j++)
+        {
+            valid = inst->args[j] < i;
+        }
+
+        if(!valid)
+        {
+            break;
+        }
+
+        switch(inst->opcode)
+        {
+            case PSL_IROpcode_Const:
+                break;
+            case PSL_IROpcode_Load:
+                valid = inst->index < kernel->num_columns &&
+                        columns[inst->index].kind == PSL_IRParamKind_Input + 1 &&
+                        columns[inst->index].type == inst->type;
+                break;
+            case PSL_IROpcode_Store:
+                valid = inst->index < kernel->num_columns &&
+                        columns[inst->index].kind == PSL_IRParamKind_Export + 1 &&
+                        columns[inst->index].type == inst->type &&
+                        psl_module_check_arg_types(insts, inst);
+                break;
+            case PSL_IROpcode_Uniform:
+                valid = inst->index < kernel->num_uniforms &&
+                        uniforms[inst->index].kind != 0 &&
+                        uniforms[inst->index].type == inst->type;
+                break;
+            case PSL_IROpcode_Reduce:
+                valid = inst->index < kernel->num_reductions &&
+                        reductions[inst->index].kind != 0 &&
+                        reductions[inst->index].type == inst->type &&
+                        psl_module_check_arg_types(insts, inst);
+                break;
+            case PSL_IROpcode_Convert:
+                valid = insts[inst->args[0]].type != inst->type;
+                break;
+            case PSL_IROpcode_Cmp:
+                valid = inst->index <= PSL_IRCmp_Neq && psl_module_check_arg_types(insts, inst);
+                break;
+            case PSL_IROpcode_Select:
+                valid = psl_module_is_mask(insts, inst->args[0]) && psl_module_check_arg_types(insts, inst);
+                break;
+            case PSL_IROpcode_Rcp:
+            case PSL_IROpcode_Rsqrt:
+                valid = inst->type == PSL_IRType_F32 && psl_module_check_arg_types(insts, inst);
+                break;
+            default:
+                valid = psl_module_check_arg_types(insts, inst);
+                break;
+        }
+    }
+
+    free(columns);
+
+    return valid;
+}
+
+bool psl_module_check(const uint8_t* data, size_t size, char** error)
+{
+    if(((uintptr_t)data % PSL_MODULE_ALIGNMENT) != 0)
+    {
+        *error = "Module data must be aligned on 8 bytes";
+        return false;
+    }
+
+    const PSL_ModuleHeader* header = (const PSL_ModuleHeader*)data;
+
+    if(size < sizeof(PSL_ModuleHeader) || header->magic != PSL_MODULE_MAGIC)
+    {
+        *error = "Not a PSL module";
+        return false;
+    }
+
+    if(header->version != PSL_MODULE_VERSION)
+    {
+        *error = "Unsupported module version";
+        return false;
+    }
+
+    if(header->size != size ||
+       header->strings_offset > size ||
+       header->strings_size != size - header->strings_offset ||
+       (header->strings_size > 0 && data[size - 1] != '\0') ||
+       !psl_module_check_range(header, sizeof(PSL_ModuleHeader), header->num_kernels, sizeof(PSL_ModuleKernel)))
+    {
+        *error = "Truncated module";
+        return false;
+    }
+
+    const PSL_ModuleKernel* kernels = (const PSL_ModuleKernel*)(data + sizeof(PSL_ModuleHeader));
+
+    for(uint32_t i = 0; i < header->num_kernels; i++)
+    {
+        if(!psl_module_check_kernel(header, data, &kernels[i]))
+        {
+            *error = "Invalid kernel in module";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+PSL_Module* psl_module_from_memory(const void* data, size_t size, char** error)
+{
+    if(!psl_module_check((const uint8_t*)data, size, error))
+    {
+        return NULL;
+    }
+
+    PSL_Module* module = (PSL_Module*)malloc(sizeof(PSL_Module));
+    module->data = (const uint8_t*)data;
+    module->size = size;
+    module->num_kernels = ((const PSL_ModuleHeader*)data)->num_kernels;
+    module->mapped = false;
+
+    return module;
+}
+
+void psl_module_unmap(const uint8_t* data, size_t size)
+{
+#if defined(PSL_WIN)
+    (void)size;
+    UnmapViewOfFile(data);
+#else
+    munmap((void*)data, size);
+#endif /* defined(PSL_WIN) */
+}
+
+/* Maps the file read-only, the view stays valid once the file is closed */
+const uint8_t* psl_module_map(const char* path, size_t* size)
+{
+#if defined(PSL_WIN)
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if(file == INVALID_HANDLE_VALUE)
+    {
+        return NULL;
+    }
+
+    LARGE_INTEGER file_size;
+    file_size.QuadPart = 0;
+
+    HANDLE mapping = NULL;
+    void* data = NULL;
+
+    if(GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0)
+    {
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    }
+
+    if(mapping != NULL)
+    {
+        data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+    }
+
+    CloseHandle(file);
+
+    *size = (size_t)file_size.QuadPart;
+
+    return (const uint8_t*)data;
+#else
+    const int fd = open(path, O_RDONLY);
+
+    if(fd < 0)
+    {
+        return NULL;
+    }
+
+    struct stat st;
+    void* data = MAP_FAILED;
+
+    if(fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        *size = (size_t)st.st_size;
+        data = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+
+    close(fd);
+
+    return data != MAP_FAILED ? (const uint8_t*)data : NULL;
+#endif /* defined(PSL_WIN) */
+}
+
+PSL_Module* psl_module_load(const char* path, char** error)
+{
+    size_t size = 0;
+    const uint8_t* data = psl_module_map(path, &size);
+
+    if(data == NULL)
+    {
+        *error = "Cannot map the module file";
+        return NULL;
+    }
+
+    PSL_Module* module = psl_module_from_memory(data, size, error);
+
+    if(module == NULL)
+    {
+        psl_module_unmap(data, size);
+        return NULL;
+    }
+
+    module->mapped = true;
+
+    return module;
+}
+
+PSL_FORCE_INLINE const PSL_ModuleKernel* psl_module_get_kernel(const PSL_Module* module, uint32_t index)
+{
+    return (const PSL_ModuleKernel*)(module->data + sizeof(PSL_ModuleHeader)) + index;
+}
+
+PSL_FORCE_INLINE const char* psl_module_get_string(const PSL_Module* module, uint32_t offset)
+{
+    return (const char*)module->data + ((const PSL_ModuleHeader*)module->data)->strings_offset + offset;
+}
+
+const char* psl_module_kernel_name(const PSL_Module* module, uint32_t index)
+{
+    return psl_module_get_string(module, psl_module_get_kernel(module, index)->name);
+}
+
+bool psl_module_compile(const PSL_Module* module, PSL_Kernel* kernel, const char* name)
+{
+    const PSL_ModuleKernel* record = NULL;
+
+    for(uint32_t i = 0; i < module->num_kernels && record == NULL; i++)
+    {
+        if(name == NULL || strcmp(psl_module_kernel_name(module, i), name) == 0)
+        {
+            record = psl_module_get_kernel(module, i);
+        }
+    }
+
+    if(record == NULL)
+    {
+        kernel->error = name != NULL ? "No kernel of this name in the module" : "The module holds no kernel";
+        return false;
+    }
+
+    snprintf(kernel->name, PSL_KERNEL_NAME_SIZE, "%s", psl_module_get_string(module, record->name));
+    kernel->codegen.unroll = record->unroll;
+
+    PSL_IR* ir = &kernel->ir;
+    psl_ir_init(ir);
+    ir->insts = (PSL_IRInst*)malloc(record->num_insts * sizeof(PSL_IRInst) + 1);
+    ir->num_insts = record->num_insts;
+    ir->capacity = record->num_insts;
+    ir->params = (PSL_IRParam*)malloc(record->num_params * sizeof(PSL_IRParam) + 1);
+    ir->num_params = record->num_params;
+    ir->num_columns = record->num_columns;
+    ir->num_uniforms = record->num_uniforms;
+    ir->num_reductions = record->num_reductions;
+
+    psl_profile_alloc(record->num_insts * sizeof(PSL_IRInst) + record->num_params * sizeof(PSL_IRParam));
+
+    const PSL_ModuleInst* insts = (const PSL_ModuleInst*)(module->data + record->insts_offset);
+
+    for(uint32_t i = 0; i < record->num_insts; i++)
+    {
+        PSL_IRInst* inst = &ir->insts[i];
+        inst->opcode = (PSL_IROpcode)insts[i].opcode;
+        inst->type = (PSL_IRType)insts[i].type;
+        memcpy(inst->args, insts[i].args, sizeof(inst->args));
+        inst->num_args = insts[i].num_args;
+        inst->index = insts[i].index;
+        inst->constant = insts[i].constant;
+        inst->line = insts[i].line;
+    }
+
+    const PSL_ModuleParam* params = (const PSL_ModuleParam*)(module->data + record->params_offset);
+
+    for(uint32_t i = 0; i < record->num_params; i++)
+    {
+        PSL_IRParam* param = &ir->params[i];
+        param->name = (char*)psl_module_get_string(module, params[i].name);
+        param->name_length = params[i].name_length;
+        param->kind = (PSL_IRParamKind)params[i].kind;
+        param->type = (PSL_IRType)params[i].type;
+        param->format = (PSL_ColumnFormat)params[i].format;
+        param->reduce_op = (PSL_IRReduceOp)params[i].reduce_op;
+        param->index = params[i].index;
+        param->reduction = params[i].reduction;
+        param->component = params[i].component;
+    }
+
+    return psl_kernel_compile_ir(kernel);
+}
+
+void psl_module_destroy(PSL_Module* module)
+{
+    if(module != NULL)
+    {
+        if(module->mapped)
+        {
+            psl_module_unmap(module->data, module->size);
+        }
+
+        free(module);
+    }
+}
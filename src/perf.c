@@ -0,0 +1,381 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#include "psl/perf.h"
+#include "psl/kernel.h"
+#include "psl/profile.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(PSL_LINUX)
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/* See tools/perf/Documentation/jitdump-specification.txt in the Linux sources */
+
+#define PSL_JITDUMP_MAGIC 0x4A695444
+#define PSL_JITDUMP_VERSION 1
+#define PSL_JITDUMP_ELF_MACH_X86_64 62
+
+#define PSL_JITDUMP_CODE_LOAD 0
+#define PSL_JITDUMP_DEBUG_INFO 2
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t total_size;
+    uint32_t elf_mach;
+    uint32_t pad1;
+    uint32_t pid;
+    uint64_t timestamp;
+    uint64_t flags;
+} PSL_JitDumpHeader;
+
+typedef struct {
+    uint32_t id;
+    uint32_t total_size;
+    uint64_t timestamp;
+} PSL_JitDumpRecord;
+
+typedef struct {
+    PSL_JitDumpRecord record;
+    uint32_t pid;
+    uint32_t tid;
+    uint64_t vma;
+    uint64_t code_addr;
+    uint64_t code_size;
+    uint64_t code_index;
+    /* followed by the null terminated name and the code */
+} PSL_JitDumpCodeLoad;
+
+typedef struct {
+    PSL_JitDumpRecord record;
+    uint64_t code_addr;
+    uint64_t nr_entry;
+    /* followed by the entries */
+} PSL_JitDumpDebugInfo;
+
+typedef struct {
+    uint64_t addr;
+    int32_t lineno;
+    int32_t discrim;
+    /* followed by the null terminated file name */
+} PSL_JitDumpDebugEntry;
+
+static pthread_mutex_t _perf_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t _outputs = 0;
+static FILE* _map_file = NULL;
+static int _dump_fd = -1;
+
+/* perf finds the jitdump of a process through an executable mapping of it */
+static void* _dump_marker = NULL;
+static size_t _dump_marker_size = 0;
+
+static uint64_t _code_index = 0;
+
+bool psl_perf_write(const void* data, size_t size)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+
+    while(size > 0)
+    {
+        const ssize_t written = write(_dump_fd, bytes, size);
+
+        if(written <= 0)
+        {
+            return false;
+        }
+
+        bytes += written;
+        size -= (size_t)written;
+    }
+
+    return true;
+}
+
+bool psl_perf_open_map(void)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/perf-%d.map", (int)getpid());
+
+    _map_file = fopen(path, "a");
+
+    return _map_file != NULL;
+}
+
+bool psl_perf_open_dump(void)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/jit-%d.dump", (int)getpid());
+
+    _dump_fd = open(path, O_CREAT | O_TRUNC | O_RDWR, 0666);
+
+    if(_dump_fd < 0)
+    {
+        return false;
+    }
+
+    PSL_JitDumpHeader header;
+    memset(&header, 0, sizeof(PSL_JitDumpHeader));
+    header.magic = PSL_JITDUMP_MAGIC;
+    header.version = PSL_JITDUMP_VERSION;
+    header.total_size = sizeof(PSL_JitDumpHeader);
+    header.elf_mach = PSL_JITDUMP_ELF_MACH_X86_64;
+    header.pid = (uint32_t)getpid();
+    header.timestamp = psl_profile_now_ns();
+
+    _dump_marker_size = (size_t)sysconf(_SC_PAGESIZE);
+    _dump_marker = mmap(NULL, _dump_marker_size, PROT_READ | PROT_EXEC, MAP_PRIVATE, _dump_fd, 0);
+
+    if(_dump_marker == MAP_FAILED || !psl_perf_write(&header, sizeof(PSL_JitDumpHeader)))
+    {
+        if(_dump_marker != MAP_FAILED)
+        {
+            munmap(_dump_marker, _dump_marker_size);
+        }
+
+        _dump_marker = NULL;
+        close(_dump_fd);
+        _dump_fd = -1;
+
+        return false;
+    }
+
+    return true;
+}
+
+void psl_perf_close(void)
+{
+    if(_map_file != NULL)
+    {
+        fclose(_map_file);
+        _map_file = NULL;
+    }
+
+    if(_dump_fd >= 0)
+    {
+        munmap(_dump_marker, _dump_marker_size);
+        _dump_marker = NULL;
+        close(_dump_fd);
+        _dump_fd = -1;
+    }
+
+    _outputs = 0;
+}
+
+bool psl_perf_enable(uint32_t outputs)
+{
+    pthread_mutex_lock(&_perf_lock);
+
+    bool success = true;
+
+    if((outputs & PSL_PerfOutput_Map) && _map_file == NULL)
+    {
+        success = psl_perf_open_map();
+    }
+
+    if(success && (outputs & PSL_PerfOutput_JitDump) && _dump_fd < 0)
+    {
+        success = psl_perf_open_dump();
+    }
+
+    if(success)
+    {
+        _outputs |= outputs;
+    }
+
+    pthread_mutex_unlock(&_perf_lock);
+
+    return success;
+}
+
+void psl_perf_disable(void)
+{
+    pthread_mutex_lock(&_perf_lock);
+    psl_perf_close();
+    pthread_mutex_unlock(&_perf_lock);
+}
+
+uint32_t psl_perf_outputs(void)
+{
+    pthread_mutex_lock(&_perf_lock);
+    const uint32_t outputs = _outputs;
+    pthread_mutex_unlock(&_perf_lock);
+
+    return outputs;
+}
+
+/* Line of the code mapped by entry, 0 for the code of the kernel itself */
+PSL_FORCE_INLINE uint32_t psl_perf_entry_line(const PSL_IR* ir, const PSL_CodeMapEntry* entry)
+{
+    return entry->value == PSL_IR_INVALID_VALUE ? 0 : ir->insts[entry->value].line;
+}
+
+void psl_perf_write_debug_info(const char* name, uint64_t code_addr, const PSL_IR* ir, const PSL_CodeMap* map)
+{
+    char file_name[PSL_KERNEL_NAME_SIZE + 8];
+    snprintf(file_name, sizeof(file_name), "%s.psl", name);
+
+    const size_t file_name_size = strlen(file_name) + 1;
+
+    /* Consecutive entries on the same line are merged, the code of the kernel is left out */
+    uint64_t num_entries = 0;
+    uint32_t last_line = 0;
+
+    for(uint32_t i = 0; i < map->num_entries; i++)
+    {
+        const uint32_t line = psl_perf_entry_line(ir, &map->entries[i]);
+
+        if(line != 0 && line != last_line)
+        {
+            num_entries++;
+        }
+
+        last_line = line != 0 ? line : last_line;
+    }
+
+    if(num_entries == 0)
+    {
+        return;
+    }
+
+    PSL_JitDumpDebugInfo info;
+    info.record.id = PSL_JITDUMP_DEBUG_INFO;
+    info.record.total_size = (uint32_t)(sizeof(PSL_JitDumpDebugInfo) +
+                                        num_entries * (sizeof(PSL_JitDumpDebugEntry) + file_name_size));
+    info.record.timestamp = psl_profile_now_ns();
+    info.code_addr = code_addr;
+    info.nr_entry = num_entries;
+
+    psl_perf_write(&info, sizeof(PSL_JitDumpDebugInfo));
+
+    last_line = 0;
+
+    for(uint32_t i = 0; i < map->num_entries; i++)
+    {
+        const uint32_t line = psl_perf_entry_line(ir, &map->entries[i]);
+
+        if(line != 0 && line != last_line)
+        {
+            PSL_JitDumpDebugEntry entry;
+            entry.addr = code_addr + map->entries[i].offset;
+            entry.lineno = (int32_t)line;
+            entry.discrim = 0;
+
+            psl_perf_write(&entry, sizeof(PSL_JitDumpDebugEntry));
+            psl_perf_write(file_name, file_name_size);
+        }
+
+        last_line = line != 0 ? line : last_line;
+    }
+}
+
+void psl_perf_register(const char* name, const void* code, size_t code_size, const PSL_IR* ir, const PSL_CodeMap* map)
+{
+    pthread_mutex_lock(&_perf_lock);
+
+    if(_outputs == 0)
+    {
+        pthread_mutex_unlock(&_perf_lock);
+        return;
+    }
+
+    char symbol[PSL_KERNEL_NAME_SIZE + 8];
+    snprintf(symbol, sizeof(symbol), "psl::%s", name);
+
+    if(_map_file != NULL)
+    {
+        fprintf(_map_file, "%llx %zx %s\n", (unsigned long long)(uintptr_t)code, code_size, symbol);
+        fflush(_map_file);
+    }
+
+    if(_dump_fd >= 0)
+    {
+        if(ir != NULL && map != NULL)
+        {
+            psl_perf_write_debug_info(name, (uint64_t)(uintptr_t)code, ir, map);
+        }
+
+        const size_t symbol_size = strlen(symbol) + 1;
+
+        PSL_JitDumpCodeLoad load;
+        load.record.id = PSL_JITDUMP_CODE_LOAD;
+        load.record.total_size = (uint32_t)(sizeof(PSL_JitDumpCodeLoad) + symbol_size + code_size);
+        load.record.timestamp = psl_profile_now_ns();
+        load.pid = (uint32_t)getpid();
+        load.tid = (uint32_t)syscall(SYS_gettid);
+        load.vma = (uint64_t)(uintptr_t)code;
+        load.code_addr = (uint64_t)(uintptr_t)code;
+        load.code_size = code_size;
+        load.code_index = _code_index++;
+
+        psl_perf_write(&load, sizeof(PSL_JitDumpCodeLoad));
+        psl_perf_write(symbol, symbol_size);
+        psl_perf_write(code, code_size);
+    }
+
+    pthread_mutex_unlock(&_perf_lock);
+}
+#else
+bool psl_perf_enable(uint32_t outputs)
+{
+    return outputs == 0;
+}
+
+void psl_perf_disable(void)
+{
+}
+
+uint32_t psl_perf_outputs(void)
+{
+    return 0;
+}
+
+void psl_perf_register(const char* name, const void* code, size_t code_size, const PSL_IR* ir, const PSL_CodeMap* map)
+{
+    (void)name;
+    (void)code;
+    (void)code_size;
+    (void)ir;
+    (void)map;
+}
+#endif /* defined(PSL_LINUX) */
+
+void psl_perf_init_from_env(void)
+{
+    const char* value = getenv(PSL_PERF_ENV);
+
+    if(value == NULL)
+    {
+        return;
+    }
+
+    uint32_t outputs = 0;
+
+    while(*value != '\0')
+    {
+        const size_t length = strcspn(value, ",");
+
+        if(length == 3 && strncmp(value, "map", 3) == 0)
+        {
+            outputs |= PSL_PerfOutput_Map;
+        }
+        else if(length == 7 && strncmp(value, "jitdump", 7) == 0)
+        {
+            outputs |= PSL_PerfOutput_JitDump;
+        }
+
+        value += length + (value[length] == ',' ? 1 : 0);
+    }
+
+    if(outputs != 0 && !psl_perf_enable(outputs))
+    {
+        fprintf(stderr, "PSL cannot create the perf outputs requested by %s\n", PSL_PERF_ENV);
+    }
+}
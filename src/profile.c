@@ -0,0 +1,228 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#include "psl/profile.h"
+
+#include <string.h>
+
+#if defined(PSL_WIN)
+#include <Windows.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#endif /* defined(PSL_WIN) */
+
+PSL_THREAD_LOCAL PSL_CompileStats* _psl_current_stats = NULL;
+
+static PSL_CompileStats _totals;
+
+#if defined(PSL_WIN)
+static SRWLOCK _totals_lock = SRWLOCK_INIT;
+#else
+static pthread_mutex_t _totals_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif /* defined(PSL_WIN) */
+
+void psl_profile_lock(void)
+{
+#if defined(PSL_WIN)
+    AcquireSRWLockExclusive(&_totals_lock);
+#else
+    pthread_mutex_lock(&_totals_lock);
+#endif /* defined(PSL_WIN) */
+}
+
+void psl_profile_unlock(void)
+{
+#if defined(PSL_WIN)
+    ReleaseSRWLockExclusive(&_totals_lock);
+#else
+    pthread_mutex_unlock(&_totals_lock);
+#endif /* defined(PSL_WIN) */
+}
+
+uint64_t psl_profile_now_ns(void)
+{
+#if defined(PSL_WIN)
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+
+    return (uint64_t)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+#endif /* defined(PSL_WIN) */
+}
+
+void psl_profile_accumulate(PSL_CompileStats* dst, const PSL_CompileStats* src)
+{
+    for(uint32_t i = 0; i < PSL_CompilePhase_Count; i++)
+    {
+        dst->phases[i].time_ns += src->phases[i].time_ns;
+        dst->phases[i].bytes_allocated += src->phases[i].bytes_allocated;
+        dst->phases[i].count += src->phases[i].count;
+    }
+
+    dst->num_tokens += src->num_tokens;
+    dst->num_nodes += src->num_nodes;
+    dst->arena_peak = dst->arena_peak > src->arena_peak ? dst->arena_peak : src->arena_peak;
+    dst->arena_resizes += src->arena_resizes;
+    dst->num_insts += src->num_insts;
+    dst->code_size += src->code_size;
+    dst->num_compilations += src->num_compilations;
+    dst->bytes_allocated += src->bytes_allocated;
+}
+
+void psl_profile_begin(PSL_CompileStats* stats)
+{
+    memset(stats, 0, sizeof(PSL_CompileStats));
+    stats->num_compilations = 1;
+
+    _psl_current_stats = stats;
+}
+
+void psl_profile_end(void)
+{
+    if(_psl_current_stats == NULL)
+    {
+        return;
+    }
+
+    psl_profile_lock();
+    psl_profile_accumulate(&_totals, _psl_current_stats);
+    psl_profile_unlock();
+
+    _psl_current_stats = NULL;
+}
+
+void psl_profile_get_totals(PSL_CompileStats* totals)
+{
+    psl_profile_lock();
+    *totals = _totals;
+    psl_profile_unlock();
+}
+
+void psl_profile_reset_totals(void)
+{
+    psl_profile_lock();
+    memset(&_totals, 0, sizeof(PSL_CompileStats));
+    psl_profile_unlock();
+}
+
+const char* psl_compile_phase_to_string(PSL_CompilePhase phase)
+{
+    switch(phase)
+    {
+        case PSL_CompilePhase_Lex:
+            return "lex";
+        case PSL_CompilePhase_Parse:
+            return "parse";
+        case PSL_CompilePhase_Lower:
+            return "lower";
+        case PSL_CompilePhase_Specialize:
+            return "specialize";
+        case PSL_CompilePhase_FoldConstants:
+            return "fold_constants";
+        case PSL_CompilePhase_CSE:
+            return "cse";
+        case PSL_CompilePhase_DCE:
+            return "dce";
+        case PSL_CompilePhase_FastMath:
+            return "fast_math";
+        case PSL_CompilePhase_SlotLayout:
+            return "slot_layout";
+        case PSL_CompilePhase_Encode:
+            return "encode";
+        case PSL_CompilePhase_CacheLookup:
+            return "cache_lookup";
+        default:
+            return "unknown";
+    }
+}
+
+size_t psl_compile_stats_to_json(const PSL_CompileStats* stats, char* buffer, size_t size)
+{
+    size_t length = 0;
+
+/* Appends to the buffer while it has room, and counts the whole length anyway */
+#define PSL_JSON_APPEND(...)                                                                    \
+    {                                                                                           \
+        const int written = snprintf(length < size ? buffer + length : NULL,                    \
+                                     length < size ? size - length : 0,                         \
+                                     __VA_ARGS__);                                              \
+        length += written > 0 ? (size_t)written : 0;                                            \
+    }
+
+    PSL_JSON_APPEND("{\"phases\":{");
+
+    for(uint32_t i = 0; i < PSL_CompilePhase_Count; i++)
+    {
+        PSL_JSON_APPEND("%s\"%s\":{\"time_ns\":%llu,\"bytes_allocated\":%llu,\"count\":%llu}",
+                        i == 0 ? "" : ",",
+                        psl_compile_phase_to_string((PSL_CompilePhase)i),
+                        (unsigned long long)stats->phases[i].time_ns,
+                        (unsigned long long)stats->phases[i].bytes_allocated,
+                        (unsigned long long)stats->phases[i].count);
+    }
+
+    PSL_JSON_APPEND("},\"num_tokens\":%llu,\"num_nodes\":%llu,\"arena_peak\":%llu,\"arena_resizes\":%llu,"
+                    "\"num_insts\":%llu,\"code_size\":%llu,\"num_compilations\":%llu,\"bytes_allocated\":%llu}",
+                    (unsigned long long)stats->num_tokens,
+                    (unsigned long long)stats->num_nodes,
+                    (unsigned long long)stats->arena_peak,
+                    (unsigned long long)stats->arena_resizes,
+                    (unsigned long long)stats->num_insts,
+                    (unsigned long long)stats->code_size,
+                    (unsigned long long)stats->num_compilations,
+                    (unsigned long long)stats->bytes_allocated);
+
+#undef PSL_JSON_APPEND
+
+    return length;
+}
+
+void psl_profile_phase_begin(PSL_ProfileScope* scope)
+{
+    if(_psl_current_stats == NULL)
+    {
+        return;
+    }
+
+    scope->start_ns = psl_profile_now_ns();
+    scope->start_bytes = _psl_current_stats->bytes_allocated;
+}
+
+void psl_profile_phase_end(PSL_ProfileScope* scope, PSL_CompilePhase phase)
+{
+    if(_psl_current_stats == NULL)
+    {
+        return;
+    }
+
+    PSL_PhaseStats* stats = &_psl_current_stats->phases[phase];
+    stats->time_ns += psl_profile_now_ns() - scope->start_ns;
+    stats->bytes_allocated += _psl_current_stats->bytes_allocated - scope->start_bytes;
+    stats->count++;
+}
+
+void psl_profile_alloc(size_t size)
+{
+    if(_psl_current_stats != NULL)
+    {
+        _psl_current_stats->bytes_allocated += size;
+    }
+}
+
+void psl_profile_counts(uint64_t num_tokens, uint64_t num_insts, uint64_t code_size)
+{
+    if(_psl_current_stats != NULL)
+    {
+        _psl_current_stats->num_tokens += num_tokens;
+        _psl_current_stats->num_insts += num_insts;
+        _psl_current_stats->code_size += code_size;
+    }
+}
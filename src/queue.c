@@ -0,0 +1,541 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#include "psl/queue.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(PSL_WIN)
+#include <Windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif /* defined(PSL_WIN) */
+
+/* Most elements of a batch of coalesced submissions, larger submissions are executed on their own */
+#define PSL_QUEUE_BATCH_SIZE 4096
+
+/* Platform layer */
+
+#if defined(PSL_WIN)
+typedef CRITICAL_SECTION PSL_Mutex;
+typedef CONDITION_VARIABLE PSL_CondVar;
+typedef HANDLE PSL_Thread;
+#else
+typedef pthread_mutex_t PSL_Mutex;
+typedef pthread_cond_t PSL_CondVar;
+typedef pthread_t PSL_Thread;
+#endif /* defined(PSL_WIN) */
+
+PSL_FORCE_INLINE void psl_mutex_init(PSL_Mutex* mutex)
+{
+#if defined(PSL_WIN)
+    InitializeCriticalSection(mutex);
+#else
+    pthread_mutex_init(mutex, NULL);
+#endif /* defined(PSL_WIN) */
+}
+
+PSL_FORCE_INLINE void psl_mutex_lock(PSL_Mutex* mutex)
+{
+#if defined(PSL_WIN)
+    EnterCriticalSection(mutex);
+#else
+    pthread_mutex_lock(mutex);
+#endif /* defined(PSL_WIN) */
+}
+
+PSL_FORCE_INLINE void psl_mutex_unlock(PSL_Mutex* mutex)
+{
+#if defined(PSL_WIN)
+    LeaveCriticalSection(mutex);
+#else
+    pthread_mutex_unlock(mutex);
+#endif /* defined(PSL_WIN) */
+}
+
+PSL_FORCE_INLINE void psl_mutex_destroy(PSL_Mutex* mutex)
+{
+#if defined(PSL_WIN)
+    DeleteCriticalSection(mutex);
+#else
+    pthread_mutex_destroy(mutex);
+#endif /* defined(PSL_WIN) */
+}
+
+PSL_FORCE_INLINE void psl_condvar_init(PSL_CondVar* cond)
+{
+#if defined(PSL_WIN)
+    InitializeConditionVariable(cond);
+#else
+    pthread_cond_init(cond, NULL);
+#endif /* defined(PSL_WIN) */
+}
+
+PSL_FORCE_INLINE void psl_condvar_wait(PSL_CondVar* cond, PSL_Mutex* mutex)
+{
+#if defined(PSL_WIN)
+    SleepConditionVariableCS(cond, mutex, INFINITE);
+#else
+    pthread_cond_wait(cond, mutex);
+#endif /* defined(PSL_WIN) */
+}
+
+PSL_FORCE_INLINE void psl_condvar_signal(PSL_CondVar* cond)
+{
+#if defined(PSL_WIN)
+    WakeConditionVariable(cond);
+#else
+    pthread_cond_signal(cond);
+#endif /* defined(PSL_WIN) */
+}
+
+PSL_FORCE_INLINE void psl_condvar_broadcast(PSL_CondVar* cond)
+{
+#if defined(PSL_WIN)
+    WakeAllConditionVariable(cond);
+#else
+    pthread_cond_broadcast(cond);
+#endif /* defined(PSL_WIN) */
+}
+
+PSL_FORCE_INLINE void psl_condvar_destroy(PSL_CondVar* cond)
+{
+#if defined(PSL_WIN)
+    (void)cond;
+#else
+    pthread_cond_destroy(cond);
+#endif /* defined(PSL_WIN) */
+}
+
+uint32_t psl_queue_num_processors(void)
+{
+#if defined(PSL_WIN)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+
+    return (uint32_t)info.dwNumberOfProcessors;
+#else
+    const long num_processors = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return num_processors > 0 ? (uint32_t)num_processors : 1;
+#endif /* defined(PSL_WIN) */
+}
+
+/* Queue */
+
+typedef struct PSL_Submission {
+    struct PSL_Submission* next;
+    PSL_Kernel* kernel;
+    void** columns; /* copies of the bindings arrays, allocated along the submission */
+    void** uniforms;
+    size_t count;
+    PSL_CompletionFunc callback;
+    void* user_data;
+    PSL_Fence fence;
+} PSL_Submission;
+
+typedef struct {
+    PSL_Queue* queue;
+    PSL_Thread thread;
+    PSL_Fence in_flight; /* fence of the first submission of the batch being executed, 0 when idle */
+} PSL_Worker;
+
+struct PSL_Queue {
+    PSL_Mutex mutex;
+    PSL_CondVar work; /* signaled on submission and when stopping */
+    PSL_CondVar done; /* broadcast when a batch completes */
+    PSL_Submission* head;
+    PSL_Submission* tail;
+    PSL_Fence last_fence;
+    PSL_Worker* workers;
+    uint32_t num_workers;
+    bool stop;
+};
+
+/* Whether the columns of next overlap the exports of the batch from first up to next */
+bool psl_queue_accesses_batch_exports(const PSL_Submission* first, const PSL_Submission* next)
+{
+    const PSL_IR* ir = &first->kernel->ir;
+
+    for(uint32_t i = 0; i < ir->num_params; i++)
+    {
+        const PSL_IRParam* param = &ir->params[i];
+
+        if(param->kind != PSL_IRParamKind_Input && param->kind != PSL_IRParamKind_Export)
+        {
+            continue;
+        }
+
+        const uintptr_t start = (uintptr_t)next->columns[param->index];
+        const uintptr_t end = start + next->count * psl_column_format_size(param->format);
+
+        for(uint32_t j = 0; j < ir->num_params; j++)
+        {
+            const PSL_IRParam* exported = &ir->params[j];
+
+            if(exported->kind != PSL_IRParamKind_Export)
+            {
+                continue;
+            }
+
+            for(const PSL_Submission* submission = first; submission != next; submission = submission->next)
+            {
+                const uintptr_t export_start = (uintptr_t)submission->columns[exported->index];
+                const uintptr_t export_end = export_start + submission->count * psl_column_format_size(exported->format);
+
+                if(start < export_end && export_start < end)
+                {
+                    return true;
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+/* Whether next can be executed in the same kernel call as the batch from first up to next */
+PSL_FORCE_INLINE bool psl_queue_can_coalesce(const PSL_Submission* first, const PSL_Submission* next, size_t batch_count)
+{
+    /*
+       Reductions are aggregated per submission. A batch gathers all its inputs before scattering
+       its exports, so a submission reading or writing the exports of an earlier one waits for it
+    */
+    return next->kernel == first->kernel &&
+           first->kernel->ir.num_reductions == 0 &&
+           batch_count + next->count <= PSL_QUEUE_BATCH_SIZE &&
+           memcmp(next->uniforms, first->uniforms, first->kernel->ir.num_uniforms * sizeof(void*)) == 0 &&
+           !psl_queue_accesses_batch_exports(first, next);
+}
+
+/* Gathers the inputs of the submissions into contiguous columns, executes them at once and scatters the exports */
+void psl_queue_execute_coalesced(PSL_Submission* first, size_t batch_count, const PSL_ExecuteOptions* options)
+{
+    PSL_Kernel* kernel = first->kernel;
+    PSL_IR* ir = &kernel->ir;
+
+    size_t element_sizes = 0;
+
+    for(uint32_t i = 0; i < ir->num_params; i++)
+    {
+        if(ir->params[i].kind == PSL_IRParamKind_Input || ir->params[i].kind == PSL_IRParamKind_Export)
+        {
+            element_sizes += psl_column_format_size(ir->params[i].format);
+        }
+    }
+
+    uint8_t* data = (uint8_t*)malloc(element_sizes * batch_count + 1);
+    void** columns = (void**)calloc(ir->num_columns + 1, sizeof(void*));
+
+    size_t offset = 0;
+
+    for(uint32_t i = 0; i < ir->num_params; i++)
+    {
+        const PSL_IRParam* param = &ir->params[i];
+
+        if(param->kind == PSL_IRParamKind_Input || param->kind == PSL_IRParamKind_Export)
+        {
+            columns[param->index] = data + offset;
+            offset += psl_column_format_size(param->format) * batch_count;
+        }
+    }
+
+    for(uint32_t direction = 0; direction < 2; direction++)
+    {
+        /* Inputs are gathered before the execution, exports scattered after it */
+        if(direction == 1)
+        {
+            PSL_Bindings bindings;
+            bindings.columns = columns;
+            bindings.uniforms = first->uniforms;
+
+            psl_kernel_execute_with_options(kernel, &bindings, batch_count, options);
+        }
+
+        const PSL_IRParamKind kind = direction == 0 ? PSL_IRParamKind_Input : PSL_IRParamKind_Export;
+
+        for(uint32_t i = 0; i < ir->num_params; i++)
+        {
+            const PSL_IRParam* param = &ir->params[i];
+
+            if(param->kind != kind)
+            {
+                continue;
+            }
+
+            const size_t element_size = psl_column_format_size(param->format);
+            uint8_t* batch_column = (uint8_t*)columns[param->index];
+
+            for(PSL_Submission* submission = first; submission != NULL; submission = submission->next)
+            {
+                if(direction == 0)
+                {
+                    memcpy(batch_column, submission->columns[param->index], submission->count * element_size);
+                }
+                else
+                {
+                    memcpy(submission->columns[param->index], batch_column, submission->count * element_size);
+                }
+
+                batch_column += submission->count * element_size;
+            }
+        }
+    }
+
+    free(columns);
+    free(data);
+}
+
+void psl_queue_execute(PSL_Submission* first, size_t batch_count)
+{
+    /* Never compiles variants, which would modify the kernel from several threads */
+    PSL_ExecuteOptions options;
+    psl_execute_options_init(&options);
+    options.streaming_threshold = 0;
+
+    if(first->next != NULL)
+    {
+        psl_queue_execute_coalesced(first, batch_count, &options);
+        return;
+    }
+
+    PSL_Bindings bindings;
+    bindings.columns = first->columns;
+    bindings.uniforms = first->uniforms;
+
+    psl_kernel_execute_with_options(first->kernel, &bindings, first->count, &options);
+}
+
+/* Fence of the oldest submission that has not completed, the queue must be locked */
+PSL_Fence psl_queue_oldest_pending(PSL_Queue* queue)
+{
+    PSL_Fence oldest = queue->head != NULL ? queue->head->fence : queue->last_fence + 1;
+
+    for(uint32_t i = 0; i < queue->num_workers; i++)
+    {
+        if(queue->workers[i].in_flight != 0 && queue->workers[i].in_flight < oldest)
+        {
+            oldest = queue->workers[i].in_flight;
+        }
+    }
+
+    return oldest;
+}
+
+void psl_queue_worker_run(PSL_Worker* worker)
+{
+    PSL_Queue* queue = worker->queue;
+
+    psl_mutex_lock(&queue->mutex);
+
+    while(true)
+    {
+        while(queue->head == NULL && !queue->stop)
+        {
+            psl_condvar_wait(&queue->work, &queue->mutex);
+        }
+
+        if(queue->head == NULL)
+        {
+            break;
+        }
+
+        /* Takes the head and the following submissions it can be coalesced with */
+        PSL_Submission* first = queue->head;
+        PSL_Submission* last = first;
+        size_t batch_count = first->count;
+
+        while(last->next != NULL && psl_queue_can_coalesce(first, last->next, batch_count))
+        {
+            last = last->next;
+            batch_count += last->count;
+        }
+
+        queue->head = last->next;
+        queue->tail = queue->head != NULL ? queue->tail : NULL;
+        last->next = NULL;
+
+        worker->in_flight = first->fence;
+
+        psl_mutex_unlock(&queue->mutex);
+
+        psl_queue_execute(first, batch_count);
+
+        while(first != NULL)
+        {
+            PSL_Submission* next = first->next;
+
+            if(first->callback != NULL)
+            {
+                first->callback(first->user_data);
+            }
+
+            free(first);
+            first = next;
+        }
+
+        psl_mutex_lock(&queue->mutex);
+
+        worker->in_flight = 0;
+        psl_condvar_broadcast(&queue->done);
+    }
+
+    psl_mutex_unlock(&queue->mutex);
+}
+
+#if defined(PSL_WIN)
+DWORD WINAPI psl_queue_worker_entry(LPVOID worker)
+{
+    psl_queue_worker_run((PSL_Worker*)worker);
+    return 0;
+}
+#else
+void* psl_queue_worker_entry(void* worker)
+{
+    psl_queue_worker_run((PSL_Worker*)worker);
+    return NULL;
+}
+#endif /* defined(PSL_WIN) */
+
+PSL_Queue* psl_queue_new(uint32_t num_threads)
+{
+    PSL_Queue* queue = (PSL_Queue*)malloc(sizeof(PSL_Queue));
+
+    psl_mutex_init(&queue->mutex);
+    psl_condvar_init(&queue->work);
+    psl_condvar_init(&queue->done);
+    queue->head = NULL;
+    queue->tail = NULL;
+    queue->last_fence = 0;
+    queue->num_workers = num_threads != 0 ? num_threads : psl_queue_num_processors();
+    queue->workers = (PSL_Worker*)malloc(queue->num_workers * sizeof(PSL_Worker));
+    queue->stop = false;
+
+    for(uint32_t i = 0; i < queue->num_workers; i++)
+    {
+        PSL_Worker* worker = &queue->workers[i];
+        worker->queue = queue;
+        worker->in_flight = 0;
+
+#if defined(PSL_WIN)
+        worker->thread = CreateThread(NULL, 0, psl_queue_worker_entry, worker, 0, NULL);
+        PSL_ASSERT(worker->thread != NULL, "Cannot create queue worker thread");
+#else
+        const int result = pthread_create(&worker->thread, NULL, psl_queue_worker_entry, worker);
+        PSL_ASSERT(result == 0, "Cannot create queue worker thread");
+#endif /* defined(PSL_WIN) */
+    }
+
+    return queue;
+}
+
+PSL_Fence psl_kernel_submit(PSL_Queue* queue,
+                            PSL_Kernel* kernel,
+                            const PSL_Bindings* bindings,
+                            size_t count,
+                            PSL_CompletionFunc callback,
+                            void* user_data)
+{
+    PSL_ASSERT(kernel->func != NULL, "Kernel has not been compiled");
+
+    const uint32_t num_columns = kernel->ir.num_columns;
+    const uint32_t num_uniforms = kernel->ir.num_uniforms;
+
+    PSL_Submission* submission = (PSL_Submission*)malloc(sizeof(PSL_Submission) +
+                                                         (num_columns + num_uniforms) * sizeof(void*));
+
+    submission->next = NULL;
+    submission->kernel = kernel;
+    submission->columns = (void**)(submission + 1);
+    submission->uniforms = submission->columns + num_columns;
+    submission->count = count;
+    submission->callback = callback;
+    submission->user_data = user_data;
+
+    if(num_columns > 0)
+    {
+        memcpy(submission->columns, bindings->columns, num_columns * sizeof(void*));
+    }
+
+    if(num_uniforms > 0)
+    {
+        memcpy(submission->uniforms, bindings->uniforms, num_uniforms * sizeof(void*));
+    }
+
+    psl_mutex_lock(&queue->mutex);
+
+    const PSL_Fence fence = ++queue->last_fence;
+    submission->fence = fence;
+
+    if(queue->tail != NULL)
+    {
+        queue->tail->next = submission;
+    }
+    else
+    {
+        queue->head = submission;
+    }
+
+    queue->tail = submission;
+
+    psl_condvar_signal(&queue->work);
+    psl_mutex_unlock(&queue->mutex);
+
+    /* The submission may already have been executed and freed */
+    return fence;
+}
+
+PSL_Fence psl_queue_fence(PSL_Queue* queue)
+{
+    psl_mutex_lock(&queue->mutex);
+    const PSL_Fence fence = queue->last_fence;
+    psl_mutex_unlock(&queue->mutex);
+
+    return fence;
+}
+
+void psl_wait(PSL_Queue* queue, PSL_Fence fence)
+{
+    psl_mutex_lock(&queue->mutex);
+
+    while(psl_queue_oldest_pending(queue) <= fence)
+    {
+        psl_condvar_wait(&queue->done, &queue->mutex);
+    }
+
+    psl_mutex_unlock(&queue->mutex);
+}
+
+void psl_queue_destroy(PSL_Queue* queue)
+{
+    if(queue == NULL)
+    {
+        return;
+    }
+
+    psl_mutex_lock(&queue->mutex);
+    queue->stop = true;
+    psl_condvar_broadcast(&queue->work);
+    psl_mutex_unlock(&queue->mutex);
+
+    /* Workers drain the queue before stopping */
+    for(uint32_t i = 0; i < queue->num_workers; i++)
+    {
+#if defined(PSL_WIN)
+        WaitForSingleObject(queue->workers[i].thread, INFINITE);
+        CloseHandle(queue->workers[i].thread);
+#else
+        pthread_join(queue->workers[i].thread, NULL);
+#endif /* defined(PSL_WIN) */
+    }
+
+    psl_condvar_destroy(&queue->done);
+    psl_condvar_destroy(&queue->work);
+    psl_mutex_destroy(&queue->mutex);
+
+    free(queue->workers);
+    free(queue);
+}
@@ -0,0 +1,560 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#include "psl/stream.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(PSL_WIN)
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif /* defined(PSL_WIN) */
+
+/* Default elements per window, a few MiB per column */
+#define PSL_STREAM_WINDOW_SIZE ((size_t)1 << 20)
+
+typedef struct {
+#if defined(PSL_WIN)
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int fd;
+#endif /* defined(PSL_WIN) */
+    uint64_t data_offset; /* bytes before the first value */
+    size_t element_size;
+    size_t count;
+    bool writable;
+} PSL_ColumnFile;
+
+/* Mapped elements of a column file */
+
+typedef struct {
+    void* base; /* start of the mapping, aligned on the allocation granularity */
+    size_t size;
+    void* values;
+} PSL_ColumnWindow;
+
+void psl_stream_options_init(PSL_StreamOptions* options)
+{
+    options->count = 0;
+    options->window_size = PSL_STREAM_WINDOW_SIZE;
+    psl_execute_options_init(&options->execute);
+}
+
+/* Platform layer */
+
+PSL_FORCE_INLINE void psl_column_file_init(PSL_ColumnFile* file)
+{
+#if defined(PSL_WIN)
+    file->file = INVALID_HANDLE_VALUE;
+    file->mapping = NULL;
+#else
+    file->fd = -1;
+#endif /* defined(PSL_WIN) */
+    file->data_offset = 0;
+    file->element_size = 0;
+    file->count = 0;
+    file->writable = false;
+}
+
+PSL_FORCE_INLINE bool psl_column_file_is_open(const PSL_ColumnFile* file)
+{
+#if defined(PSL_WIN)
+    return file->file != INVALID_HANDLE_VALUE;
+#else
+    return file->fd != -1;
+#endif /* defined(PSL_WIN) */
+}
+
+/* Alignment of the file offsets mappings start at */
+size_t psl_column_file_granularity(void)
+{
+#if defined(PSL_WIN)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+
+    return (size_t)info.dwAllocationGranularity;
+#else
+    return (size_t)sysconf(_SC_PAGESIZE);
+#endif /* defined(PSL_WIN) */
+}
+
+bool psl_column_file_os_open(PSL_ColumnFile* file, const char* path, bool create)
+{
+#if defined(PSL_WIN)
+    file->file = CreateFileA(path,
+                             create ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+                             FILE_SHARE_READ,
+                             NULL,
+                             create ? CREATE_ALWAYS : OPEN_EXISTING,
+                             FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                             NULL);
+#else
+    file->fd = create ? open(path, O_RDWR | O_CREAT | O_TRUNC, 0644) : open(path, O_RDONLY);
+#endif /* defined(PSL_WIN) */
+
+    file->writable = create;
+
+    return psl_column_file_is_open(file);
+}
+
+bool psl_column_file_os_size(PSL_ColumnFile* file, uint64_t* size)
+{
+#if defined(PSL_WIN)
+    LARGE_INTEGER file_size;
+
+    if(!GetFileSizeEx(file->file, &file_size))
+    {
+        return false;
+    }
+
+    *size = (uint64_t)file_size.QuadPart;
+#else
+    struct stat st;
+
+    if(fstat(file->fd, &st) != 0)
+    {
+        return false;
+    }
+
+    *size = (uint64_t)st.st_size;
+#endif /* defined(PSL_WIN) */
+
+    return true;
+}
+
+/* Reads or writes size bytes at the start of the file */
+bool psl_column_file_os_access_header(PSL_ColumnFile* file, void* data, size_t size, bool write)
+{
+#if defined(PSL_WIN)
+    DWORD transferred = 0;
+    OVERLAPPED overlapped;
+    memset(&overlapped, 0, sizeof(OVERLAPPED));
+
+    const BOOL result = write ? WriteFile(file->file, data, (DWORD)size, &transferred, &overlapped) :
+                                ReadFile(file->file, data, (DWORD)size, &transferred, &overlapped);
+
+    return result && transferred == size;
+#else
+    const ssize_t transferred = write ? pwrite(file->fd, data, size, 0) : pread(file->fd, data, size, 0);
+
+    return transferred == (ssize_t)size;
+#endif /* defined(PSL_WIN) */
+}
+
+bool psl_column_file_os_resize(PSL_ColumnFile* file, uint64_t size)
+{
+#if defined(PSL_WIN)
+    LARGE_INTEGER file_size;
+    file_size.QuadPart = (LONGLONG)size;
+
+    return SetFilePointerEx(file->file, file_size, NULL, FILE_BEGIN) && SetEndOfFile(file->file);
+#else
+    return ftruncate(file->fd, (off_t)size) == 0;
+#endif /* defined(PSL_WIN) */
+}
+
+void psl_column_file_close(PSL_ColumnFile* file)
+{
+#if defined(PSL_WIN)
+    if(file->mapping != NULL)
+    {
+        CloseHandle(file->mapping);
+    }
+
+    if(file->file != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(file->file);
+    }
+#else
+    if(file->fd != -1)
+    {
+        close(file->fd);
+    }
+#endif /* defined(PSL_WIN) */
+
+    psl_column_file_init(file);
+}
+
+/* Maps count elements from start, in sequential access mode */
+bool psl_column_file_map(PSL_ColumnFile* file, size_t start, size_t count, PSL_ColumnWindow* window)
+{
+    const uint64_t offset = file->data_offset + (uint64_t)start * file->element_size;
+    const uint64_t map_offset = offset - offset % psl_column_file_granularity();
+
+    window->size = (size_t)(offset - map_offset) + count * file->element_size;
+
+#if defined(PSL_WIN)
+    if(file->mapping == NULL)
+    {
+        file->mapping = CreateFileMappingA(file->file, NULL, file->writable ? PAGE_READWRITE : PAGE_READONLY, 0, 0, NULL);
+
+        if(file->mapping == NULL)
+        {
+            return false;
+        }
+    }
+
+    window->base = MapViewOfFile(file->mapping,
+                                 file->writable ? FILE_MAP_WRITE : FILE_MAP_READ,
+                                 (DWORD)(map_offset >> 32),
+                                 (DWORD)(map_offset & 0xFFFFFFFF),
+                                 window->size);
+
+    if(window->base == NULL)
+    {
+        return false;
+    }
+#else
+    window->base = mmap(NULL,
+                        window->size,
+                        file->writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                        MAP_SHARED,
+                        file->fd,
+                        (off_t)map_offset);
+
+    if(window->base == MAP_FAILED)
+    {
+        window->base = NULL;
+        return false;
+    }
+
+    madvise(window->base, window->size, MADV_SEQUENTIAL);
+#endif /* defined(PSL_WIN) */
+
+    window->values = (uint8_t*)window->base + (offset - map_offset);
+
+    return true;
+}
+
+void psl_column_file_unmap(PSL_ColumnWindow* window)
+{
+    if(window->base == NULL)
+    {
+        return;
+    }
+
+#if defined(PSL_WIN)
+    UnmapViewOfFile(window->base);
+#else
+    munmap(window->base, window->size);
+#endif /* defined(PSL_WIN) */
+
+    window->base = NULL;
+}
+
+/*
+   Asks the system to read count elements from start in the background, or to drop them from its
+   cache once they have been processed. Windows relies on the sequential scan flag of the file
+*/
+void psl_column_file_advise(PSL_ColumnFile* file, size_t start, size_t count, bool will_need)
+{
+#if defined(PSL_WIN)
+    (void)file;
+    (void)start;
+    (void)count;
+    (void)will_need;
+#else
+    posix_fadvise(file->fd,
+                  (off_t)(file->data_offset + (uint64_t)start * file->element_size),
+                  (off_t)(count * file->element_size),
+                  will_need ? POSIX_FADV_WILLNEED : POSIX_FADV_DONTNEED);
+#endif /* defined(PSL_WIN) */
+}
+
+/* Column files */
+
+bool psl_column_file_open_input(PSL_ColumnFile* file, const char* path, PSL_ColumnFormat format, char** error)
+{
+    if(path == NULL || !psl_column_file_os_open(file, path, false))
+    {
+        *error = "Cannot open input column file";
+        return false;
+    }
+
+    uint64_t size;
+
+    if(!psl_column_file_os_size(file, &size))
+    {
+        *error = "Cannot get the size of input column file";
+        return false;
+    }
+
+    file->element_size = psl_column_format_size(format);
+
+    PSL_ColumnFileHeader header;
+
+    if(size >= sizeof(PSL_ColumnFileHeader) &&
+       psl_column_file_os_access_header(file, &header, sizeof(PSL_ColumnFileHeader), false) &&
+       memcmp(header.magic, PSL_COLUMN_FILE_MAGIC, sizeof(header.magic)) == 0)
+    {
+        if(header.version != PSL_COLUMN_FILE_VERSION)
+        {
+            *error = "Unsupported column file version";
+            return false;
+        }
+
+        if(header.format != (uint32_t)format)
+        {
+            *error = "Column file format does not match the format of its column";
+            return false;
+        }
+
+        if(header.count > (size - sizeof(PSL_ColumnFileHeader)) / file->element_size)
+        {
+            *error = "Column file is smaller than the count of its header";
+            return false;
+        }
+
+        file->data_offset = sizeof(PSL_ColumnFileHeader);
+        file->count = (size_t)header.count;
+
+        return true;
+    }
+
+    if(size % file->element_size != 0)
+    {
+        *error = "Raw column file size is not a multiple of the size of its elements";
+        return false;
+    }
+
+    file->data_offset = 0;
+    file->count = (size_t)(size / file->element_size);
+
+    return true;
+}
+
+bool psl_column_file_create(PSL_ColumnFile* file,
+                            const char* path,
+                            PSL_ColumnFormat format,
+                            size_t count,
+                            PSL_ColumnFileLayout layout,
+                            char** error)
+{
+    if(path == NULL || !psl_column_file_os_open(file, path, true))
+    {
+        *error = "Cannot create export column file";
+        return false;
+    }
+
+    file->element_size = psl_column_format_size(format);
+    file->count = count;
+    file->data_offset = layout == PSL_ColumnFileLayout_Container ? sizeof(PSL_ColumnFileHeader) : 0;
+
+    if(!psl_column_file_os_resize(file, file->data_offset + (uint64_t)count * file->element_size))
+    {
+        *error = "Cannot resize export column file";
+        return false;
+    }
+
+    if(layout == PSL_ColumnFileLayout_Container)
+    {
+        PSL_ColumnFileHeader header;
+        memset(&header, 0, sizeof(PSL_ColumnFileHeader));
+        memcpy(header.magic, PSL_COLUMN_FILE_MAGIC, sizeof(header.magic));
+        header.version = PSL_COLUMN_FILE_VERSION;
+        header.format = (uint32_t)format;
+        header.count = (uint64_t)count;
+
+        if(!psl_column_file_os_access_header(file, &header, sizeof(PSL_ColumnFileHeader), true))
+        {
+            *error = "Cannot write the header of export column file";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Execution */
+
+/* Opens the inputs and finds the count of elements to process, then creates the exports */
+bool psl_stream_open_files(PSL_Kernel* kernel,
+                           const PSL_FileBindings* files,
+                           PSL_ColumnFile* column_files,
+                           size_t* count)
+{
+    size_t input_count = 0;
+    bool has_input = false;
+
+    for(uint32_t i = 0; i < kernel->ir.num_params; i++)
+    {
+        const PSL_IRParam* param = &kernel->ir.params[i];
+
+        if(param->kind != PSL_IRParamKind_Input)
+        {
+            continue;
+        }
+
+        PSL_ColumnFile* file = &column_files[param->index];
+
+        if(!psl_column_file_open_input(file, files->paths[param->index], param->format, &kernel->error))
+        {
+            return false;
+        }
+
+        if(has_input && file->count != input_count)
+        {
+            kernel->error = "Input column files hold different counts of elements";
+            return false;
+        }
+
+        input_count = file->count;
+        has_input = true;
+    }
+
+    if(*count == 0)
+    {
+        *count = input_count;
+    }
+    else if(has_input && input_count < *count)
+    {
+        kernel->error = "Input column files hold fewer elements than the count to process";
+        return false;
+    }
+
+    for(uint32_t i = 0; i < kernel->ir.num_params; i++)
+    {
+        const PSL_IRParam* param = &kernel->ir.params[i];
+
+        if(param->kind == PSL_IRParamKind_Export &&
+           !psl_column_file_create(&column_files[param->index],
+                                   files->paths[param->index],
+                                   param->format,
+                                   *count,
+                                   files->export_layout,
+                                   &kernel->error))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Maps the window of every column file, returns false if one of them cannot be mapped */
+bool psl_stream_map_window(PSL_Kernel* kernel,
+                           PSL_ColumnFile* column_files,
+                           PSL_ColumnWindow* windows,
+                           void** columns,
+                           size_t start,
+                           size_t count)
+{
+    for(uint32_t i = 0; i < kernel->ir.num_columns; i++)
+    {
+        if(!psl_column_file_is_open(&column_files[i]))
+        {
+            continue;
+        }
+
+        if(!psl_column_file_map(&column_files[i], start, count, &windows[i]))
+        {
+            kernel->error = "Cannot map column file";
+            return false;
+        }
+
+        columns[i] = windows[i].values;
+    }
+
+    return true;
+}
+
+bool psl_kernel_execute_files(PSL_Kernel* kernel, const PSL_FileBindings* files, const PSL_StreamOptions* options)
+{
+    PSL_ASSERT(kernel->func != NULL, "Kernel has not been compiled");
+
+    PSL_StreamOptions default_options;
+
+    if(options == NULL)
+    {
+        psl_stream_options_init(&default_options);
+        options = &default_options;
+    }
+
+    const uint32_t num_columns = kernel->ir.num_columns;
+
+    PSL_ColumnFile* column_files = (PSL_ColumnFile*)malloc(num_columns * sizeof(PSL_ColumnFile) + 1);
+    PSL_ColumnWindow* windows = (PSL_ColumnWindow*)calloc(num_columns + 1, sizeof(PSL_ColumnWindow));
+    void** columns = (void**)calloc(num_columns + 1, sizeof(void*));
+
+    for(uint32_t i = 0; i < num_columns; i++)
+    {
+        psl_column_file_init(&column_files[i]);
+    }
+
+    /* Reductions keep the result they are bound to */
+    for(uint32_t i = 0; i < kernel->ir.num_params; i++)
+    {
+        if(kernel->ir.params[i].kind == PSL_IRParamKind_Reduction)
+        {
+            columns[kernel->ir.params[i].index] = files->bindings.columns[kernel->ir.params[i].index];
+        }
+    }
+
+    PSL_Bindings bindings;
+    bindings.columns = columns;
+    bindings.uniforms = files->bindings.uniforms;
+
+    size_t count = options->count;
+    bool success = psl_stream_open_files(kernel, files, column_files, &count);
+
+    const size_t window_size = options->window_size < PSL_LANES ?
+                               PSL_LANES :
+                               options->window_size - options->window_size % PSL_LANES;
+
+    /* Every window executes the same variants, compiled before the first one is mapped */
+    if(success)
+    {
+        psl_kernel_reset_reductions(kernel, &bindings);
+        psl_kernel_prepare(kernel, &options->execute);
+    }
+
+    for(size_t start = 0; success && start < count; start += window_size)
+    {
+        const size_t window_count = count - start < window_size ? count - start : window_size;
+        const size_t next_count = count - start - window_count < window_size ? count - start - window_count : window_size;
+
+        for(uint32_t i = 0; next_count > 0 && i < num_columns; i++)
+        {
+            if(psl_column_file_is_open(&column_files[i]) && !column_files[i].writable)
+            {
+                psl_column_file_advise(&column_files[i], start + window_count, next_count, true);
+            }
+        }
+
+        success = psl_stream_map_window(kernel, column_files, windows, columns, start, window_count);
+
+        if(success)
+        {
+            psl_kernel_accumulate(kernel, &bindings, window_count, &options->execute);
+        }
+
+        /* Processed inputs are not needed anymore, exports are written back by the system */
+        for(uint32_t i = 0; i < num_columns; i++)
+        {
+            psl_column_file_unmap(&windows[i]);
+
+            if(psl_column_file_is_open(&column_files[i]) && !column_files[i].writable)
+            {
+                psl_column_file_advise(&column_files[i], start, window_count, false);
+            }
+        }
+    }
+
+    for(uint32_t i = 0; i < num_columns; i++)
+    {
+        psl_column_file_close(&column_files[i]);
+    }
+
+    free(columns);
+    free(windows);
+    free(column_files);
+
+    return success;
+}
@@ -0,0 +1,1010 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#include "psl/x64.h"
+#include "psl/profile.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+void psl_code_buffer_init(PSL_CodeBuffer* buffer, const size_t capacity)
+{
+    buffer->data = (uint8_t*)malloc(capacity);
+    psl_profile_alloc(capacity);
+    buffer->size = 0;
+    buffer->capacity = capacity;
+}
+
+PSL_FORCE_INLINE void psl_code_buffer_reserve(PSL_CodeBuffer* buffer, const size_t size)
+{
+    if((buffer->size + size) <= buffer->capacity)
+    {
+        return;
+    }
+
+    size_t new_capacity = buffer->capacity * 2;
+
+    while(new_capacity < (buffer->size + size))
+    {
+        new_capacity *= 2;
+    }
+
+    uint8_t* new_data = (uint8_t*)realloc(buffer->data, new_capacity);
+
+    PSL_ASSERT(new_data != NULL, "Error during code buffer reallocation");
+
+    psl_profile_alloc(new_capacity);
+
+    buffer->data = new_data;
+    buffer->capacity = new_capacity;
+}
+
+void psl_code_buffer_emit8(PSL_CodeBuffer* buffer, uint8_t value)
+{
+    psl_code_buffer_reserve(buffer, 1);
+    buffer->data[buffer->size++] = value;
+}
+
+void psl_code_buffer_emit32(PSL_CodeBuffer* buffer, uint32_t value)
+{
+    psl_code_buffer_reserve(buffer, 4);
+    memcpy(buffer->data + buffer->size, &value, 4);
+    buffer->size += 4;
+}
+
+void psl_code_buffer_emit64(PSL_CodeBuffer* buffer, uint64_t value)
+{
+    psl_code_buffer_reserve(buffer, 8);
+    memcpy(buffer->data + buffer->size, &value, 8);
+    buffer->size += 8;
+}
+
+void psl_code_buffer_destroy(PSL_CodeBuffer* buffer)
+{
+    free(buffer->data);
+    buffer->data = NULL;
+    buffer->size = 0;
+    buffer->capacity = 0;
+}
+
+/* Encoding helpers */
+
+PSL_FORCE_INLINE bool x64_fits_int8(int32_t value)
+{
+    return value >= -128 && value <= 127;
+}
+
+PSL_FORCE_INLINE uint8_t x64_scale_bits(uint8_t scale)
+{
+    switch(scale)
+    {
+        case 2:
+            return 1;
+        case 4:
+            return 2;
+        case 8:
+            return 3;
+        default:
+            return 0;
+    }
+}
+
+PSL_FORCE_INLINE uint32_t x64_index_bits(const PSL_X64Mem* mem)
+{
+    return mem->index == PSL_GPR_None ? 0 : (uint32_t)mem->index;
+}
+
+/* Emits the ModRM, optional SIB and displacement bytes for a memory operand */
+void x64_emit_modrm_mem(PSL_CodeBuffer* buffer, uint32_t reg, const PSL_X64Mem* mem)
+{
+    const uint8_t base = (uint8_t)(mem->base & 7);
+    const bool need_sib = mem->index != PSL_GPR_None || base == 4;
+
+    uint8_t mod;
+
+    /* rbp and r13 as base cannot be encoded without displacement */
+    if(mem->disp == 0 && base != 5)
+    {
+        mod = 0;
+    }
+    else if(x64_fits_int8(mem->disp))
+    {
+        mod = 1;
+    }
+    else
+    {
+        mod = 2;
+    }
+
+    if(need_sib)
+    {
+        const uint8_t index = mem->index == PSL_GPR_None ? 4 : (uint8_t)(mem->index & 7);
+
+        psl_code_buffer_emit8(buffer, (uint8_t)((mod << 6) | ((reg & 7) << 3) | 4));
+        psl_code_buffer_emit8(buffer, (uint8_t)((x64_scale_bits(mem->scale) << 6) | (index << 3) | base));
+    }
+    else
+    {
+        psl_code_buffer_emit8(buffer, (uint8_t)((mod << 6) | ((reg & 7) << 3) | base));
+    }
+
+    if(mod == 1)
+    {
+        psl_code_buffer_emit8(buffer, (uint8_t)(int8_t)mem->disp);
+    }
+    else if(mod == 2)
+    {
+        psl_code_buffer_emit32(buffer, (uint32_t)mem->disp);
+    }
+}
+
+PSL_FORCE_INLINE void x64_emit_modrm_reg(PSL_CodeBuffer* buffer, uint32_t reg, uint32_t rm)
+{
+    psl_code_buffer_emit8(buffer, (uint8_t)(0xC0 | ((reg & 7) << 3) | (rm & 7)));
+}
+
+/* Emits a REX prefix if needed (or always when w is set) */
+PSL_FORCE_INLINE void x64_emit_rex(PSL_CodeBuffer* buffer, bool w, uint32_t reg, uint32_t index, uint32_t base)
+{
+    const uint8_t rex = (uint8_t)(0x40 |
+                                  (w ? 8 : 0) |
+                                  (((reg >> 3) & 1) << 2) |
+                                  (((index >> 3) & 1) << 1) |
+                                  ((base >> 3) & 1));
+
+    if(rex != 0x40)
+    {
+        psl_code_buffer_emit8(buffer, rex);
+    }
+}
+
+/* General purpose instructions */
+
+void psl_x64_push(PSL_CodeBuffer* buffer, PSL_GPR reg)
+{
+    x64_emit_rex(buffer, false, 0, 0, (uint32_t)reg);
+    psl_code_buffer_emit8(buffer, (uint8_t)(0x50 | (reg & 7)));
+}
+
+void psl_x64_pop(PSL_CodeBuffer* buffer, PSL_GPR reg)
+{
+    x64_emit_rex(buffer, false, 0, 0, (uint32_t)reg);
+    psl_code_buffer_emit8(buffer, (uint8_t)(0x58 | (reg & 7)));
+}
+
+void psl_x64_mov_rr(PSL_CodeBuffer* buffer, PSL_GPR dst, PSL_GPR src)
+{
+    x64_emit_rex(buffer, true, (uint32_t)src, 0, (uint32_t)dst);
+    psl_code_buffer_emit8(buffer, 0x89);
+    x64_emit_modrm_reg(buffer, (uint32_t)src, (uint32_t)dst);
+}
+
+void psl_x64_mov_rm(PSL_CodeBuffer* buffer, PSL_GPR dst, const PSL_X64Mem* src)
+{
+    x64_emit_rex(buffer, true, (uint32_t)dst, x64_index_bits(src), (uint32_t)src->base);
+    psl_code_buffer_emit8(buffer, 0x8B);
+    x64_emit_modrm_mem(buffer, (uint32_t)dst, src);
+}
+
+void psl_x64_mov_mr(PSL_CodeBuffer* buffer, const PSL_X64Mem* dst, PSL_GPR src)
+{
+    x64_emit_rex(buffer, true, (uint32_t)src, x64_index_bits(dst), (uint32_t)dst->base);
+    psl_code_buffer_emit8(buffer, 0x89);
+    x64_emit_modrm_mem(buffer, (uint32_t)src, dst);
+}
+
+void psl_x64_mov_ri32(PSL_CodeBuffer* buffer, PSL_GPR dst, uint32_t imm)
+{
+    x64_emit_rex(buffer, false, 0, 0, (uint32_t)dst);
+    psl_code_buffer_emit8(buffer, (uint8_t)(0xB8 | (dst & 7)));
+    psl_code_buffer_emit32(buffer, imm);
+}
+
+void psl_x64_mov_ri64(PSL_CodeBuffer* buffer, PSL_GPR dst, uint64_t imm)
+{
+    x64_emit_rex(buffer, true, 0, 0, (uint32_t)dst);
+    psl_code_buffer_emit8(buffer, (uint8_t)(0xB8 | (dst & 7)));
+    psl_code_buffer_emit64(buffer, imm);
+}
+
+void psl_x64_lea(PSL_CodeBuffer* buffer, PSL_GPR dst, const PSL_X64Mem* src)
+{
+    x64_emit_rex(buffer, true, (uint32_t)dst, x64_index_bits(src), (uint32_t)src->base);
+    psl_code_buffer_emit8(buffer, 0x8D);
+    x64_emit_modrm_mem(buffer, (uint32_t)dst, src);
+}
+
+/* Group 1 instructions (add, or, and, sub, xor, cmp) with an immediate, opcode extension in ext */
+void x64_emit_group1_ri(PSL_CodeBuffer* buffer, uint32_t ext, PSL_GPR dst, int32_t imm)
+{
+    x64_emit_rex(buffer, true, 0, 0, (uint32_t)dst);
+
+    if(x64_fits_int8(imm))
+    {
+        psl_code_buffer_emit8(buffer, 0x83);
+        x64_emit_modrm_reg(buffer, ext, (uint32_t)dst);
+        psl_code_buffer_emit8(buffer, (uint8_t)(int8_t)imm);
+    }
+    else
+    {
+        psl_code_buffer_emit8(buffer, 0x81);
+        x64_emit_modrm_reg(buffer, ext, (uint32_t)dst);
+        psl_code_buffer_emit32(buffer, (uint32_t)imm);
+    }
+}
+
+void psl_x64_add_ri(PSL_CodeBuffer* buffer, PSL_GPR dst, int32_t imm)
+{
+    x64_emit_group1_ri(buffer, 0, dst, imm);
+}
+
+void psl_x64_sub_ri(PSL_CodeBuffer* buffer, PSL_GPR dst, int32_t imm)
+{
+    x64_emit_group1_ri(buffer, 5, dst, imm);
+}
+
+void psl_x64_and_ri(PSL_CodeBuffer* buffer, PSL_GPR dst, int32_t imm)
+{
+    x64_emit_group1_ri(buffer, 4, dst, imm);
+}
+
+void psl_x64_cmp_rr(PSL_CodeBuffer* buffer, PSL_GPR a, PSL_GPR b)
+{
+    x64_emit_rex(buffer, true, (uint32_t)b, 0, (uint32_t)a);
+    psl_code_buffer_emit8(buffer, 0x39);
+    x64_emit_modrm_reg(buffer, (uint32_t)b, (uint32_t)a);
+}
+
+void psl_x64_xor_rr32(PSL_CodeBuffer* buffer, PSL_GPR dst, PSL_GPR src)
+{
+    x64_emit_rex(buffer, false, (uint32_t)src, 0, (uint32_t)dst);
+    psl_code_buffer_emit8(buffer, 0x31);
+    x64_emit_modrm_reg(buffer, (uint32_t)src, (uint32_t)dst);
+}
+
+void psl_x64_probe(PSL_CodeBuffer* buffer, const PSL_X64Mem* mem)
+{
+    x64_emit_rex(buffer, false, 0, x64_index_bits(mem), (uint32_t)mem->base);
+    psl_code_buffer_emit8(buffer, 0x85);
+    x64_emit_modrm_mem(buffer, (uint32_t)PSL_GPR_RAX, mem);
+}
+
+void psl_x64_prefetch(PSL_CodeBuffer* buffer, const PSL_X64Mem* mem)
+{
+    x64_emit_rex(buffer, false, 0, x64_index_bits(mem), (uint32_t)mem->base);
+    psl_code_buffer_emit8(buffer, 0x0F);
+    psl_code_buffer_emit8(buffer, 0x18);
+    x64_emit_modrm_mem(buffer, 1, mem);
+}
+
+void psl_x64_sfence(PSL_CodeBuffer* buffer)
+{
+    psl_code_buffer_emit8(buffer, 0x0F);
+    psl_code_buffer_emit8(buffer, 0xAE);
+    psl_code_buffer_emit8(buffer, 0xF8);
+}
+
+size_t psl_x64_jcc(PSL_CodeBuffer* buffer, PSL_Cond cond)
+{
+    psl_code_buffer_emit8(buffer, 0x0F);
+    psl_code_buffer_emit8(buffer, (uint8_t)(0x80 | cond));
+    psl_code_buffer_emit32(buffer, 0);
+
+    return buffer->size - 4;
+}
+
+size_t psl_x64_jmp(PSL_CodeBuffer* buffer)
+{
+    psl_code_buffer_emit8(buffer, 0xE9);
+    psl_code_buffer_emit32(buffer, 0);
+
+    return buffer->size - 4;
+}
+
+void psl_x64_patch_rel32(PSL_CodeBuffer* buffer, size_t patch_offset, size_t target_offset)
+{
+    const int32_t rel = (int32_t)((int64_t)target_offset - (int64_t)(patch_offset + 4));
+    memcpy(buffer->data + patch_offset, &rel, 4);
+}
+
+void psl_x64_call_r(PSL_CodeBuffer* buffer, PSL_GPR reg)
+{
+    x64_emit_rex(buffer, false, 0, 0, (uint32_t)reg);
+    psl_code_buffer_emit8(buffer, 0xFF);
+    x64_emit_modrm_reg(buffer, 2, (uint32_t)reg);
+}
+
+size_t psl_x64_call_rel32(PSL_CodeBuffer* buffer)
+{
+    psl_code_buffer_emit8(buffer, 0xE8);
+    psl_code_buffer_emit32(buffer, 0);
+
+    return buffer->size - 4;
+}
+
+void psl_x64_ret(PSL_CodeBuffer* buffer)
+{
+    psl_code_buffer_emit8(buffer, 0xC3);
+}
+
+/* VEX encoded instructions */
+
+typedef enum {
+    X64_VEX_PP_NONE = 0,
+    X64_VEX_PP_66 = 1,
+    X64_VEX_PP_F3 = 2,
+    X64_VEX_PP_F2 = 3,
+} X64VexPP;
+
+typedef enum {
+    X64_VEX_MAP_0F = 1,
+    X64_VEX_MAP_0F38 = 2,
+    X64_VEX_MAP_0F3A = 3,
+} X64VexMap;
+
+typedef struct {
+    uint8_t opcode;
+    uint8_t pp;
+    uint8_t map;
+    uint8_t w;
+    uint8_t l;
+} X64VexEncoding;
+
+static const X64VexEncoding _vex_encodings[PSL_X64VexOp_Count] = {
+    /* vmovups */       { 0x10, X64_VEX_PP_NONE, X64_VEX_MAP_0F, 0, 1 },
+    /* vmovups_store */ { 0x11, X64_VEX_PP_NONE, X64_VEX_MAP_0F, 0, 1 },
+    /* vmovaps */       { 0x28, X64_VEX_PP_NONE, X64_VEX_MAP_0F, 0, 1 },
+    /* vmovaps_store */ { 0x29, X64_VEX_PP_NONE, X64_VEX_MAP_0F, 0, 1 },
+    /* vaddps */        { 0x58, X64_VEX_PP_NONE, X64_VEX_MAP_0F, 0, 1 },
+    /* vsubps */        { 0x5C, X64_VEX_PP_NONE, X64_VEX_MAP_0F, 0, 1 },
+    /* vmulps */        { 0x59, X64_VEX_PP_NONE, X64_VEX_MAP_0F, 0, 1 },
+    /* vdivps */        { 0x5E, X64_VEX_PP_NONE, X64_VEX_MAP_0F, 0, 1 },
+    /* vminps */        { 0x5D, X64_VEX_PP_NONE, X64_VEX_MAP_0F, 0, 1 },
+    /* vmaxps */        { 0x5F, X64_VEX_PP_NONE, X64_VEX_MAP_0F, 0, 1 },
+    /* vsqrtps */       { 0x51, X64_VEX_PP_NONE, X64_VEX_MAP_0F, 0, 1 },
+    /* vandps */        { 0x54, X64_VEX_PP_NONE, X64_VEX_MAP_0F, 0, 1 },
+    /* vandnps */       { 0x55, X64_VEX_PP_NONE, X64_VEX_MAP_0F, 0, 1 },
+    /* vorps */         { 0x56, X64_VEX_PP_NONE, X64_VEX_MAP_0F, 0, 1 },
+    /* vxorps */        { 0x57, X64_VEX_PP_NONE, X64_VEX_MAP_0F, 0, 1 },
+    /* vroundps */      { 0x08, X64_VEX_PP_66, X64_VEX_MAP_0F3A, 0, 1 },
+    /* vcmpps */        { 0xC2, X64_VEX_PP_NONE, X64_VEX_MAP_0F, 0, 1 },
+    /* vblendvps */     { 0x4A, X64_VEX_PP_66, X64_VEX_MAP_0F3A, 0, 1 },
+    /* vbroadcastss */  { 0x18, X64_VEX_PP_66, X64_VEX_MAP_0F38, 0, 1 },
+    /* vpbroadcastd */  { 0x58, X64_VEX_PP_66, X64_VEX_MAP_0F38, 0, 1 },
+    /* vmovd */         { 0x6E, X64_VEX_PP_66, X64_VEX_MAP_0F, 0, 0 },
+    /* vaddpd */        { 0x58, X64_VEX_PP_66, X64_VEX_MAP_0F, 0, 1 },
+    /* vsubpd */        { 0x5C, X64_VEX_PP_66, X64_VEX_MAP_0F, 0, 1 },
+    /* vmulpd */        { 0x59, X64_VEX_PP_66, X64_VEX_MAP_0F, 0, 1 },
+    /* vdivpd */        { 0x5E, X64_VEX_PP_66, X64_VEX_MAP_0F, 0, 1 },
+    /* vminpd */        { 0x5D, X64_VEX_PP_66, X64_VEX_MAP_0F, 0, 1 },
+    /* vmaxpd */        { 0x5F, X64_VEX_PP_66, X64_VEX_MAP_0F, 0, 1 },
+    /* vsqrtpd */       { 0x51, X64_VEX_PP_66, X64_VEX_MAP_0F, 0, 1 },
+    /* vandpd */        { 0x54, X64_VEX_PP_66, X64_VEX_MAP_0F, 0, 1 },
+    /* vxorpd */        { 0x57, X64_VEX_PP_66, X64_VEX_MAP_0F, 0, 1 },
+    /* vroundpd */      { 0x09, X64_VEX_PP_66, X64_VEX_MAP_0F3A, 0, 1 },
+    /* vcmppd */        { 0xC2, X64_VEX_PP_66, X64_VEX_MAP_0F, 0, 1 },
+    /* vblendvpd */     { 0x4B, X64_VEX_PP_66, X64_VEX_MAP_0F3A, 0, 1 },
+    /* vpbroadcastq */  { 0x59, X64_VEX_PP_66, X64_VEX_MAP_0F38, 0, 1 },
+    /* vbroadcastsd */  { 0x19, X64_VEX_PP_66, X64_VEX_MAP_0F38, 0, 1 },
+    /* vmovq */         { 0x6E, X64_VEX_PP_66, X64_VEX_MAP_0F, 1, 0 },
+    /* vcvtps2pd */     { 0x5A, X64_VEX_PP_NONE, X64_VEX_MAP_0F, 0, 1 },
+    /* vcvtpd2ps */     { 0x5A, X64_VEX_PP_66, X64_VEX_MAP_0F, 0, 1 },
+    /* vinsertf128 */   { 0x18, X64_VEX_PP_66, X64_VEX_MAP_0F3A, 0, 1 },
+    /* vextractf128 */  { 0x19, X64_VEX_PP_66, X64_VEX_MAP_0F3A, 0, 1 },
+    /* vcvtph2ps */     { 0x13, X64_VEX_PP_66, X64_VEX_MAP_0F38, 0, 1 },
+    /* vcvtps2ph */     { 0x1D, X64_VEX_PP_66, X64_VEX_MAP_0F3A, 0, 1 },
+    /* vcvtdq2ps */     { 0x5B, X64_VEX_PP_NONE, X64_VEX_MAP_0F, 0, 1 },
+    /* vcvtps2dq */     { 0x5B, X64_VEX_PP_66, X64_VEX_MAP_0F, 0, 1 },
+    /* vpmovzxbd */     { 0x31, X64_VEX_PP_66, X64_VEX_MAP_0F38, 0, 1 },
+    /* vpmovzxwd */     { 0x33, X64_VEX_PP_66, X64_VEX_MAP_0F38, 0, 1 },
+    /* vpackusdw */     { 0x2B, X64_VEX_PP_66, X64_VEX_MAP_0F38, 0, 0 },
+    /* vpackuswb */     { 0x67, X64_VEX_PP_66, X64_VEX_MAP_0F, 0, 0 },
+    /* vmovq_store */   { 0xD6, X64_VEX_PP_66, X64_VEX_MAP_0F, 0, 0 },
+    /* vmovups_store128 */ { 0x11, X64_VEX_PP_NONE, X64_VEX_MAP_0F, 0, 0 },
+    /* vfmadd231ps */   { 0xB8, X64_VEX_PP_66, X64_VEX_MAP_0F38, 0, 1 },
+    /* vfmadd231pd */   { 0xB8, X64_VEX_PP_66, X64_VEX_MAP_0F38, 1, 1 },
+    /* vfnmadd231ps */  { 0xBC, X64_VEX_PP_66, X64_VEX_MAP_0F38, 0, 1 },
+    /* vfnmadd231pd */  { 0xBC, X64_VEX_PP_66, X64_VEX_MAP_0F38, 1, 1 },
+    /* vrcpps */        { 0x53, X64_VEX_PP_NONE, X64_VEX_MAP_0F, 0, 1 },
+    /* vrsqrtps */      { 0x52, X64_VEX_PP_NONE, X64_VEX_MAP_0F, 0, 1 },
+    /* vmovntps */      { 0x2B, X64_VEX_PP_NONE, X64_VEX_MAP_0F, 0, 1 },
+};
+
+/* Emits the 2 bytes VEX prefix when possible, the 3 bytes one otherwise */
+void x64_emit_vex_prefix(PSL_CodeBuffer* buffer,
+                         const X64VexEncoding* encoding,
+                         uint32_t reg,
+                         uint32_t index,
+                         uint32_t base,
+                         uint32_t vvvv)
+{
+    const uint8_t r = (uint8_t)(((~reg >> 3) & 1) << 7);
+    const uint8_t x = (uint8_t)(((~index >> 3) & 1) << 6);
+    const uint8_t b = (uint8_t)(((~base >> 3) & 1) << 5);
+    const uint8_t v = (uint8_t)((~vvvv & 0xF) << 3);
+    const uint8_t l = (uint8_t)(encoding->l << 2);
+
+    if(x != 0 && b != 0 && encoding->w == 0 && encoding->map == X64_VEX_MAP_0F)
+    {
+        psl_code_buffer_emit8(buffer, 0xC5);
+        psl_code_buffer_emit8(buffer, (uint8_t)(r | v | l | encoding->pp));
+    }
+    else
+    {
+        psl_code_buffer_emit8(buffer, 0xC4);
+        psl_code_buffer_emit8(buffer, (uint8_t)(r | x | b | encoding->map));
+        psl_code_buffer_emit8(buffer, (uint8_t)((encoding->w << 7) | v | l | encoding->pp));
+    }
+}
+
+void psl_x64_vex_rr(PSL_CodeBuffer* buffer, PSL_X64VexOp op, uint32_t reg, uint32_t vvvv, uint32_t rm)
+{
+    const X64VexEncoding* encoding = &_vex_encodings[op];
+
+    x64_emit_vex_prefix(buffer, encoding, reg, 0, rm, vvvv);
+    psl_code_buffer_emit8(buffer, encoding->opcode);
+    x64_emit_modrm_reg(buffer, reg, rm);
+}
+
+void psl_x64_vex_rm(PSL_CodeBuffer* buffer, PSL_X64VexOp op, uint32_t reg, uint32_t vvvv, const PSL_X64Mem* rm)
+{
+    const X64VexEncoding* encoding = &_vex_encodings[op];
+
+    x64_emit_vex_prefix(buffer, encoding, reg, x64_index_bits(rm), (uint32_t)rm->base, vvvv);
+    psl_code_buffer_emit8(buffer, encoding->opcode);
+    x64_emit_modrm_mem(buffer, reg, rm);
+}
+
+void psl_x64_vzeroupper(PSL_CodeBuffer* buffer)
+{
+    psl_code_buffer_emit8(buffer, 0xC5);
+    psl_code_buffer_emit8(buffer, 0xF8);
+    psl_code_buffer_emit8(buffer, 0x77);
+}
+
+/* Decoding */
+
+typedef enum {
+    X64_OPERAND_YMM,
+    X64_OPERAND_XMM,
+    X64_OPERAND_GPR, /* 64 bits with VEX.W, 32 bits otherwise */
+} X64OperandKind;
+
+typedef enum {
+    X64_FORM_UNARY,  /* reg, rm */
+    X64_FORM_BINARY, /* reg, vvvv, rm */
+    X64_FORM_STORE,  /* rm, reg */
+} X64Form;
+
+typedef enum {
+    X64_IMM_NONE,
+    X64_IMM_8,
+    X64_IMM_IS4, /* register in bits 7:4 */
+} X64Imm;
+
+typedef struct {
+    const char* name;
+    uint8_t reg;
+    uint8_t rm;
+    uint8_t form;
+    uint8_t imm;
+} X64VexSyntax;
+
+#define X64_Y X64_OPERAND_YMM
+#define X64_X X64_OPERAND_XMM
+
+static const X64VexSyntax _vex_syntaxes[PSL_X64VexOp_Count] = {
+    { "vmovups", X64_Y, X64_Y, X64_FORM_UNARY, X64_IMM_NONE },
+    { "vmovups", X64_Y, X64_Y, X64_FORM_STORE, X64_IMM_NONE },
+    { "vmovaps", X64_Y, X64_Y, X64_FORM_UNARY, X64_IMM_NONE },
+    { "vmovaps", X64_Y, X64_Y, X64_FORM_STORE, X64_IMM_NONE },
+    { "vaddps", X64_Y, X64_Y, X64_FORM_BINARY, X64_IMM_NONE },
+    { "vsubps", X64_Y, X64_Y, X64_FORM_BINARY, X64_IMM_NONE },
+    { "vmulps", X64_Y, X64_Y, X64_FORM_BINARY, X64_IMM_NONE },
+    { "vdivps", X64_Y, X64_Y, X64_FORM_BINARY, X64_IMM_NONE },
+    { "vminps", X64_Y, X64_Y, X64_FORM_BINARY, X64_IMM_NONE },
+    { "vmaxps", X64_Y, X64_Y, X64_FORM_BINARY, X64_IMM_NONE },
+    { "vsqrtps", X64_Y, X64_Y, X64_FORM_UNARY, X64_IMM_NONE },
+    { "vandps", X64_Y, X64_Y, X64_FORM_BINARY, X64_IMM_NONE },
+    { "vandnps", X64_Y, X64_Y, X64_FORM_BINARY, X64_IMM_NONE },
+    { "vorps", X64_Y, X64_Y, X64_FORM_BINARY, X64_IMM_NONE },
+    { "vxorps", X64_Y, X64_Y, X64_FORM_BINARY, X64_IMM_NONE },
+    { "vroundps", X64_Y, X64_Y, X64_FORM_UNARY, X64_IMM_8 },
+    { "vcmpps", X64_Y, X64_Y, X64_FORM_BINARY, X64_IMM_8 },
+    { "vblendvps", X64_Y, X64_Y, X64_FORM_BINARY, X64_IMM_IS4 },
+    { "vbroadcastss", X64_Y, X64_X, X64_FORM_UNARY, X64_IMM_NONE },
+    { "vpbroadcastd", X64_Y, X64_X, X64_FORM_UNARY, X64_IMM_NONE },
+    { "vmovd", X64_X, X64_OPERAND_GPR, X64_FORM_UNARY, X64_IMM_NONE },
+    { "vaddpd", X64_Y, X64_Y, X64_FORM_BINARY, X64_IMM_NONE },
+    { "vsubpd", X64_Y, X64_Y, X64_FORM_BINARY, X64_IMM_NONE },
+    { "vmulpd", X64_Y, X64_Y, X64_FORM_BINARY, X64_IMM_NONE },
+    { "vdivpd", X64_Y, X64_Y, X64_FORM_BINARY, X64_IMM_NONE },
+    { "vminpd", X64_Y, X64_Y, X64_FORM_BINARY, X64_IMM_NONE },
+    { "vmaxpd", X64_Y, X64_Y, X64_FORM_BINARY, X64_IMM_NONE },
+    { "vsqrtpd", X64_Y, X64_Y, X64_FORM_UNARY, X64_IMM_NONE },
+    { "vandpd", X64_Y, X64_Y, X64_FORM_BINARY, X64_IMM_NONE },
+    { "vxorpd", X64_Y, X64_Y, X64_FORM_BINARY, X64_IMM_NONE },
+    { "vroundpd", X64_Y, X64_Y, X64_FORM_UNARY, X64_IMM_8 },
+    { "vcmppd", X64_Y, X64_Y, X64_FORM_BINARY, X64_IMM_8 },
+    { "vblendvpd", X64_Y, X64_Y, X64_FORM_BINARY, X64_IMM_IS4 },
+    { "vpbroadcastq", X64_Y, X64_X, X64_FORM_UNARY, X64_IMM_NONE },
+    { "vbroadcastsd", X64_Y, X64_X, X64_FORM_UNARY, X64_IMM_NONE },
+    { "vmovq", X64_X, X64_OPERAND_GPR, X64_FORM_UNARY, X64_IMM_NONE },
+    { "vcvtps2pd", X64_Y, X64_X, X64_FORM_UNARY, X64_IMM_NONE },
+    { "vcvtpd2ps", X64_X, X64_Y, X64_FORM_UNARY, X64_IMM_NONE },
+    { "vinsertf128", X64_Y, X64_X, X64_FORM_BINARY, X64_IMM_8 },
+    { "vextractf128", X64_Y, X64_X, X64_FORM_STORE, X64_IMM_8 },
+    { "vcvtph2ps", X64_Y, X64_X, X64_FORM_UNARY, X64_IMM_NONE },
+    { "vcvtps2ph", X64_Y, X64_X, X64_FORM_STORE, X64_IMM_8 },
+    { "vcvtdq2ps", X64_Y, X64_Y, X64_FORM_UNARY, X64_IMM_NONE },
+    { "vcvtps2dq", X64_Y, X64_Y, X64_FORM_UNARY, X64_IMM_NONE },
+    { "vpmovzxbd", X64_Y, X64_X, X64_FORM_UNARY, X64_IMM_NONE },
+    { "vpmovzxwd", X64_Y, X64_X, X64_FORM_UNARY, X64_IMM_NONE },
+    { "vpackusdw", X64_X, X64_X, X64_FORM_BINARY, X64_IMM_NONE },
+    { "vpackuswb", X64_X, X64_X, X64_FORM_BINARY, X64_IMM_NONE },
+    { "vmovq", X64_X, X64_X, X64_FORM_STORE, X64_IMM_NONE },
+    { "vmovups", X64_X, X64_X, X64_FORM_STORE, X64_IMM_NONE },
+    { "vfmadd231ps", X64_Y, X64_Y, X64_FORM_BINARY, X64_IMM_NONE },
+    { "vfmadd231pd", X64_Y, X64_Y, X64_FORM_BINARY, X64_IMM_NONE },
+    { "vfnmadd231ps", X64_Y, X64_Y, X64_FORM_BINARY, X64_IMM_NONE },
+    { "vfnmadd231pd", X64_Y, X64_Y, X64_FORM_BINARY, X64_IMM_NONE },
+    { "vrcpps", X64_Y, X64_Y, X64_FORM_UNARY, X64_IMM_NONE },
+    { "vrsqrtps", X64_Y, X64_Y, X64_FORM_UNARY, X64_IMM_NONE },
+    { "vmovntps", X64_Y, X64_Y, X64_FORM_STORE, X64_IMM_NONE },
+};
+
+#undef X64_Y
+#undef X64_X
+
+static const char* _gpr64_names[16] = {
+    "rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+    "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15",
+};
+
+static const char* _gpr32_names[16] = {
+    "eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi",
+    "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d",
+};
+
+static const char* _group1_names[8] = { "add", "or", "adc", "sbb", "and", "sub", "xor", "cmp" };
+
+static const char* _cond_names[16] = {
+    "jo", "jno", "jb", "jae", "je", "jne", "jbe", "ja",
+    "js", "jns", "jp", "jnp", "jl", "jge", "jle", "jg",
+};
+
+typedef struct {
+    const uint8_t* code;
+    size_t size;
+    size_t pos;
+    bool overflow;
+} X64Decoder;
+
+uint8_t x64_read8(X64Decoder* decoder)
+{
+    if(decoder->pos >= decoder->size)
+    {
+        decoder->overflow = true;
+        return 0;
+    }
+
+    return decoder->code[decoder->pos++];
+}
+
+int32_t x64_read32(X64Decoder* decoder)
+{
+    uint32_t value = 0;
+
+    for(uint32_t i = 0; i < 4; i++)
+    {
+        value |= (uint32_t)x64_read8(decoder) << (i * 8);
+    }
+
+    return (int32_t)value;
+}
+
+/* ModRM operand, rm is a register number when mod is 3 and mem holds the memory operand otherwise */
+typedef struct {
+    uint32_t mod;
+    uint32_t reg;
+    uint32_t rm;
+    char mem[48];
+} X64ModRM;
+
+/* Signed hexadecimal, as an immediate or after the registers of a memory operand */
+void x64_format_hex(char* text, size_t size, int64_t value, bool sign)
+{
+    const char* prefix = value < 0 ? "-" : (sign ? "+" : "");
+    const uint64_t magnitude = value < 0 ? (uint64_t)(-(value + 1)) + 1 : (uint64_t)value;
+
+    snprintf(text, size, "%s0x%llx", prefix, (unsigned long long)magnitude);
+}
+
+void x64_decode_modrm(X64Decoder* decoder, uint32_t rex_r, uint32_t rex_x, uint32_t rex_b, X64ModRM* modrm)
+{
+    const uint8_t byte = x64_read8(decoder);
+
+    modrm->mod = byte >> 6;
+    modrm->reg = ((byte >> 3) & 7) | (rex_r << 3);
+    modrm->rm = (byte & 7) | (rex_b << 3);
+    modrm->mem[0] = '\0';
+
+    if(modrm->mod == 3)
+    {
+        return;
+    }
+
+    const char* base = _gpr64_names[modrm->rm];
+    const char* index = NULL;
+    uint32_t scale = 1;
+
+    if((byte & 7) == 4)
+    {
+        const uint8_t sib = x64_read8(decoder);
+        const uint32_t index_bits = ((sib >> 3) & 7) | (rex_x << 3);
+
+        scale = 1u << (sib >> 6);
+        index = index_bits == 4 ? NULL : _gpr64_names[index_bits];
+        base = (sib & 7) == 5 && modrm->mod == 0 ? NULL : _gpr64_names[(sib & 7) | (rex_b << 3)];
+    }
+    else if((byte & 7) == 5 && modrm->mod == 0)
+    {
+        base = "rip";
+    }
+
+    int32_t disp = 0;
+
+    if(modrm->mod == 1)
+    {
+        disp = (int8_t)x64_read8(decoder);
+    }
+    else if(modrm->mod == 2 || base == NULL || strcmp(base, "rip") == 0)
+    {
+        disp = x64_read32(decoder);
+    }
+
+    char disp_text[16] = "";
+    char index_text[16] = "";
+
+    if(disp != 0 || (base == NULL && index == NULL))
+    {
+        x64_format_hex(disp_text, sizeof(disp_text), disp, base != NULL || index != NULL);
+    }
+
+    if(index != NULL && scale > 1)
+    {
+        snprintf(index_text, sizeof(index_text), "%s%s*%u", base != NULL ? "+" : "", index, scale);
+    }
+    else if(index != NULL)
+    {
+        snprintf(index_text, sizeof(index_text), "%s%s", base != NULL ? "+" : "", index);
+    }
+
+    snprintf(modrm->mem, sizeof(modrm->mem), "[%s%s%s]", base != NULL ? base : "", index_text, disp_text);
+}
+
+/* Name of the register number of kind, GPR are 64 bits wide with w */
+const char* x64_operand(char* text, size_t size, X64OperandKind kind, uint32_t number, bool w)
+{
+    switch(kind)
+    {
+        case X64_OPERAND_YMM:
+            snprintf(text, size, "ymm%u", number);
+            break;
+        case X64_OPERAND_XMM:
+            snprintf(text, size, "xmm%u", number);
+            break;
+        default:
+            snprintf(text, size, "%s", w ? _gpr64_names[number & 15] : _gpr32_names[number & 15]);
+            break;
+    }
+
+    return text;
+}
+
+PSL_FORCE_INLINE const char* x64_rm_operand(char* text, size_t size, X64OperandKind kind, const X64ModRM* modrm, bool w)
+{
+    return modrm->mod == 3 ? x64_operand(text, size, kind, modrm->rm, w) : modrm->mem;
+}
+
+bool x64_decode_vex(X64Decoder* decoder, uint8_t prefix, PSL_X64Inst* inst)
+{
+    const uint8_t byte1 = x64_read8(decoder);
+
+    uint32_t r = ((~byte1) >> 7) & 1;
+    uint32_t x = 0;
+    uint32_t b = 0;
+    uint32_t map = X64_VEX_MAP_0F;
+    uint32_t w = 0;
+    uint8_t byte2 = byte1;
+
+    if(prefix == 0xC4)
+    {
+        byte2 = x64_read8(decoder);
+        x = ((~byte1) >> 6) & 1;
+        b = ((~byte1) >> 5) & 1;
+        map = byte1 & 0x1F;
+        w = byte2 >> 7;
+    }
+
+    const uint32_t vvvv = ((~byte2) >> 3) & 0xF;
+    const uint32_t l = (byte2 >> 2) & 1;
+    const uint32_t pp = byte2 & 3;
+    const uint8_t opcode = x64_read8(decoder);
+
+    if(opcode == 0x77 && map == X64_VEX_MAP_0F && l == 0 && pp == X64_VEX_PP_NONE)
+    {
+        inst->inst_class = PSL_X64InstClass_Other;
+        snprintf(inst->text, PSL_X64_INST_TEXT_SIZE, "vzeroupper");
+        return true;
+    }
+
+    uint32_t op = 0;
+
+    while(op < PSL_X64VexOp_Count && (_vex_encodings[op].opcode != opcode ||
+                                      _vex_encodings[op].pp != pp ||
+                                      _vex_encodings[op].map != map ||
+                                      _vex_encodings[op].w != w ||
+                                      _vex_encodings[op].l != l))
+    {
+        op++;
+    }
+
+    if(op == PSL_X64VexOp_Count)
+    {
+        return false;
+    }
+
+    const X64VexSyntax* syntax = &_vex_syntaxes[op];
+
+    X64ModRM modrm;
+    x64_decode_modrm(decoder, r, x, b, &modrm);
+
+    const uint8_t imm = syntax->imm != X64_IMM_NONE ? x64_read8(decoder) : 0;
+
+    inst->inst_class = PSL_X64InstClass_Vex;
+    inst->vex_op = (PSL_X64VexOp)op;
+    inst->memory = modrm.mod != 3;
+
+    char reg_text[16];
+    char vvvv_text[16];
+    char rm_text[16];
+    char imm_text[16] = "";
+
+    const char* reg_operand = x64_operand(reg_text, sizeof(reg_text), (X64OperandKind)syntax->reg, modrm.reg, w != 0);
+    const char* rm_operand = x64_rm_operand(rm_text, sizeof(rm_text), (X64OperandKind)syntax->rm, &modrm, w != 0);
+
+    if(syntax->imm == X64_IMM_8)
+    {
+        snprintf(imm_text, sizeof(imm_text), ", 0x%x", imm);
+    }
+    else if(syntax->imm == X64_IMM_IS4)
+    {
+        snprintf(imm_text, sizeof(imm_text), ", %s", x64_operand(vvvv_text, sizeof(vvvv_text), (X64OperandKind)syntax->reg, imm >> 4, false));
+    }
+
+    switch(syntax->form)
+    {
+        case X64_FORM_UNARY:
+            snprintf(inst->text, PSL_X64_INST_TEXT_SIZE, "%s %s, %s%s", syntax->name, reg_operand, rm_operand, imm_text);
+            break;
+        case X64_FORM_BINARY:
+            snprintf(inst->text,
+                     PSL_X64_INST_TEXT_SIZE,
+                     "%s %s, %s, %s%s",
+                     syntax->name,
+                     reg_operand,
+                     x64_operand(vvvv_text, sizeof(vvvv_text), (X64OperandKind)syntax->reg, vvvv, false),
+                     rm_operand,
+                     imm_text);
+            break;
+        default:
+            snprintf(inst->text, PSL_X64_INST_TEXT_SIZE, "%s %s, %s%s", syntax->name, rm_operand, reg_operand, imm_text);
+            break;
+    }
+
+    return true;
+}
+
+bool x64_decode_legacy(X64Decoder* decoder, uint8_t opcode, size_t offset, PSL_X64Inst* inst)
+{
+    uint8_t rex = 0;
+
+    if((opcode & 0xF0) == 0x40)
+    {
+        rex = opcode;
+        opcode = x64_read8(decoder);
+    }
+
+    const uint32_t r = (rex >> 2) & 1;
+    const uint32_t x = (rex >> 1) & 1;
+    const uint32_t b = rex & 1;
+    const char** gprs = (rex & 8) != 0 ? _gpr64_names : _gpr32_names;
+
+    X64ModRM modrm;
+    char rm_text[16];
+    char imm_text[24];
+
+    inst->inst_class = PSL_X64InstClass_Alu;
+
+    if(opcode >= 0x50 && opcode <= 0x5F)
+    {
+        inst->inst_class = opcode < 0x58 ? PSL_X64InstClass_Store : PSL_X64InstClass_Load;
+        snprintf(inst->text, PSL_X64_INST_TEXT_SIZE, "%s %s", opcode < 0x58 ? "push" : "pop", _gpr64_names[(opcode & 7) | (b << 3)]);
+        return true;
+    }
+
+    if(opcode >= 0xB8 && opcode <= 0xBF)
+    {
+        const uint32_t low = (uint32_t)x64_read32(decoder);
+        const uint64_t imm = (rex & 8) != 0 ? ((uint64_t)(uint32_t)x64_read32(decoder) << 32) | low : low;
+
+        snprintf(inst->text, PSL_X64_INST_TEXT_SIZE, "mov %s, 0x%llx", gprs[(opcode & 7) | (b << 3)], (unsigned long long)imm);
+        return true;
+    }
+
+    switch(opcode)
+    {
+        case 0x89:
+        case 0x8B:
+        case 0x8D:
+        case 0x39:
+        case 0x31:
+        case 0x85:
+        {
+            x64_decode_modrm(decoder, r, x, b, &modrm);
+
+            const char* rm_operand = x64_rm_operand(rm_text, sizeof(rm_text), X64_OPERAND_GPR, &modrm, (rex & 8) != 0);
+            const char* reg_operand = gprs[modrm.reg];
+
+            inst->memory = modrm.mod != 3 && opcode != 0x8D;
+
+            switch(opcode)
+            {
+                case 0x89:
+                    inst->inst_class = inst->memory ? PSL_X64InstClass_Store : PSL_X64InstClass_Alu;
+                    snprintf(inst->text, PSL_X64_INST_TEXT_SIZE, "mov %s, %s", rm_operand, reg_operand);
+                    return true;
+                case 0x8B:
+                    inst->inst_class = inst->memory ? PSL_X64InstClass_Load : PSL_X64InstClass_Alu;
+                    snprintf(inst->text, PSL_X64_INST_TEXT_SIZE, "mov %s, %s", reg_operand, rm_operand);
+                    return true;
+                case 0x8D:
+                    snprintf(inst->text, PSL_X64_INST_TEXT_SIZE, "lea %s, %s", reg_operand, rm_operand);
+                    return modrm.mod != 3;
+                default:
+                    inst->inst_class = inst->memory ? PSL_X64InstClass_Load : PSL_X64InstClass_Alu;
+                    snprintf(inst->text,
+                             PSL_X64_INST_TEXT_SIZE,
+                             "%s %s, %s",
+                             opcode == 0x39 ? "cmp" : (opcode == 0x31 ? "xor" : "test"),
+                             rm_operand,
+                             reg_operand);
+                    return true;
+            }
+        }
+        case 0x81:
+        case 0x83:
+        {
+            x64_decode_modrm(decoder, 0, x, b, &modrm);
+
+            const int32_t imm = opcode == 0x83 ? (int8_t)x64_read8(decoder) : x64_read32(decoder);
+
+            inst->memory = modrm.mod != 3;
+            inst->inst_class = inst->memory ? PSL_X64InstClass_Load : PSL_X64InstClass_Alu;
+
+            x64_format_hex(imm_text, sizeof(imm_text), imm, false);
+            snprintf(inst->text,
+                     PSL_X64_INST_TEXT_SIZE,
+                     "%s %s, %s",
+                     _group1_names[modrm.reg],
+                     x64_rm_operand(rm_text, sizeof(rm_text), X64_OPERAND_GPR, &modrm, (rex & 8) != 0),
+                     imm_text);
+            return true;
+        }
+        case 0xE9:
+        {
+            const int32_t rel = x64_read32(decoder);
+
+            inst->inst_class = PSL_X64InstClass_Branch;
+            inst->target = (int64_t)(offset + decoder->pos) + rel;
+            snprintf(inst->text, PSL_X64_INST_TEXT_SIZE, "jmp 0x%llx", (unsigned long long)inst->target);
+            return true;
+        }
+        case 0xE8:
+        {
+            const int32_t rel = x64_read32(decoder);
+
+            inst->inst_class = PSL_X64InstClass_Call;
+            snprintf(inst->text,
+                     PSL_X64_INST_TEXT_SIZE,
+                     "call 0x%llx",
+                     (unsigned long long)((int64_t)(offset + decoder->pos) + rel));
+            return true;
+        }
+        case 0xC3:
+            inst->inst_class = PSL_X64InstClass_Branch;
+            snprintf(inst->text, PSL_X64_INST_TEXT_SIZE, "ret");
+            return true;
+        case 0xFF:
+            x64_decode_modrm(decoder, 0, x, b, &modrm);
+
+            inst->inst_class = PSL_X64InstClass_Call;
+            inst->memory = modrm.mod != 3;
+            snprintf(inst->text,
+                     PSL_X64_INST_TEXT_SIZE,
+                     "call %s",
+                     x64_rm_operand(rm_text, sizeof(rm_text), X64_OPERAND_GPR, &modrm, true));
+            return modrm.reg == 2;
+        case 0x0F:
+        {
+            const uint8_t opcode2 = x64_read8(decoder);
+
+            if(opcode2 == 0x18)
+            {
+                static const char* hints[4] = { "prefetchnta", "prefetcht0", "prefetcht1", "prefetcht2" };
+
+                x64_decode_modrm(decoder, 0, x, b, &modrm);
+
+                inst->inst_class = PSL_X64InstClass_Load;
+                inst->memory = true;
+                snprintf(inst->text, PSL_X64_INST_TEXT_SIZE, "%s %s", hints[modrm.reg & 3], modrm.mem);
+                return modrm.mod != 3 && modrm.reg < 4;
+            }
+
+            if(opcode2 == 0xAE && x64_read8(decoder) == 0xF8)
+            {
+                inst->inst_class = PSL_X64InstClass_Other;
+                snprintf(inst->text, PSL_X64_INST_TEXT_SIZE, "sfence");
+                return true;
+            }
+
+            if((opcode2 & 0xF0) == 0x80)
+            {
+                const int32_t rel = x64_read32(decoder);
+
+                inst->inst_class = PSL_X64InstClass_Branch;
+                inst->target = (int64_t)(offset + decoder->pos) + rel;
+                snprintf(inst->text, PSL_X64_INST_TEXT_SIZE, "%s 0x%llx", _cond_names[opcode2 & 0xF], (unsigned long long)inst->target);
+                return true;
+            }
+
+            return false;
+        }
+        default:
+            return false;
+    }
+}
+
+bool psl_x64_decode(const uint8_t* code, size_t size, size_t offset, PSL_X64Inst* inst)
+{
+    X64Decoder decoder;
+    decoder.code = code + offset;
+    decoder.size = offset < size ? size - offset : 0;
+    decoder.pos = 0;
+    decoder.overflow = false;
+
+    inst->size = 0;
+    inst->inst_class = PSL_X64InstClass_Other;
+    inst->vex_op = PSL_X64VexOp_Count;
+    inst->memory = false;
+    inst->target = -1;
+    inst->text[0] = '\0';
+
+    const uint8_t first = x64_read8(&decoder);
+
+    const bool success = first == 0xC4 || first == 0xC5 ?
+                         x64_decode_vex(&decoder, first, inst) :
+                         x64_decode_legacy(&decoder, first, offset, inst);
+
+    if(!success || decoder.overflow)
+    {
+        snprintf(inst->text, PSL_X64_INST_TEXT_SIZE, "(bad)");
+        return false;
+    }
+
+    inst->size = (uint32_t)decoder.pos;
+
+    return true;
+}
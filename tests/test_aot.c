@@ -0,0 +1,396 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#include "psl/aot.h"
+#include "test_utils.h"
+
+#include "libromano/logger.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(PSL_LINUX)
+#include <elf.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define NUM_ELEMENTS 1003
+
+/* Helpers in f32 and f64, reductions and a vector */
+static const char* source = "main shade(vec3 n, f32 x, f64 y, uniform f32 s, export f32 a, export f64 b,\n"
+                            "           reduce(sum) f64 total, reduce(max) f32 peak)\n"
+                            "{ a = sin(x) * s + n.y;\n"
+                            "  b = pow(y, 2.0) + atan2(y, 1.0);\n"
+                            "  total = y;\n"
+                            "  peak = a; }\n";
+
+/* jmp [rip + 0] followed by the address to jump to */
+#define STUB_SIZE 16
+
+/* Address of the vector helper named by an undefined symbol of the object */
+uintptr_t find_helper(const char* symbol)
+{
+    const char* prefix = "psl_builtin_vector_";
+
+    if(strncmp(symbol, prefix, strlen(prefix)) != 0)
+    {
+        return 0;
+    }
+
+    const char* name = symbol + strlen(prefix);
+    uint32_t length = (uint32_t)strlen(name);
+    const bool f64 = length > 4 && strcmp(name + length - 4, "_f64") == 0;
+
+    PSL_BuiltinID id;
+    const PSL_Builtin* builtin = psl_builtin_find(name, f64 ? length - 4 : length, &id);
+
+    if(builtin == NULL)
+    {
+        return 0;
+    }
+
+    return f64 ? (uintptr_t)builtin->vector_func_f64 : (uintptr_t)builtin->vector_func;
+}
+
+/*
+   Minimal static linker: maps the text section of the object followed by one stub per symbol,
+   jumping to the helper it names, and applies the relocations. Returns the mapping
+*/
+uint8_t* load_object(const uint8_t* object, size_t object_size, const char* symbol, void** func, size_t* mapped_size)
+{
+    const Elf64_Ehdr* header = (const Elf64_Ehdr*)object;
+
+    if(object_size < sizeof(Elf64_Ehdr) || memcmp(header->e_ident, ELFMAG, SELFMAG) != 0 ||
+       header->e_type != ET_REL || header->e_machine != EM_X86_64 ||
+       header->e_shoff + header->e_shnum * sizeof(Elf64_Shdr) > object_size)
+    {
+        logger_log_error("Malformed object header");
+        return NULL;
+    }
+
+    const Elf64_Shdr* sections = (const Elf64_Shdr*)(object + header->e_shoff);
+    const char* section_names = (const char*)object + sections[header->e_shstrndx].sh_offset;
+
+    const Elf64_Shdr* text = NULL;
+    const Elf64_Shdr* rela = NULL;
+    const Elf64_Shdr* symtab = NULL;
+
+    for(uint32_t i = 0; i < header->e_shnum; i++)
+    {
+        const char* name = section_names + sections[i].sh_name;
+
+        if(strcmp(name, ".text") == 0 && sections[i].sh_type == SHT_PROGBITS)
+        {
+            text = &sections[i];
+        }
+        else if(strcmp(name, ".rela.text") == 0 && sections[i].sh_type == SHT_RELA)
+        {
+            rela = &sections[i];
+        }
+        else if(strcmp(name, ".symtab") == 0 && sections[i].sh_type == SHT_SYMTAB)
+        {
+            symtab = &sections[i];
+        }
+    }
+
+    if(text == NULL || rela == NULL || symtab == NULL || sections[0].sh_name != 0)
+    {
+        logger_log_error("Missing sections in the object");
+        return NULL;
+    }
+
+    const Elf64_Sym* symbols = (const Elf64_Sym*)(object + symtab->sh_offset);
+    const size_t num_symbols = symtab->sh_size / sizeof(Elf64_Sym);
+    const char* strtab = (const char*)object + sections[symtab->sh_link].sh_offset;
+
+    *mapped_size = text->sh_size + num_symbols * STUB_SIZE;
+
+    uint8_t* code = (uint8_t*)mmap(NULL, *mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if(code == MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    memcpy(code, object + text->sh_offset, text->sh_size);
+
+    *func = NULL;
+
+    for(size_t i = 0; i < num_symbols; i++)
+    {
+        const char* name = strtab + symbols[i].st_name;
+
+        if(ELF64_ST_TYPE(symbols[i].st_info) == STT_FUNC && strcmp(name, symbol) == 0)
+        {
+            *func = code + symbols[i].st_value;
+        }
+
+        if(symbols[i].st_shndx != SHN_UNDEF || symbols[i].st_name == 0)
+        {
+            continue;
+        }
+
+        const uintptr_t helper = find_helper(name);
+
+        if(helper == 0)
+        {
+            logger_log_error("Unknown symbol %s", name);
+            *func = NULL;
+            break;
+        }
+
+        uint8_t* stub = code + text->sh_size + i * STUB_SIZE;
+        const uint8_t jump[6] = { 0xFF, 0x25, 0x00, 0x00, 0x00, 0x00 };
+        memcpy(stub, jump, sizeof(jump));
+        memcpy(stub + sizeof(jump), &helper, sizeof(helper));
+    }
+
+    const Elf64_Rela* relas = (const Elf64_Rela*)(object + rela->sh_offset);
+
+    for(size_t i = 0; *func != NULL && i < rela->sh_size / sizeof(Elf64_Rela); i++)
+    {
+        if(ELF64_R_TYPE(relas[i].r_info) != R_X86_64_PLT32)
+        {
+            logger_log_error("Unexpected relocation type %u", (uint32_t)ELF64_R_TYPE(relas[i].r_info));
+            *func = NULL;
+            break;
+        }
+
+        const uintptr_t stub = (uintptr_t)(code + text->sh_size + ELF64_R_SYM(relas[i].r_info) * STUB_SIZE);
+        const uintptr_t place = (uintptr_t)(code + relas[i].r_offset);
+        const int32_t value = (int32_t)((intptr_t)stub + relas[i].r_addend - (intptr_t)place);
+
+        memcpy(code + relas[i].r_offset, &value, sizeof(value));
+    }
+
+    if(*func == NULL || mprotect(code, *mapped_size, PROT_READ | PROT_EXEC) != 0)
+    {
+        munmap(code, *mapped_size);
+        return NULL;
+    }
+
+    return code;
+}
+
+typedef struct {
+    float* n[3];
+    float* x;
+    double* y;
+    float* a;
+    double* b;
+    double total;
+    float peak;
+} ShadeData;
+
+void shade_data_init(ShadeData* data, const ShadeData* inputs)
+{
+    memset(data, 0, sizeof(ShadeData));
+
+    for(uint32_t i = 0; i < 3; i++)
+    {
+        data->n[i] = inputs != NULL ? inputs->n[i] : (float*)malloc(NUM_ELEMENTS * sizeof(float));
+    }
+
+    data->x = inputs != NULL ? inputs->x : (float*)malloc(NUM_ELEMENTS * sizeof(float));
+    data->y = inputs != NULL ? inputs->y : (double*)malloc(NUM_ELEMENTS * sizeof(double));
+    data->a = (float*)calloc(NUM_ELEMENTS, sizeof(float));
+    data->b = (double*)calloc(NUM_ELEMENTS, sizeof(double));
+}
+
+void shade_data_bind(ShadeData* data, void** columns)
+{
+    columns[0] = data->n[0];
+    columns[1] = data->n[1];
+    columns[2] = data->n[2];
+    columns[3] = data->x;
+    columns[4] = data->y;
+    columns[5] = data->a;
+    columns[6] = data->b;
+    columns[7] = &data->total;
+    columns[8] = &data->peak;
+}
+
+bool test_object(void)
+{
+    PSL_Kernel* kernel = compile_source(source);
+
+    if(kernel == NULL)
+    {
+        return false;
+    }
+
+    char path[128];
+    snprintf(path, sizeof(path), "/tmp/psl-aot-%d.o", (int)getpid());
+
+    const char* symbol = "psl_test_shade";
+    char* error = NULL;
+
+    if(!psl_aot_write_object(&kernel, &symbol, 1, path, &error))
+    {
+        logger_log_error("Cannot write the object: %s", error);
+        psl_kernel_destroy(kernel);
+        return false;
+    }
+
+    size_t object_size;
+    uint8_t* object = read_file(path, &object_size);
+    remove(path);
+
+    void* func = NULL;
+    size_t mapped_size = 0;
+    uint8_t* code = object != NULL ? load_object(object, object_size, symbol, &func, &mapped_size) : NULL;
+    free(object);
+
+    if(code == NULL)
+    {
+        logger_log_error("Cannot load the object");
+        psl_kernel_destroy(kernel);
+        return false;
+    }
+
+    PSL_AOTKernel aot;
+    aot.name = "shade";
+    aot.func = (PSL_KernelFunc)func;
+    aot.params = kernel->ir.params;
+    aot.num_params = kernel->ir.num_params;
+    aot.num_columns = kernel->ir.num_columns;
+    aot.num_uniforms = kernel->ir.num_uniforms;
+    aot.num_reductions = kernel->ir.num_reductions;
+
+    ShadeData jit;
+    shade_data_init(&jit, NULL);
+
+    for(size_t i = 0; i < NUM_ELEMENTS; i++)
+    {
+        jit.n[0][i] = 0.0f;
+        jit.n[1][i] = (float)i * 0.01f;
+        jit.n[2][i] = 0.0f;
+        jit.x[i] = (float)i * 0.03f - 10.0f;
+        jit.y[i] = (double)i * 0.007;
+    }
+
+    ShadeData aot_data;
+    shade_data_init(&aot_data, &jit);
+
+    float s = 1.5f;
+    void* uniforms[1] = { &s };
+
+    void* jit_columns[9];
+    shade_data_bind(&jit, jit_columns);
+    void* aot_columns[9];
+    shade_data_bind(&aot_data, aot_columns);
+
+    PSL_Bindings bindings;
+    bindings.uniforms = uniforms;
+
+    bindings.columns = jit_columns;
+    psl_kernel_execute(kernel, &bindings, NUM_ELEMENTS);
+
+    bindings.columns = aot_columns;
+    psl_aot_execute(&aot, &bindings, NUM_ELEMENTS);
+
+    /* Same code, same bits */
+    bool success = memcmp(jit.a, aot_data.a, NUM_ELEMENTS * sizeof(float)) == 0 &&
+                   memcmp(jit.b, aot_data.b, NUM_ELEMENTS * sizeof(double)) == 0 &&
+                   jit.total == aot_data.total &&
+                   jit.peak == aot_data.peak;
+
+    if(!success)
+    {
+        logger_log_error("Ahead-of-time results differ: a[7] %f %f, b[7] %f %f, total %f %f, peak %f %f",
+                         jit.a[7], aot_data.a[7], jit.b[7], aot_data.b[7], jit.total, aot_data.total,
+                         jit.peak, aot_data.peak);
+    }
+
+    for(uint32_t i = 0; i < 3; i++)
+    {
+        free(jit.n[i]);
+    }
+
+    free(jit.x);
+    free(jit.y);
+    free(jit.a);
+    free(jit.b);
+    free(aot_data.a);
+    free(aot_data.b);
+
+    munmap(code, mapped_size);
+    psl_kernel_destroy(kernel);
+
+    return success;
+}
+
+bool test_header(void)
+{
+    PSL_Kernel* kernel = compile_source(source);
+
+    if(kernel == NULL)
+    {
+        return false;
+    }
+
+    char path[128];
+    snprintf(path, sizeof(path), "/tmp/psl-aot-%d.h", (int)getpid());
+
+    const char* symbol = "psl_test_shade";
+    char* error = NULL;
+
+    bool success = psl_aot_write_header(&kernel, &symbol, 1, path, &error);
+
+    if(!success)
+    {
+        logger_log_error("Cannot write the header: %s", error);
+    }
+
+    size_t size;
+    char* header = success ? (char*)read_file(path, &size) : NULL;
+    remove(path);
+
+    const char* expected[] = {
+        "void psl_test_shade(const PSL_KernelArgs* args);",
+        "static inline const PSL_AOTKernel* psl_test_shade_kernel(void)",
+        "static inline void psl_test_shade_execute(const PSL_Bindings* bindings, size_t count)",
+        "column 8: peak, f32 max reduction",
+        "uniform 0: s, f32",
+        "{ \"shade\", psl_test_shade, params, 10, 9, 1, 2 }",
+    };
+
+    for(size_t i = 0; header != NULL && i < sizeof(expected) / sizeof(expected[0]); i++)
+    {
+        if(strstr(header, expected[i]) == NULL)
+        {
+            logger_log_error("Header does not contain %s:\n%s", expected[i], header);
+            success = false;
+        }
+    }
+
+    free(header);
+    psl_kernel_destroy(kernel);
+
+    /* Errors are reported, not asserted */
+    if(psl_aot_write_object(NULL, NULL, 0, "/nonexistent/psl.o", &error) || error == NULL)
+    {
+        logger_log_error("Writing to a missing directory has not failed");
+        success = false;
+    }
+
+    return success;
+}
+#endif /* defined(PSL_LINUX) */
+
+int main(void)
+{
+    logger_init();
+
+    bool success = true;
+
+#if defined(PSL_LINUX)
+    success &= test_object();
+    success &= test_header();
+#endif /* defined(PSL_LINUX) */
+
+    logger_release();
+
+    return success ? 0 : 1;
+}
@@ -3,16 +3,22 @@
 /* All rights reserved. */
 
 #include "psl/ast.h"
+#include "psl/kernel.h"
+#include "psl/profile.h"
 
 #include "libromano/logger.h"
 #include "libromano/filesystem.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-int main(void)
-{
-    logger_init();
+#define NUM_FUNCTIONS 300
+#define NUM_PARAMETERS 40
+#define NUM_STATEMENTS 1000
 
+bool test_example(void)
+{
     const char* example_path = TESTS_DATA_DIR"/example.psl";
 
     FileContent content;
@@ -20,7 +26,7 @@ int main(void)
     if(!fs_file_content_new(example_path, &content))
     {
         logger_log_error("Cannot open %s file", example_path);
-        return 1;
+        return false;
     }
 
     printf("Source content:\n%.*s\n\n", content.content_length, content.content);
@@ -38,8 +44,8 @@ int main(void)
     {
         psl_ast_destroy(ast);
         vector_free(tokens);
-        logger_release();
-        return 1;
+        fs_file_content_free(&content);
+        return false;
     }
 
     psl_ast_print(ast);
@@ -50,7 +56,152 @@ int main(void)
 
     fs_file_content_free(&content);
 
+    return true;
+}
+
+void append(char* source, size_t* size, const char* format, uint32_t value)
+{
+    *size += (size_t)sprintf(source + *size, format, value);
+}
+
+/* Functions, parameters, arguments and statements past the former fixed stacks of 32 and 128 */
+bool test_large_source(void)
+{
+    char* source = (char*)malloc(1 << 20);
+    size_t size = 0;
+
+    for(uint32_t i = 0; i < NUM_FUNCTIONS; i++)
+    {
+        append(source, &size, "f32 fn%u(", i);
+
+        for(uint32_t j = 0; j < NUM_PARAMETERS; j++)
+        {
+            append(source, &size, j == 0 ? "f32 a%u" : ", f32 a%u", j);
+        }
+
+        append(source, &size, ") { return a0 + a%u; }\n", NUM_PARAMETERS - 1);
+    }
+
+    append(source, &size, "main large(f32 x, export f32 out) {\n t = fn%u(x", NUM_FUNCTIONS - 1);
+
+    for(uint32_t j = 1; j < NUM_PARAMETERS; j++)
+    {
+        append(source, &size, ", %u.0", j);
+    }
+
+    append(source, &size, ");\n", 0);
+
+    for(uint32_t i = 2; i < NUM_STATEMENTS; i++)
+    {
+        append(source, &size, " t = t + 1.0;\n", i);
+    }
+
+    append(source, &size, " out = t;\n}\n", 0);
+
+    PSL_Lexer lexer;
+    psl_lexer_init(&lexer, source);
+
+    Vector* tokens = vector_new(128, sizeof(PSL_Token));
+
+    PSL_AST* ast = psl_ast_new();
+
+    PSL_CompileStats stats;
+    psl_profile_begin(&stats);
+
+    bool success = psl_lexer_lex(&lexer, tokens) && psl_ast_from_tokens(ast, tokens);
+
+    psl_profile_end();
+
+    if(!success)
+    {
+        logger_log_error("Cannot parse the large source: %s", ast->error);
+    }
+
+    PSL_ASTSource* src = success ? PSL_AST_CAST(PSL_ASTSource, ast->root) : NULL;
+
+    if(success && src->num_functions != NUM_FUNCTIONS + 1)
+    {
+        logger_log_error("Parsed %u functions, expected %u", src->num_functions, NUM_FUNCTIONS + 1);
+        success = false;
+    }
+
+    if(success)
+    {
+        PSL_ASTFunction* helper = PSL_AST_CAST(PSL_ASTFunction, src->functions[NUM_FUNCTIONS - 1]);
+        PSL_ASTFunction* main = PSL_AST_CAST(PSL_ASTFunction, src->functions[NUM_FUNCTIONS]);
+        PSL_ASTBlock* body = PSL_AST_CAST(PSL_ASTBlock, main->body);
+        PSL_ASTAssignment* first = PSL_AST_CAST(PSL_ASTAssignment, body->statements[0]);
+        PSL_ASTFunctionCall* call = PSL_AST_CAST(PSL_ASTFunctionCall, first->rvalue);
+
+        if(helper->num_parameters != NUM_PARAMETERS ||
+           body->num_statements != NUM_STATEMENTS ||
+           call == NULL ||
+           call->num_arguments != NUM_PARAMETERS)
+        {
+            logger_log_error("Parsed %u parameters, %u statements and %u arguments",
+                             helper->num_parameters,
+                             body->num_statements,
+                             call != NULL ? call->num_arguments : 0);
+            success = false;
+        }
+    }
+
+    /* The arena grows geometrically, and the scratch stack only holds the children still being parsed */
+    if(stats.arena_resizes > 16 || ast->scratch_capacity > 2 * (NUM_FUNCTIONS + 1 + NUM_STATEMENTS + NUM_PARAMETERS))
+    {
+        logger_log_error("Parsing took %llu arena blocks and %u scratch nodes",
+                         (unsigned long long)stats.arena_resizes,
+                         ast->scratch_capacity);
+        success = false;
+    }
+
+    PSL_Kernel* kernel = psl_kernel_new();
+
+    if(success && !psl_kernel_compile(kernel, ast, NULL, NULL))
+    {
+        logger_log_error("Cannot compile the large source: %s", kernel->error);
+        success = false;
+    }
+
+    if(success)
+    {
+        float x[4] = { 1.0f, 2.0f, 3.0f, 4.0f };
+        float out[4];
+        void* columns[2] = { x, out };
+
+        PSL_Bindings bindings;
+        bindings.columns = columns;
+        bindings.uniforms = NULL;
+
+        psl_kernel_execute(kernel, &bindings, 4);
+
+        const float expected = x[3] + (float)(NUM_PARAMETERS - 1) + (float)(NUM_STATEMENTS - 2);
+
+        if(out[3] != expected)
+        {
+            logger_log_error("Large source computed %f, expected %f", out[3], expected);
+            success = false;
+        }
+    }
+
+    psl_kernel_destroy(kernel);
+    psl_ast_destroy(ast);
+    vector_free(tokens);
+    free(source);
+
+    return success;
+}
+
+int main(void)
+{
+    logger_init();
+
+    bool success = true;
+
+    success &= test_example();
+    success &= test_large_source();
+
     logger_release();
 
-    return 0;
+    return success ? 0 : 1;
 }
\ No newline at end of file
@@ -0,0 +1,272 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#include "psl/codeheap.h"
+#include "psl/kernel.h"
+
+#include "libromano/logger.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_FUNCTIONS 500
+
+typedef int (*ConstantFunc)(void);
+
+/* mov eax, value; ret, padded with nops to size bytes */
+void emit_constant(uint8_t* code, size_t size, int value)
+{
+    memset(code, 0x90, size);
+    code[0] = 0xB8;
+    memcpy(code + 1, &value, sizeof(value));
+    code[5] = 0xC3;
+}
+
+bool check_stats(const char* name, uint32_t num_chunks, uint32_t num_allocations)
+{
+    PSL_CodeHeapStats stats;
+    psl_code_heap_get_stats(&stats);
+
+    if(stats.num_chunks != num_chunks || stats.num_allocations != num_allocations)
+    {
+        logger_log_error("%s: %u chunks and %u allocations, expected %u and %u",
+                         name, stats.num_chunks, stats.num_allocations, num_chunks, num_allocations);
+        return false;
+    }
+
+    return true;
+}
+
+bool test_mode(PSL_CodeHeapMode mode)
+{
+    psl_code_heap_set_mode(mode);
+    psl_code_heap_compact();
+
+    if(!check_stats("Empty heap", 0, 0))
+    {
+        return false;
+    }
+
+    const char* name = mode == PSL_CodeHeapMode_DualMapping ? "Dual mapping" : "Protect";
+
+    uint8_t code[200];
+    void* functions[NUM_FUNCTIONS];
+    bool success = true;
+
+    for(int i = 0; i < NUM_FUNCTIONS; i++)
+    {
+        emit_constant(code, sizeof(code), i);
+        functions[i] = psl_code_heap_alloc(code, sizeof(code));
+
+        if(functions[i] == NULL || ((uintptr_t)functions[i] % PSL_CODE_HEAP_ALIGNMENT) != 0)
+        {
+            logger_log_error("%s: function %d is not allocated on a cache line", name, i);
+            return false;
+        }
+    }
+
+    /* 256 bytes per function when packed, a page each when protected */
+    PSL_CodeHeapStats packed;
+    psl_code_heap_get_stats(&packed);
+
+    if(psl_code_heap_get_mode() != mode)
+    {
+        logger_log_info("%s is not available", name);
+    }
+    else if(mode == PSL_CodeHeapMode_DualMapping && (packed.used != NUM_FUNCTIONS * 256 || packed.num_chunks != 1))
+    {
+        logger_log_error("%s: %zu bytes in %u chunks, expected %d in one", name, packed.used, packed.num_chunks, NUM_FUNCTIONS * 256);
+        success = false;
+    }
+    else if(mode == PSL_CodeHeapMode_Protect && packed.used % 4096 != 0)
+    {
+        logger_log_error("%s: %zu bytes used, kernels share pages", name, packed.used);
+        success = false;
+    }
+
+    for(int i = 0; success && i < NUM_FUNCTIONS; i++)
+    {
+        const int value = ((ConstantFunc)functions[i])();
+
+        if(value != i)
+        {
+            logger_log_error("%s: function %d returned %d", name, i, value);
+            success = false;
+        }
+    }
+
+    /* Freed code is reused by functions of the same size, without new chunks */
+    PSL_CodeHeapStats before;
+    psl_code_heap_get_stats(&before);
+
+    for(int i = 0; i < NUM_FUNCTIONS; i += 2)
+    {
+        psl_code_heap_free(functions[i], sizeof(code));
+    }
+
+    success &= check_stats(name, before.num_chunks, NUM_FUNCTIONS / 2);
+
+    for(int i = 0; i < NUM_FUNCTIONS; i += 2)
+    {
+        emit_constant(code, sizeof(code), -i);
+        functions[i] = psl_code_heap_alloc(code, sizeof(code));
+    }
+
+    PSL_CodeHeapStats after;
+    psl_code_heap_get_stats(&after);
+
+    if(after.reserved != before.reserved || after.used != before.used || after.free != 0)
+    {
+        logger_log_error("%s: freed code has not been reused, %zu bytes reserved instead of %zu",
+                         name, after.reserved, before.reserved);
+        success = false;
+    }
+
+    for(int i = 0; success && i < NUM_FUNCTIONS; i++)
+    {
+        const int value = ((ConstantFunc)functions[i])();
+
+        if(value != (i % 2 == 0 ? -i : i))
+        {
+            logger_log_error("%s: function %d returned %d after reuse", name, i, value);
+            success = false;
+        }
+    }
+
+    for(int i = 0; i < NUM_FUNCTIONS; i++)
+    {
+        psl_code_heap_free(functions[i], sizeof(code));
+    }
+
+    /* The empty chunks are pooled until compacted */
+    PSL_CodeHeapStats stats;
+    psl_code_heap_get_stats(&stats);
+
+    if(stats.num_allocations != 0 || stats.used != 0 || stats.free != 0 || stats.num_chunks > 1)
+    {
+        logger_log_error("%s: %u allocations, %zu bytes used, %zu free in %u chunks after freeing everything",
+                         name, stats.num_allocations, stats.used, stats.free, stats.num_chunks);
+        success = false;
+    }
+
+    if(psl_code_heap_compact() != stats.reserved || !check_stats(name, 0, 0))
+    {
+        logger_log_error("%s: empty chunks have not been released", name);
+        success = false;
+    }
+
+    return success;
+}
+
+bool test_large_code(void)
+{
+    const size_t size = PSL_CODE_HEAP_CHUNK_SIZE + 100;
+    uint8_t* code = (uint8_t*)malloc(size);
+    emit_constant(code, size, 42);
+
+    void* small = psl_code_heap_alloc(code, 64);
+    void* large = psl_code_heap_alloc(code, size);
+
+    bool success = large != NULL && ((ConstantFunc)large)() == 42 && ((ConstantFunc)small)() == 42;
+
+    if(!success)
+    {
+        logger_log_error("Code larger than a chunk cannot be allocated");
+    }
+
+    psl_code_heap_free(large, size);
+    psl_code_heap_free(small, 64);
+    psl_code_heap_compact();
+
+    success &= check_stats("Large code", 0, 0);
+
+    free(code);
+
+    return success;
+}
+
+/* Thousands of kernels compiled and discarded keep a bounded heap */
+bool test_kernels(void)
+{
+    Vector* tokens = vector_new(128, sizeof(PSL_Token));
+
+    PSL_Lexer lexer;
+    psl_lexer_init(&lexer, "main shade(f32 x, uniform f32 s, export f32 a) { a = x * s + 1.0; }");
+
+    PSL_AST* ast = psl_ast_new();
+
+    bool success = psl_lexer_lex(&lexer, tokens) && psl_ast_from_tokens(ast, tokens);
+
+    PSL_Kernel* kernels[64];
+    size_t peak_reserved = 0;
+
+    for(uint32_t round = 0; success && round < 50; round++)
+    {
+        for(uint32_t i = 0; i < 64; i++)
+        {
+            kernels[i] = psl_kernel_new();
+            success &= psl_kernel_compile(kernels[i], ast, NULL, NULL);
+        }
+
+        PSL_CodeHeapStats stats;
+        psl_code_heap_get_stats(&stats);
+        peak_reserved = stats.reserved > peak_reserved ? stats.reserved : peak_reserved;
+
+        float x[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+        float a[8];
+        float s = 2.0f;
+        void* columns[2] = { x, a };
+        void* uniforms[1] = { &s };
+
+        PSL_Bindings bindings;
+        bindings.columns = columns;
+        bindings.uniforms = uniforms;
+
+        for(uint32_t i = 0; success && i < 64; i++)
+        {
+            psl_kernel_execute(kernels[i], &bindings, 8);
+            success = a[7] == 17.0f;
+        }
+
+        for(uint32_t i = 0; i < 64; i++)
+        {
+            psl_kernel_destroy(kernels[i]);
+        }
+    }
+
+    if(!success)
+    {
+        logger_log_error("Kernels compiled in the code heap do not run");
+    }
+
+    if(psl_code_heap_get_mode() == PSL_CodeHeapMode_DualMapping && peak_reserved > PSL_CODE_HEAP_CHUNK_SIZE)
+    {
+        logger_log_error("64 small kernels take %zu bytes", peak_reserved);
+        success = false;
+    }
+
+    psl_ast_destroy(ast);
+    vector_free(tokens);
+
+    return success;
+}
+
+int main(void)
+{
+    logger_init();
+
+    bool success = true;
+
+    success &= test_mode(PSL_CodeHeapMode_DualMapping);
+    success &= test_mode(PSL_CodeHeapMode_Protect);
+
+    psl_code_heap_set_mode(PSL_CodeHeapMode_DualMapping);
+
+    success &= test_large_code();
+    success &= test_kernels();
+
+    logger_release();
+
+    return success ? 0 : 1;
+}
@@ -0,0 +1,273 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#include "psl/context.h"
+#include "psl/profile.h"
+
+#include "libromano/logger.h"
+
+#include <string.h>
+
+#define NUM_ROUNDS 20
+
+const char* sources[3] = {
+    "main scale(f32 x, uniform f32 s, export f32 a) { a = x * s + 1.0; }",
+    "f32 square(f32 v) { return v * v; }\n"
+    "main shade(f32 x, uniform f32 s, export f32 a) { t = square(x) - s; a = t > 0.0 ? sqrt(t) : 0.0 - t; }",
+    "main mix3(vec3 c, uniform f32 s, export f32 a) { v = c * s; a = dot(v, vec3(1.0, 2.0, 3.0)) / (1.0 + s); }",
+};
+
+/* Runs the kernel over 8 elements with s = 0.5 into a */
+void run(PSL_Kernel* kernel, float* a)
+{
+    float x[24];
+
+    for(uint32_t i = 0; i < 24; i++)
+    {
+        x[i] = (float)i * 0.25f - 1.0f;
+    }
+
+    float s = 0.5f;
+    void* columns[4] = { x, x + 8, x + 16, a };
+    void* uniforms[1] = { &s };
+
+    /* The vector source binds its three components before a */
+    if(kernel->ir.num_columns == 2)
+    {
+        columns[1] = a;
+    }
+
+    PSL_Bindings bindings;
+    bindings.columns = columns;
+    bindings.uniforms = uniforms;
+
+    psl_kernel_execute(kernel, &bindings, 8);
+}
+
+/* Kernels compiled in a context are the ones compiled on their own */
+bool test_results(PSL_CompileContext* context)
+{
+    bool success = true;
+
+    for(uint32_t round = 0; round < NUM_ROUNDS; round++)
+    {
+        const uint32_t index = round % 3;
+
+        if(psl_compile_context_parse(context, sources[index]) == NULL)
+        {
+            logger_log_error("Cannot parse source %u: %s", index, context->error);
+            return false;
+        }
+
+        PSL_Kernel* kernel = psl_kernel_new();
+
+        if(!psl_compile_context_compile(context, kernel, NULL, NULL))
+        {
+            logger_log_error("Cannot compile source %u: %s", index, kernel->error);
+            psl_kernel_destroy(kernel);
+            return false;
+        }
+
+        Vector* tokens = vector_new(128, sizeof(PSL_Token));
+
+        PSL_Lexer lexer;
+        psl_lexer_init(&lexer, sources[index]);
+
+        PSL_AST* ast = psl_ast_new();
+        PSL_Kernel* reference = psl_kernel_new();
+
+        success &= psl_lexer_lex(&lexer, tokens) &&
+                   psl_ast_from_tokens(ast, tokens) &&
+                   psl_kernel_compile(reference, ast, NULL, NULL);
+
+        /* The kernel does not depend on the context anymore */
+        psl_compile_context_reset(context);
+
+        float a[8];
+        float expected[8];
+
+        run(kernel, a);
+        run(reference, expected);
+
+        if(!success ||
+           memcmp(a, expected, sizeof(a)) != 0 ||
+           kernel->ir.num_insts != reference->ir.num_insts ||
+           kernel->ir.scratch != NULL)
+        {
+            logger_log_error("Source %u compiled in a context differs from its reference", index);
+            success = false;
+        }
+
+        psl_kernel_destroy(reference);
+        psl_kernel_destroy(kernel);
+        psl_ast_destroy(ast);
+        vector_free(tokens);
+    }
+
+    return success;
+}
+
+/* Once the context has compiled a source, compiling it again does not allocate until the kernel is copied out */
+bool test_steady_state(PSL_CompileContext* context)
+{
+    PSL_CompileOptions options;
+    psl_compile_options_init(&options);
+    options.fast_math = PSL_FastMath_All;
+
+    bool success = true;
+
+    for(uint32_t round = 0; success && round < 3; round++)
+    {
+        PSL_CompileStats stats;
+        psl_profile_begin(&stats);
+
+        PSL_Kernel* kernel = psl_kernel_new();
+
+        success = psl_compile_context_parse(context, sources[1]) != NULL &&
+                  psl_compile_context_compile(context, kernel, NULL, &options);
+
+        psl_profile_end();
+
+        /* The lexer accounts for its tokens whether the vector grows or not */
+        for(uint32_t i = 0; success && round > 0 && i < PSL_CompilePhase_Count; i++)
+        {
+            if(i != PSL_CompilePhase_Lex && stats.phases[i].bytes_allocated != 0)
+            {
+                logger_log_error("%s allocated %llu bytes in a warm context",
+                                 psl_compile_phase_to_string((PSL_CompilePhase)i),
+                                 (unsigned long long)stats.phases[i].bytes_allocated);
+                success = false;
+            }
+        }
+
+        psl_kernel_destroy(kernel);
+    }
+
+    return success;
+}
+
+/* Failed parses and compilations leave the arenas as they were */
+bool test_rollback(PSL_CompileContext* context)
+{
+    bool success = psl_compile_context_parse(context, sources[0]) != NULL;
+
+    PSL_ASTNode* root = context->ast->root;
+    const size_t nodes_size = context->ast->nodes_data.size;
+
+    Vector* tokens = vector_new(128, sizeof(PSL_Token));
+
+    PSL_Lexer lexer;
+    psl_lexer_init(&lexer, "main broken(f32 x, export f32 a) { a = x * ; }");
+
+    if(!success ||
+       !psl_lexer_lex(&lexer, tokens) ||
+       psl_ast_from_tokens(context->ast, tokens) ||
+       context->ast->root != root ||
+       context->ast->nodes_data.size != nodes_size)
+    {
+        logger_log_error("A failed parse has not been rolled back");
+        success = false;
+    }
+
+    vector_free(tokens);
+
+    const size_t scratch_size = context->scratch.size;
+
+    PSL_Kernel* kernel = psl_kernel_new();
+
+    if(psl_compile_context_compile(context, kernel, "missing", NULL) ||
+       context->scratch.size != scratch_size ||
+       kernel->ir.insts != NULL)
+    {
+        logger_log_error("A failed compilation has not been rolled back");
+        success = false;
+    }
+
+    psl_kernel_destroy(kernel);
+
+    if(psl_compile_context_parse(context, "main broken(f32 x, export f32 a) { b = x; }") == NULL)
+    {
+        logger_log_error("Cannot parse a source with an unassigned export");
+        return false;
+    }
+
+    kernel = psl_kernel_new();
+
+    if(psl_compile_context_compile(context, kernel, NULL, NULL) || context->scratch.size != scratch_size)
+    {
+        logger_log_error("A failed lowering has not been rolled back");
+        success = false;
+    }
+
+    psl_kernel_destroy(kernel);
+
+    return success;
+}
+
+/* Blocks released by a rollback are chained again instead of allocating new ones */
+bool test_arena(void)
+{
+    Arena arena;
+    psl_arena_init(&arena, 256);
+
+    uint64_t* first = (uint64_t*)psl_arena_push(&arena, NULL, sizeof(uint64_t));
+    *first = 42;
+
+    const ArenaMark mark = psl_arena_mark(&arena);
+
+    for(uint32_t i = 0; i < 100; i++)
+    {
+        psl_arena_push(&arena, NULL, 1000);
+    }
+
+    const size_t size = arena.size;
+
+    psl_arena_rollback(&arena, &mark);
+
+    PSL_CompileStats stats;
+    psl_profile_begin(&stats);
+
+    for(uint32_t i = 0; i < 100; i++)
+    {
+        psl_arena_push(&arena, NULL, 1000);
+    }
+
+    psl_profile_end();
+
+    bool success = *first == 42 && arena.size == size && stats.bytes_allocated == 0;
+
+    psl_arena_reset(&arena);
+
+    success &= arena.size == 0 && arena.offset == ARENA_BLOCK_HEADER_SIZE && arena.spare != NULL;
+
+    if(!success)
+    {
+        logger_log_error("Arena blocks have not been reused after a rollback, %llu bytes allocated",
+                         (unsigned long long)stats.bytes_allocated);
+    }
+
+    psl_arena_destroy(&arena);
+
+    return success;
+}
+
+int main(void)
+{
+    logger_init();
+
+    PSL_CompileContext* context = psl_compile_context_new();
+
+    bool success = true;
+
+    success &= test_results(context);
+    success &= test_steady_state(context);
+    success &= test_rollback(context);
+    success &= test_arena();
+
+    psl_compile_context_destroy(context);
+
+    logger_release();
+
+    return success ? 0 : 1;
+}
@@ -0,0 +1,182 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#include "psl/counters.h"
+#include "psl/queue.h"
+#include "test_utils.h"
+
+#include "libromano/logger.h"
+
+#include <string.h>
+
+#define NUM_CALLS 10
+
+#define NUM_SUBMISSIONS 64
+
+#define COUNT 1003
+
+bool check_stats(PSL_Kernel* kernel, uint64_t calls, uint64_t elements, uint64_t tail_iterations)
+{
+    PSL_KernelStats stats;
+    psl_kernel_get_stats(kernel, &stats);
+
+    if(stats.calls != calls || stats.elements != elements || stats.tail_iterations != tail_iterations)
+    {
+        logger_log_error("Kernel %s counted %llu calls, %llu elements and %llu tails, expected %llu, %llu and %llu",
+                         kernel->name,
+                         (unsigned long long)stats.calls,
+                         (unsigned long long)stats.elements,
+                         (unsigned long long)stats.tail_iterations,
+                         (unsigned long long)calls,
+                         (unsigned long long)elements,
+                         (unsigned long long)tail_iterations);
+        return false;
+    }
+
+    if(calls > 0 && stats.cycles == 0)
+    {
+        logger_log_error("Kernel %s counted no cycles", kernel->name);
+        return false;
+    }
+
+    return true;
+}
+
+typedef struct {
+    PSL_Kernel* kernels[2];
+    bool found[2];
+    uint32_t num_live;
+} LiveKernels;
+
+void find_live_kernel(PSL_Kernel* kernel, const PSL_KernelStats* stats, void* user_data)
+{
+    LiveKernels* live = (LiveKernels*)user_data;
+
+    for(uint32_t i = 0; i < 2; i++)
+    {
+        live->found[i] |= live->kernels[i] == kernel && stats->calls > 0;
+    }
+
+    live->num_live++;
+}
+
+bool test_counters(void)
+{
+    PSL_Kernel* scale = compile_source("main scale(f32 x, uniform f32 s, export f32 a) { a = x * s; }");
+    PSL_Kernel* total = compile_source("main total(f32 x, reduce(sum) f32 t) { t = x; }");
+
+    if(scale == NULL || total == NULL)
+    {
+        psl_kernel_destroy(scale);
+        psl_kernel_destroy(total);
+        return false;
+    }
+
+    bool success = true;
+
+    if(strcmp(scale->name, "scale") != 0)
+    {
+        logger_log_error("Kernel is named %s, expected scale", scale->name);
+        success = false;
+    }
+
+    if(psl_tsc_frequency() <= 0.0)
+    {
+        logger_log_error("Time stamp counter has not been calibrated");
+        success = false;
+    }
+
+    float x[COUNT];
+    float a[COUNT];
+
+    for(size_t i = 0; i < COUNT; i++)
+    {
+        x[i] = (float)i;
+    }
+
+    float s = 2.0f;
+
+    void* columns[2] = { x, a };
+    void* uniforms[1] = { &s };
+
+    PSL_Bindings bindings;
+    bindings.columns = columns;
+    bindings.uniforms = uniforms;
+
+    success &= check_stats(scale, 0, 0, 0);
+
+    /* Full vectors only, then with a tail */
+    for(uint32_t i = 0; i < NUM_CALLS; i++)
+    {
+        psl_kernel_execute(scale, &bindings, i % 2 == 0 ? 1000 : COUNT);
+    }
+
+    success &= check_stats(scale, NUM_CALLS, (NUM_CALLS / 2) * (1000 + COUNT), NUM_CALLS / 2);
+
+    /* Reductions are not coalesced, each submission is one call counted by its worker thread */
+    float sums[NUM_SUBMISSIONS];
+
+    PSL_Queue* queue = psl_queue_new(4);
+
+    for(uint32_t i = 0; i < NUM_SUBMISSIONS; i++)
+    {
+        void* reduce_columns[2] = { x, &sums[i] };
+
+        PSL_Bindings reduce_bindings;
+        reduce_bindings.columns = reduce_columns;
+        reduce_bindings.uniforms = NULL;
+
+        psl_kernel_submit(queue, total, &reduce_bindings, COUNT, NULL, NULL);
+    }
+
+    psl_queue_destroy(queue);
+
+    success &= check_stats(total, NUM_SUBMISSIONS, NUM_SUBMISSIONS * COUNT, NUM_SUBMISSIONS);
+
+    LiveKernels live;
+    memset(&live, 0, sizeof(LiveKernels));
+    live.kernels[0] = scale;
+    live.kernels[1] = total;
+
+    psl_kernel_for_each_live(find_live_kernel, &live);
+
+    if(!live.found[0] || !live.found[1] || live.num_live != 2)
+    {
+        logger_log_error("Live kernels have not been listed");
+        success = false;
+    }
+
+    psl_kernel_reset_stats(scale);
+    success &= check_stats(scale, 0, 0, 0);
+
+    psl_kernel_destroy(scale);
+
+    memset(&live, 0, sizeof(LiveKernels));
+    live.kernels[1] = total;
+
+    psl_kernel_for_each_live(find_live_kernel, &live);
+
+    if(live.num_live != 1 || !live.found[1])
+    {
+        logger_log_error("Destroyed kernel is still listed");
+        success = false;
+    }
+
+    psl_kernel_destroy(total);
+
+    return success;
+}
+
+int main(void)
+{
+    logger_init();
+
+    bool success = true;
+
+    success &= test_counters();
+
+    logger_release();
+
+    return success ? 0 : 1;
+}
@@ -0,0 +1,279 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#include "psl/dump.h"
+#include "test_utils.h"
+
+#include "libromano/logger.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const char* source = "main shade(f32 x, f64 y, uniform f32 s, export f32 a, reduce(sum) f64 total)\n"
+                            "{ a = sqrt(x) * s;\n"
+                            "  total = y * 2.0; }\n";
+
+PSL_Kernel* compile_unrolled(const char* source, uint32_t unroll)
+{
+    PSL_CompileOptions options;
+    psl_compile_options_init(&options);
+    options.unroll = unroll;
+
+    return compile_source_with_options(source, &options);
+}
+
+/* Decodes the instructions emitted from offset and compares them to the expected text */
+bool check_decode(PSL_CodeBuffer* buffer, size_t offset, const char* expected)
+{
+    PSL_X64Inst inst;
+
+    if(!psl_x64_decode(buffer->data, buffer->size, offset, &inst) ||
+       offset + inst.size != buffer->size ||
+       strcmp(inst.text, expected) != 0)
+    {
+        logger_log_error("Decoded \"%s\" instead of \"%s\"", inst.text, expected);
+        return false;
+    }
+
+    return true;
+}
+
+bool test_decode(void)
+{
+    PSL_CodeBuffer buffer;
+    psl_code_buffer_init(&buffer, 256);
+
+    bool success = true;
+    size_t offset = 0;
+
+    PSL_X64Mem slot = psl_x64_mem(PSL_GPR_RSP, 0x40);
+    PSL_X64Mem element = psl_x64_mem_index(PSL_GPR_RAX, PSL_GPR_RBX, 4, 0x20);
+    PSL_X64Mem saved = psl_x64_mem(PSL_GPR_RBP, -40);
+    PSL_X64Mem partial = psl_x64_mem(PSL_GPR_R15, 0);
+
+    psl_x64_push(&buffer, PSL_GPR_R12);
+    success &= check_decode(&buffer, offset, "push r12");
+    offset = buffer.size;
+
+    psl_x64_mov_rm(&buffer, PSL_GPR_R13, &partial);
+    success &= check_decode(&buffer, offset, "mov r13, [r15]");
+    offset = buffer.size;
+
+    psl_x64_lea(&buffer, PSL_GPR_RSP, &saved);
+    success &= check_decode(&buffer, offset, "lea rsp, [rbp-0x28]");
+    offset = buffer.size;
+
+    psl_x64_and_ri(&buffer, PSL_GPR_RSP, -32);
+    success &= check_decode(&buffer, offset, "and rsp, -0x20");
+    offset = buffer.size;
+
+    psl_x64_mov_ri64(&buffer, PSL_GPR_RAX, 0x123456789);
+    success &= check_decode(&buffer, offset, "mov rax, 0x123456789");
+    offset = buffer.size;
+
+    psl_x64_xor_rr32(&buffer, PSL_GPR_RBX, PSL_GPR_RBX);
+    success &= check_decode(&buffer, offset, "xor ebx, ebx");
+    offset = buffer.size;
+
+    psl_x64_patch_rel32(&buffer, psl_x64_jcc(&buffer, PSL_Cond_AE), 0);
+    success &= check_decode(&buffer, offset, "jae 0x0");
+    offset = buffer.size;
+
+    psl_x64_vex_rm(&buffer, PSL_X64VexOp_vmovups, 0, 0, &element);
+    success &= check_decode(&buffer, offset, "vmovups ymm0, [rax+rbx*4+0x20]");
+    offset = buffer.size;
+
+    psl_x64_vex_rm(&buffer, PSL_X64VexOp_vaddpd, 9, 1, &slot);
+    success &= check_decode(&buffer, offset, "vaddpd ymm9, ymm1, [rsp+0x40]");
+    offset = buffer.size;
+
+    psl_x64_vex_rm(&buffer, PSL_X64VexOp_vmovaps_store, 12, 0, &slot);
+    success &= check_decode(&buffer, offset, "vmovaps [rsp+0x40], ymm12");
+    offset = buffer.size;
+
+    psl_x64_vex_rm(&buffer, PSL_X64VexOp_vblendvps, 0, 1, &slot);
+    psl_code_buffer_emit8(&buffer, 2 << 4);
+    success &= check_decode(&buffer, offset, "vblendvps ymm0, ymm1, [rsp+0x40], ymm2");
+    offset = buffer.size;
+
+    psl_x64_vex_rr(&buffer, PSL_X64VexOp_vextractf128, 0, 0, 1);
+    psl_code_buffer_emit8(&buffer, 1);
+    success &= check_decode(&buffer, offset, "vextractf128 xmm1, ymm0, 0x1");
+    offset = buffer.size;
+
+    psl_x64_vex_rr(&buffer, PSL_X64VexOp_vmovq, 0, 0, PSL_GPR_RAX);
+    success &= check_decode(&buffer, offset, "vmovq xmm0, rax");
+    offset = buffer.size;
+
+    psl_x64_vex_rr(&buffer, PSL_X64VexOp_vfmadd231pd, 0, 1, 2);
+    success &= check_decode(&buffer, offset, "vfmadd231pd ymm0, ymm1, ymm2");
+    offset = buffer.size;
+
+    psl_x64_vzeroupper(&buffer);
+    success &= check_decode(&buffer, offset, "vzeroupper");
+    offset = buffer.size;
+
+    PSL_X64Inst inst;
+    const uint8_t unknown[2] = { 0x0F, 0x0B };
+
+    if(psl_x64_decode(unknown, sizeof(unknown), 0, &inst))
+    {
+        logger_log_error("ud2 is not emitted but has been decoded as %s", inst.text);
+        success = false;
+    }
+
+    psl_code_buffer_destroy(&buffer);
+
+    return success;
+}
+
+char* dump_to_string(PSL_Kernel* kernel)
+{
+    FILE* file = tmpfile();
+
+    if(file == NULL || !psl_kernel_dump(kernel, file))
+    {
+        logger_log_error("Cannot dump the kernel");
+
+        if(file != NULL)
+        {
+            fclose(file);
+        }
+
+        return NULL;
+    }
+
+    const size_t size = (size_t)ftell(file);
+    char* text = (char*)malloc(size + 1);
+
+    fseek(file, 0, SEEK_SET);
+    text[fread(text, 1, size, file)] = '\0';
+    fclose(file);
+
+    return text;
+}
+
+bool test_dump(void)
+{
+    PSL_Kernel* kernel = compile_unrolled(source, 2);
+
+    if(kernel == NULL)
+    {
+        return false;
+    }
+
+    char* text = dump_to_string(kernel);
+
+    if(text == NULL)
+    {
+        psl_kernel_destroy(kernel);
+        return false;
+    }
+
+    static const char* expected[] = {
+        "kernel shade:",
+        "sqrt %",
+        "load column 0  ; line 1",
+        "line 2",
+        "line 3",
+        "per group",
+        "invariant",
+        "reduction 0 accumulates in ymm3-ymm4",
+        "; main loop, 16 lanes per iteration",
+        "vsqrtps ymm0, [rsp+",
+        "vmulpd ymm0, ymm0, [rsp+",
+        "vaddpd ymm3, ymm0, ymm3",
+        "ret",
+        "16 lanes",
+        "bound by p",
+    };
+
+    bool success = true;
+
+    for(uint32_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++)
+    {
+        if(strstr(text, expected[i]) == NULL)
+        {
+            logger_log_error("Dump misses \"%s\"", expected[i]);
+            success = false;
+        }
+    }
+
+    if(strstr(text, "(bad)") != NULL)
+    {
+        logger_log_error("Dump has instructions that cannot be decoded");
+        success = false;
+    }
+
+    if(!success)
+    {
+        logger_log_error("%s", text);
+    }
+
+    free(text);
+    psl_kernel_destroy(kernel);
+
+    return success;
+}
+
+bool test_cost(void)
+{
+    PSL_Kernel* single = compile_unrolled(source, 1);
+    PSL_Kernel* unrolled = compile_unrolled(source, 4);
+
+    if(single == NULL || unrolled == NULL)
+    {
+        psl_kernel_destroy(single);
+        psl_kernel_destroy(unrolled);
+        return false;
+    }
+
+    PSL_KernelCost single_cost;
+    PSL_KernelCost unrolled_cost;
+
+    bool success = psl_kernel_estimate_cost(single, &single_cost) && psl_kernel_estimate_cost(unrolled, &unrolled_cost);
+
+    if(!success)
+    {
+        logger_log_error("Cannot estimate the cost of the kernels");
+    }
+    else if(single_cost.lanes != PSL_LANES || unrolled_cost.lanes != 4 * PSL_LANES)
+    {
+        logger_log_error("Wrong lanes per iteration: %u and %u", single_cost.lanes, unrolled_cost.lanes);
+        success = false;
+    }
+    else if(single_cost.num_loads == 0 || single_cost.num_stores == 0 || single_cost.ports[single_cost.bottleneck] <= 0.0)
+    {
+        logger_log_error("Empty cost estimate");
+        success = false;
+    }
+    else if(unrolled_cost.insts_per_lane >= single_cost.insts_per_lane)
+    {
+        /* Loop control is shared by the groups of an unrolled iteration */
+        logger_log_error("Unrolling does not reduce the instructions per lane: %f and %f",
+                         unrolled_cost.insts_per_lane,
+                         single_cost.insts_per_lane);
+        success = false;
+    }
+
+    psl_kernel_destroy(single);
+    psl_kernel_destroy(unrolled);
+
+    return success;
+}
+
+int main(void)
+{
+    logger_init();
+
+    bool success = true;
+
+    success &= test_decode();
+    success &= test_dump();
+    success &= test_cost();
+
+    logger_release();
+
+    return success ? 0 : 1;
+}
@@ -0,0 +1,1768 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#include "psl/kernel.h"
+#include "test_utils.h"
+
+#include "libromano/logger.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(PSL_WIN)
+#include <pthread.h>
+#endif /* !defined(PSL_WIN) */
+
+#define NUM_ELEMENTS 1003
+
+bool check_close(const char* name, float* values, float* expected, size_t count)
+{
+    for(size_t i = 0; i < count; i++)
+    {
+        if(fabsf(values[i] - expected[i]) > 1e-5f)
+        {
+            logger_log_error("%s[%zu] = %f, expected %f", name, i, values[i], expected[i]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool check_close_f64(const char* name, double* values, double* expected, size_t count)
+{
+    for(size_t i = 0; i < count; i++)
+    {
+        if(fabs(values[i] - expected[i]) > 1e-12)
+        {
+            logger_log_error("%s[%zu] = %.17g, expected %.17g", name, i, values[i], expected[i]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool test_example(void)
+{
+    FileContent content;
+    PSL_Kernel* kernel = compile_file(TESTS_DATA_DIR"/example.psl", "myFunc", NULL, &content);
+
+    if(kernel == NULL)
+    {
+        return false;
+    }
+
+    psl_ir_print(&kernel->ir);
+
+    float* data = (float*)malloc(7 * NUM_ELEMENTS * sizeof(float));
+    float* nx = data;
+    float* ny = data + NUM_ELEMENTS;
+    float* nz = data + 2 * NUM_ELEMENTS;
+    float* u = data + 3 * NUM_ELEMENTS;
+    float* v = data + 4 * NUM_ELEMENTS;
+    float* expected_u = data + 5 * NUM_ELEMENTS;
+    float* expected_v = data + 6 * NUM_ELEMENTS;
+
+    for(size_t i = 0; i < NUM_ELEMENTS; i++)
+    {
+        const float t = (float)i * 0.01f;
+        nx[i] = cosf(t) * cosf(t * 0.5f);
+        ny[i] = sinf(t * 0.5f);
+        nz[i] = sinf(t) * cosf(t * 0.5f);
+        expected_u[i] = atan2f(nz[i], nx[i]) * 0.1591f + 0.5f;
+        expected_v[i] = asinf(ny[i]) * 0.3183f + 0.5f;
+    }
+
+    void* columns[5] = { nx, ny, nz, u, v };
+
+    PSL_Bindings bindings;
+    bindings.columns = columns;
+    bindings.uniforms = NULL;
+
+    psl_kernel_execute(kernel, &bindings, NUM_ELEMENTS);
+
+    bool success = check_close("u", u, expected_u, NUM_ELEMENTS) &&
+                   check_close("v", v, expected_v, NUM_ELEMENTS);
+
+    free(data);
+
+    psl_kernel_destroy(kernel);
+    fs_file_content_free(&content);
+
+    return success;
+}
+
+bool test_uniform(void)
+{
+    FileContent content;
+    Vector* tokens = vector_new(128, sizeof(PSL_Token));
+
+    PSL_AST* ast = parse_file(TESTS_DATA_DIR"/uniform.psl", &content, tokens);
+
+    if(ast == NULL)
+    {
+        vector_free(tokens);
+        return false;
+    }
+
+    psl_ast_print(ast);
+
+    float scale = 4.0f;
+    float offset = 0.25f;
+
+    float* data = (float*)malloc(3 * NUM_ELEMENTS * sizeof(float));
+    float* x = data;
+    float* y = data + NUM_ELEMENTS;
+    float* expected_y = data + 2 * NUM_ELEMENTS;
+
+    for(size_t i = 0; i < NUM_ELEMENTS; i++)
+    {
+        x[i] = (float)i * 0.5f - 100.0f;
+        expected_y[i] = x[i] * (scale * 2.0f + offset) + sqrtf(scale);
+    }
+
+    void* columns[2] = { x, y };
+    void* uniforms[2] = { &scale, &offset };
+
+    PSL_Bindings bindings;
+    bindings.columns = columns;
+    bindings.uniforms = uniforms;
+
+    /* Uniforms read at execution */
+    PSL_Kernel* kernel = psl_kernel_new();
+
+    bool success = psl_kernel_compile(kernel, ast, NULL, NULL);
+
+    if(!success)
+    {
+        logger_log_error("Error during compilation: %s", kernel->error);
+    }
+    else
+    {
+        psl_kernel_execute(kernel, &bindings, NUM_ELEMENTS);
+        success = check_close("y", y, expected_y, NUM_ELEMENTS);
+    }
+
+    psl_kernel_destroy(kernel);
+
+    /* Uniform specialized at compile time, scale is folded away */
+    PSL_Specialization specialization;
+    specialization.name = "scale";
+    specialization.value = scale;
+
+    PSL_CompileOptions options;
+    psl_compile_options_init(&options);
+    options.specializations = &specialization;
+    options.num_specializations = 1;
+
+    kernel = psl_kernel_new();
+
+    if(success && !psl_kernel_compile(kernel, ast, "scaleOffset", &options))
+    {
+        logger_log_error("Error during specialized compilation: %s", kernel->error);
+        success = false;
+    }
+    else if(success)
+    {
+        psl_ir_print(&kernel->ir);
+
+        for(uint32_t i = 0; i < kernel->ir.num_insts; i++)
+        {
+            if(kernel->ir.insts[i].opcode == PSL_IROpcode_Uniform && kernel->ir.insts[i].index == 0)
+            {
+                logger_log_error("Specialized uniform has not been folded");
+                success = false;
+            }
+        }
+
+        /* The specialized uniform must not be read */
+        uniforms[0] = NULL;
+
+        psl_kernel_execute(kernel, &bindings, NUM_ELEMENTS);
+        success &= check_close("y", y, expected_y, NUM_ELEMENTS);
+    }
+
+    psl_kernel_destroy(kernel);
+    free(data);
+    psl_ast_destroy(ast);
+    vector_free(tokens);
+    fs_file_content_free(&content);
+
+    return success;
+}
+
+float reference_saturate(float x)
+{
+    return x < 0.0f ? 0.0f : (x > 1.0f ? 1.0f : x);
+}
+
+bool test_conditionals(void)
+{
+    FileContent content;
+    PSL_Kernel* kernel = compile_file(TESTS_DATA_DIR"/conditionals.psl", NULL, NULL, &content);
+
+    if(kernel == NULL)
+    {
+        return false;
+    }
+
+    psl_ir_print(&kernel->ir);
+
+    float* data = (float*)malloc(8 * NUM_ELEMENTS * sizeof(float));
+    float* x = data;
+    float* y = data + NUM_ELEMENTS;
+    float* a = data + 2 * NUM_ELEMENTS;
+    float* b = data + 3 * NUM_ELEMENTS;
+    float* c = data + 4 * NUM_ELEMENTS;
+    float* expected_a = data + 5 * NUM_ELEMENTS;
+    float* expected_b = data + 6 * NUM_ELEMENTS;
+    float* expected_c = data + 7 * NUM_ELEMENTS;
+
+    for(size_t i = 0; i < NUM_ELEMENTS; i++)
+    {
+        x[i] = sinf((float)i * 0.1f) * 2.0f;
+        y[i] = (i % 7) == 0 ? x[i] : cosf((float)i * 0.05f) * 1.5f;
+
+        expected_a[i] = x[i] < 0.0f ? x[i] * 0.5f : x[i] * 2.0f;
+        expected_b[i] = x[i] >= y[i] ? fminf(fmaxf(x[i], 0.25f), 1.0f) : reference_saturate(y[i]);
+        expected_c[i] = x[i] != y[i] ? fabsf(x[i] - y[i]) : 1.0f;
+    }
+
+    void* columns[5] = { x, y, a, b, c };
+
+    PSL_Bindings bindings;
+    bindings.columns = columns;
+    bindings.uniforms = NULL;
+
+    psl_kernel_execute(kernel, &bindings, NUM_ELEMENTS);
+
+    bool success = check_close("a", a, expected_a, NUM_ELEMENTS) &&
+                   check_close("b", b, expected_b, NUM_ELEMENTS) &&
+                   check_close("c", c, expected_c, NUM_ELEMENTS);
+
+    free(data);
+
+    psl_kernel_destroy(kernel);
+    fs_file_content_free(&content);
+
+    return success;
+}
+
+bool test_precision(void)
+{
+    FileContent content;
+    PSL_Kernel* kernel = compile_file(TESTS_DATA_DIR"/precision.psl", NULL, NULL, &content);
+
+    if(kernel == NULL)
+    {
+        return false;
+    }
+
+    psl_ir_print(&kernel->ir);
+
+    float* x = (float*)malloc(NUM_ELEMENTS * sizeof(float));
+    float* narrowed = (float*)malloc(3 * NUM_ELEMENTS * sizeof(float));
+    float* sign = narrowed + NUM_ELEMENTS;
+    float* expected_narrowed = narrowed + 2 * NUM_ELEMENTS;
+    double* y = (double*)malloc(5 * NUM_ELEMENTS * sizeof(double));
+    double* length = y + NUM_ELEMENTS;
+    double* picked = y + 2 * NUM_ELEMENTS;
+    double* expected_length = y + 3 * NUM_ELEMENTS;
+    double* expected_picked = y + 4 * NUM_ELEMENTS;
+    float* expected_sign = (float*)malloc(NUM_ELEMENTS * sizeof(float));
+
+    double scale = 1.0 + 1e-9;
+
+    for(size_t i = 0; i < NUM_ELEMENTS; i++)
+    {
+        x[i] = (float)i * 0.001f;
+        y[i] = sin((double)i * 0.37) * 1e3 + 1e-7;
+
+        expected_length[i] = sqrt((double)x[i] * (double)x[i] + y[i] * y[i]) * scale + 0.1;
+        /* Keeps the compiler from contracting the reference into a fma */
+        volatile float square = x[i] * x[i];
+
+        expected_narrowed[i] = square + (float)(y[i] * 0.5);
+        expected_sign[i] = y[i] < 0.0 ? x[i] : 1.0f;
+        expected_picked[i] = x[i] < 0.5f ? floor(y[i]) : fabs(y[i]);
+    }
+
+    void* columns[6] = { x, y, length, narrowed, sign, picked };
+    void* uniforms[1] = { &scale };
+
+    PSL_Bindings bindings;
+    bindings.columns = columns;
+    bindings.uniforms = uniforms;
+
+    psl_kernel_execute(kernel, &bindings, NUM_ELEMENTS);
+
+    bool success = check_close_f64("length", length, expected_length, NUM_ELEMENTS) &&
+                   check_close("narrowed", narrowed, expected_narrowed, NUM_ELEMENTS) &&
+                   check_close("sign", sign, expected_sign, NUM_ELEMENTS) &&
+                   check_close_f64("picked", picked, expected_picked, NUM_ELEMENTS);
+
+    free(x);
+    free(narrowed);
+    free(y);
+    free(expected_sign);
+
+    psl_kernel_destroy(kernel);
+    fs_file_content_free(&content);
+
+    /* Narrowing conversions must be explicit */
+    Vector* tokens = vector_new(128, sizeof(PSL_Token));
+    PSL_AST* ast = parse_source("main narrow(f64 x, export f32 y) { y = x * 2.0; }", tokens);
+
+    kernel = psl_kernel_new();
+
+    if(ast == NULL || psl_kernel_compile(kernel, ast, NULL, NULL))
+    {
+        logger_log_error("Implicit narrowing conversion has not been rejected");
+        success = false;
+    }
+
+    psl_kernel_destroy(kernel);
+    psl_ast_destroy(ast);
+    vector_free(tokens);
+
+    /* A literal narrowed explicitly is widened from its f32 value */
+    kernel = compile_source("main widen(f64 x, export f64 y) { y = f64(f32(0.1)) + x; }");
+
+    if(kernel == NULL)
+    {
+        success = false;
+    }
+    else
+    {
+        double x[PSL_LANES] = { 0.0 };
+        double y[PSL_LANES];
+
+        void* columns[2] = { x, y };
+
+        PSL_Bindings bindings;
+        bindings.columns = columns;
+        bindings.uniforms = NULL;
+
+        psl_kernel_execute(kernel, &bindings, PSL_LANES);
+
+        if(y[0] != (double)0.1f)
+        {
+            logger_log_error("f64(f32(0.1)) is %.17g, expected %.17g", y[0], (double)0.1f);
+            success = false;
+        }
+    }
+
+    psl_kernel_destroy(kernel);
+
+    return success;
+}
+
+/* Decodes an IEEE half, subnormals are off by less than 1e-4 */
+float half_to_float(uint16_t half)
+{
+    const int exponent = (half >> 10) & 0x1F;
+    const float mantissa = 1.0f + (float)(half & 0x3FF) / 1024.0f;
+    const float value = ldexpf(mantissa, exponent - 15);
+
+    return (half & 0x8000) ? -value : value;
+}
+
+uint32_t encode_unorm(float value, float max)
+{
+    value = value > 0.0f ? value : 0.0f;
+    value = value < 1.0f ? value : 1.0f;
+
+    return (uint32_t)lrintf(value * max);
+}
+
+bool test_storage(void)
+{
+    FileContent content;
+    const PSL_ColumnStorage storages[] = {
+        { "color", PSL_ColumnFormat_Unorm8 },
+        { "weight", PSL_ColumnFormat_Unorm16 },
+        { "depth", PSL_ColumnFormat_F16 },
+        { "bias", PSL_ColumnFormat_F64 },
+        { "offset", PSL_ColumnFormat_F32 },
+        { "brightened", PSL_ColumnFormat_Unorm8 },
+        { "blended", PSL_ColumnFormat_F16 },
+        { "scaled", PSL_ColumnFormat_Unorm16 },
+        { "shifted", PSL_ColumnFormat_F32 },
+        { "total", PSL_ColumnFormat_F64 },
+    };
+
+    PSL_CompileOptions options;
+    psl_compile_options_init(&options);
+    options.column_formats = storages;
+    options.num_column_formats = sizeof(storages) / sizeof(storages[0]);
+
+    PSL_Kernel* kernel = compile_file(TESTS_DATA_DIR"/storage.psl", NULL, &options, &content);
+
+    if(kernel == NULL)
+    {
+        return false;
+    }
+
+    bool success = true;
+
+    uint8_t* color = (uint8_t*)malloc(2 * NUM_ELEMENTS * sizeof(uint8_t));
+    uint8_t* brightened = color + NUM_ELEMENTS;
+    uint16_t* weight = (uint16_t*)malloc(4 * NUM_ELEMENTS * sizeof(uint16_t));
+    uint16_t* depth = weight + NUM_ELEMENTS;
+    uint16_t* blended = weight + 2 * NUM_ELEMENTS;
+    uint16_t* scaled = weight + 3 * NUM_ELEMENTS;
+    float* offset = (float*)malloc(3 * NUM_ELEMENTS * sizeof(float));
+    float* shifted = offset + NUM_ELEMENTS;
+    float* expected_shifted = offset + 2 * NUM_ELEMENTS;
+    double* bias = (double*)malloc(3 * NUM_ELEMENTS * sizeof(double));
+    double* total = bias + NUM_ELEMENTS;
+    double* expected_total = bias + 2 * NUM_ELEMENTS;
+
+    for(size_t i = 0; i < NUM_ELEMENTS; i++)
+    {
+        color[i] = (uint8_t)(i * 7);
+        weight[i] = (uint16_t)(i * 331);
+        depth[i] = (uint16_t)(0x3C00 + (i % 1024)); /* [1, 2) */
+        bias[i] = (double)i * 0.01 + 1e-9;
+        offset[i] = (float)i * 0.25f;
+    }
+
+    void* columns[10] = { color, weight, depth, bias, offset, brightened, blended, scaled, shifted, total };
+
+    PSL_Bindings bindings;
+    bindings.columns = columns;
+    bindings.uniforms = NULL;
+
+    psl_kernel_execute(kernel, &bindings, NUM_ELEMENTS);
+
+    for(size_t i = 0; success && i < NUM_ELEMENTS; i++)
+    {
+        const float color_value = (float)color[i] * (1.0f / 255.0f);
+        const float weight_value = (float)weight[i] * (1.0f / 65535.0f);
+        const double depth_value = (double)half_to_float(depth[i]);
+
+        /* Keeps the compiler from contracting the reference into a fma */
+        volatile float doubled = color_value * 2.0f;
+        const uint32_t expected_brightened = encode_unorm(doubled - 0.25f, 255.0f);
+        const uint32_t expected_scaled = encode_unorm((float)(depth_value * 0.5), 65535.0f);
+        const float expected_blended = color_value * weight_value;
+
+        expected_shifted[i] = (float)((double)offset[i] + depth_value);
+        expected_total[i] = (double)((float)bias[i] + weight_value);
+
+        if(brightened[i] != expected_brightened || scaled[i] != expected_scaled)
+        {
+            logger_log_error("unorm[%zu] = %u %u, expected %u %u",
+                             i, brightened[i], scaled[i], expected_brightened, expected_scaled);
+            success = false;
+        }
+
+        if(fabsf(half_to_float(blended[i]) - expected_blended) > 1e-3f)
+        {
+            logger_log_error("blended[%zu] = %f, expected %f", i, half_to_float(blended[i]), expected_blended);
+            success = false;
+        }
+    }
+
+    success = success &&
+              check_close("shifted", shifted, expected_shifted, NUM_ELEMENTS) &&
+              check_close_f64("total", total, expected_total, NUM_ELEMENTS);
+
+    free(color);
+    free(weight);
+    free(offset);
+    free(bias);
+
+    psl_kernel_destroy(kernel);
+    fs_file_content_free(&content);
+
+    return success;
+}
+
+/* Sums like kernels do: per lane over the full vectors, then lane by lane, then the tail */
+float reference_sum(const float* values, size_t count)
+{
+    const size_t full = count - (count % 8);
+    float lanes[8] = { 0.0f };
+    float sum = 0.0f;
+
+    for(size_t i = 0; i < full; i++)
+    {
+        lanes[i % 8] += values[i];
+    }
+
+    for(size_t i = 0; i < 8 && full > 0; i++)
+    {
+        sum += lanes[i];
+    }
+
+    for(size_t i = full; i < count; i++)
+    {
+        sum += values[i];
+    }
+
+    return sum;
+}
+
+double reference_sum_f64(const double* values, size_t count)
+{
+    const size_t full = count - (count % 8);
+    double lanes[8] = { 0.0 };
+    double sum = 0.0;
+
+    for(size_t i = 0; i < full; i++)
+    {
+        lanes[i % 8] += values[i];
+    }
+
+    for(size_t i = 0; i < 8 && full > 0; i++)
+    {
+        sum += lanes[i];
+    }
+
+    for(size_t i = full; i < count; i++)
+    {
+        sum += values[i];
+    }
+
+    return sum;
+}
+
+bool test_reduction(void)
+{
+    FileContent content;
+    PSL_Kernel* kernel = compile_file(TESTS_DATA_DIR"/reduction.psl", NULL, NULL, &content);
+
+    if(kernel == NULL)
+    {
+        return false;
+    }
+
+    bool success = true;
+
+    psl_ir_print(&kernel->ir);
+
+    float* data = (float*)malloc(5 * NUM_ELEMENTS * sizeof(float));
+    float* r = data;
+    float* g = data + NUM_ELEMENTS;
+    float* b = data + 2 * NUM_ELEMENTS;
+    float* y = data + 3 * NUM_ELEMENTS;
+    float* wave = data + 4 * NUM_ELEMENTS;
+    double* weight = (double*)malloc(2 * NUM_ELEMENTS * sizeof(double));
+    double* weighted_values = weight + NUM_ELEMENTS;
+
+    for(size_t i = 0; i < NUM_ELEMENTS; i++)
+    {
+        r[i] = (float)(i % 17) / 16.0f;
+        g[i] = (float)(i % 29) / 28.0f;
+        b[i] = (float)(i % 11) / 10.0f;
+        weight[i] = 1.0 + (double)i * 1e-3;
+    }
+
+    float total, darkest, brightest, peak;
+    double weighted;
+
+    void* columns[10] = { r, g, b, weight, y, wave, &total, &darkest, &brightest, &weighted };
+    void* columns_with_peak[11];
+
+    for(size_t i = 0; i < 10; i++)
+    {
+        columns_with_peak[i] = columns[i];
+    }
+
+    columns_with_peak[10] = &peak;
+
+    PSL_Bindings bindings;
+    bindings.columns = columns_with_peak;
+    bindings.uniforms = NULL;
+
+    psl_kernel_execute(kernel, &bindings, NUM_ELEMENTS);
+
+    float expected_darkest = INFINITY;
+    float expected_brightest = -INFINITY;
+    float expected_peak = -INFINITY;
+
+    for(size_t i = 0; i < NUM_ELEMENTS; i++)
+    {
+        expected_darkest = y[i] < expected_darkest ? y[i] : expected_darkest;
+        expected_brightest = y[i] > expected_brightest ? y[i] : expected_brightest;
+        expected_peak = wave[i] > expected_peak ? wave[i] : expected_peak;
+        weighted_values[i] = weight[i] * (double)y[i];
+    }
+
+    const float expected_total = reference_sum(y, NUM_ELEMENTS);
+    const double expected_weighted = reference_sum_f64(weighted_values, NUM_ELEMENTS);
+
+    if(total != expected_total || darkest != expected_darkest || brightest != expected_brightest ||
+       peak != expected_peak || weighted != expected_weighted)
+    {
+        logger_log_error("Reductions %f %f %f %f %.17g, expected %f %f %f %f %.17g",
+                         total, darkest, brightest, peak, weighted,
+                         expected_total, expected_darkest, expected_brightest, expected_peak, expected_weighted);
+        success = false;
+    }
+
+    /* Results are overwritten, not accumulated, by every execution */
+    psl_kernel_execute(kernel, &bindings, NUM_ELEMENTS);
+
+    if(total != expected_total || weighted != expected_weighted)
+    {
+        logger_log_error("Reductions differ between executions");
+        success = false;
+    }
+
+    free(data);
+    free(weight);
+
+    psl_kernel_destroy(kernel);
+    fs_file_content_free(&content);
+
+    /* More accumulators than registers, the last ones are kept in memory */
+    char source[1024];
+    int length = snprintf(source, sizeof(source), "main many(f64 x");
+
+    for(int i = 0; i < 8; i++)
+    {
+        length += snprintf(source + length, sizeof(source) - length, ", reduce(sum) f64 s%d", i);
+    }
+
+    length += snprintf(source + length, sizeof(source) - length, ") {");
+
+    for(int i = 0; i < 8; i++)
+    {
+        length += snprintf(source + length, sizeof(source) - length, " s%d = x * %d.0;", i, i + 1);
+    }
+
+    snprintf(source + length, sizeof(source) - length, " }");
+
+    kernel = compile_source(source);
+
+    if(kernel == NULL)
+    {
+        success = false;
+    }
+    else
+    {
+        double* x = (double*)malloc(2 * NUM_ELEMENTS * sizeof(double));
+        double* scaled = x + NUM_ELEMENTS;
+        double sums[8];
+        void* columns[9] = { x };
+
+        for(size_t i = 0; i < NUM_ELEMENTS; i++)
+        {
+            x[i] = (double)i * 0.37 - 100.0;
+        }
+
+        for(int i = 0; i < 8; i++)
+        {
+            columns[i + 1] = &sums[i];
+        }
+
+        PSL_Bindings bindings;
+        bindings.columns = columns;
+        bindings.uniforms = NULL;
+
+        psl_kernel_execute(kernel, &bindings, NUM_ELEMENTS);
+
+        for(int i = 0; i < 8 && success; i++)
+        {
+            for(size_t j = 0; j < NUM_ELEMENTS; j++)
+            {
+                scaled[j] = x[j] * (double)(i + 1);
+            }
+
+            const double expected = reference_sum_f64(scaled, NUM_ELEMENTS);
+
+            if(sums[i] != expected)
+            {
+                logger_log_error("s%d = %.17g, expected %.17g", i, sums[i], expected);
+                success = false;
+            }
+        }
+
+        free(x);
+    }
+
+    psl_kernel_destroy(kernel);
+
+    /* Only sum, min and max are supported */
+    Vector* tokens = vector_new(128, sizeof(PSL_Token));
+    PSL_AST* ast = psl_ast_new();
+
+    PSL_Lexer lexer;
+    psl_lexer_init(&lexer, "main average(f32 x, reduce(avg) f32 a) { a = x; }");
+
+    if(psl_lexer_lex(&lexer, tokens) && psl_ast_from_tokens(ast, tokens))
+    {
+        logger_log_error("Unknown reduction has not been rejected");
+        success = false;
+    }
+
+    psl_ast_destroy(ast);
+    vector_free(tokens);
+
+    return success;
+}
+
+bool test_fusion(void)
+{
+    FileContent content;
+    Vector* tokens = vector_new(128, sizeof(PSL_Token));
+    Vector* shade_tokens = vector_new(128, sizeof(PSL_Token));
+
+    PSL_AST* ast = parse_file(TESTS_DATA_DIR"/example.psl", &content, tokens);
+
+    if(ast == NULL)
+    {
+        vector_free(shade_tokens);
+        vector_free(tokens);
+        return false;
+    }
+
+    /* Reads u exported by myFunc, and shares the Ny input */
+    PSL_AST* shade_ast = parse_source("main shade(f32 u, f32 Ny, uniform f32 gain, export f32 w)"
+                                      "{ w = u * gain + Ny; }",
+                                      shade_tokens);
+
+    bool success = shade_ast != NULL;
+
+    PSL_EntryPoint entry_points[2];
+    entry_points[0].ast = ast;
+    entry_points[0].name = "myFunc";
+    entry_points[1].ast = shade_ast;
+    entry_points[1].name = NULL;
+
+    PSL_Kernel* kernel = psl_kernel_new();
+
+    if(success && !psl_kernel_compile_fused(kernel, entry_points, 2, NULL))
+    {
+        logger_log_error("Error during compilation: %s", kernel->error);
+        success = false;
+    }
+
+    if(success)
+    {
+        psl_ir_print(&kernel->ir);
+
+        float* data = (float*)malloc(8 * NUM_ELEMENTS * sizeof(float));
+        float* nx = data;
+        float* ny = data + NUM_ELEMENTS;
+        float* nz = data + 2 * NUM_ELEMENTS;
+        float* u = data + 3 * NUM_ELEMENTS;
+        float* v = data + 4 * NUM_ELEMENTS;
+        float* w = data + 5 * NUM_ELEMENTS;
+        float* expected_u = data + 6 * NUM_ELEMENTS;
+        float* expected_w = data + 7 * NUM_ELEMENTS;
+        float gain = 3.0f;
+
+        for(size_t i = 0; i < NUM_ELEMENTS; i++)
+        {
+            const float t = (float)i * 0.01f;
+            nx[i] = cosf(t) * cosf(t * 0.5f);
+            ny[i] = sinf(t * 0.5f);
+            nz[i] = sinf(t) * cosf(t * 0.5f);
+            expected_u[i] = atan2f(nz[i], nx[i]) * 0.1591f + 0.5f;
+            expected_w[i] = expected_u[i] * gain + ny[i];
+        }
+
+        /* Nx, Ny, Nz, u, v from myFunc, then w from shade */
+        void* columns[6] = { nx, ny, nz, u, v, w };
+        void* uniforms[1] = { &gain };
+
+        PSL_Bindings bindings;
+        bindings.columns = columns;
+        bindings.uniforms = uniforms;
+
+        psl_kernel_execute(kernel, &bindings, NUM_ELEMENTS);
+
+        success = kernel->ir.num_columns == 6 &&
+                  check_close("u", u, expected_u, NUM_ELEMENTS) &&
+                  check_close("w", w, expected_w, NUM_ELEMENTS);
+
+        /* Each shared input is loaded once */
+        uint32_t num_loads = 0;
+
+        for(uint32_t i = 0; i < kernel->ir.num_insts; i++)
+        {
+            num_loads += kernel->ir.insts[i].opcode == PSL_IROpcode_Load;
+        }
+
+        if(num_loads != 3)
+        {
+            logger_log_error("Fused kernel loads %u columns, expected 3", num_loads);
+            success = false;
+        }
+
+        free(data);
+    }
+
+    psl_kernel_destroy(kernel);
+
+    /* Exports cannot be written by two entry points */
+    entry_points[1].ast = ast;
+    kernel = psl_kernel_new();
+
+    if(psl_kernel_compile_fused(kernel, entry_points, 2, NULL))
+    {
+        logger_log_error("Export written by two fused entry points has not been rejected");
+        success = false;
+    }
+
+    psl_kernel_destroy(kernel);
+    psl_ast_destroy(shade_ast);
+    psl_ast_destroy(ast);
+    vector_free(shade_tokens);
+    vector_free(tokens);
+    fs_file_content_free(&content);
+
+    return success;
+}
+
+bool test_variant(void)
+{
+    FileContent content;
+    PSL_Kernel* kernel = compile_file(TESTS_DATA_DIR"/example.psl", "myFunc", NULL, &content);
+
+    if(kernel == NULL)
+    {
+        return false;
+    }
+
+    /* Only u, in column 3, is needed */
+    PSL_Kernel* variant = psl_kernel_variant(kernel, (uint64_t)1 << 3);
+
+    bool success = variant != NULL;
+
+    if(!success)
+    {
+        logger_log_error("Error during variant compilation: %s", kernel->error);
+    }
+    else
+    {
+        psl_ir_print(&variant->ir);
+
+        for(uint32_t i = 0; i < variant->ir.num_insts; i++)
+        {
+            const PSL_IRInst* inst = &variant->ir.insts[i];
+
+            if(inst->opcode == PSL_IROpcode_Load && inst->index == 1)
+            {
+                logger_log_error("Variant still loads Ny");
+                success = false;
+            }
+
+            if(inst->opcode == PSL_IROpcode_Call && inst->index == PSL_BuiltinID_Asin)
+            {
+                logger_log_error("Variant still computes asin");
+                success = false;
+            }
+        }
+
+        if(psl_kernel_variant(kernel, (uint64_t)1 << 3) != variant ||
+           psl_kernel_variant(kernel, ~(uint64_t)0) != kernel)
+        {
+            logger_log_error("Kernel variants are not cached");
+            success = false;
+        }
+
+        float* data = (float*)malloc(4 * NUM_ELEMENTS * sizeof(float));
+        float* nx = data;
+        float* nz = data + NUM_ELEMENTS;
+        float* u = data + 2 * NUM_ELEMENTS;
+        float* expected_u = data + 3 * NUM_ELEMENTS;
+
+        for(size_t i = 0; i < NUM_ELEMENTS; i++)
+        {
+            const float t = (float)i * 0.01f;
+            nx[i] = cosf(t) * cosf(t * 0.5f);
+            nz[i] = sinf(t) * cosf(t * 0.5f);
+            expected_u[i] = atan2f(nz[i], nx[i]) * 0.1591f + 0.5f;
+        }
+
+        /* Columns the variant does not use are not accessed */
+        void* columns[5] = { nx, NULL, nz, u, NULL };
+
+        PSL_Bindings bindings;
+        bindings.columns = columns;
+        bindings.uniforms = NULL;
+
+        psl_kernel_execute(variant, &bindings, NUM_ELEMENTS);
+
+        success = success && check_close("u", u, expected_u, NUM_ELEMENTS);
+
+        free(data);
+    }
+
+    psl_kernel_destroy(kernel);
+    fs_file_content_free(&content);
+
+    return success;
+}
+
+bool test_common_subexpressions(void)
+{
+    /* atan2(z, x) and x * z are computed once, the sums are not reassociated */
+    PSL_Kernel* kernel = compile_source("f32 angle(f32 x, f32 z) { return atan2(z, x); }"
+                                        "main shared(f32 x, f32 z, export f32 a, export f32 b, export f32 c)"
+                                        "{ a = angle(x, z) * 2.0 + x * z; b = atan2(z, x) + z * x; c = (x + z) + a - (x + (z + a)); }");
+
+    if(kernel == NULL)
+    {
+        return false;
+    }
+
+    bool success = true;
+
+    psl_ir_print(&kernel->ir);
+
+    uint32_t num_calls = 0;
+    uint32_t num_muls = 0;
+    uint32_t num_adds = 0;
+
+    for(uint32_t i = 0; i < kernel->ir.num_insts; i++)
+    {
+        num_calls += kernel->ir.insts[i].opcode == PSL_IROpcode_Call;
+        num_muls += kernel->ir.insts[i].opcode == PSL_IROpcode_Mul;
+        num_adds += kernel->ir.insts[i].opcode == PSL_IROpcode_Add;
+    }
+
+    /* x * z and angle * 2 */
+    if(num_calls != 1 || num_muls != 2 || num_adds != 6)
+    {
+        logger_log_error("Found %u calls, %u muls and %u adds, expected 1, 2 and 6", num_calls, num_muls, num_adds);
+        success = false;
+    }
+
+    float* data = (float*)malloc(8 * NUM_ELEMENTS * sizeof(float));
+    float* x = data;
+    float* z = data + NUM_ELEMENTS;
+    float* a = data + 2 * NUM_ELEMENTS;
+    float* b = data + 3 * NUM_ELEMENTS;
+    float* c = data + 4 * NUM_ELEMENTS;
+    float* expected_a = data + 5 * NUM_ELEMENTS;
+    float* expected_b = data + 6 * NUM_ELEMENTS;
+    float* expected_c = data + 7 * NUM_ELEMENTS;
+
+    for(size_t i = 0; i < NUM_ELEMENTS; i++)
+    {
+        x[i] = (float)i * 0.01f - 3.0f;
+        z[i] = (float)(i % 13) * 0.7f + 1e-3f;
+
+        /* Keeps the compiler from contracting the reference into a fma */
+        volatile float product = x[i] * z[i];
+        volatile float twice = atan2f(z[i], x[i]) * 2.0f;
+
+        expected_a[i] = twice + product;
+        expected_b[i] = atan2f(z[i], x[i]) + product;
+        expected_c[i] = ((x[i] + z[i]) + expected_a[i]) - (x[i] + (z[i] + expected_a[i]));
+    }
+
+    void* columns[5] = { x, z, a, b, c };
+
+    PSL_Bindings bindings;
+    bindings.columns = columns;
+    bindings.uniforms = NULL;
+
+    psl_kernel_execute(kernel, &bindings, NUM_ELEMENTS);
+
+    success = success &&
+              check_close("a", a, expected_a, NUM_ELEMENTS) &&
+              check_close("b", b, expected_b, NUM_ELEMENTS) &&
+              check_close("c", c, expected_c, NUM_ELEMENTS);
+
+    free(data);
+
+    psl_kernel_destroy(kernel);
+
+    return success;
+}
+
+bool check_relative(const char* name, float* values, float* expected, size_t count, float tolerance)
+{
+    for(size_t i = 0; i < count; i++)
+    {
+        if(fabsf(values[i] - expected[i]) > tolerance * fabsf(expected[i]))
+        {
+            logger_log_error("%s[%zu] = %.9g, expected %.9g", name, i, values[i], expected[i]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool test_fast_math(void)
+{
+    PSL_CompileOptions options;
+    psl_compile_options_init(&options);
+    options.fast_math = PSL_FastMath_All;
+
+    PSL_Kernel* kernel = compile_source_with_options("main fast(f32 x, f32 y, f32 z, f32 w, export f32 a, export f32 r, export f32 s,"
+                                                     "          export f32 t, export f32 q)"
+                                                     "{ a = x * y + z; r = x / y; s = 1.0 / sqrt(z); t = x + y + z + w; q = x / 4.0; }",
+                                                     &options);
+
+    if(kernel == NULL)
+    {
+        return false;
+    }
+
+    bool success = true;
+
+    psl_ir_print(&kernel->ir);
+
+    uint32_t counts[PSL_IROpcode_Count] = { 0 };
+
+    for(uint32_t i = 0; i < kernel->ir.num_insts; i++)
+    {
+        counts[kernel->ir.insts[i].opcode]++;
+    }
+
+    /* x * y + z contracted, x + y + z + w summed as (x + y) + (z + w) */
+    if(counts[PSL_IROpcode_Fma] != 1 ||
+       counts[PSL_IROpcode_Rcp] != 1 ||
+       counts[PSL_IROpcode_Rsqrt] != 1 ||
+       counts[PSL_IROpcode_Div] != 0 ||
+       counts[PSL_IROpcode_Add] != 3)
+    {
+        logger_log_error("Found %u fma, %u rcp, %u rsqrt, %u div and %u add, expected 1, 1, 1, 0 and 3",
+                         counts[PSL_IROpcode_Fma],
+                         counts[PSL_IROpcode_Rcp],
+                         counts[PSL_IROpcode_Rsqrt],
+                         counts[PSL_IROpcode_Div],
+                         counts[PSL_IROpcode_Add]);
+        success = false;
+    }
+
+    float* data = (float*)malloc(14 * NUM_ELEMENTS * sizeof(float));
+    float* x = data;
+    float* y = data + NUM_ELEMENTS;
+    float* z = data + 2 * NUM_ELEMENTS;
+    float* w = data + 3 * NUM_ELEMENTS;
+    float* a = data + 4 * NUM_ELEMENTS;
+    float* r = data + 5 * NUM_ELEMENTS;
+    float* s = data + 6 * NUM_ELEMENTS;
+    float* t = data + 7 * NUM_ELEMENTS;
+    float* q = data + 8 * NUM_ELEMENTS;
+    float* expected_a = data + 9 * NUM_ELEMENTS;
+    float* expected_r = data + 10 * NUM_ELEMENTS;
+    float* expected_s = data + 11 * NUM_ELEMENTS;
+    float* expected_t = data + 12 * NUM_ELEMENTS;
+    float* expected_q = data + 13 * NUM_ELEMENTS;
+
+    for(size_t i = 0; i < NUM_ELEMENTS; i++)
+    {
+        x[i] = (float)i * 0.37f - 150.0f;
+        y[i] = (float)(i % 17) * 1.3f + 0.25f;
+        z[i] = (float)(i % 29) * 11.0f + 1e-2f;
+        w[i] = (float)i * 1e-3f;
+
+        expected_a[i] = fmaf(x[i], y[i], z[i]);
+        expected_r[i] = x[i] / y[i];
+        expected_s[i] = 1.0f / sqrtf(z[i]);
+        expected_t[i] = (x[i] + y[i]) + (z[i] + w[i]);
+        expected_q[i] = x[i] * 0.25f;
+    }
+
+    void* columns[9] = { x, y, z, w, a, r, s, t, q };
+
+    PSL_Bindings bindings;
+    bindings.columns = columns;
+    bindings.uniforms = NULL;
+
+    psl_kernel_execute(kernel, &bindings, NUM_ELEMENTS);
+
+    /* Approximations are refined with a Newton-Raphson step */
+    success = success &&
+              check_relative("a", a, expected_a, NUM_ELEMENTS, 0.0f) &&
+              check_relative("r", r, expected_r, NUM_ELEMENTS, 1e-6f) &&
+              check_relative("s", s, expected_s, NUM_ELEMENTS, 1e-6f) &&
+              check_relative("t", t, expected_t, NUM_ELEMENTS, 0.0f) &&
+              check_relative("q", q, expected_q, NUM_ELEMENTS, 0.0f);
+
+    free(data);
+
+    psl_kernel_destroy(kernel);
+
+    return success;
+}
+
+bool test_unroll(void)
+{
+    Vector* tokens = vector_new(128, sizeof(PSL_Token));
+
+    PSL_AST* ast = parse_source("main unrolled(f32 x, f64 y, uniform f32 k, export f32 a, export f32 b, reduce(sum) f32 total,"
+                                "             reduce(max) f64 peak)"
+                                "{ p = x * k + y * 0.5; a = f32(p * p - x); b = sin(x) * 0.5 + 0.5; total = a; peak = p; }",
+                                tokens);
+
+    if(ast == NULL)
+    {
+        vector_free(tokens);
+        return false;
+    }
+
+    /* Any number of groups per iteration gives the same bits, reductions included */
+    const PSL_ColumnStorage storage = { "b", PSL_ColumnFormat_Unorm8 };
+
+    float* x = (float*)malloc(NUM_ELEMENTS * sizeof(float));
+    double* y = (double*)malloc(NUM_ELEMENTS * sizeof(double));
+    float* a = (float*)malloc(2 * NUM_ELEMENTS * sizeof(float));
+    uint8_t* b = (uint8_t*)malloc(2 * NUM_ELEMENTS);
+
+    float k = 1.25f;
+    float totals[2];
+    double peaks[2];
+
+    for(size_t i = 0; i < NUM_ELEMENTS; i++)
+    {
+        x[i] = (float)i * 0.013f - 6.0f;
+        y[i] = (double)(i % 23) * 0.11;
+    }
+
+    bool success = true;
+
+    for(uint32_t unroll = 1; success && unroll <= PSL_CODEGEN_MAX_UNROLL; unroll++)
+    {
+        PSL_CompileOptions options;
+        psl_compile_options_init(&options);
+        options.column_formats = &storage;
+        options.num_column_formats = 1;
+        options.unroll = unroll;
+
+        PSL_Kernel* kernel = psl_kernel_new();
+
+        if(!psl_kernel_compile(kernel, ast, NULL, &options))
+        {
+            logger_log_error("Error during compilation: %s", kernel->error);
+            psl_kernel_destroy(kernel);
+            success = false;
+            break;
+        }
+
+        const size_t run = unroll == 1 ? 0 : 1;
+
+        void* columns[6] = { x, y, a + run * NUM_ELEMENTS, b + run * NUM_ELEMENTS, &totals[run], &peaks[run] };
+        void* uniforms[1] = { &k };
+
+        PSL_Bindings bindings;
+        bindings.columns = columns;
+        bindings.uniforms = uniforms;
+
+        psl_kernel_execute(kernel, &bindings, NUM_ELEMENTS);
+        psl_kernel_destroy(kernel);
+
+        if(run == 0)
+        {
+            continue;
+        }
+
+        if(memcmp(a, a + NUM_ELEMENTS, NUM_ELEMENTS * sizeof(float)) != 0 ||
+           memcmp(b, b + NUM_ELEMENTS, NUM_ELEMENTS) != 0 ||
+           memcmp(&totals[0], &totals[1], sizeof(float)) != 0 ||
+           memcmp(&peaks[0], &peaks[1], sizeof(double)) != 0)
+        {
+            logger_log_error("Results with %u groups per iteration differ from the ones with 1", unroll);
+            success = false;
+        }
+    }
+
+    free(b);
+    free(a);
+    free(y);
+    free(x);
+    psl_ast_destroy(ast);
+    vector_free(tokens);
+
+    return success;
+}
+
+bool test_opt_levels(void)
+{
+    Vector* tokens = vector_new(128, sizeof(PSL_Token));
+
+    /* Constants to fold, a repeated subexpression, a widened literal, a narrowed one and a call */
+    PSL_AST* ast = parse_source("f32 wave(f32 v, f32 k) { return sin(v * k) * (0.5 * 2.0); }"
+                                "main levels(f32 x, f64 y, uniform f32 k, export f32 a, export f64 b, export f32 c, reduce(sum) f64 total)"
+                                "{ a = wave(x, k) + (x * k) * (x * k); b = y * x + 0.1; c = f32(f64(f32(0.1)) * 100000000.0 - 10000000.0) + x; total = b; }",
+                                tokens);
+
+    if(ast == NULL)
+    {
+        vector_free(tokens);
+        return false;
+    }
+
+    float* x = (float*)malloc(NUM_ELEMENTS * sizeof(float));
+    double* y = (double*)malloc(NUM_ELEMENTS * sizeof(double));
+    float* a = (float*)malloc(2 * NUM_ELEMENTS * sizeof(float));
+    double* b = (double*)malloc(2 * NUM_ELEMENTS * sizeof(double));
+    float* c = (float*)malloc(2 * NUM_ELEMENTS * sizeof(float));
+
+    float k = 0.75f;
+    double totals[2];
+
+    for(size_t i = 0; i < NUM_ELEMENTS; i++)
+    {
+        x[i] = (float)i * 0.011f - 5.0f;
+        y[i] = (double)(i % 17) * 0.3;
+    }
+
+    bool success = true;
+    uint32_t num_insts[3] = { 0, 0, 0 };
+
+    /* Level 2 runs first, the others must give the same bits */
+    for(int level = PSL_OptLevel_2; success && level >= PSL_OptLevel_0; level--)
+    {
+        PSL_CompileOptions options;
+        psl_compile_options_init(&options);
+        options.opt_level = (PSL_OptLevel)level;
+
+        PSL_Kernel* kernel = psl_kernel_new();
+
+        if(!psl_kernel_compile(kernel, ast, NULL, &options))
+        {
+            logger_log_error("Error during compilation at level %d: %s", level, kernel->error);
+            psl_kernel_destroy(kernel);
+            success = false;
+            break;
+        }
+
+        num_insts[level] = kernel->ir.num_insts;
+
+        if(kernel->codegen.unroll != (level == PSL_OptLevel_2 ? 0u : 1u))
+        {
+            logger_log_error("Level %d emits %u groups per iteration", level, kernel->codegen.unroll);
+            success = false;
+        }
+
+        const size_t run = level == PSL_OptLevel_2 ? 0 : 1;
+
+        void* columns[6] = { x, y, a + run * NUM_ELEMENTS, b + run * NUM_ELEMENTS, c + run * NUM_ELEMENTS, &totals[run] };
+        void* uniforms[1] = { &k };
+
+        PSL_Bindings bindings;
+        bindings.columns = columns;
+        bindings.uniforms = uniforms;
+
+        psl_kernel_execute(kernel, &bindings, NUM_ELEMENTS);
+        psl_kernel_destroy(kernel);
+
+        if(run == 0)
+        {
+            /* The narrowed literal is widened from its f32 value, whether it is folded or not */
+            const float narrowed = (float)((double)0.1f * 1e8 - 1e7);
+
+            for(size_t i = 0; i < NUM_ELEMENTS && success; i++)
+            {
+                if(c[i] != narrowed + x[i])
+                {
+                    logger_log_error("Element %zu of the narrowed literal is %f, expected %f", i, c[i], narrowed + x[i]);
+                    success = false;
+                }
+            }
+
+            continue;
+        }
+
+        if(memcmp(a, a + NUM_ELEMENTS, NUM_ELEMENTS * sizeof(float)) != 0 ||
+           memcmp(b, b + NUM_ELEMENTS, NUM_ELEMENTS * sizeof(double)) != 0 ||
+           memcmp(c, c + NUM_ELEMENTS, NUM_ELEMENTS * sizeof(float)) != 0 ||
+           memcmp(&totals[0], &totals[1], sizeof(double)) != 0)
+        {
+            logger_log_error("Results at level %d differ from the ones at level 2", level);
+            success = false;
+        }
+    }
+
+    if(success && !(num_insts[PSL_OptLevel_0] > num_insts[PSL_OptLevel_1] && num_insts[PSL_OptLevel_1] > num_insts[PSL_OptLevel_2]))
+    {
+        logger_log_error("Levels 0, 1 and 2 leave %u, %u and %u instructions",
+                         num_insts[PSL_OptLevel_0], num_insts[PSL_OptLevel_1], num_insts[PSL_OptLevel_2]);
+        success = false;
+    }
+
+    free(c);
+    free(b);
+    free(a);
+    free(y);
+    free(x);
+    psl_ast_destroy(ast);
+    vector_free(tokens);
+
+    return success;
+}
+
+bool test_streaming(void)
+{
+    PSL_Kernel* kernel = compile_source("main stream(f32 x, f64 y, export f32 a, export f64 b, reduce(sum) f64 total)"
+                                        "{ a = x * 2.0 + 1.0; b = y * x; total = b; }");
+
+    if(kernel == NULL)
+    {
+        return false;
+    }
+
+    bool success = true;
+
+    /* Non-temporal stores need exports aligned on 32 bytes, the last run is misaligned and falls back */
+    uint8_t* data = (uint8_t*)malloc(NUM_ELEMENTS * (4 + 8 + 3 * 4 + 3 * 8) + 64);
+    uint8_t* aligned = data + (32 - (uintptr_t)data % 32);
+
+    double* y = (double*)aligned;
+    double* b = y + NUM_ELEMENTS;
+    float* x = (float*)(b + 3 * NUM_ELEMENTS);
+    float* a = x + NUM_ELEMENTS;
+
+    for(size_t i = 0; i < NUM_ELEMENTS; i++)
+    {
+        x[i] = (float)i * 0.25f - 100.0f;
+        y[i] = (double)(i % 7) * 1.5;
+    }
+
+    double totals[3];
+
+    for(size_t run = 0; run < 3; run++)
+    {
+        PSL_ExecuteOptions options;
+        psl_execute_options_init(&options);
+
+        if(run > 0)
+        {
+            options.streaming_threshold = 1;
+            options.prefetch_distance = 256;
+        }
+
+        const size_t offset = run == 2 ? 1 : 0;
+
+        void* columns[5] = { x, y, a + run * NUM_ELEMENTS + offset, b + run * NUM_ELEMENTS + offset, &totals[run] };
+
+        PSL_Bindings bindings;
+        bindings.columns = columns;
+        bindings.uniforms = NULL;
+
+        psl_kernel_execute_with_options(kernel, &bindings, NUM_ELEMENTS - offset, &options);
+    }
+
+    for(size_t run = 1; success && run < 3; run++)
+    {
+        const size_t offset = run == 2 ? 1 : 0;
+
+        if(memcmp(a, a + run * NUM_ELEMENTS + offset, (NUM_ELEMENTS - offset) * sizeof(float)) != 0 ||
+           memcmp(b, b + run * NUM_ELEMENTS + offset, (NUM_ELEMENTS - offset) * sizeof(double)) != 0)
+        {
+            logger_log_error("Exports of the streaming run %zu differ from the regular ones", run);
+            success = false;
+        }
+    }
+
+    if(totals[0] != totals[1])
+    {
+        logger_log_error("total = %f with streaming, expected %f", totals[1], totals[0]);
+        success = false;
+    }
+
+    free(data);
+
+    psl_kernel_destroy(kernel);
+
+    return success;
+}
+
+#if !defined(PSL_WIN)
+#define NUM_VARIANT_THREADS 8
+
+typedef struct {
+    PSL_Kernel* kernel;
+    uint32_t thread;
+    volatile bool* start;
+} VariantThread;
+
+/* Each thread looks up variants other threads are compiling at the same time */
+void* variant_thread(void* data)
+{
+    VariantThread* thread = (VariantThread*)data;
+
+    float x[64];
+    float a[64];
+    float c[64];
+
+    for(uint32_t i = 0; i < 64; i++)
+    {
+        x[i] = (float)i;
+    }
+
+    void* columns[3] = { x, a, c };
+
+    PSL_Bindings bindings;
+    bindings.columns = columns;
+    bindings.uniforms = NULL;
+
+    while(!*thread->start)
+    {
+    }
+
+    for(uint32_t i = 0; i < 16; i++)
+    {
+        PSL_ExecuteOptions options;
+        psl_execute_options_init(&options);
+        options.prefetch_distance = 64 * ((thread->thread + i) % 3);
+
+        psl_kernel_variant(thread->kernel, (uint64_t)1 << (1 + (thread->thread + i) % 2));
+        psl_kernel_execute_with_options(thread->kernel, &bindings, 64, &options);
+    }
+
+    return NULL;
+}
+
+/* Variants compiled concurrently are published once, psl_kernel_prepare compiles them ahead */
+bool test_concurrent_variants(void)
+{
+    PSL_Kernel* kernel = compile_source("main pair(f32 x, export f32 a, export f32 c) { a = x * 2.0; c = x + 1.0; }");
+
+    if(kernel == NULL)
+    {
+        return false;
+    }
+
+    bool success = true;
+
+    volatile bool start = false;
+
+    pthread_t threads[NUM_VARIANT_THREADS];
+    VariantThread data[NUM_VARIANT_THREADS];
+
+    for(uint32_t i = 0; i < NUM_VARIANT_THREADS; i++)
+    {
+        data[i].kernel = kernel;
+        data[i].thread = i;
+        data[i].start = &start;
+
+        pthread_create(&threads[i], NULL, variant_thread, &data[i]);
+    }
+
+    start = true;
+
+    for(uint32_t i = 0; i < NUM_VARIANT_THREADS; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    /* Two export variants and two prefetch distances */
+    uint32_t num_variants = 0;
+
+    for(PSL_Kernel* variant = kernel->variants; variant != NULL; variant = variant->variants)
+    {
+        num_variants++;
+    }
+
+    if(num_variants != 4)
+    {
+        logger_log_error("%u variants published by concurrent executions, expected 4", num_variants);
+        success = false;
+    }
+
+    PSL_ExecuteOptions options;
+    psl_execute_options_init(&options);
+    options.prefetch_distance = 256;
+
+    if(!psl_kernel_prepare(kernel, &options) ||
+       kernel->variants == NULL ||
+       !kernel->variants->codegen.streaming ||
+       kernel->variants->codegen.prefetch_distance != 256 ||
+       kernel->variants->variants->codegen.prefetch_distance != 256)
+    {
+        logger_log_error("The variants of the execute options have not been prepared");
+        success = false;
+    }
+
+    psl_kernel_destroy(kernel);
+
+    return success;
+}
+#endif /* !defined(PSL_WIN) */
+
+bool test_vectors(void)
+{
+    FileContent content;
+    Vector* tokens = vector_new(128, sizeof(PSL_Token));
+
+    PSL_AST* ast = parse_file(TESTS_DATA_DIR"/vectors.psl", &content, tokens);
+
+    if(ast == NULL)
+    {
+        vector_free(tokens);
+        return false;
+    }
+
+    PSL_Kernel* kernel = psl_kernel_new();
+
+    bool success = psl_kernel_compile(kernel, ast, NULL, NULL);
+
+    if(!success)
+    {
+        logger_log_error("Error during compilation: %s", kernel->error);
+    }
+    else
+    {
+        psl_ir_print(&kernel->ir);
+
+        /* Every component of direction and normal is loaded from its own column, once */
+        uint32_t num_loads = 0;
+
+        for(uint32_t i = 0; i < kernel->ir.num_insts; i++)
+        {
+            num_loads += kernel->ir.insts[i].opcode == PSL_IROpcode_Load;
+        }
+
+        if(num_loads != 6)
+        {
+            logger_log_error("Vector inputs are loaded with %u instructions, expected 6", num_loads);
+            success = false;
+        }
+
+        float light[3] = { 0.48f, 0.6f, -0.64f };
+
+        /* direction, normal, reflected, uv, facing and side columns, then the expected exports */
+        float* data = (float*)malloc(24 * NUM_ELEMENTS * sizeof(float));
+        float* columns_data[15];
+        float* expected[9];
+
+        for(size_t i = 0; i < 15; i++)
+        {
+            columns_data[i] = data + i * NUM_ELEMENTS;
+        }
+
+        for(size_t i = 0; i < 9; i++)
+        {
+            expected[i] = data + (15 + i) * NUM_ELEMENTS;
+        }
+
+        float** direction = columns_data;
+        float** normal = columns_data + 3;
+
+        for(size_t i = 0; i < NUM_ELEMENTS; i++)
+        {
+            const float t = (float)i * 0.01f;
+
+            direction[0][i] = cosf(t);
+            direction[1][i] = sinf(t * 3.0f) - 0.5f;
+            direction[2][i] = 0.25f * t;
+            normal[0][i] = sinf(t) + 1.5f;
+            normal[1][i] = cosf(t * 0.5f);
+            normal[2][i] = (float)(i % 7) * 0.3f - 1.0f;
+
+            const float length = sqrtf(normal[0][i] * normal[0][i] + normal[1][i] * normal[1][i] + normal[2][i] * normal[2][i]);
+            const float inverse = 1.0f / length;
+            const float n[3] = { normal[0][i] * inverse, normal[1][i] * inverse, normal[2][i] * inverse };
+            const float d_dot_n = direction[0][i] * n[0] + direction[1][i] * n[1] + direction[2][i] * n[2];
+
+            for(size_t c = 0; c < 3; c++)
+            {
+                expected[c][i] = direction[c][i] - n[c] * (2.0f * d_dot_n);
+            }
+
+            expected[3][i] = atan2f(n[2], n[0]) * 0.1591f + 0.5f;
+            expected[4][i] = asinf(n[1]) * 0.3183f + 0.5f;
+            expected[5][i] = reference_saturate(n[0] * light[0] + n[1] * light[1] + n[2] * light[2]);
+            expected[6][i] = n[1] * light[2] - n[2] * light[1];
+            expected[7][i] = sqrtf(direction[0][i] * direction[0][i] + direction[1][i] * direction[1][i]);
+            expected[8][i] = n[0] * light[1] - n[1] * light[0];
+        }
+
+        void* columns[15];
+        void* uniforms[3] = { &light[0], &light[1], &light[2] };
+
+        for(size_t i = 0; i < 15; i++)
+        {
+            columns[i] = columns_data[i];
+        }
+
+        PSL_Bindings bindings;
+        bindings.columns = columns;
+        bindings.uniforms = uniforms;
+
+        psl_kernel_execute(kernel, &bindings, NUM_ELEMENTS);
+
+        const char* names[9] = { "reflected.x", "reflected.y", "reflected.z", "uv.x", "uv.y", "facing", "side.x", "side.y", "side.z" };
+
+        for(size_t i = 0; i < 9 && success; i++)
+        {
+            success = check_close(names[i], columns_data[6 + i], expected[i], NUM_ELEMENTS);
+        }
+
+        /* Fused with an entry point sharing the normal input, and reading the facing export */
+        Vector* shade_tokens = vector_new(128, sizeof(PSL_Token));
+        PSL_AST* shade_ast = parse_source("main shade(vec3 normal, f32 facing, export f32 lit) { lit = facing * normal.y; }",
+                                          shade_tokens);
+
+        PSL_EntryPoint entry_points[2];
+        entry_points[0].ast = ast;
+        entry_points[0].name = "vectors";
+        entry_points[1].ast = shade_ast;
+        entry_points[1].name = NULL;
+
+        PSL_Kernel* fused = psl_kernel_new();
+
+        if(success && (shade_ast == NULL || !psl_kernel_compile_fused(fused, entry_points, 2, NULL)))
+        {
+            logger_log_error("Error during compilation of the fused vectors: %s", fused->error);
+            success = false;
+        }
+
+        if(success)
+        {
+            float* lit = (float*)malloc(2 * NUM_ELEMENTS * sizeof(float));
+            float* expected_lit = lit + NUM_ELEMENTS;
+
+            for(size_t i = 0; i < NUM_ELEMENTS; i++)
+            {
+                expected_lit[i] = expected[5][i] * normal[1][i];
+            }
+
+            void* fused_columns[16];
+
+            for(size_t i = 0; i < 15; i++)
+            {
+                fused_columns[i] = columns_data[i];
+            }
+
+            fused_columns[15] = lit;
+            bindings.columns = fused_columns;
+
+            psl_kernel_execute(fused, &bindings, NUM_ELEMENTS);
+
+            success = fused->ir.num_columns == 16 && check_close("lit", lit, expected_lit, NUM_ELEMENTS);
+
+            free(lit);
+        }
+
+        psl_kernel_destroy(fused);
+        psl_ast_destroy(shade_ast);
+        vector_free(shade_tokens);
+
+        free(data);
+    }
+
+    psl_kernel_destroy(kernel);
+    psl_ast_destroy(ast);
+    vector_free(tokens);
+    fs_file_content_free(&content);
+
+    /* Operands must have the same number of components unless one of them is a scalar */
+    const char* invalid_sources[3] = {
+        "main invalid(vec2 a, vec3 b, export vec3 c) { c = a + b; }",
+        "main invalid(vec2 a, export vec2 c) { c = cross(a, a); }",
+        "main invalid(vec3 a, export f32 c) { c = a.w; }",
+    };
+
+    for(uint32_t i = 0; i < 3 && success; i++)
+    {
+        tokens = vector_new(128, sizeof(PSL_Token));
+        ast = parse_source(invalid_sources[i], tokens);
+        kernel = psl_kernel_new();
+
+        if(ast == NULL || psl_kernel_compile(kernel, ast, NULL, NULL))
+        {
+            logger_log_error("Invalid vector operation has been compiled: %s", invalid_sources[i]);
+            success = false;
+        }
+
+        psl_kernel_destroy(kernel);
+        psl_ast_destroy(ast);
+        vector_free(tokens);
+    }
+
+    return success;
+}
+
+/* Enough nodes for the AST arena to grow several times, the nodes pushed before must stay valid */
+#define NUM_LARGE_STATEMENTS 100
+
+bool test_large_source(void)
+{
+    char* source = (char*)malloc(64 + NUM_LARGE_STATEMENTS * 16);
+    size_t length = (size_t)sprintf(source, "main large(f32 x, export f32 a) { t = x; ");
+
+    for(uint32_t i = 0; i < NUM_LARGE_STATEMENTS; i++)
+    {
+        length += (size_t)sprintf(source + length, "t = t + x; ");
+    }
+
+    sprintf(source + length, "a = t; }");
+
+    PSL_Kernel* kernel = compile_source(source);
+
+    if(kernel == NULL)
+    {
+        free(source);
+        return false;
+    }
+
+    float* data = (float*)malloc(3 * NUM_ELEMENTS * sizeof(float));
+    float* x = data;
+    float* a = data + NUM_ELEMENTS;
+    float* expected_a = data + 2 * NUM_ELEMENTS;
+
+    for(size_t i = 0; i < NUM_ELEMENTS; i++)
+    {
+        x[i] = (float)i * 0.01f - 3.0f;
+        expected_a[i] = x[i];
+
+        for(uint32_t j = 0; j < NUM_LARGE_STATEMENTS; j++)
+        {
+            expected_a[i] += x[i];
+        }
+    }
+
+    void* columns[2] = { x, a };
+
+    PSL_Bindings bindings;
+    bindings.columns = columns;
+    bindings.uniforms = NULL;
+
+    psl_kernel_execute(kernel, &bindings, NUM_ELEMENTS);
+
+    const bool success = check_close("a", a, expected_a, NUM_ELEMENTS);
+
+    free(data);
+
+    psl_kernel_destroy(kernel);
+    free(source);
+
+    return success;
+}
+
+int main(void)
+{
+    logger_init();
+
+    bool success = true;
+
+    success &= test_example();
+    success &= test_uniform();
+    success &= test_conditionals();
+    success &= test_precision();
+    success &= test_storage();
+    success &= test_reduction();
+    success &= test_fusion();
+    success &= test_variant();
+    success &= test_common_subexpressions();
+    success &= test_fast_math();
+    success &= test_unroll();
+    success &= test_opt_levels();
+    success &= test_streaming();
+#if !defined(PSL_WIN)
+    success &= test_concurrent_variants();
+#endif /* !defined(PSL_WIN) */
+    success &= test_vectors();
+    success &= test_large_source();
+
+    logger_release();
+
+    return success ? 0 : 1;
+}
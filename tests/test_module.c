@@ -0,0 +1,432 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#include "psl/module.h"
+#include "test_utils.h"
+
+#include "libromano/logger.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(PSL_WIN)
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif /* defined(PSL_WIN) */
+
+#define NUM_ELEMENTS 1003
+
+#define NUM_KERNELS 3
+
+/* Helpers in f32 and f64, reductions, a vector, and entry points to fuse */
+static const char* source = "main shade(vec3 n, f32 x, f64 y, uniform f32 s, export f32 a, export f64 b,\n"
+                            "           reduce(sum) f64 total, reduce(max) f32 peak)\n"
+                            "{ a = sin(x) * s + n.y;\n"
+                            "  b = pow(y, 2.0) + atan2(y, 1.0);\n"
+                            "  total = y;\n"
+                            "  peak = a; }\n"
+                            "main tone(f32 x, uniform f32 s, export f32 c) { c = x / (1.0 + s) > 0.5 ? sqrt(x) : x * x; }\n"
+                            "main grade(f32 c, export f32 g) { g = c * 2.0; }\n";
+
+typedef struct {
+    void* columns[16];
+    double uniforms[16];
+    void* uniform_pointers[16];
+} Data;
+
+/* Fills the columns of the inputs and the uniforms of the kernel with the same values every time */
+void data_init(Data* data, PSL_Kernel* kernel)
+{
+    for(uint32_t i = 0; i < kernel->ir.num_columns; i++)
+    {
+        data->columns[i] = calloc(NUM_ELEMENTS, sizeof(double));
+    }
+
+    for(uint32_t i = 0; i < kernel->ir.num_params; i++)
+    {
+        const PSL_IRParam* param = &kernel->ir.params[i];
+
+        if(param->kind == PSL_IRParamKind_Uniform)
+        {
+            if(param->type == PSL_IRType_F32)
+            {
+                const float value = 0.5f;
+                memcpy(&data->uniforms[param->index], &value, sizeof(float));
+            }
+            else
+            {
+                data->uniforms[param->index] = 0.5;
+            }
+
+            data->uniform_pointers[param->index] = &data->uniforms[param->index];
+        }
+        else if(param->kind == PSL_IRParamKind_Input)
+        {
+            for(uint32_t j = 0; j < NUM_ELEMENTS; j++)
+            {
+                const double value = (double)(j % 100) * 0.02 + (double)param->component;
+
+                if(param->format == PSL_ColumnFormat_F32)
+                {
+                    ((float*)data->columns[param->index])[j] = (float)value;
+                }
+                else
+                {
+                    ((double*)data->columns[param->index])[j] = value;
+                }
+            }
+        }
+    }
+}
+
+void data_release(Data* data, PSL_Kernel* kernel)
+{
+    for(uint32_t i = 0; i < kernel->ir.num_columns; i++)
+    {
+        free(data->columns[i]);
+    }
+}
+
+void data_execute(Data* data, PSL_Kernel* kernel)
+{
+    PSL_Bindings bindings;
+    bindings.columns = data->columns;
+    bindings.uniforms = data->uniform_pointers;
+
+    psl_kernel_reset_reductions(kernel, &bindings);
+    psl_kernel_execute(kernel, &bindings, NUM_ELEMENTS);
+}
+
+/* Kernels compiled from the module have the code and the results of the ones saved to it */
+bool compare_kernels(PSL_Kernel* saved, PSL_Kernel* loaded)
+{
+    if(strcmp(saved->name, loaded->name) != 0 ||
+       saved->code_size != loaded->code_size ||
+       memcmp(saved->code, loaded->code, saved->code_size) != 0 ||
+       saved->export_mask != loaded->export_mask)
+    {
+        logger_log_error("Kernel %s loaded from a module does not have the code it has been saved with", saved->name);
+        return false;
+    }
+
+    Data expected;
+    Data results;
+
+    data_init(&expected, saved);
+    data_init(&results, loaded);
+
+    data_execute(&expected, saved);
+    data_execute(&results, loaded);
+
+    bool success = true;
+
+    for(uint32_t i = 0; i < saved->ir.num_columns; i++)
+    {
+        success &= memcmp(expected.columns[i], results.columns[i], NUM_ELEMENTS * sizeof(double)) == 0;
+    }
+
+    if(!success)
+    {
+        logger_log_error("Kernel %s loaded from a module computes other results", saved->name);
+    }
+
+    data_release(&expected, saved);
+    data_release(&results, loaded);
+
+    return success;
+}
+
+bool test_round_trip(PSL_Kernel** kernels, const char* path)
+{
+    char* error = NULL;
+
+    if(!psl_module_save(kernels, NUM_KERNELS, path, &error))
+    {
+        logger_log_error("Cannot save the module: %s", error);
+        return false;
+    }
+
+    PSL_Module* module = psl_module_load(path, &error);
+
+    if(module == NULL || module->num_kernels != NUM_KERNELS)
+    {
+        logger_log_error("Cannot load the module: %s", error);
+        psl_module_destroy(module);
+        return false;
+    }
+
+    bool success = true;
+
+    for(uint32_t i = 0; i < NUM_KERNELS; i++)
+    {
+        PSL_Kernel* loaded = psl_kernel_new();
+
+        if(strcmp(psl_module_kernel_name(module, i), kernels[i]->name) != 0 ||
+           !psl_module_compile(module, loaded, kernels[i]->name))
+        {
+            logger_log_error("Cannot compile %s from the module: %s", kernels[i]->name, loaded->error);
+            success = false;
+        }
+        else
+        {
+            success &= compare_kernels(kernels[i], loaded);
+        }
+
+        /* Variants and parameter lookups work on the loaded IR */
+        if(success && i == 0 && (psl_ir_find_param(&loaded->ir, "peak", 4) == NULL ||
+                                 psl_kernel_variant(loaded, 1ull << psl_ir_find_param(&loaded->ir, "a", 1)->index) == NULL))
+        {
+            logger_log_error("The parameters of a kernel loaded from a module cannot be found");
+            success = false;
+        }
+
+        psl_kernel_destroy(loaded);
+    }
+
+    PSL_Kernel* kernel = psl_kernel_new();
+
+    if(psl_module_compile(module, kernel, "missing") || kernel->error == NULL)
+    {
+        logger_log_error("A missing kernel has been compiled from the module");
+        success = false;
+    }
+
+    psl_kernel_destroy(kernel);
+    psl_module_destroy(module);
+
+    return success;
+}
+
+/* Modules that are not the ones written are rejected without being compiled */
+bool test_invalid(const char* path)
+{
+    size_t size = 0;
+    uint8_t* data = read_file(path, &size);
+    uint8_t* copy = (uint8_t*)malloc(size + 8);
+
+    if(data == NULL)
+    {
+        logger_log_error("Cannot read the module");
+        free(copy);
+        return false;
+    }
+
+    const PSL_ModuleHeader* header = (const PSL_ModuleHeader*)data;
+    const PSL_ModuleKernel* kernels = (const PSL_ModuleKernel*)(data + sizeof(PSL_ModuleHeader));
+
+    PSL_ModuleInst* insts = (PSL_ModuleInst*)(copy + kernels[0].insts_offset);
+    PSL_ModuleKernel* kernel = (PSL_ModuleKernel*)(copy + sizeof(PSL_ModuleHeader));
+
+    uint32_t with_args = 0;
+    uint32_t load = 0;
+    uint32_t add = 0;
+    uint32_t store = 0;
+
+    for(uint32_t i = 0; i < kernels[0].num_insts; i++)
+    {
+        const PSL_ModuleInst* inst = (const PSL_ModuleInst*)(data + kernels[0].insts_offset) + i;
+
+        with_args = with_args == 0 && inst->num_args > 0 ? i : with_args;
+        load = inst->opcode == PSL_IROpcode_Load ? i : load;
+        add = inst->opcode == PSL_IROpcode_Add ? i : add;
+        store = inst->opcode == PSL_IROpcode_Store ? i : store;
+    }
+
+    /* The select of the conditional of tone */
+    PSL_ModuleInst* select = NULL;
+
+    for(uint32_t i = 0; i < kernels[1].num_insts; i++)
+    {
+        const PSL_ModuleInst* inst = (const PSL_ModuleInst*)(data + kernels[1].insts_offset) + i;
+        select = inst->opcode == PSL_IROpcode_Select ? (PSL_ModuleInst*)(copy + kernels[1].insts_offset) + i : select;
+    }
+
+    if(select == NULL)
+    {
+        logger_log_error("No select in the module");
+        free(copy);
+        free(data);
+        return false;
+    }
+
+    bool success = true;
+    char* error = NULL;
+
+    for(uint32_t test = 0; test < 13; test++)
+    {
+        memcpy(copy, data, size);
+
+        size_t copy_size = size;
+        const char* name = NULL;
+
+        switch(test)
+        {
+            case 0:
+                name = "magic";
+                copy[0] ^= 0xFF;
+                break;
+            case 1:
+                name = "version";
+                ((PSL_ModuleHeader*)copy)->version++;
+                break;
+            case 2:
+                name = "truncation";
+                copy_size -= 8;
+                break;
+            case 3:
+                name = "forward reference";
+                insts[with_args].args[0] = with_args;
+                break;
+            case 4:
+                name = "column";
+                insts[load].index = kernels[0].num_columns;
+                break;
+            case 5:
+                name = "opcode";
+                insts[0].opcode = PSL_IROpcode_Count;
+                break;
+            case 6:
+                name = "instructions";
+                kernel->num_insts = (uint32_t)(size / sizeof(PSL_ModuleInst));
+                break;
+            case 7:
+                name = "string table";
+                copy[size - 1] = 'x';
+                break;
+            case 8:
+                name = "alignment";
+                memmove(copy + 1, copy, size);
+                break;
+            case 9:
+                name = "operand type";
+                insts[add].type ^= 1;
+                break;
+            case 10:
+                name = "select mask";
+                select->args[0] = select->args[1];
+                break;
+            case 11:
+                name = "store type";
+                insts[store].type ^= 1;
+                break;
+            case 12:
+                name = "column count";
+                kernel->num_columns = 0xFFFFFFFF;
+                break;
+        }
+
+        PSL_Module* module = psl_module_from_memory(test == 8 ? copy + 1 : copy, copy_size, &error);
+
+        if(module != NULL)
+        {
+            logger_log_error("A module with an invalid %s has been loaded", name);
+            psl_module_destroy(module);
+            success = false;
+        }
+    }
+
+    memcpy(copy, data, size);
+
+    PSL_Module* module = psl_module_from_memory(copy, size, &error);
+
+    if(module == NULL || header->num_kernels != NUM_KERNELS)
+    {
+        logger_log_error("Cannot load a module from memory: %s", error);
+        success = false;
+    }
+
+    psl_module_destroy(module);
+
+    if(psl_module_load("/nonexistent/psl.pslm", &error) != NULL)
+    {
+        logger_log_error("A missing module has been loaded");
+        success = false;
+    }
+
+    PSL_Kernel* uncompiled = psl_kernel_new();
+
+    if(psl_module_save(&uncompiled, 1, path, &error))
+    {
+        logger_log_error("A kernel that has not been compiled has been saved");
+        success = false;
+    }
+
+    psl_kernel_destroy(uncompiled);
+
+    free(copy);
+    free(data);
+
+    return success;
+}
+
+int main(void)
+{
+    logger_init();
+
+    Vector* tokens = vector_new(128, sizeof(PSL_Token));
+
+    PSL_Lexer lexer;
+    psl_lexer_init(&lexer, source);
+
+    PSL_AST* ast = psl_ast_new();
+
+    if(!psl_lexer_lex(&lexer, tokens) || !psl_ast_from_tokens(ast, tokens))
+    {
+        logger_log_error("Cannot parse the source");
+        return 1;
+    }
+
+    PSL_CompileOptions options[NUM_KERNELS];
+
+    for(uint32_t i = 0; i < NUM_KERNELS; i++)
+    {
+        psl_compile_options_init(&options[i]);
+    }
+
+    options[1].fast_math = PSL_FastMath_All;
+    options[1].unroll = 2;
+    options[2].opt_level = PSL_OptLevel_1;
+
+    PSL_EntryPoint entry_points[2] = { { ast, "tone" }, { ast, "grade" } };
+
+    PSL_Kernel* kernels[NUM_KERNELS];
+    bool success = true;
+
+    for(uint32_t i = 0; i < NUM_KERNELS; i++)
+    {
+        kernels[i] = psl_kernel_new();
+
+        success &= i == 2 ? psl_kernel_compile_fused(kernels[i], entry_points, 2, &options[i]) :
+                            psl_kernel_compile(kernels[i], ast, i == 0 ? "shade" : "tone", &options[i]);
+    }
+
+    char path[128];
+    snprintf(path, sizeof(path), "psl-module-%d.pslm", (int)getpid());
+
+    if(!success)
+    {
+        logger_log_error("Cannot compile the kernels");
+    }
+    else
+    {
+        success &= test_round_trip(kernels, path);
+        success &= test_invalid(path);
+    }
+
+    remove(path);
+
+    for(uint32_t i = 0; i < NUM_KERNELS; i++)
+    {
+        psl_kernel_destroy(kernels[i]);
+    }
+
+    psl_ast_destroy(ast);
+    vector_free(tokens);
+
+    logger_release();
+
+    return success ? 0 : 1;
+}
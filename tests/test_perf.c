@@ -0,0 +1,184 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#include "psl/kernel.h"
+#include "psl/perf.h"
+#include "test_utils.h"
+
+#include "libromano/logger.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(PSL_LINUX)
+#include <unistd.h>
+
+/* Statements on lines 3 and 4, the function call is inlined with the line of its body */
+static const char* source = "f32 square(f32 v) { return v * v; }\n"
+                            "main shade(f32 x, uniform f32 s, export f32 a, export f32 b)\n"
+                            "{ a = square(x) * s;\n"
+                            "  b = x + 1.0; }\n";
+
+bool check_map(const char* path, PSL_Kernel* kernel)
+{
+    size_t size;
+    char* map = (char*)read_file(path, &size);
+
+    if(map == NULL)
+    {
+        logger_log_error("Cannot read %s", path);
+        return false;
+    }
+
+    char expected[128];
+    snprintf(expected, sizeof(expected), "%llx %zx psl::shade\n",
+             (unsigned long long)(uintptr_t)kernel->code,
+             kernel->code_size);
+
+    const bool found = strstr(map, expected) != NULL;
+
+    if(!found)
+    {
+        logger_log_error("Perf map does not describe the kernel: %s", map);
+    }
+
+    free(map);
+
+    return found;
+}
+
+bool check_dump(const char* path, PSL_Kernel* kernel)
+{
+    size_t size;
+    uint8_t* dump = read_file(path, &size);
+
+    if(dump == NULL || size < 40 || *(uint32_t*)dump != 0x4A695444)
+    {
+        logger_log_error("Malformed jitdump %s", path);
+        free(dump);
+        return false;
+    }
+
+    bool code_loaded = false;
+    bool lines[5] = { false, false, false, false, false };
+
+    /* Records follow the 40 bytes header: id, total size, timestamp, then their content */
+    for(size_t offset = *(uint32_t*)(dump + 8); offset + 16 <= size;)
+    {
+        const uint32_t id = *(uint32_t*)(dump + offset);
+        const uint32_t total_size = *(uint32_t*)(dump + offset + 4);
+
+        if(total_size < 16 || offset + total_size > size)
+        {
+            logger_log_error("Truncated jitdump record");
+            break;
+        }
+
+        if(id == 0)
+        {
+            const uint64_t code_addr = *(uint64_t*)(dump + offset + 32);
+            const uint64_t code_size = *(uint64_t*)(dump + offset + 40);
+            const char* name = (const char*)(dump + offset + 56);
+            const uint8_t* code = dump + offset + 56 + strlen(name) + 1;
+
+            code_loaded |= code_addr == (uintptr_t)kernel->code &&
+                           code_size == kernel->code_size &&
+                           strcmp(name, "psl::shade") == 0 &&
+                           memcmp(code, kernel->code, kernel->code_size) == 0;
+        }
+        else if(id == 2 && *(uint64_t*)(dump + offset + 16) == (uintptr_t)kernel->code)
+        {
+            const uint64_t num_entries = *(uint64_t*)(dump + offset + 24);
+            size_t entry = offset + 32;
+
+            for(uint64_t i = 0; i < num_entries; i++)
+            {
+                const uint64_t addr = *(uint64_t*)(dump + entry);
+                const int32_t line = *(int32_t*)(dump + entry + 8);
+                const char* file_name = (const char*)(dump + entry + 16);
+
+                if(line > 0 && line < 5 && strcmp(file_name, "shade.psl") == 0 &&
+                   addr >= (uintptr_t)kernel->code && addr < (uintptr_t)kernel->code + kernel->code_size)
+                {
+                    lines[line] = true;
+                }
+
+                entry += 16 + strlen(file_name) + 1;
+            }
+        }
+
+        offset += total_size;
+    }
+
+    free(dump);
+
+    if(!code_loaded)
+    {
+        logger_log_error("Jitdump does not hold the code of the kernel");
+        return false;
+    }
+
+    /* Inlined body of square, then the statements of shade */
+    if(!lines[1] || !lines[3] || !lines[4])
+    {
+        logger_log_error("Jitdump misses source lines: 1 %d, 3 %d, 4 %d", lines[1], lines[3], lines[4]);
+        return false;
+    }
+
+    return true;
+}
+
+bool test_perf_outputs(void)
+{
+    if(!psl_perf_enable(PSL_PerfOutput_Map | PSL_PerfOutput_JitDump))
+    {
+        logger_log_error("Cannot enable perf outputs");
+        return false;
+    }
+
+    PSL_Kernel* kernel = compile_source(source);
+
+    psl_perf_disable();
+
+    if(kernel == NULL)
+    {
+        return false;
+    }
+
+    char map_path[64];
+    char dump_path[64];
+    snprintf(map_path, sizeof(map_path), "/tmp/perf-%d.map", (int)getpid());
+    snprintf(dump_path, sizeof(dump_path), "/tmp/jit-%d.dump", (int)getpid());
+
+    bool success = check_map(map_path, kernel) && check_dump(dump_path, kernel);
+
+    if(psl_perf_outputs() != 0)
+    {
+        logger_log_error("Perf outputs are still enabled");
+        success = false;
+    }
+
+    remove(map_path);
+    remove(dump_path);
+
+    psl_kernel_destroy(kernel);
+
+    return success;
+}
+#endif /* defined(PSL_LINUX) */
+
+int main(void)
+{
+    logger_init();
+
+    bool success = true;
+
+#if defined(PSL_LINUX)
+    success &= test_perf_outputs();
+#endif /* defined(PSL_LINUX) */
+
+    logger_release();
+
+    return success ? 0 : 1;
+}
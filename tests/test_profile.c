@@ -0,0 +1,212 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#include "psl/kernel.h"
+#include "psl/profile.h"
+
+#include "libromano/logger.h"
+
+#include <string.h>
+
+static const char* source = "f32 square(f32 v) { return v * v; }\n"
+                            "main shade(f32 x, f32 y, uniform f32 s, export f32 a, export f32 b)\n"
+                            "{\n"
+                            "    a = square(x) * s + y;\n"
+                            "    b = x * 2.0 + 1.0;\n"
+                            "}\n";
+
+bool compile_source(PSL_Kernel* kernel, const char* source)
+{
+    Vector* tokens = vector_new(128, sizeof(PSL_Token));
+
+    PSL_Lexer lexer;
+    psl_lexer_init(&lexer, source);
+
+    PSL_AST* ast = psl_ast_new();
+
+    const bool success = psl_lexer_lex(&lexer, tokens) &&
+                         psl_ast_from_tokens(ast, tokens) &&
+                         psl_kernel_compile(kernel, ast, NULL, NULL);
+
+    if(!success)
+    {
+        logger_log_error("Cannot compile %s", source);
+    }
+
+    psl_ast_destroy(ast);
+    vector_free(tokens);
+
+    return success;
+}
+
+bool test_compile_stats(void)
+{
+    psl_profile_reset_totals();
+
+    PSL_CompileStats stats;
+    psl_profile_begin(&stats);
+
+    PSL_Kernel* kernel = psl_kernel_new();
+    bool success = compile_source(kernel, source);
+
+    /* Dropping an export compiles a variant, a second lookup finds it in the cache */
+    success = success && psl_kernel_variant(kernel, 1 << 3) != NULL;
+    success = success && psl_kernel_variant(kernel, 1 << 3) != NULL;
+
+    psl_profile_end();
+
+    if(!success)
+    {
+        psl_kernel_destroy(kernel);
+        return false;
+    }
+
+    const PSL_CompilePhase ran[] = {
+        PSL_CompilePhase_Lex,
+        PSL_CompilePhase_Parse,
+        PSL_CompilePhase_Lower,
+        PSL_CompilePhase_FoldConstants,
+        PSL_CompilePhase_CSE,
+        PSL_CompilePhase_DCE,
+        PSL_CompilePhase_SlotLayout,
+        PSL_CompilePhase_Encode,
+        PSL_CompilePhase_CacheLookup,
+    };
+
+    for(size_t i = 0; i < sizeof(ran) / sizeof(ran[0]); i++)
+    {
+        if(stats.phases[ran[i]].count == 0)
+        {
+            logger_log_error("Phase %s has not been recorded", psl_compile_phase_to_string(ran[i]));
+            success = false;
+        }
+    }
+
+    if(stats.phases[PSL_CompilePhase_FastMath].count != 0 || stats.phases[PSL_CompilePhase_Specialize].count != 0)
+    {
+        logger_log_error("Phases that did not run have been recorded");
+        success = false;
+    }
+
+    /* The kernel and its variant */
+    if(stats.phases[PSL_CompilePhase_Encode].count != 2 || stats.phases[PSL_CompilePhase_CacheLookup].count != 2)
+    {
+        logger_log_error("Encoded %llu times and looked up %llu variants, expected 2 and 2",
+                         (unsigned long long)stats.phases[PSL_CompilePhase_Encode].count,
+                         (unsigned long long)stats.phases[PSL_CompilePhase_CacheLookup].count);
+        success = false;
+    }
+
+    if(stats.code_size != kernel->code_size + kernel->variants->code_size)
+    {
+        logger_log_error("Code size is %llu, expected %zu",
+                         (unsigned long long)stats.code_size,
+                         kernel->code_size + kernel->variants->code_size);
+        success = false;
+    }
+
+    if(stats.num_tokens == 0 || stats.num_nodes == 0 || stats.arena_peak == 0 || stats.num_insts == 0)
+    {
+        logger_log_error("Missing counts");
+        success = false;
+    }
+
+    if(stats.phases[PSL_CompilePhase_Lower].bytes_allocated == 0 ||
+       stats.phases[PSL_CompilePhase_SlotLayout].bytes_allocated == 0 ||
+       stats.bytes_allocated < stats.phases[PSL_CompilePhase_Lower].bytes_allocated)
+    {
+        logger_log_error("Missing allocations");
+        success = false;
+    }
+
+    PSL_CompileStats totals;
+    psl_profile_get_totals(&totals);
+
+    if(totals.num_compilations != 1 || totals.code_size != stats.code_size)
+    {
+        logger_log_error("Totals do not match the recorded compilation");
+        success = false;
+    }
+
+    char json[4096];
+    const size_t length = psl_compile_stats_to_json(&stats, json, sizeof(json));
+
+    if(length != strlen(json) || json[0] != '{' || json[length - 1] != '}' || strstr(json, "\"cache_lookup\":{") == NULL)
+    {
+        logger_log_error("Malformed JSON: %s", json);
+        success = false;
+    }
+
+    /* Truncated output still reports the whole length */
+    char truncated[16];
+
+    if(psl_compile_stats_to_json(&stats, truncated, sizeof(truncated)) != length || strlen(truncated) != 15)
+    {
+        logger_log_error("Truncated JSON does not report the whole length");
+        success = false;
+    }
+
+    psl_kernel_destroy(kernel);
+
+    return success;
+}
+
+bool test_process_totals(void)
+{
+    PSL_CompileStats totals;
+    psl_profile_get_totals(&totals);
+
+    /* Without a recording, compilations are not accounted anywhere */
+    PSL_Kernel* kernel = psl_kernel_new();
+    bool success = compile_source(kernel, source);
+    psl_kernel_destroy(kernel);
+
+    PSL_CompileStats after;
+    psl_profile_get_totals(&after);
+
+    if(memcmp(&totals, &after, sizeof(PSL_CompileStats)) != 0)
+    {
+        logger_log_error("Compilation has been recorded without profiling");
+        success = false;
+    }
+
+    /* Recordings are accumulated process-wide */
+    for(uint32_t i = 0; success && i < 2; i++)
+    {
+        PSL_CompileStats stats;
+        psl_profile_begin(&stats);
+
+        kernel = psl_kernel_new();
+        success = compile_source(kernel, source);
+        psl_kernel_destroy(kernel);
+
+        psl_profile_end();
+    }
+
+    psl_profile_get_totals(&after);
+
+    if(success && after.num_compilations != totals.num_compilations + 2)
+    {
+        logger_log_error("Totals hold %llu compilations, expected %llu",
+                         (unsigned long long)after.num_compilations,
+                         (unsigned long long)totals.num_compilations + 2);
+        success = false;
+    }
+
+    return success;
+}
+
+int main(void)
+{
+    logger_init();
+
+    bool success = true;
+
+    success &= test_compile_stats();
+    success &= test_process_totals();
+
+    logger_release();
+
+    return success ? 0 : 1;
+}
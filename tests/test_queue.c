@@ -0,0 +1,222 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#include "psl/queue.h"
+#include "test_utils.h"
+
+#include "libromano/logger.h"
+
+#include <stdlib.h>
+
+#define NUM_SUBMISSIONS 200
+
+#define MAX_SUBMISSION_SIZE 256
+
+#define NUM_WORKERS 4
+
+void mark_completed(void* user_data)
+{
+    *(int*)user_data += 1;
+}
+
+bool test_small_submissions(void)
+{
+    PSL_Kernel* kernel = compile_source("main scale(f32 x, uniform f32 s, export f32 a) { a = x * s + 1.0; }");
+
+    if(kernel == NULL)
+    {
+        return false;
+    }
+
+    float* x[NUM_SUBMISSIONS];
+    float* a[NUM_SUBMISSIONS];
+    size_t counts[NUM_SUBMISSIONS];
+    int completed[NUM_SUBMISSIONS];
+
+    /* Submissions alternate uniforms every 50 of them, which splits the coalesced batches */
+    float scales[2] = { 2.0f, -0.5f };
+
+    PSL_Queue* queue = psl_queue_new(NUM_WORKERS);
+
+    for(size_t i = 0; i < NUM_SUBMISSIONS; i++)
+    {
+        counts[i] = 1 + (i * 37) % MAX_SUBMISSION_SIZE;
+        completed[i] = 0;
+        x[i] = (float*)malloc(counts[i] * sizeof(float));
+        a[i] = (float*)malloc(counts[i] * sizeof(float));
+
+        for(size_t j = 0; j < counts[i]; j++)
+        {
+            x[i][j] = (float)(i * 3 + j) * 0.25f;
+        }
+
+        void* columns[2] = { x[i], a[i] };
+        void* uniforms[1] = { &scales[(i / 50) % 2] };
+
+        /* The bindings arrays are copied, they can go out of scope before the execution */
+        PSL_Bindings bindings;
+        bindings.columns = columns;
+        bindings.uniforms = uniforms;
+
+        psl_kernel_submit(queue, kernel, &bindings, counts[i], mark_completed, &completed[i]);
+    }
+
+    psl_wait(queue, psl_queue_fence(queue));
+
+    bool success = true;
+
+    for(size_t i = 0; i < NUM_SUBMISSIONS && success; i++)
+    {
+        if(completed[i] != 1)
+        {
+            logger_log_error("Completion of submission %zu has been called %d times", i, completed[i]);
+            success = false;
+        }
+
+        for(size_t j = 0; j < counts[i] && success; j++)
+        {
+            const float expected = x[i][j] * scales[(i / 50) % 2] + 1.0f;
+
+            if(a[i][j] != expected)
+            {
+                logger_log_error("Element %zu of submission %zu is %f, expected %f", j, i, a[i][j], expected);
+                success = false;
+            }
+        }
+    }
+
+    psl_queue_destroy(queue);
+
+    for(size_t i = 0; i < NUM_SUBMISSIONS; i++)
+    {
+        free(a[i]);
+        free(x[i]);
+    }
+
+    psl_kernel_destroy(kernel);
+
+    return success;
+}
+
+bool test_reduction_submissions(void)
+{
+    PSL_Kernel* kernel = compile_source("main total(f32 x, reduce(sum) f32 s) { s = x; }");
+
+    if(kernel == NULL)
+    {
+        return false;
+    }
+
+    float x[MAX_SUBMISSION_SIZE];
+    float sums[8];
+
+    for(size_t i = 0; i < MAX_SUBMISSION_SIZE; i++)
+    {
+        x[i] = 1.0f;
+    }
+
+    /* Reductions are aggregated per submission, they are never coalesced */
+    PSL_Queue* queue = psl_queue_new(0);
+
+    PSL_Fence fence = 0;
+
+    for(size_t i = 0; i < 8; i++)
+    {
+        void* columns[2] = { x, &sums[i] };
+
+        PSL_Bindings bindings;
+        bindings.columns = columns;
+        bindings.uniforms = NULL;
+
+        fence = psl_kernel_submit(queue, kernel, &bindings, i + 1, NULL, NULL);
+    }
+
+    psl_wait(queue, fence);
+
+    bool success = true;
+
+    for(size_t i = 0; i < 8; i++)
+    {
+        if(sums[i] != (float)(i + 1))
+        {
+            logger_log_error("Reduction of submission %zu is %f, expected %f", i, sums[i], (float)(i + 1));
+            success = false;
+        }
+    }
+
+    psl_queue_destroy(queue);
+    psl_kernel_destroy(kernel);
+
+    return success;
+}
+
+bool test_chained_submissions(void)
+{
+    PSL_Kernel* kernel = compile_source("main increment(f32 x, export f32 y) { y = x + 1.0; }");
+
+    if(kernel == NULL)
+    {
+        return false;
+    }
+
+    /* Each chain writes b1 from b0, then b2 from b1: the second submission must see the first one */
+    float b0[NUM_SUBMISSIONS];
+    float b1[NUM_SUBMISSIONS];
+    float b2[NUM_SUBMISSIONS];
+
+    /* In order execution of the submissions needs a single worker */
+    PSL_Queue* queue = psl_queue_new(1);
+
+    for(size_t i = 0; i < NUM_SUBMISSIONS; i++)
+    {
+        b0[i] = (float)i;
+        b1[i] = 100.0f;
+        b2[i] = 0.0f;
+
+        void* first[2] = { &b0[i], &b1[i] };
+        void* second[2] = { &b1[i], &b2[i] };
+
+        PSL_Bindings bindings;
+        bindings.uniforms = NULL;
+
+        bindings.columns = first;
+        psl_kernel_submit(queue, kernel, &bindings, 1, NULL, NULL);
+
+        bindings.columns = second;
+        psl_kernel_submit(queue, kernel, &bindings, 1, NULL, NULL);
+    }
+
+    psl_wait(queue, psl_queue_fence(queue));
+
+    bool success = true;
+
+    for(size_t i = 0; i < NUM_SUBMISSIONS && success; i++)
+    {
+        if(b2[i] != (float)i + 2.0f)
+        {
+            logger_log_error("Chain %zu produced %f, expected %f", i, b2[i], (float)i + 2.0f);
+            success = false;
+        }
+    }
+
+    psl_queue_destroy(queue);
+    psl_kernel_destroy(kernel);
+
+    return success;
+}
+
+int main(void)
+{
+    logger_init();
+
+    bool success = true;
+
+    success &= test_small_submissions();
+    success &= test_reduction_submissions();
+    success &= test_chained_submissions();
+
+    logger_release();
+
+    return success ? 0 : 1;
+}
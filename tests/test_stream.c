@@ -0,0 +1,208 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#include "psl/stream.h"
+#include "test_utils.h"
+
+#include "libromano/logger.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_ELEMENTS 10003
+
+#define WINDOW_SIZE 1000
+
+bool write_file(const char* path, const void* header, size_t header_size, const void* data, size_t size)
+{
+    FILE* file = fopen(path, "wb");
+
+    if(file == NULL)
+    {
+        logger_log_error("Cannot create %s", path);
+        return false;
+    }
+
+    /* Raw layouts have no header */
+    const bool success = (header_size == 0 || fwrite(header, 1, header_size, file) == header_size) &&
+                         fwrite(data, 1, size, file) == size;
+
+    fclose(file);
+
+    return success;
+}
+
+bool test_execute_files(void)
+{
+    PSL_Kernel* kernel = compile_source("main bake(f32 x, f64 y, export f32 a, reduce(max) f64 peak, reduce(sum) f32 total)"
+                                        "{ a = x * 3.0 - 1.0; peak = y * x; total = a; }");
+
+    if(kernel == NULL)
+    {
+        return false;
+    }
+
+    float* x = (float*)malloc(NUM_ELEMENTS * sizeof(float));
+    double* y = (double*)malloc(NUM_ELEMENTS * sizeof(double));
+    float* a = (float*)malloc(NUM_ELEMENTS * sizeof(float));
+    float* streamed_a = (float*)malloc(NUM_ELEMENTS * sizeof(float));
+
+    for(size_t i = 0; i < NUM_ELEMENTS; i++)
+    {
+        x[i] = (float)(i % 101) * 0.5f - 20.0f;
+        y[i] = (double)(i % 13) * 0.25;
+    }
+
+    /* x is a raw column, y a container */
+    PSL_ColumnFileHeader header;
+    memset(&header, 0, sizeof(PSL_ColumnFileHeader));
+    memcpy(header.magic, PSL_COLUMN_FILE_MAGIC, sizeof(header.magic));
+    header.version = PSL_COLUMN_FILE_VERSION;
+    header.format = PSL_ColumnFormat_F64;
+    header.count = NUM_ELEMENTS;
+
+    bool success = write_file("stream_x.bin", NULL, 0, x, NUM_ELEMENTS * sizeof(float)) &&
+                   write_file("stream_y.bin", &header, sizeof(PSL_ColumnFileHeader), y, NUM_ELEMENTS * sizeof(double));
+
+    double peak;
+    float total;
+    double streamed_peak;
+    float streamed_total;
+
+    if(success)
+    {
+        void* columns[5] = { x, y, a, &peak, &total };
+
+        PSL_Bindings bindings;
+        bindings.columns = columns;
+        bindings.uniforms = NULL;
+
+        psl_kernel_execute(kernel, &bindings, NUM_ELEMENTS);
+
+        const char* paths[5] = { "stream_x.bin", "stream_y.bin", "stream_a.bin", NULL, NULL };
+        void* results[5] = { NULL, NULL, NULL, &streamed_peak, &streamed_total };
+
+        PSL_FileBindings files;
+        files.paths = paths;
+        files.bindings.columns = results;
+        files.bindings.uniforms = NULL;
+        files.export_layout = PSL_ColumnFileLayout_Container;
+
+        PSL_StreamOptions options;
+        psl_stream_options_init(&options);
+        options.window_size = WINDOW_SIZE;
+
+        success = psl_kernel_execute_files(kernel, &files, &options);
+
+        if(!success)
+        {
+            logger_log_error("Error during execution: %s", kernel->error);
+        }
+    }
+
+    if(success)
+    {
+        FILE* file = fopen("stream_a.bin", "rb");
+
+        success = file != NULL &&
+                  fread(&header, 1, sizeof(PSL_ColumnFileHeader), file) == sizeof(PSL_ColumnFileHeader) &&
+                  fread(streamed_a, sizeof(float), NUM_ELEMENTS, file) == NUM_ELEMENTS;
+
+        if(file != NULL)
+        {
+            fclose(file);
+        }
+
+        if(!success || header.format != PSL_ColumnFormat_F32 || header.count != NUM_ELEMENTS)
+        {
+            logger_log_error("Export column file is not a f32 container of %d elements", NUM_ELEMENTS);
+            success = false;
+        }
+    }
+
+    if(success && memcmp(a, streamed_a, NUM_ELEMENTS * sizeof(float)) != 0)
+    {
+        logger_log_error("Streamed export differs from the one computed in memory");
+        success = false;
+    }
+
+    /* Windows are combined one after the other, the order of the sum differs */
+    if(success && (peak != streamed_peak || fabsf(total - streamed_total) > 1e-5f * fabsf(total)))
+    {
+        logger_log_error("Streamed reductions are %f and %f, expected %f and %f", streamed_peak, streamed_total, peak, total);
+        success = false;
+    }
+
+    remove("stream_x.bin");
+    remove("stream_y.bin");
+    remove("stream_a.bin");
+
+    free(streamed_a);
+    free(a);
+    free(y);
+    free(x);
+    psl_kernel_destroy(kernel);
+
+    return success;
+}
+
+bool test_invalid_files(void)
+{
+    PSL_Kernel* kernel = compile_source("main copy(f32 x, f32 y, export f32 a) { a = x + y; }");
+
+    if(kernel == NULL)
+    {
+        return false;
+    }
+
+    const float values[3] = { 1.0f, 2.0f, 3.0f };
+
+    bool success = write_file("invalid_x.bin", NULL, 0, values, 3 * sizeof(float)) &&
+                   write_file("invalid_y.bin", NULL, 0, values, 2 * sizeof(float));
+
+    const char* paths[3] = { "invalid_x.bin", "invalid_y.bin", "invalid_a.bin" };
+
+    PSL_FileBindings files;
+    files.paths = paths;
+    files.bindings.columns = NULL;
+    files.bindings.uniforms = NULL;
+    files.export_layout = PSL_ColumnFileLayout_Raw;
+
+    if(success && psl_kernel_execute_files(kernel, &files, NULL))
+    {
+        logger_log_error("Input files of different counts have been accepted");
+        success = false;
+    }
+
+    paths[1] = "missing.bin";
+
+    if(success && psl_kernel_execute_files(kernel, &files, NULL))
+    {
+        logger_log_error("Missing input file has been accepted");
+        success = false;
+    }
+
+    remove("invalid_x.bin");
+    remove("invalid_y.bin");
+    remove("invalid_a.bin");
+
+    psl_kernel_destroy(kernel);
+
+    return success;
+}
+
+int main(void)
+{
+    logger_init();
+
+    bool success = true;
+
+    success &= test_execute_files();
+    success &= test_invalid_files();
+
+    logger_release();
+
+    return success ? 0 : 1;
+}
@@ -0,0 +1,143 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2025 - Present Romain Augier */
+/* All rights reserved. */
+
+#pragma once
+
+#if !defined(__PSL_TEST_UTILS)
+#define __PSL_TEST_UTILS
+
+/* Helpers shared by the tests, each test being a single translation unit including them once */
+
+#include "psl/kernel.h"
+
+#include "libromano/logger.h"
+#include "libromano/filesystem.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Lexes and parses source into a new AST, tokens must outlive it. Returns NULL on error */
+PSL_AST* parse_source(const char* source, Vector* tokens)
+{
+    PSL_Lexer lexer;
+    psl_lexer_init(&lexer, source);
+
+    if(!psl_lexer_lex(&lexer, tokens))
+    {
+        logger_log_error("Error during lexing: %s", psl_lexer_get_error(&lexer));
+        return NULL;
+    }
+
+    PSL_AST* ast = psl_ast_new();
+
+    if(!psl_ast_from_tokens(ast, tokens))
+    {
+        logger_log_error("Error during parsing: %s", ast->error);
+        psl_ast_destroy(ast);
+        return NULL;
+    }
+
+    return ast;
+}
+
+/* Parses the file at path, content must be freed once the AST is destroyed, unless NULL is returned */
+PSL_AST* parse_file(const char* path, FileContent* content, Vector* tokens)
+{
+    if(!fs_file_content_new(path, content))
+    {
+        logger_log_error("Cannot open %s file", path);
+        return NULL;
+    }
+
+    PSL_AST* ast = parse_source(content->content, tokens);
+
+    if(ast == NULL)
+    {
+        fs_file_content_free(content);
+    }
+
+    return ast;
+}
+
+/*
+   Compiles the main function entry_point of source (the first one if NULL) with options (the
+   default ones if NULL). Parameter names of the kernel point into source. Returns NULL on error
+*/
+PSL_Kernel* compile_entry_point(const char* source, const char* entry_point, const PSL_CompileOptions* options)
+{
+    Vector* tokens = vector_new(128, sizeof(PSL_Token));
+    PSL_AST* ast = parse_source(source, tokens);
+    PSL_Kernel* kernel = NULL;
+
+    if(ast != NULL)
+    {
+        kernel = psl_kernel_new();
+
+        if(!psl_kernel_compile(kernel, ast, entry_point, options))
+        {
+            logger_log_error("Error during compilation: %s", kernel->error);
+            psl_kernel_destroy(kernel);
+            kernel = NULL;
+        }
+    }
+
+    psl_ast_destroy(ast);
+    vector_free(tokens);
+
+    return kernel;
+}
+
+PSL_Kernel* compile_source_with_options(const char* source, const PSL_CompileOptions* options)
+{
+    return compile_entry_point(source, NULL, options);
+}
+
+PSL_Kernel* compile_source(const char* source)
+{
+    return compile_entry_point(source, NULL, NULL);
+}
+
+/* Compiles a main function of the file at path, content must be freed once the kernel is destroyed, unless NULL is returned */
+PSL_Kernel* compile_file(const char* path, const char* entry_point, const PSL_CompileOptions* options, FileContent* content)
+{
+    if(!fs_file_content_new(path, content))
+    {
+        logger_log_error("Cannot open %s file", path);
+        return NULL;
+    }
+
+    PSL_Kernel* kernel = compile_entry_point(content->content, entry_point, options);
+
+    if(kernel == NULL)
+    {
+        fs_file_content_free(content);
+    }
+
+    return kernel;
+}
+
+/* Returns the content of the file at path followed by a null terminator, NULL if it cannot be opened */
+uint8_t* read_file(const char* path, size_t* size)
+{
+    FILE* file = fopen(path, "rb");
+
+    if(file == NULL)
+    {
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    *size = (size_t)ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    uint8_t* data = (uint8_t*)malloc(*size + 1);
+    *size = fread(data, 1, *size, file);
+    data[*size] = 0;
+
+    fclose(file);
+
+    return data;
+}
+
+#endif /* !defined(__PSL_TEST_UTILS) */